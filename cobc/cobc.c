@@ -2740,6 +2740,8 @@ cobc_print_info (void)
 	cobc_var_print (_("indexed file handler"),		"EXTFH", 0);
 #elif defined	(WITH_DB)
 	cobc_var_print (_("indexed file handler"),		"BDB", 0);
+#elif defined	(WITH_LMDB)
+	cobc_var_print (_("indexed file handler"),		"LMDB", 0);
 #elif defined	(WITH_CISAM)
 	cobc_var_print (_("indexed file handler"),		"C-ISAM", 0);
 #elif defined	(WITH_DISAM)
@@ -2751,7 +2753,7 @@ cobc_print_info (void)
 	cobc_var_print (_("indexed file handler"),		"VBISAM", 0);
 #endif
 #else
-	cobc_var_print (_("indexed file handler"),		_("disabled"), 0);
+	cobc_var_print (_("indexed file handler"),		"built-in", 0);
 #endif
 
 #if defined(__MPIR_VERSION)
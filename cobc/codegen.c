@@ -239,6 +239,7 @@ static int			gen_if_level = 0;
 static int			gen_init_working = 0;	/* enable (0) / disable (1) use of DEPENDING ON fields */
 static int			need_plus_sign = 0;
 static int			odo_stop_now = 0;
+static int			search_lookup_used = 0;	/* a serial SEARCH has a lookup */
 static unsigned int		nolitcast = 0;
 
 static unsigned int		in_cond = 0;
@@ -3214,6 +3215,10 @@ output_long_integer (cb_tree x)
 			output (")");
 		} else {
 			output ("(");
+			/* native COMPUTE: operands may be of smaller type */
+			if (p->flag == BOP_RESOLVE_AS_S64) {
+				output ("(cob_s64_t)");
+			}
 			output_long_integer (p->x);
 			output (" %c ", p->op);
 			output_long_integer (p->y);
@@ -5885,6 +5890,79 @@ output_initialize (struct cb_initialize *p)
 
 /* SEARCH */
 
+/* whether changing 'x' may change a table that has a serial SEARCH
+   lookup: its storage is that of such a table, or may be an alias of it */
+static int
+search_lookup_receiver (cb_tree x)
+{
+	struct cb_field	*f;
+
+	if (!search_lookup_used) {
+		return 0;
+	}
+	if (CB_REFERENCE_P (x)) {
+		x = cb_ref (x);
+	}
+	if (!CB_FIELD_P (x)) {
+		return 1;
+	}
+	f = cb_field_storage_root (CB_FIELD (x));
+	return f->flag_search_lookup
+	    || f->flag_item_based || f->flag_external
+	    || f->storage == CB_STORAGE_LINKAGE;
+}
+
+/* whether statement 'p' may change a table that has a serial SEARCH
+   lookup; other changes are either done in statements that only change
+   their 'receivers', or in the loops of PERFORM VARYING and SEARCH,
+   or are done by called programs */
+static int
+search_lookup_statement (const struct cb_statement *p)
+{
+	cb_tree		l;
+
+	if (!search_lookup_used) {
+		return 0;
+	}
+	if (p->flag_receivers) {
+		for (l = p->receivers; l; l = CB_CHAIN (l)) {
+			if (search_lookup_receiver (CB_VALUE (l))) {
+				return 1;
+			}
+		}
+		return 0;
+	}
+	switch (p->statement) {
+	case STMT_IF:
+	case STMT_EVALUATE:
+	case STMT_DISPLAY:
+	case STMT_SEARCH:
+	case STMT_SEARCH_ALL:
+	case STMT_PERFORM:
+	case STMT_CONTINUE:
+	case STMT_GO_TO:
+	case STMT_EXIT:
+	case STMT_EXIT_PERFORM:
+	case STMT_EXIT_PERFORM_CYCLE:
+	case STMT_EXIT_PARAGRAPH:
+	case STMT_EXIT_SECTION:
+	case STMT_EXIT_PROGRAM:
+	case STMT_GOBACK:
+	case STMT_STOP_RUN:
+		return 0;
+	default:
+		return 1;
+	}
+}
+
+/* tell cob_search_index to check its indexes against the tables
+   again, as these may have been changed */
+static void
+output_search_index_changed (void)
+{
+	output_line ("cob_search_index_changed ();");
+}
+
 static void
 output_occurs (struct cb_field *p)
 {
@@ -5897,7 +5975,7 @@ output_occurs (struct cb_field *p)
 
 static void
 output_search_whens (cb_tree table, struct cb_field *p, cb_tree at_end,
-						cb_tree var, cb_tree whens)
+						cb_tree var, cb_tree whens, cb_tree lookup)
 {
 	cb_tree		l;
 	cb_tree		idx = NULL;
@@ -5929,6 +6007,42 @@ output_search_whens (cb_tree table, struct cb_field *p, cb_tree at_end,
 	output (";");
 	output_newline ();
 
+	/* Skip to the first position the WHEN may be true at, from
+	   cob_search_index ('lookup'), or past the end; if the WHEN
+	   is false there the entries after it are checked one by one */
+	if (lookup && var && var != idx) {
+		/* VARYING identifier is only changed with the index */
+		output_block_open ();
+		output_prefix ();
+		output ("const int next = ");
+		output_funcall (lookup);
+		output (";");
+		output_newline ();
+		output_prefix ();
+		output ("if (next != ");
+		output_integer (idx);
+		output (")");
+		output_newline ();
+		output_block_open ();
+		output_prefix ();
+		output_integer (idx);
+		output (" = next;");
+		output_newline ();
+		output_move (idx, var);
+		if (search_lookup_receiver (var)) {
+			output_search_index_changed ();
+		}
+		output_block_close ();
+		output_block_close ();
+	} else if (lookup) {
+		output_prefix ();
+		output_integer (idx);
+		output (" = ");
+		output_funcall (lookup);
+		output (";");
+		output_newline ();
+	}
+
 	/* Start loop */
 	last_line = -1; /* force statement reference output at begin of loop */
 	output_line ("for (;;)");
@@ -5973,6 +6087,9 @@ output_search_whens (cb_tree table, struct cb_field *p, cb_tree at_end,
 	output_newline ();
 	if (var && var != idx) {
 		output_move (idx, var);
+		if (search_lookup_receiver (var)) {
+			output_search_index_changed ();
+		}
 	}
 	/* End loop */
 	output_block_close ();
@@ -5980,6 +6097,57 @@ output_search_whens (cb_tree table, struct cb_field *p, cb_tree at_end,
 	output_block_close ();
 }
 
+/* generate code for SEARCH ALL on a single key, setting the index to
+   the position found by the binary search in cob_search_all ('lookup'),
+   then checking the WHEN condition only there;
+   not used when tracing all statements, which includes each probe */
+static void
+output_search_all_lookup (cb_tree table, struct cb_field *p, cb_tree at_end,
+			  cb_tree when_cond, cb_tree when_stmts, cb_tree lookup)
+{
+	cb_tree		idx;
+
+	idx = CB_VALUE (p->index_list);
+	output_block_open ();
+
+	/* single pass loop, WHEN and AT END end with "break" */
+	last_line = -1; /* force statement reference output at begin of loop */
+	output_line ("for (;;)");
+	output_block_open ();
+
+	output_source_reference (table, STMT_SEARCH_VARYING);
+	output_prefix ();
+	output_integer (idx);
+	output (" = ");
+	output_funcall (lookup);
+	output (";");
+	output_newline ();
+
+	/* WHEN test at the found position, which is 0 for an empty table */
+	output_source_reference (when_cond, STMT_WHEN);
+	output_prefix ();
+	output ("if (");
+	output_integer (idx);
+	output (" > 0 && (");
+	output_cond (when_cond, 0);
+	output ("))");
+	output_newline ();
+	output_block_open ();
+	output_stmt (when_stmts);
+	output_block_close ();
+	output_newline ();
+
+	if (at_end) {
+		output_source_reference (CB_PAIR_X (at_end), STMT_AT_END);
+		output_stmt (CB_PAIR_Y (at_end));	/* this is a CB_LIST ending with "break" */
+	} else {
+		output_source_reference (table, STMT_AT_END);
+		output_line ("break;");
+	}
+	output_block_close ();
+	output_block_close ();
+}
+
 /* generate code for SEARCH ALL,
    setup head (starting with 0) and tail (starting with max),
    using the mid as index, then compare,
@@ -6115,13 +6283,19 @@ output_search (struct cb_search *p)
 		}
 	}
 
-	if (p->flag_all) {
+	if (p->flag_all && p->lookup
+	 && !cb_flag_traceall && !cb_old_trace) {
+		output_search_all_lookup (p->table, fp, p->at_end,
+				   CB_IF (p->whens)->test, CB_IF (p->whens)->stmt1,
+				   p->lookup);
+	} else if (p->flag_all) {
 		/* note: no runtime check for index, because set by this code */
 		output_search_all (p->table, fp, p->at_end,
 				   CB_IF (p->whens)->test, CB_IF (p->whens)->stmt1);
 	} else {
 		/* note: no runtime check for index, because if too big -> AT END */
-		output_search_whens (p->table, fp, p->at_end, p->var, p->whens);
+		output_search_whens (p->table, fp, p->at_end, p->var, p->whens,
+			(cb_flag_traceall || cb_old_trace) ? NULL : p->lookup);
 	}
 }
 
@@ -7185,6 +7359,11 @@ output_call (struct cb_call *p)
 
 	output (");");
 	output_newline ();
+	/* the called program may have changed tables with SEARCH lookup,
+	   COBOL programs tell so on exit */
+	if (search_lookup_used) {
+		output_search_index_changed ();
+	}
 
 	if (except_id > 0) {
 		output_line ("if (unlikely((cob_glob_ptr->cob_exception_code & 0x%04x) == 0x%04x))",
@@ -7684,6 +7863,9 @@ output_perform_until (struct cb_perform *p, cb_tree l)
 	if (next && CB_PERFORM_VARYING (CB_VALUE (next))->name) {
 		output_move (CB_PERFORM_VARYING (CB_VALUE (next))->from,
 			     CB_PERFORM_VARYING (CB_VALUE (next))->name);
+		if (search_lookup_receiver (CB_PERFORM_VARYING (CB_VALUE (next))->name)) {
+			output_search_index_changed ();
+		}
 		/* DEBUG */
 		if (current_prog->flag_gen_debug) {
 			f = CB_FIELD (cb_ref (CB_PERFORM_VARYING (CB_VALUE (next))->name));
@@ -7734,6 +7916,9 @@ output_perform_until (struct cb_perform *p, cb_tree l)
 	if (v->step) {
 		output_source_reference (v->step, STMT_VARYING);
 		output_stmt (v->step);
+		if (v->name && search_lookup_receiver (v->name)) {
+			output_search_index_changed ();
+		}
 	}
 
 	output_block_close ();
@@ -7770,6 +7955,9 @@ output_perform (struct cb_perform *p)
 		v = CB_PERFORM_VARYING (CB_VALUE (p->varying));
 		if (v->name) {
 			output_move (v->from, v->name);
+			if (search_lookup_receiver (v->name)) {
+				output_search_index_changed ();
+			}
 			/* DEBUG */
 			if (current_prog->flag_gen_debug) {
 				f = CB_FIELD (cb_ref (v->name));
@@ -9105,6 +9293,10 @@ output_stmt (cb_tree x)
 			output_stmt (p->null_check);
 		}
 
+		if (search_lookup_statement (p)) {
+			output_search_index_changed ();
+		}
+
 		if (p->body) {
 			output_stmt (p->body);
 		}
@@ -13884,6 +14076,7 @@ codegen_init (struct cb_program *prog, const char *translate_name)
 	gen_native = 0;
 	gen_figurative = 0;
 	non_nested_count = 0;
+	search_lookup_used = 0;
 	working_mem = 0;
 	pic_cache = NULL;
 	base_cache = NULL;
@@ -13906,6 +14099,12 @@ codegen_init (struct cb_program *prog, const char *translate_name)
 			output_target = cp->local_include->local_fp;
 			output_header (timestamp_buffer, cp);
 		}
+		/* nested programs may change the tables of others */
+		for (cp = prog; cp; cp = cp->next_program) {
+			if (cp->flag_search_lookup) {
+				search_lookup_used = 1;
+			}
+		}
 	}
 	output_target = yyout;
 
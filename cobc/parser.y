@@ -16226,19 +16226,35 @@ end_pos_token:
 search_whens:
   search_when	%prec SHIFT_PREFER
   {
-	$$ = CB_LIST_INIT ($1);
+	$$ = $1;
   }
 | search_when search_whens
   {
-	$$ = cb_list_add ($2, $1);
+	$$ = cb_list_append ($2, $1);
   }
 ;
 
+/* list entry of the WHEN with the expression as purpose */
 search_when:
-  WHEN condition
+  WHEN search_condition
   statement_list
   {
-	$$ = cb_build_if_check_break ($2, $3);
+	$$ = cb_build_list (CB_PAIR_X ($2),
+		cb_build_if_check_break (CB_PAIR_Y ($2), $3), NULL);
+  }
+;
+
+/* pair of the expression and the condition built from it */
+search_condition:
+  expr
+  {
+	$$ = CB_BUILD_PAIR ($1, cb_build_cond ($1));
+	cb_end_cond (CB_PAIR_Y ($$));
+  }
+| error
+  {
+	$$ = CB_BUILD_PAIR (cb_error_node, cb_error_node);
+	cb_end_cond (cb_error_node);
   }
 ;
 
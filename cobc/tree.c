@@ -4195,6 +4195,20 @@ cb_field_founder (const struct cb_field * const f)
 	return (struct cb_field *)ff;
 }
 
+/* returns the record field (level 01) that holds the storage of 'f',
+   which is the redefined one for a record field with a REDEFINES */
+struct cb_field *
+cb_field_storage_root (const struct cb_field * const f)
+{
+	struct cb_field	*ff;
+
+	ff = cb_field_founder (f);
+	while (ff->redefines) {
+		ff = cb_field_founder (ff->redefines);
+	}
+	return ff;
+}
+
 /* returns the first field that has an ODO below 'f', if any
    note: per standard there would be only 0 or 1 of those, but mind
    the supported extensions that allow nested ODO as well as
@@ -4998,17 +5012,6 @@ finalize_file (struct cb_file *f, struct cb_field *records)
 		f->linage_ctr = cb_build_field_reference (CB_FIELD (x), NULL);
 		CB_FIELD_ADD (current_program->working_storage, CB_FIELD (x));
 	}
-
-#if	!defined (WITH_INDEX_EXTFH) && \
-	!defined (WITH_DB) && \
-	!defined (WITH_CISAM) && !defined(WITH_DISAM) && !defined(WITH_VBISAM)
-	if (f->organization == COB_ORG_INDEXED) {
-		char msg[80];
-		snprintf (msg, sizeof (msg), "ORGANIZATION INDEXED; FD %s", f->name);
-		cb_warning (cb_warn_unsupported,
-			_("runtime is not configured to support %s"), msg);
-	}
-#endif
 }
 
 /* Communication description */
@@ -1003,6 +1003,7 @@ struct cb_field {
 	unsigned int flag_internal_register	: 1;	/* Is an internally generated register */
 	unsigned int flag_picture_l : 1;	/* Is USAGE PICTURE L */
 	unsigned int flag_comp_1	: 1;	/* Is USAGE COMP-1 */
+	unsigned int flag_search_lookup	: 1;	/* storage of a table with serial SEARCH lookup */
 	unsigned int flag_is_verified	: 1;	/* Has been verified */
 
 	unsigned int flag_had_definition_note : 1;	/* had its defintion output */
@@ -1265,7 +1266,8 @@ enum cb_binary_op_op {
 
 enum cb_binary_op_flag {
 	BOP_RESOLVE_AS_INTEGER = 1,
-	BOP_OPERANDS_SWAPPED = 2
+	BOP_OPERANDS_SWAPPED = 2,
+	BOP_RESOLVE_AS_S64 = 3		/* native COMPUTE, in 64bit */
 };
 
 struct cb_binary_op {
@@ -1379,6 +1381,9 @@ struct cb_search {
 	cb_tree			at_end;		/* AT END (pair of position and statements) */
 	cb_tree			whens;		/* WHEN (conditions and statements)
 	       			      		   [for not SEARCH ALL: list of those] */
+	cb_tree			lookup;		/* SEARCH ALL: call of cob_search_all
+						   for a single key, SEARCH: call of
+						   cob_search_index, or NULL */
 	int			flag_all;	/* SEARCH ALL */
 };
 
@@ -1534,12 +1539,14 @@ struct cb_statement {
 	cb_tree			null_check;		/* NULL check */
 	cb_tree			debug_check;		/* Field DEBUG */
 	cb_tree			debug_nodups;		/* Field DEBUG dups */
+	cb_tree			receivers;		/* Changed fields, if flag_receivers */
 	struct cb_attr_struct	*attr_ptr;		/* Attributes */
 	enum cb_handler_type	handler_type;		/* Handler type */
 	unsigned int		flag_no_based	: 1;	/* Check BASED */
 	unsigned int		flag_in_debug	: 1;	/* In DEBUGGING */
 	unsigned int		flag_callback	: 1;	/* DEBUG Callback */
 	unsigned int		flag_implicit	: 1;	/* Is an implicit statement */
+	unsigned int		flag_receivers	: 1;	/* Changes only 'receivers' */
 };
 
 #define CB_STATEMENT(x)		(CB_TREE_CAST (CB_TAG_STATEMENT, struct cb_statement, x))
@@ -1951,6 +1958,7 @@ struct cb_program {
 	unsigned int	flag_void		: 1;	/* void return for subprogram */
 	unsigned int	flag_decimal_comp	: 1;	/* program group has decimal computations */
 	unsigned int	flag_prototype		: 1;	/* Is a prototype */
+	unsigned int	flag_search_lookup	: 1;	/* Has serial SEARCH lookup */
 };
 
 #define CB_PROGRAM(x)	(CB_TREE_CAST (CB_TAG_PROGRAM, struct cb_program, x))
@@ -2142,6 +2150,7 @@ extern struct cb_field		*cb_field_add (struct cb_field *,
 extern int				cb_field_size (const cb_tree x);
 #define FIELD_SIZE_UNKNOWN -1
 extern struct cb_field		*cb_field_founder (const struct cb_field * const);
+extern struct cb_field		*cb_field_storage_root (const struct cb_field * const);
 extern struct cb_field		*cb_field_variable_size (const struct cb_field *);
 #if 0	/* unused */
 extern unsigned int		cb_field_variable_address (const struct cb_field *);
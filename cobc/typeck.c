@@ -6523,6 +6523,272 @@ decimal_assign (cb_tree x, cb_tree d, cb_tree round_opt)
 				   build_store_option (x, round_opt)));
 }
 
+/* Native integer arithmetic: if the magnitude of all operands and of
+   every intermediate result of an expression is known to fit into a
+   signed 64-bit integer, the expression is generated as plain C integer
+   arithmetic; only the final value is passed into a decimal, so that
+   scale, rounding, truncation and SIZE ERROR handling is unchanged. */
+
+#define NATIVE_MAX_BITS	63
+
+/* number of bits needed for the given unsigned value */
+static int
+native_bits (cob_u64_t val)
+{
+	int	bits = 0;
+
+	while (val) {
+		bits++;
+		val >>= 1;
+	}
+	return bits;
+}
+
+static cob_u64_t
+native_pow10 (int n)
+{
+	cob_u64_t	val = 1;
+
+	while (n-- > 0) {
+		val *= 10;
+	}
+	return val;
+}
+
+/* binary operation of a native expression, computed in 64bit */
+static cb_tree
+native_binary_op (cb_tree x, const int op, cb_tree y)
+{
+	cb_tree		e = cb_build_binary_op (x, op, y);
+
+	if (CB_BINARY_OP_P (e)) {
+		CB_BINARY_OP (e)->flag = BOP_RESOLVE_AS_S64;
+	}
+	return e;
+}
+
+/* multiply native expression x by 10 ^ shift for scale alignment */
+static cb_tree
+native_shift (cb_tree x, int *bits, const int shift)
+{
+	cob_u64_t	val;
+	char		buff[24];
+
+	if (shift == 0) {
+		return x;
+	}
+	if (shift > 18) {
+		return NULL;
+	}
+	val = native_pow10 (shift);
+	*bits += native_bits (val);
+	if (*bits > NATIVE_MAX_BITS) {
+		return NULL;
+	}
+	sprintf (buff, CB_FMT_LLU, val);
+	return native_binary_op (x, '*', cb_build_numeric_literal (0, buff, 0));
+}
+
+static cb_tree
+native_combine (const int op, cb_tree x, int xbits, int xscale,
+		cb_tree y, int ybits, int yscale, int *bits, int *scale)
+{
+	switch (op) {
+	case '+':
+	case '-':
+		if (xscale < yscale) {
+			x = native_shift (x, &xbits, yscale - xscale);
+			xscale = yscale;
+		} else if (xscale > yscale) {
+			y = native_shift (y, &ybits, xscale - yscale);
+		}
+		*bits = (xbits > ybits ? xbits : ybits) + 1;
+		*scale = xscale;
+		break;
+	case '*':
+		*bits = xbits + ybits;
+		*scale = xscale + yscale;
+		break;
+	default:
+		return NULL;
+	}
+	if (x == NULL || y == NULL
+	 || *bits > NATIVE_MAX_BITS) {
+		return NULL;
+	}
+	return native_binary_op (x, op, y);
+}
+
+/* check if x can be computed natively; returns the (possibly rewritten)
+   expression with its maximum magnitude in bits and its implied scale,
+   or NULL if not */
+static cb_tree
+native_expand (cb_tree x, int *bits, int *scale)
+{
+	switch (CB_TREE_TAG (x)) {
+	case CB_TAG_CONST:
+		if (x != cb_zero) {
+			return NULL;
+		}
+		*bits = 0;
+		*scale = 0;
+		return x;
+	case CB_TAG_LITERAL: {
+		const struct cb_literal	*l = CB_LITERAL (x);
+		cob_u64_t	val = 0;
+		unsigned int	i;
+
+		if (CB_TREE_CATEGORY (x) != CB_CATEGORY_NUMERIC
+		 || l->all || l->llit
+		 || l->size == 0 || l->size > 18
+		 || l->scale < 0) {
+			return NULL;
+		}
+		for (i = 0; i < l->size; i++) {
+			if (!isdigit (l->data[i])) {
+				return NULL;
+			}
+			val = val * 10 + (l->data[i] - '0');
+		}
+		*bits = native_bits (val);
+		*scale = l->scale;
+		if (l->scale == 0) {
+			return x;
+		}
+		/* use the unscaled value, the scale is tracked separately */
+		return cb_build_numeric_literal (l->sign, l->data, 0);
+	}
+	case CB_TAG_REFERENCE: {
+		const struct cb_field	*f;
+
+		if (CB_REFERENCE (x)->offset
+		 || !CB_FIELD_P (cb_ref (x))) {
+			return NULL;
+		}
+		f = CB_FIELD_PTR (x);
+		if (!f->pic
+		 || f->pic->scale != 0
+		 || f->flag_any_numeric) {
+			return NULL;
+		}
+		switch (f->usage) {
+		case CB_USAGE_BINARY:
+		case CB_USAGE_COMP_5:
+		case CB_USAGE_COMP_X:
+		case CB_USAGE_COMP_N:
+			/* the storage may hold more than the PICTURE allows */
+			if (f->size < 1 || f->size > 8) {
+				return NULL;
+			}
+			*bits = f->size * 8 - (f->pic->have_sign ? 1 : 0);
+			break;
+		case CB_USAGE_DISPLAY:
+		case CB_USAGE_PACKED:
+		case CB_USAGE_COMP_6:
+			if (f->pic->digits < 1 || f->pic->digits > 18) {
+				return NULL;
+			}
+			/* one more bit as invalid data may contain "digits" > 9 */
+			*bits = native_bits (native_pow10 (f->pic->digits) - 1) + 1;
+			break;
+		default:
+			return NULL;
+		}
+		if (*bits > NATIVE_MAX_BITS) {
+			return NULL;
+		}
+		*scale = 0;
+		return x;
+	}
+	case CB_TAG_BINARY_OP: {
+		const struct cb_binary_op	*p = CB_BINARY_OP (x);
+		cb_tree		nx, ny;
+		int		xbits, xscale, ybits, yscale;
+
+		if (p->op != '+' && p->op != '-' && p->op != '*') {
+			return NULL;
+		}
+		nx = native_expand (p->x, &xbits, &xscale);
+		if (nx == NULL) {
+			return NULL;
+		}
+		ny = native_expand (p->y, &ybits, &yscale);
+		if (ny == NULL) {
+			return NULL;
+		}
+		if (nx == p->x && ny == p->y
+		 && xscale == 0 && yscale == 0) {
+			/* no scale alignment needed, just check the size */
+			if (p->op == '*') {
+				*bits = xbits + ybits;
+			} else {
+				*bits = (xbits > ybits ? xbits : ybits) + 1;
+			}
+			*scale = 0;
+			if (*bits > NATIVE_MAX_BITS) {
+				return NULL;
+			}
+			return native_binary_op (nx, p->op, ny);
+		}
+		return native_combine (p->op, nx, xbits, xscale,
+			ny, ybits, yscale, bits, scale);
+	}
+	default:
+		return NULL;
+	}
+}
+
+/* set decimal d to "var op val" (or only val if var is NULL)
+   computed in native integers; returns 0 if that is not possible,
+   with d being NULL only checks if that would be possible */
+static int
+decimal_expand_native (cb_tree d, cb_tree var, const int op, cb_tree val)
+{
+	cb_tree		x, v;
+	int		bits, scale, vbits, vscale;
+
+	if (cb_arithmetic_osvs
+	 || cb_flag_correct_numeric
+	 || CB_EXCEPTION_ENABLE (COB_EC_DATA_INCOMPATIBLE)
+	 || error_statement == current_statement) {
+		return 0;
+	}
+	if (var == NULL && !CB_BINARY_OP_P (val)) {
+		/* nothing to gain */
+		return 0;
+	}
+	x = native_expand (val, &bits, &scale);
+	if (x == NULL) {
+		return 0;
+	}
+	if (var) {
+		v = native_expand (var, &vbits, &vscale);
+		if (v == NULL) {
+			return 0;
+		}
+		x = native_combine (op, v, vbits, vscale, x, bits, scale,
+			&bits, &scale);
+		if (x == NULL) {
+			return 0;
+		}
+	}
+	if (x == cb_error_node) {
+		return 0;
+	}
+	if (d == NULL) {
+		/* check only */
+		return 1;
+	}
+	if (scale == 0) {
+		dpush (CB_BUILD_FUNCALL_2 ("cob_decimal_set_llint", d,
+			cb_build_cast_llint (x)));
+	} else {
+		dpush (CB_BUILD_FUNCALL_3 ("cob_decimal_set_llint_scaled", d,
+			cb_build_cast_llint (x), cb_int (scale)));
+	}
+	return 1;
+}
+
 static cb_tree
 cb_build_mul (cb_tree v, cb_tree n, cb_tree round_opt)
 {
@@ -6576,6 +6842,7 @@ build_decimal_assign (cb_tree vars, const int op, cb_tree val)
 	cb_tree	s1;
 	cb_tree	s2;
 	cb_tree	d;
+	int	need_d;
 
 	/* note: vars validated by caller: cb_emit_arithmetic */
 	if (cb_arithmetic_osvs) {
@@ -6599,8 +6866,21 @@ build_decimal_assign (cb_tree vars, const int op, cb_tree val)
 
 	d = decimal_alloc ();
 
-	/* Set d, VAL */
-	d = decimal_expand (d, val);
+	/* Set d, VAL - unless all results can be computed natively */
+	need_d = 1;
+	if (op == 0) {
+		need_d = !decimal_expand_native (d, NULL, 0, val);
+	} else {
+		for (l = vars; l; l = CB_CHAIN (l)) {
+			if (!decimal_expand_native (NULL, CB_VALUE (l), op, val)) {
+				break;
+			}
+		}
+		need_d = l != NULL;
+	}
+	if (need_d) {
+		d = decimal_expand (d, val);
+	}
 
 	s1 = NULL;
 	if (op == 0) {
@@ -6622,8 +6902,10 @@ build_decimal_assign (cb_tree vars, const int op, cb_tree val)
 			 * OP t, d
 			 * set VAR <- t, with appropriate rounding
 			 */
-			t = decimal_expand (t, CB_VALUE (l));
-			decimal_compute (op, t, d);
+			if (!decimal_expand_native (t, CB_VALUE (l), op, val)) {
+				t = decimal_expand (t, CB_VALUE (l));
+				decimal_compute (op, t, d);
+			}
 			decimal_assign (CB_VALUE (l), t, CB_PURPOSE (l));
 			s2 = cb_list_reverse (decimal_stack);
 			if (!s1) {
@@ -6678,6 +6960,27 @@ cb_emit_arithmetic (cb_tree vars, const int op, cb_tree val)
 		return;
 	}
 
+	/* arithmetic statements change their targets only,
+	   note: the list entries are replaced by the operations below */
+	switch (current_statement->statement) {
+	case STMT_ADD:
+	case STMT_SUBTRACT:
+	case STMT_MULTIPLY:
+	case STMT_DIVIDE:
+	case STMT_COMPUTE:
+		{
+			cb_tree	l;
+			for (l = vars; l; l = CB_CHAIN (l)) {
+				current_statement->receivers = cb_list_add (
+					current_statement->receivers, CB_VALUE (l));
+			}
+			current_statement->flag_receivers = 1;
+		}
+		break;
+	default:
+		break;
+	}
+
 	if (!CB_BINARY_OP_P (x)
 	 && (op == '+' || op == '-' || op == '*' || op == '/')) {
 		cb_tree l;
@@ -12587,6 +12890,81 @@ cb_build_move_literal (cb_tree src, cb_tree dst)
 	return CB_BUILD_FUNCALL_2 ("cob_move", src, dst);
 }
 
+/* MOVE between numeric DISPLAY and PACKED-DECIMAL / COMP-6 fields
+   of fixed layout: precompute the digit positions to transfer and
+   call the specialized entry points instead of cob_move;
+   returns NULL if the layout is not known at compile time */
+static cb_tree
+cb_build_move_display_bcd (cb_tree src, cb_tree dst)
+{
+	const struct cb_field	*src_f = CB_FIELD_PTR (src);
+	const struct cb_field	*dst_f = CB_FIELD_PTR (dst);
+	int	src_skip, dst_skip, count;
+
+	if (!CB_REFERENCE_P (src) || CB_REFERENCE (src)->offset
+	 || !CB_REFERENCE_P (dst) || CB_REFERENCE (dst)->offset
+	 || CB_TREE_CATEGORY (src) != CB_CATEGORY_NUMERIC
+	 || CB_TREE_CATEGORY (dst) != CB_CATEGORY_NUMERIC
+	 || src_f->flag_any_numeric || dst_f->flag_any_numeric
+	 || cb_field_variable_size (src_f)
+	 || cb_field_variable_size (dst_f)) {
+		return NULL;
+	}
+
+	if (src_f->usage == CB_USAGE_DISPLAY
+	 && (dst_f->usage == CB_USAGE_PACKED
+	  || dst_f->usage == CB_USAGE_COMP_6)) {
+		/* see cob_move_display_to_packed for the offset logic */
+		const int	src_digits = src_f->size
+			- ((src_f->pic->have_sign && src_f->flag_sign_separate) ? 1 : 0);
+		const int	dst_digits = 2 * dst_f->size
+			- (dst_f->usage == CB_USAGE_COMP_6 ? 0 : 1);
+		const int	src_offset = src_digits - src_f->pic->scale - 1;
+		const int	dst_offset = dst_digits - dst_f->pic->scale - 1;
+		src_skip = src_offset > dst_offset ? src_offset - dst_offset : 0;
+		dst_skip = dst_offset > src_offset ? dst_offset - src_offset : 0;
+		count = src_digits - src_skip < dst_digits - dst_skip
+			? src_digits - src_skip : dst_digits - dst_skip;
+		if (count <= 0) {
+			src_skip = dst_skip = count = 0;
+		}
+		return CB_BUILD_FUNCALL_5 ("cob_move_display_to_bcd", src, dst,
+			cb_int (src_skip), cb_int (dst_skip),
+			cb_int (count));
+	}
+
+	if ((src_f->usage == CB_USAGE_PACKED
+	  || src_f->usage == CB_USAGE_COMP_6)
+	 && dst_f->usage == CB_USAGE_DISPLAY
+	 && src_f->pic->scale >= 0) {
+		/* see cob_move_packed_to_display and store_common_region */
+		const int	src_pad = 2 * src_f->size
+			- (src_f->usage == CB_USAGE_COMP_6 ? 0 : 1)
+			- src_f->pic->digits;
+		const int	dst_digits = dst_f->size
+			- ((dst_f->pic->have_sign && dst_f->flag_sign_separate) ? 1 : 0);
+		const int	src_high = src_f->pic->digits - src_f->pic->scale;
+		const int	dst_high = dst_digits - dst_f->pic->scale;
+		const int	high = src_high < dst_high ? src_high : dst_high;
+		const int	low = src_f->pic->scale < dst_f->pic->scale
+			? -src_f->pic->scale : -dst_f->pic->scale;
+		if (src_pad < 0 || src_pad > 1) {
+			return NULL;
+		}
+		src_skip = src_pad + src_high - high;
+		dst_skip = dst_high - high;
+		count = high - low;
+		if (count <= 0) {
+			src_skip = dst_skip = count = 0;
+		}
+		return CB_BUILD_FUNCALL_5 ("cob_move_bcd_to_display", src, dst,
+			cb_int (src_skip), cb_int (dst_skip),
+			cb_int (count));
+	}
+
+	return NULL;
+}
+
 static cb_tree
 cb_build_move_field (cb_tree src, cb_tree dst)
 {
@@ -12669,6 +13047,29 @@ cb_build_move_field (cb_tree src, cb_tree dst)
 		 && dst_f->pic->scale >= 0) {
 			return CB_BUILD_FUNCALL_2 ("cob_move_bcd", src, dst);
 		}
+	} else {
+		cb_tree	x = cb_build_move_display_bcd (src, dst);
+		if (x) {
+			return x;
+		}
+	}
+
+	if (src_size > 0 && dst_size > 0 && src_size < dst_size
+	 && !cb_move_ibm
+	 && !cb_field_variable_size (src_f)
+	 && !cb_field_variable_size (dst_f)
+	 && dst_f->flag_justified == 0
+	 && (CB_TREE_CATEGORY (dst) == CB_CATEGORY_ALPHANUMERIC
+	  || (CB_TREE_CATEGORY (dst) == CB_CATEGORY_ALPHABETIC
+	   && CB_TREE_CATEGORY (src) == CB_CATEGORY_ALPHABETIC))
+	 && (CB_TREE_CATEGORY (src) == CB_CATEGORY_ALPHANUMERIC
+	  || CB_TREE_CATEGORY (src) == CB_CATEGORY_ALPHABETIC)) {
+		/* Move string with padding */
+		return CB_BUILD_FUNCALL_4 ("cob_move_pad",
+					   CB_BUILD_CAST_ADDRESS (dst),
+					   CB_BUILD_CAST_ADDRESS (src),
+					   CB_BUILD_CAST_LENGTH (dst),
+					   CB_BUILD_CAST_LENGTH (src));
 	}
 
 	return CB_BUILD_FUNCALL_2 ("cob_move", src, dst);
@@ -12884,6 +13285,12 @@ cb_emit_move (cb_tree src, cb_tree dsts)
 		return;
 	}
 
+	/* MOVE changes its targets only */
+	if (current_statement->statement == STMT_MOVE) {
+		current_statement->receivers = dsts;
+		current_statement->flag_receivers = 1;
+	}
+
 	/* validate / fix-up source, if requested */
 	cb_emit_incompat_data_checks (src);
 
@@ -13580,9 +13987,183 @@ cb_build_search_all (cb_tree table, cb_tree cond)
 	return cb_build_cond (c1);
 }
 
+/* whether the entries of table 'f' can be handled by a run-time lookup:
+   a single index and a fixed entry size */
+static int
+search_lookup_table (const struct cb_field *f)
+{
+	return f->indexes == 1 && f->index_list
+	    && !f->flag_unbounded && !cb_odoslide
+	    && !cb_field_variable_size (f);
+}
+
+/* the field of key reference 'x' within the entries of table 'f',
+   subscripted by 'idx' only; NULL if not usable for a lookup */
+static struct cb_field *
+search_lookup_key (cb_tree x, struct cb_field *f, cb_tree idx)
+{
+	struct cb_reference	*r;
+	struct cb_field		*kf;
+	struct cb_field		*p;
+
+	if (!CB_REFERENCE_P (x) || !CB_FIELD_P (cb_ref (x))) {
+		return NULL;
+	}
+	r = CB_REFERENCE (x);
+	if (r->offset || !r->subs || CB_CHAIN (r->subs)
+	 || !CB_REFERENCE_P (CB_VALUE (r->subs))
+	 || cb_ref (CB_VALUE (r->subs)) != cb_ref (idx)) {
+		return NULL;
+	}
+	kf = CB_FIELD (r->value);
+	if (kf->flag_any_length || kf->children) {
+		return NULL;
+	}
+	for (p = kf; p != f; p = p->parent) {
+		if (!p || p->flag_occurs) {
+			return NULL;
+		}
+	}
+	return kf;
+}
+
+/* whether 'x' is a value that doesn't change during the search of
+   table 'f' with 'var': a literal or a field without subscript or
+   reference-modification that is neither the search index nor in
+   a table */
+static int
+search_lookup_value (cb_tree x, struct cb_field *f, cb_tree var)
+{
+	struct cb_reference	*r;
+	cb_tree			l;
+	cb_tree			v;
+
+	if (CB_LITERAL_P (x)) {
+		return 1;
+	}
+	if (!CB_REFERENCE_P (x)) {
+		return 0;
+	}
+	r = CB_REFERENCE (x);
+	v = cb_ref (x);
+	if (r->subs || r->offset
+	 || !CB_FIELD_P (v)
+	 || CB_FIELD (v)->flag_any_length
+	 || CB_FIELD (v)->flag_occurs
+	 || (var && v == cb_ref (var))) {
+		return 0;
+	}
+	for (l = f->index_list; l; l = CB_CHAIN (l)) {
+		if (v == cb_ref (CB_VALUE (l))) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* SEARCH ALL on the first KEY only, compared to a value that doesn't
+   depend on the index: call of cob_search_all returning the position
+   to check the WHEN condition at; NULL if not possible */
+static cb_tree
+cb_build_search_all_lookup (cb_tree table, struct cb_field *f)
+{
+	const struct cb_key	*k = &f->keys[0];
+	struct cb_field		*kf;
+	int			i;
+
+	if (f->nkeys < 1 || !k->ref
+	 || !search_lookup_table (f)) {
+		return NULL;
+	}
+	for (i = 1; i < f->nkeys; i++) {
+		if (f->keys[i].ref) {
+			return NULL;
+		}
+	}
+	kf = search_lookup_key (k->ref, f, CB_VALUE (f->index_list));
+	if (!kf
+	 || !search_lookup_value (k->val, f, NULL)) {
+		return NULL;
+	}
+
+	/* the key is passed without subscript, as only its attributes are
+	   used, and the index is not set yet */
+	return CB_BUILD_FUNCALL_6 ("cob_search_all", table,
+		cb_build_field_reference (kf, NULL),
+		cb_int (kf->offset - f->offset),
+		f->depending ? cb_build_cast_int (f->depending)
+			     : cb_int (f->occurs_max),
+		k->val, cb_int (k->dir));
+}
+
+/* serial SEARCH with a single WHEN 'expr' comparing a key of the entry
+   for equality to a value that doesn't depend on the index: call of
+   cob_search_index returning the next position from the index 'idx'
+   on to check the WHEN condition at; NULL if not possible */
+static cb_tree
+cb_build_search_lookup (cb_tree table, struct cb_field *f, cb_tree var,
+			cb_tree expr)
+{
+	struct cb_binary_op	*p;
+	struct cb_field		*kf;
+	cb_tree			idx = NULL;
+	cb_tree			val;
+	cb_tree			l;
+
+	if (!search_lookup_table (f)
+	 || !CB_BINARY_OP_P (expr)
+	 || CB_BINARY_OP (expr)->op != '=') {
+		return NULL;
+	}
+
+	/* same index as used in output_search_whens */
+	if (var) {
+		for (l = f->index_list; l; l = CB_CHAIN (l)) {
+			if (cb_ref (CB_VALUE (l)) == cb_ref (var)) {
+				idx = var;
+			}
+		}
+	}
+	if (!idx) {
+		idx = CB_VALUE (f->index_list);
+	}
+
+	p = CB_BINARY_OP (expr);
+	kf = search_lookup_key (p->x, f, idx);
+	val = p->y;
+	if (!kf) {
+		kf = search_lookup_key (p->y, f, idx);
+		val = p->x;
+	}
+	if (!kf
+	 || !search_lookup_value (val, f, var)) {
+		return NULL;
+	}
+	/* the VARYING identifier is changed during the search */
+	if (var && var != idx && CB_FIELD_P (cb_ref (var))
+	 && cb_field_storage_root (CB_FIELD (cb_ref (var)))
+	    == cb_field_storage_root (f)) {
+		return NULL;
+	}
+
+	/* statements that may change this storage tell cob_search_index
+	   to check the index again, see output_search_index_changed */
+	cb_field_storage_root (f)->flag_search_lookup = 1;
+	current_program->flag_search_lookup = 1;
+
+	return CB_BUILD_FUNCALL_6 ("cob_search_index", table,
+		cb_build_field_reference (kf, NULL),
+		cb_int (kf->offset - f->offset),
+		f->depending ? cb_build_cast_int (f->depending)
+			     : cb_int (f->occurs_max),
+		cb_build_cast_int (idx), val);
+}
+
 cb_tree
 cb_emit_search (cb_tree table, cb_tree varying, cb_tree at_end, cb_tree whens)
 {
+	cb_tree		x;
+
 	if (cb_validate_one (table)
 	 || cb_validate_one (varying)
 	 || whens == cb_error_node) {
@@ -13592,7 +14173,12 @@ cb_emit_search (cb_tree table, cb_tree varying, cb_tree at_end, cb_tree whens)
 	if (at_end) {
 		cb_check_needs_break (CB_PAIR_Y (at_end));
 	}
-	return cb_emit (cb_build_search (0, table, varying, at_end, whens));
+	x = cb_build_search (0, table, varying, at_end, whens);
+	if (cb_flag_search_index && !CB_CHAIN (whens)) {
+		CB_SEARCH (x)->lookup = cb_build_search_lookup (table,
+			CB_FIELD_PTR (table), varying, CB_PURPOSE (whens));
+	}
+	return cb_emit (x);
 }
 
 cb_tree
@@ -13600,6 +14186,7 @@ cb_emit_search_all (cb_tree table, cb_tree at_end, cb_tree when, cb_tree stmts)
 {
 	cb_tree		x;
 	cb_tree		stmt_lis;
+	cb_tree		lookup;
 
 	if (cb_validate_one (table)
 	 || when == cb_error_node) {
@@ -13609,13 +14196,16 @@ cb_emit_search_all (cb_tree table, cb_tree at_end, cb_tree when, cb_tree stmts)
 	if (!x) {
 		return NULL;
 	}
+	lookup = cb_build_search_all_lookup (table, CB_FIELD_PTR (table));
 
 	stmt_lis = cb_check_needs_break (stmts);
 	if (at_end) {
 		cb_check_needs_break (CB_PAIR_Y (at_end));
 	}
 	x = cb_build_if (x, stmt_lis, NULL, STMT_WHEN);
-	return cb_emit (cb_build_search (1, table, NULL, at_end, x));
+	x = cb_build_search (1, table, NULL, at_end, x);
+	CB_SEARCH (x)->lookup = lookup;
+	return cb_emit (x);
 }
 
 /* SET statement */
@@ -13728,6 +14318,10 @@ cb_emit_set_to (cb_tree vars, cb_tree src)
 	/* validate / fix-up source, if requested */
 	cb_emit_incompat_data_checks (src);
 
+	/* SET changes its targets only */
+	current_statement->receivers = vars;
+	current_statement->flag_receivers = 1;
+
 	/* Emit statements. */
 	for (l = vars; l; l = CB_CHAIN (l)) {
 		cb_emit (cb_build_move (src, CB_VALUE (l)));
@@ -13877,6 +14471,9 @@ cb_emit_set_up_down (cb_tree l, cb_tree flag, cb_tree x)
 	 || cb_validate_list (l)) {
 		return;
 	}
+	/* SET changes its targets only */
+	current_statement->receivers = l;
+	current_statement->flag_receivers = 1;
 	for (; l; l = CB_CHAIN (l)) {
 		cb_tree target = CB_VALUE (l);
 		if (flag == cb_int0) {
@@ -45,6 +45,15 @@ FILE *fmemopen (void *buf, size_t size, const char *mode);
 #endif
 
 #include <errno.h>
+#include <time.h>
+
+/* the names of the modules in the directories of COB_LIBRARY_PATH are
+   read once and checked instead of probing each directory, where file
+   names are case-sensitive */
+#if	!defined (_WIN32) && !defined (__APPLE__) && !defined (__OS400__)
+#include <dirent.h>
+#define	COB_RESOLVE_LIST_DIRS
+#endif
 
 /* include internal and external libcob definitions, forcing exports */
 #define	COB_LIB_EXPIMP
@@ -124,12 +133,14 @@ lt_dlerror (void)
 #define	CALL_BUFF_SIZE		256U
 #define	CALL_BUFF_MAX		(CALL_BUFF_SIZE - 1U)
 
-#define HASH_SIZE		131U
+#define CALL_TABLE_INIT_SIZE	128U	/* power of two */
+#define CALL_MISS_MAX		4096U	/* unresolved names kept at most */
 
 /* Call table */
 
 struct call_hash {
 	struct call_hash	*next;		/* Linked list next pointer */
+	unsigned int		hash_val;	/* Hash value of name */
 	const char		*name;		/* Original called name */
 	void			*func;		/* Function address */
 	cob_module		*module;	/* Program module structure */
@@ -138,6 +149,30 @@ struct call_hash {
 	unsigned int		no_phys_cancel;	/* No physical cancel */
 };
 
+/* Hashed set of names, for unresolved names and directory listings */
+
+struct name_entry {
+	struct name_entry	*next;		/* Linked list next pointer */
+	unsigned int		hash_val;	/* Hash value of name */
+	int			flags;		/* Lookup flags (unresolved names) */
+	char			*name;
+};
+
+struct name_set {
+	struct name_entry	**table;	/* Buckets, power of two */
+	size_t			size;
+	size_t			count;
+};
+
+/* Directory of the resolve path */
+
+struct resolve_dir {
+	time_t			mtime;		/* Modification time when checked */
+	time_t			read_time;	/* Time of last (re-)check */
+	int			flag_listed;	/* Module names are read */
+	struct name_set		modules;	/* Module names without extension */
+};
+
 struct struct_handle {
 	struct struct_handle	*next;		/* Linked list next pointer */
 	const char		*path;		/* Path of module */
@@ -146,13 +181,19 @@ struct struct_handle {
 
 struct system_table {
 	const char		*syst_name;
-	int			syst_hash_val;
+	unsigned int		syst_hash_val;
 	cob_call_union		syst_call;
 };
 
 /* Local variables */
 
 static struct call_hash		**call_table;
+static size_t			call_table_size;
+static size_t			call_table_count;
+
+/* Unresolved names with the case folding and module type looked up,
+   dropped when anything is loaded or the resolve path changes */
+static struct name_set		call_misses;
 
 static struct struct_handle	*base_preload_ptr;
 static struct struct_handle	*base_dynload_ptr;
@@ -161,6 +202,8 @@ static cob_global		*cobglobptr = NULL;
 static cob_settings		*cobsetptr = NULL;
 
 static char			**resolve_path;
+static struct resolve_dir	*resolve_dirs;
+static time_t			resolve_dirs_checked;
 static char			*resolve_error;
 static char			*resolve_alloc;
 static char			*resolve_error_buff;
@@ -289,6 +332,278 @@ static int last_entry_is_working_directory (const char *buff, const char *pstr)
 	return 0;
 }
 
+/* FNV-1a hash of a name */
+static COB_INLINE unsigned int
+hash (const unsigned char *s)
+{
+	register const unsigned char *p = s;
+	register unsigned int	val = 2166136261U;
+
+	while (*p) {
+		val ^= *p++;
+		val *= 16777619U;
+	}
+	return val;
+}
+
+/* double the number of buckets of the call table,
+   keeping the order of the entries in each bucket */
+static void
+call_table_grow (void)
+{
+	struct call_hash	**new_table;
+	struct call_hash	**tail[2];
+	struct call_hash	*p;
+	struct call_hash	*q;
+	size_t			i;
+
+	new_table = cob_malloc (sizeof (struct call_hash *) * call_table_size * 2);
+	for (i = 0; i < call_table_size; ++i) {
+		tail[0] = &new_table[i];
+		tail[1] = &new_table[i + call_table_size];
+		for (p = call_table[i]; p; p = q) {
+			const int	high = (p->hash_val & call_table_size) != 0;
+			q = p->next;
+			p->next = NULL;
+			*tail[high] = p;
+			tail[high] = &p->next;
+		}
+	}
+	cob_free (call_table);
+	call_table = new_table;
+	call_table_size *= 2;
+}
+
+static void
+insert (const char *name, void *func, lt_dlhandle handle,
+	cob_module *module, const char *path,
+	const unsigned int nocanc)
+{
+	struct call_hash	*p;
+	unsigned int		val;
+
+	if (call_table_count >= call_table_size) {
+		call_table_grow ();
+	}
+	p = cob_malloc (sizeof (struct call_hash));
+	p->name = cob_strdup (name);
+	p->func = func;
+	p->handle = handle;
+	p->module = module;
+
+	if (path) {
+		p->path = cob_path_to_absolute (path);
+	}
+	p->no_phys_cancel = nocanc;
+	val = hash ((const unsigned char *)name);
+	p->hash_val = val;
+	val &= call_table_size - 1;
+	p->next = call_table[val];
+	call_table[val] = p;
+	call_table_count++;
+}
+
+static void *
+lookup (const char *name)
+{
+	struct call_hash	*p;
+	const unsigned int	val = hash ((const unsigned char *)name);
+
+	p = call_table[val & (call_table_size - 1)];
+	for (; p; p = p->next) {
+		if (p->hash_val == val
+		 && strcmp (name, p->name) == 0) {
+			return p->func;
+		}
+	}
+	return NULL;
+}
+
+static struct name_entry *
+name_set_find (const struct name_set *set, const char *name,
+	       const unsigned int hash_val, const int flags)
+{
+	struct name_entry	*p;
+
+	if (set->count == 0) {
+		return NULL;
+	}
+	p = set->table[hash_val & (set->size - 1)];
+	for (; p; p = p->next) {
+		if (p->hash_val == hash_val
+		 && p->flags == flags
+		 && strcmp (name, p->name) == 0) {
+			return p;
+		}
+	}
+	return NULL;
+}
+
+static void
+name_set_add (struct name_set *set, const char *name,
+	      const unsigned int hash_val, const int flags)
+{
+	struct name_entry	*p;
+	size_t			i;
+
+	if (set->count >= set->size) {
+		const size_t		new_size = set->size ? set->size * 2 : 64;
+		struct name_entry	**new_table;
+		struct name_entry	*q;
+		new_table = cob_malloc (sizeof (struct name_entry *) * new_size);
+		for (i = 0; i < set->size; ++i) {
+			for (p = set->table[i]; p; p = q) {
+				q = p->next;
+				p->next = new_table[p->hash_val & (new_size - 1)];
+				new_table[p->hash_val & (new_size - 1)] = p;
+			}
+		}
+		if (set->table) {
+			cob_free (set->table);
+		}
+		set->table = new_table;
+		set->size = new_size;
+	}
+	p = cob_malloc (sizeof (struct name_entry));
+	p->name = cob_strdup (name);
+	p->hash_val = hash_val;
+	p->flags = flags;
+	i = hash_val & (set->size - 1);
+	p->next = set->table[i];
+	set->table[i] = p;
+	set->count++;
+}
+
+/* drop all names of the set, keeping its buckets */
+static void
+name_set_clear (struct name_set *set)
+{
+	struct name_entry	*p;
+	struct name_entry	*q;
+	size_t			i;
+
+	if (set->count == 0) {
+		return;
+	}
+	for (i = 0; i < set->size; ++i) {
+		for (p = set->table[i]; p; p = q) {
+			q = p->next;
+			cob_free (p->name);
+			cob_free (p);
+		}
+		set->table[i] = NULL;
+	}
+	set->count = 0;
+}
+
+static void
+name_set_free (struct name_set *set)
+{
+	name_set_clear (set);
+	if (set->table) {
+		cob_free (set->table);
+	}
+	set->table = NULL;
+	set->size = 0;
+}
+
+/* check the directories of the resolve path for changes, at most
+   every COB_RESOLVE_CHECK seconds; a changed directory drops its module
+   names and all unresolved names, as the one modified within the second
+   of the check, which may change again without a different time stamp */
+static void
+resolve_dirs_check (void)
+{
+	const time_t		now = time (NULL);
+	struct resolve_dir	*d;
+	struct stat		st;
+	size_t			i;
+
+	if (cobsetptr->cob_resolve_check
+	 && now - resolve_dirs_checked < (time_t)cobsetptr->cob_resolve_check) {
+		return;
+	}
+	resolve_dirs_checked = now;
+	for (i = 0; i < resolve_size; ++i) {
+		d = &resolve_dirs[i];
+		if (stat (resolve_path[i], &st) != 0) {
+			st.st_mtime = 0;
+		}
+		if (st.st_mtime != d->mtime
+		 || d->mtime >= d->read_time) {
+			d->mtime = st.st_mtime;
+			d->read_time = now;
+			if (d->flag_listed) {
+				name_set_clear (&d->modules);
+				d->flag_listed = 0;
+			}
+			name_set_clear (&call_misses);
+		}
+	}
+}
+
+#ifdef	COB_RESOLVE_LIST_DIRS
+/* whether there is a module file for 'module_name' in the directory
+   'i' of the resolve path, reading its module names on first use;
+   assumes it is there if the directory can't be read or was just
+   modified */
+static int
+resolve_dir_has_module (const size_t i, const char *module_name)
+{
+	struct resolve_dir	*d = &resolve_dirs[i];
+
+	/* just modified: check the file */
+	if (d->mtime >= d->read_time) {
+		return 1;
+	}
+	if (!d->flag_listed) {
+		const size_t	ext_len = strlen (COB_MODULE_EXT) + 1;
+		DIR		*dir;
+		struct dirent	*ent;
+		char		buff[COB_NORMAL_BUFF];
+
+		dir = opendir (resolve_path[i]);
+		if (!dir) {
+			return 1;
+		}
+		while ((ent = readdir (dir)) != NULL) {
+			const size_t	len = strlen (ent->d_name);
+			if (len <= ext_len
+			 || len >= COB_NORMAL_MAX
+			 || ent->d_name[len - ext_len] != '.'
+			 || strcmp (ent->d_name + len - ext_len + 1, COB_MODULE_EXT)) {
+				continue;
+			}
+			memcpy (buff, ent->d_name, len - ext_len);
+			buff[len - ext_len] = 0;
+			name_set_add (&d->modules, buff,
+				hash ((const unsigned char *)buff), 0);
+		}
+		closedir (dir);
+		d->flag_listed = 1;
+	}
+	return name_set_find (&d->modules, module_name,
+		hash ((const unsigned char *)module_name), 0) != NULL;
+}
+#endif
+
+static void
+resolve_dirs_free (void)
+{
+	size_t	i;
+
+	if (!resolve_dirs) {
+		return;
+	}
+	for (i = 0; i < resolve_size; ++i) {
+		name_set_free (&resolve_dirs[i].modules);
+	}
+	cob_free (resolve_dirs);
+	resolve_dirs = NULL;
+	resolve_dirs_checked = 0;
+	name_set_clear (&call_misses);
+}
+
 /* resolves the actual library path used from
    * COB_LIBRARY_PATH runtime setting
    * "." as current working direktory [if not included already: prefixed]
@@ -310,6 +625,7 @@ cob_set_library_path ()
 		cob_free (resolve_path);
 		cob_free (resolve_alloc);
 	}
+	resolve_dirs_free ();
 
 	/* setup buffer and count number of separators,
 	   check for "." */
@@ -381,6 +697,7 @@ cob_set_library_path ()
 	pstr = resolve_alloc;
 
 	resolve_path = cob_malloc (sizeof (char *) * i);
+	resolve_dirs = cob_malloc (sizeof (struct resolve_dir) * i);
 	resolve_size = 0;
 
 	for (; ; ) {
@@ -492,6 +809,7 @@ do_cancel_module (struct call_hash *p, struct call_hash **base_hash,
 	} else {
 		prev->next = p->next;
 	}
+	call_table_count--;
 	if (p->name) {
 		cob_free ((void *)(p->name));
 	}
@@ -517,6 +835,9 @@ cache_dynload (const char *path, lt_dlhandle handle)
 {
 	struct struct_handle	*dynptr;
 
+	/* the new module may contain names not resolved before */
+	name_set_clear (&call_misses);
+
 	for (dynptr = base_dynload_ptr; dynptr; dynptr = dynptr->next) {
 		if (!strcmp (path, dynptr->path)) {
 			if (!dynptr->handle) {
@@ -537,6 +858,8 @@ add_to_preload (const char *path, lt_dlhandle libhandle, struct struct_handle *l
 {
 	struct struct_handle *preptr;
 
+	name_set_clear (&call_misses);
+
 	preptr = cob_malloc (sizeof (struct struct_handle));
 	preptr->path = cob_strdup (path);
 	preptr->handle = libhandle;
@@ -605,7 +928,7 @@ cache_preload (const char *path)
 	 && call_table) {
 		struct call_hash	*p;
 		size_t	i;
-		for (i = 0; i < HASH_SIZE; ++i) {
+		for (i = 0; i < call_table_size; ++i) {
 			p = call_table[i];
 			for (; p;) {
 				if ((p->path && !strcmp (path, p->path))
@@ -636,55 +959,6 @@ cache_preload (const char *path)
 	return 1;
 }
 
-static COB_INLINE unsigned int
-hash (const unsigned char *s)
-{
-	register const unsigned char *p = s;
-	register unsigned int	val = 0;
-
-	while (*p) {
-		val += *p++;
-	}
-	return val % HASH_SIZE;
-}
-
-static void
-insert (const char *name, void *func, lt_dlhandle handle,
-	cob_module *module, const char *path,
-	const unsigned int nocanc)
-{
-	struct call_hash	*p;
-	unsigned int		val;
-
-	p = cob_malloc (sizeof (struct call_hash));
-	p->name = cob_strdup (name);
-	p->func = func;
-	p->handle = handle;
-	p->module = module;
-
-	if (path) {
-		p->path = cob_path_to_absolute (path);
-	}
-	p->no_phys_cancel = nocanc;
-	val = hash ((const unsigned char *)name);
-	p->next = call_table[val];
-	call_table[val] = p;
-}
-
-static void *
-lookup (const char *name)
-{
-	struct call_hash	*p;
-
-	p = call_table[hash ((const unsigned char *)name)];
-	for (; p; p = p->next) {
-		if (strcmp (name, p->name) == 0) {
-			return p->func;
-		}
-	}
-	return NULL;
-}
-
 static int
 cob_encode_invalid_chars (const unsigned char* const name,
 	unsigned char* const name_buff,
@@ -798,6 +1072,18 @@ cob_resolve_internal  (const char *name, const char *dirent,
 		}
 	}
 
+	/* Search the names not resolved before */
+	if (!dirent) {
+		resolve_dirs_check ();
+		if (name_set_find (&call_misses, name, hash ((const unsigned char *)name),
+				   fold_case * 2 + module_type)) {
+			snprintf (resolve_error_buff, (size_t)CALL_BUFF_MAX,
+				  "module '%s' not found", name);
+			set_resolve_error (module_type);
+			return NULL;
+		}
+	}
+
 	if (strlen (name) > COB_MAX_NAMELEN) {
 		/* note: we allow up to COB_MAX_WORDLEN for relaxed syntax... */
 		snprintf (resolve_error_buff, (size_t)CALL_BUFF_MAX,
@@ -939,6 +1225,11 @@ cob_resolve_internal  (const char *name, const char *dirent,
 			snprintf (call_filename_buff, (size_t)COB_NORMAL_MAX,
 				  "%s.%s", (char *)s, COB_MODULE_EXT);
 		} else {
+#ifdef	COB_RESOLVE_LIST_DIRS
+			if (!resolve_dir_has_module (i, (const char *)s)) {
+				continue;
+			}
+#endif
 			snprintf (call_filename_buff, (size_t)COB_NORMAL_MAX,
 				  "%s%c%s.%s", resolve_path[i],
 				  SLASH_CHAR, (char *)s, COB_MODULE_EXT);
@@ -968,6 +1259,12 @@ cob_resolve_internal  (const char *name, const char *dirent,
 			return NULL;
 		}
 	}
+	/* remember as unresolved until anything changes */
+	if (call_misses.count >= CALL_MISS_MAX) {
+		name_set_clear (&call_misses);
+	}
+	name_set_add (&call_misses, name, hash ((const unsigned char *)name),
+		      fold_case * 2 + module_type);
 #endif
 	snprintf (resolve_error_buff, (size_t)CALL_BUFF_MAX,
 		  "module '%s' not found", name);
@@ -1053,10 +1350,12 @@ void
 cob_set_cancel (cob_module *m)
 {
 	struct call_hash	*p;
+	const unsigned int	val = hash ((const unsigned char *)(m->module_name));
 
-	p = call_table[hash ((const unsigned char *)(m->module_name))];
+	p = call_table[val & (call_table_size - 1)];
 	for (; p; p = p->next) {
-		if (strcmp (m->module_name, p->name) == 0) {
+		if (p->hash_val == val
+		 && strcmp (m->module_name, p->name) == 0) {
 			p->module = m;
 			/* Set path in program module structure */
 			if (p->path && m->module_path && !*(m->module_path)) {
@@ -1191,7 +1490,7 @@ cob_call_field (const cob_field *f, const struct cob_call_struct *cs,
 	/* Check if system routine */
 	{
 		const struct system_table	*psyst = system_tab;
-		const int		entry_hash = hash ((unsigned char *)entry);
+		const unsigned int	entry_hash = hash ((unsigned char *)entry);
 		while (psyst->syst_name) {
 			if (psyst->syst_hash_val == entry_hash
 			 && !strcmp (psyst->syst_name, entry)) {
@@ -1249,7 +1548,7 @@ cob_cancel (const char *name)
 
 	entry = cob_chk_dirp (name);
 
-	q = &call_table[hash ((const unsigned char *)entry)];
+	q = &call_table[hash ((const unsigned char *)entry) & (call_table_size - 1)];
 	p = *q;
 	r = NULL;
 	for (; p; p = p->next) {
@@ -1512,17 +1811,19 @@ cob_exit_call (void)
 		cob_free (resolve_alloc);
 		resolve_alloc = NULL;
 	}
+	resolve_dirs_free ();
 	if (resolve_path) {
 		cob_free (resolve_path);
 		resolve_path = NULL;
 		resolve_size = 0;
 	}
+	name_set_free (&call_misses);
 
 	if (call_table) {
 		struct call_hash	*p;
 		struct call_hash	*q;
 		size_t			i;
-		for (i = 0; i < HASH_SIZE; ++i) {
+		for (i = 0; i < call_table_size; ++i) {
 			p = call_table[i];
 			for (; p;) {
 				q = p;
@@ -1540,6 +1841,8 @@ cob_exit_call (void)
 			cob_free (call_table);
 		}
 		call_table = NULL;
+		call_table_size = 0;
+		call_table_count = 0;
 	}
 	close_and_free_module_list (&base_preload_ptr);
 	close_and_free_module_list (&base_dynload_ptr);
@@ -1612,6 +1915,8 @@ cob_init_call (cob_global *lptr, cob_settings* sptr, const int check_mainhandle)
 	base_preload_ptr = NULL;
 	base_dynload_ptr = NULL;
 	resolve_path = NULL;
+	resolve_dirs = NULL;
+	resolve_dirs_checked = 0;
 	resolve_alloc = NULL;
 	resolve_error = NULL;
 	call_buffer = NULL;
@@ -1629,7 +1934,9 @@ cob_init_call (cob_global *lptr, cob_settings* sptr, const int check_mainhandle)
 	/* Big enough for anything from libdl/libltdl */
 	resolve_error_buff = cob_malloc ((size_t)CALL_BUFF_SIZE);
 
-	call_table = cob_malloc (sizeof (struct call_hash *) * HASH_SIZE);
+	call_table_size = CALL_TABLE_INIT_SIZE;
+	call_table_count = 0;
+	call_table = cob_malloc (sizeof (struct call_hash *) * call_table_size);
 
 	/* setup hash for system routines (modifying "const table" here) */
 	{
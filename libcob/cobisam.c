@@ -0,0 +1,2838 @@
+/*
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of GnuCOBOL.
+
+   The GnuCOBOL runtime library is free software: you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   GnuCOBOL is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with GnuCOBOL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#define _LFS64_LARGEFILE		1
+#define _LFS64_STDIO			1
+#define _FILE_OFFSET_BITS		64
+#define _LARGEFILE64_SOURCE		1
+#ifdef	_AIX
+#define _LARGE_FILES			1
+#endif	/* _AIX */
+#if defined(__hpux__) && !defined(__LP64__)
+#define _APP32_64BIT_OFF_T		1
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef	HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef	HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#ifdef	_WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#if !defined(__BORLANDC__) && !defined(__WATCOMC__) && !defined(__ORANGEC__)
+#define	open		_open
+#define	close		_close
+#define	unlink		_unlink
+#ifndef lseek
+#define lseek		_lseeki64
+#endif
+#endif
+#else
+#ifndef	O_BINARY
+#define	O_BINARY	0
+#endif
+#endif
+
+/* include internal and external libcob definitions, forcing exports */
+#define	COB_LIB_EXPIMP
+#include "coblocal.h"
+
+/* the built-in ISAM is only used without an external INDEXED handler,
+   see fileio.c */
+#if	!defined(WITH_DB) && !defined(WITH_LMDB) \
+ && !defined(WITH_CISAM) && !defined(WITH_DISAM) && !defined(WITH_VBISAM) \
+ && !defined(WITH_INDEX_EXTFH)
+
+#include "cobisam.h"
+
+/* check before the data of a file is changed */
+#define	JOURNAL_BEFORE(fd,offset,len) \
+	cob_journal_before (fd, (cob_s64_t)(offset), (size_t)(len))
+
+/* Built-in ISAM
+
+   An INDEXED file "name" consists of
+   - "name.dat": the records in slots of fixed size, numbered from 1;
+     each slot holds its state, the record length and for each key
+     with duplicates the sequence number of its index entry,
+     deleted slots are chained for reuse;
+   - "name.idx": a header page with the file attributes and the keys,
+     followed by the pages of a B+tree for each key; the entries of a
+     key are its value (followed by the sequence number for keys with
+     duplicates, so that these are read in the order written) and the
+     record number, branch pages hold such separators and the child
+     page numbers; leaf pages are chained both ways for READ NEXT and
+     READ PREVIOUS; empty pages are not merged; a record whose NULLKEY
+     holds only its null character has no entry for that key.
+
+   The pages are held in a cache per file which is shared by all its
+   handles in the process; with ISEXCLLOCK dirty pages are only written
+   when evicted and on isclose / isflush, otherwise each call locks the
+   index for the other processes, drops the cache if the file was
+   changed meanwhile and writes the changed pages before returning.
+   Entries after the last one of a key (ascending keys) are appended to
+   its rightmost leaf without a search; full pages on this right edge
+   are split at the end, so that loading in key order fills them.
+   Record locks are byte locks on the data file, kept in a list to
+   detect the locks of other handles of the same file in this process. */
+
+#define	ISAM_MAGIC		"GCISAM01"
+#define	ISAM_HEADER_SIZE	64
+#define	ISAM_PAGE_HEADER	16
+#define	ISAM_PAGE_MIN		4096
+#define	ISAM_CACHE_SIZE		(2 * 1024 * 1024)	/* Bytes of pages cached per file */
+#define	ISAM_CACHE_MIN		32
+#define	ISAM_MAX_DEPTH		32
+#define	ISAM_SLOT_HEADER	8
+#define	ISAM_BULK_SIZE		(4 * 1024 * 1024)	/* Bytes of entries deferred per key */
+#define	ISAM_WBUF_SIZE		(64 * 1024)	/* Bytes of slots appended at once */
+
+#define	ISAM_LEAF		1
+#define	ISAM_BRANCH		2
+
+/* Lock bytes in the index file, records lock their number in the data file */
+#define	ISAM_LOCK_OPEN		1
+#define	ISAM_LOCK_UPDATE	2
+
+struct isam_key {
+	struct keydesc	desc;
+	unsigned int	root;		/* Root page of the B+tree */
+	int		klen;		/* Length of the key value */
+	int		cmp_len;	/* Key value and sequence number */
+	int		entry_len;	/* Entry: cmp_len + record / page number */
+	int		capacity;	/* Entries per page */
+	unsigned int	last_leaf;	/* Rightmost leaf, 0 = not known */
+	unsigned char	*pending;	/* Entries not yet inserted, bulk load */
+	int		npending;
+	int		max_pending;
+};
+
+struct isam_page {
+	unsigned char	*data;
+	unsigned int	pageno;		/* 0 = unused buffer */
+	int		pins;		/* In use, not to be evicted */
+	int		dirty;
+	int		ref;		/* Used since the clock passed */
+	int		hnext;		/* Next buffer in the hash chain */
+};
+
+struct isam_lock {
+	unsigned int	recnum;
+	int		isfd;		/* Handle holding the lock */
+};
+
+/* Position of an entry read ahead */
+struct isam_ahead {
+	unsigned int	pageno;
+	int		pos;
+	int		dup;		/* The next entry has the same value */
+};
+
+/* An INDEXED file opened in this process */
+struct isam_file {
+	struct isam_file	*next;
+	char			*name;
+	dev_t			dev;		/* Identify the file if opened */
+	ino_t			ino;		/* by another name */
+	int			idx_fd;
+	int			dat_fd;
+	int			readonly;	/* Opened without write access */
+	int			refs;		/* Open handles */
+	int			excl;		/* Opened with ISEXCLLOCK */
+	int			bulk;		/* Defer keys with duplicates */
+	int			open_lock;	/* Lock held on ISAM_LOCK_OPEN */
+	int			in_update;	/* ISAM_LOCK_UPDATE is held */
+	int			hdr_dirty;
+	unsigned int		changes;	/* Changes of the B+trees */
+	unsigned int		updates;	/* Update calls, for read-ahead */
+	/* header */
+	unsigned int		page_size;
+	unsigned int		rec_size;
+	unsigned int		varlen;
+	unsigned int		nkeys;
+	unsigned int		slot_size;
+	unsigned int		nrecords;
+	unsigned int		next_recnum;
+	unsigned int		free_rec;
+	unsigned int		page_count;
+	unsigned int		stamp;		/* Incremented on each update */
+	cob_u64_t		dup_seq;
+	struct isam_key		*keys;
+	/* page cache */
+	struct isam_page	*pages;
+	int			npages;
+	int			*hash;
+	int			clock;
+	unsigned char		*slot;		/* Buffer for a record slot */
+	unsigned char		*wbuf;		/* Slots appended, not written */
+	unsigned int		wbuf_first;	/* Record number of the first */
+	unsigned int		wbuf_count;
+	unsigned int		wbuf_max;
+	struct isam_lock	*locks;
+	size_t			nlocks;
+	size_t			alloc_locks;
+	struct isam_status	*st;		/* Result of the current call,
+						   set by isam_handle */
+};
+
+/* Handle returned by isopen / isbuild */
+struct isam_handle {
+	struct isam_file	*fp;
+	int			mode;
+	int			keyno;		/* Current key, -1 = record number */
+	int			has_cur;	/* cur holds the current entry */
+	int			at_end;		/* Positioned after the last entry */
+	int			started;	/* isstart done, ISNEXT reads cur */
+	unsigned int		recnum;		/* Current record */
+	unsigned int		cur_page;	/* Position of cur, while */
+	int			cur_pos;	/* fp->changes is cur_changes */
+	unsigned int		cur_changes;
+	unsigned char		*cur;
+	unsigned char		*entry;		/* Work buffers for entries */
+	unsigned char		*entry2;
+	/* read-ahead for ISNEXT, valid while fp->changes and fp->updates
+	   are those when read */
+	struct isam_ahead	*ahead;
+	unsigned char		*ahead_entries;
+	unsigned char		*ahead_slots;
+	int			ahead_alloc;	/* Entries allocated */
+	int			ahead_count;
+	int			ahead_next;
+	unsigned int		ahead_changes;
+	unsigned int		ahead_updates;
+	unsigned long		reads_next;	/* Statistics */
+	unsigned long		reads_ahead;
+	unsigned long		batches;
+};
+
+static cob_settings		*cobsetptr = NULL;
+static struct isam_file		*isam_files = NULL;
+static struct isam_handle	**isam_handles = NULL;
+static int			isam_nhandles = 0;
+
+static COB_INLINE unsigned int
+isam_get32 (const unsigned char *p)
+{
+	unsigned int	v;
+
+	memcpy (&v, p, sizeof (v));
+	return v;
+}
+
+static COB_INLINE void
+isam_put32 (unsigned char *p, const unsigned int v)
+{
+	memcpy (p, &v, sizeof (v));
+}
+
+/* read / write 'len' bytes at 'offset' of 'fd', returning the errno */
+static int
+isam_io (const int fd, const cob_s64_t offset, unsigned char *buff,
+	 size_t len, const int write_it)
+{
+	if (write_it && JOURNAL_BEFORE (fd, offset, len)) {
+		return errno ? errno : EBADFILE;
+	}
+	if (lseek (fd, (off_t)offset, SEEK_SET) == (off_t)-1) {
+		return errno ? errno : EBADFILE;
+	}
+	while (len > 0) {
+		const int	n = (int)(write_it
+				  ? write (fd, buff, len) : read (fd, buff, len));
+		if (n <= 0) {
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			return n < 0 && errno ? errno : EBADFILE;
+		}
+		buff += n;
+		len -= n;
+	}
+	return 0;
+}
+
+/* Header */
+
+static void
+isam_key_sizes (const struct isam_file *fp, struct isam_key *k)
+{
+	int	part;
+
+	k->klen = 0;
+	for (part = 0; part < k->desc.k_nparts; ++part) {
+		k->klen += k->desc.k_part[part].kp_leng;
+	}
+	k->desc.k_len = k->klen;
+	k->cmp_len = k->klen + ((k->desc.k_flags & ISDUPS) ? 8 : 0);
+	k->entry_len = k->cmp_len + 4;
+	/* one entry more fits, for splitting a full branch page */
+	k->capacity = (int)((fp->page_size - ISAM_PAGE_HEADER) / k->entry_len) - 1;
+}
+
+static size_t
+isam_header_size (const struct isam_file *fp, const unsigned int nkeys)
+{
+	size_t		size = ISAM_HEADER_SIZE;
+	unsigned int	k;
+
+	for (k = 0; k < nkeys; ++k) {
+		size += 12 + 12 * fp->keys[k].desc.k_nparts;
+	}
+	return size;
+}
+
+static int
+isam_write_header (struct isam_file *fp)
+{
+	const size_t	size = isam_header_size (fp, fp->nkeys);
+	unsigned char	*buff = cob_malloc (size);
+	unsigned char	*p = buff + ISAM_HEADER_SIZE;
+	unsigned int	k;
+	int		part, ret;
+
+	memcpy (buff, ISAM_MAGIC, 8);
+	isam_put32 (buff + 8, fp->page_size);
+	isam_put32 (buff + 12, fp->rec_size);
+	isam_put32 (buff + 16, fp->varlen);
+	isam_put32 (buff + 20, fp->nkeys);
+	isam_put32 (buff + 24, fp->slot_size);
+	isam_put32 (buff + 28, fp->nrecords);
+	isam_put32 (buff + 32, fp->next_recnum);
+	isam_put32 (buff + 36, fp->free_rec);
+	isam_put32 (buff + 40, fp->page_count);
+	isam_put32 (buff + 44, fp->stamp);
+	isam_put32 (buff + 48, (unsigned int)(fp->dup_seq & 0xFFFFFFFF));
+	isam_put32 (buff + 52, (unsigned int)(fp->dup_seq >> 32));
+	for (k = 0; k < fp->nkeys; ++k) {
+		const struct keydesc	*kd = &fp->keys[k].desc;
+		isam_put32 (p, fp->keys[k].root);
+		isam_put32 (p + 4, (unsigned int)kd->k_flags);
+		isam_put32 (p + 8, (unsigned int)kd->k_nparts);
+		p += 12;
+		for (part = 0; part < kd->k_nparts; ++part) {
+			isam_put32 (p, (unsigned int)kd->k_part[part].kp_start);
+			isam_put32 (p + 4, (unsigned int)kd->k_part[part].kp_leng);
+			isam_put32 (p + 8, (unsigned int)kd->k_part[part].kp_type);
+			p += 12;
+		}
+	}
+	ret = isam_io (fp->idx_fd, 0, buff, size, 1);
+	cob_free (buff);
+	if (!ret) {
+		fp->hdr_dirty = 0;
+	}
+	return ret;
+}
+
+/* read the header, only the variable part with 'counters_only' */
+static int
+isam_read_header (struct isam_file *fp, const int counters_only)
+{
+	unsigned char	fixed[ISAM_HEADER_SIZE];
+	unsigned char	*buff, *p;
+	unsigned int	k;
+	int		part, ret;
+
+	ret = isam_io (fp->idx_fd, 0, fixed, ISAM_HEADER_SIZE, 0);
+	if (ret) {
+		return ret;
+	}
+	if (memcmp (fixed, ISAM_MAGIC, 8)) {
+		return EBADFILE;
+	}
+	fp->nrecords = isam_get32 (fixed + 28);
+	fp->next_recnum = isam_get32 (fixed + 32);
+	fp->free_rec = isam_get32 (fixed + 36);
+	fp->page_count = isam_get32 (fixed + 40);
+	fp->stamp = isam_get32 (fixed + 44);
+	fp->dup_seq = isam_get32 (fixed + 48)
+		| ((cob_u64_t)isam_get32 (fixed + 52) << 32);
+	if (counters_only) {
+		/* the roots may have changed by splits */
+		buff = cob_malloc (isam_header_size (fp, fp->nkeys));
+		ret = isam_io (fp->idx_fd, 0, buff,
+			isam_header_size (fp, fp->nkeys), 0);
+		p = buff + ISAM_HEADER_SIZE;
+		for (k = 0; k < fp->nkeys && !ret; ++k) {
+			fp->keys[k].root = isam_get32 (p);
+			p += 12 + 12 * fp->keys[k].desc.k_nparts;
+		}
+		cob_free (buff);
+		return ret;
+	}
+	fp->page_size = isam_get32 (fixed + 8);
+	fp->rec_size = isam_get32 (fixed + 12);
+	fp->varlen = isam_get32 (fixed + 16);
+	fp->nkeys = isam_get32 (fixed + 20);
+	fp->slot_size = isam_get32 (fixed + 24);
+	if (fp->page_size < ISAM_PAGE_MIN
+	 || fp->nkeys == 0
+	 || fp->slot_size != ISAM_SLOT_HEADER + 8 * fp->nkeys + fp->rec_size) {
+		return EBADFILE;
+	}
+	buff = cob_malloc (fp->page_size);
+	ret = isam_io (fp->idx_fd, 0, buff, fp->page_size, 0);
+	fp->keys = cob_malloc (fp->nkeys * sizeof (struct isam_key));
+	p = buff + ISAM_HEADER_SIZE;
+	for (k = 0; k < fp->nkeys && !ret; ++k) {
+		struct isam_key	*key = &fp->keys[k];
+		key->root = isam_get32 (p);
+		key->desc.k_flags = (int)isam_get32 (p + 4);
+		key->desc.k_nparts = (int)isam_get32 (p + 8);
+		p += 12;
+		if (key->desc.k_nparts < 1 || key->desc.k_nparts > NPARTS
+		 || p + 12 * key->desc.k_nparts > buff + fp->page_size) {
+			ret = EBADFILE;
+			break;
+		}
+		for (part = 0; part < key->desc.k_nparts; ++part) {
+			key->desc.k_part[part].kp_start = (int)isam_get32 (p);
+			key->desc.k_part[part].kp_leng = (int)isam_get32 (p + 4);
+			key->desc.k_part[part].kp_type = (int)isam_get32 (p + 8);
+			p += 12;
+		}
+		isam_key_sizes (fp, key);
+	}
+	cob_free (buff);
+	return ret;
+}
+
+/* Page cache */
+
+static void
+isam_cache_init (struct isam_file *fp)
+{
+	int	i;
+
+	fp->npages = (int)(ISAM_CACHE_SIZE / fp->page_size);
+	if (fp->npages < ISAM_CACHE_MIN) {
+		fp->npages = ISAM_CACHE_MIN;
+	}
+	fp->pages = cob_malloc (fp->npages * sizeof (struct isam_page));
+	fp->hash = cob_malloc (fp->npages * sizeof (int));
+	for (i = 0; i < fp->npages; ++i) {
+		fp->pages[i].data = cob_fast_malloc (fp->page_size);
+		fp->hash[i] = -1;
+	}
+	fp->clock = 0;
+}
+
+static int
+isam_page_write (struct isam_file *fp, struct isam_page *pg)
+{
+	const int	ret = isam_io (fp->idx_fd,
+				(cob_s64_t)pg->pageno * fp->page_size,
+				pg->data, fp->page_size, 1);
+
+	if (!ret) {
+		pg->dirty = 0;
+	}
+	return ret;
+}
+
+/* write all changed pages and the header */
+static int
+isam_cache_flush (struct isam_file *fp)
+{
+	int	i, ret;
+
+	for (i = 0; i < fp->npages; ++i) {
+		if (fp->pages[i].dirty) {
+			ret = isam_page_write (fp, &fp->pages[i]);
+			if (ret) {
+				return ret;
+			}
+		}
+	}
+	if (fp->hdr_dirty) {
+		return isam_write_header (fp);
+	}
+	return 0;
+}
+
+/* forget the cached pages, changed by another process */
+static void
+isam_cache_drop (struct isam_file *fp)
+{
+	unsigned int	k;
+	int		i;
+
+	for (i = 0; i < fp->npages; ++i) {
+		fp->pages[i].pageno = 0;
+		fp->pages[i].dirty = 0;
+		fp->hash[i] = -1;
+	}
+	for (k = 0; k < fp->nkeys; ++k) {
+		fp->keys[k].last_leaf = 0;
+	}
+	fp->changes++;
+}
+
+static void
+isam_cache_unlink (struct isam_file *fp, const int i)
+{
+	int	*link = &fp->hash[fp->pages[i].pageno % fp->npages];
+
+	while (*link != i) {
+		link = &fp->pages[*link].hnext;
+	}
+	*link = fp->pages[i].hnext;
+	fp->pages[i].pageno = 0;
+}
+
+/* get a buffer for page 'pageno', evicting the least recently used */
+static struct isam_page *
+isam_cache_slot (struct isam_file *fp, const unsigned int pageno)
+{
+	struct isam_page	*pg;
+	int			tries = 2 * fp->npages;
+	int			i;
+
+	for (; ;) {
+		i = fp->clock;
+		fp->clock = (fp->clock + 1) % fp->npages;
+		pg = &fp->pages[i];
+		if (pg->pins == 0) {
+			if (pg->pageno == 0 || !pg->ref) {
+				break;
+			}
+			pg->ref = 0;
+		}
+		/* LCOV_EXCL_START */
+		if (--tries == 0) {
+			fp->st->iserrno = ENOMEM;
+			return NULL;
+		}
+		/* LCOV_EXCL_STOP */
+	}
+	if (pg->pageno != 0) {
+		if (pg->dirty) {
+			fp->st->iserrno = isam_page_write (fp, pg);
+			/* LCOV_EXCL_START */
+			if (fp->st->iserrno) {
+				return NULL;
+			}
+			/* LCOV_EXCL_STOP */
+		}
+		isam_cache_unlink (fp, i);
+	}
+	pg->pageno = pageno;
+	pg->hnext = fp->hash[pageno % fp->npages];
+	fp->hash[pageno % fp->npages] = i;
+	pg->pins = 1;
+	pg->ref = 1;
+	pg->dirty = 0;
+	return pg;
+}
+
+/* get page 'pageno', to be released by isam_page_put */
+static struct isam_page *
+isam_page_get (struct isam_file *fp, const unsigned int pageno)
+{
+	struct isam_page	*pg;
+	int			i;
+
+	for (i = fp->hash[pageno % fp->npages]; i >= 0; i = fp->pages[i].hnext) {
+		if (fp->pages[i].pageno == pageno) {
+			pg = &fp->pages[i];
+			pg->pins++;
+			pg->ref = 1;
+			return pg;
+		}
+	}
+	if (pageno == 0 || pageno >= fp->page_count) {
+		fp->st->iserrno = EBADFILE;
+		return NULL;
+	}
+	pg = isam_cache_slot (fp, pageno);
+	if (pg == NULL) {
+		return NULL;
+	}
+	fp->st->iserrno = isam_io (fp->idx_fd, (cob_s64_t)pageno * fp->page_size,
+			   pg->data, fp->page_size, 0);
+	if (fp->st->iserrno) {
+		isam_cache_unlink (fp, (int)(pg - fp->pages));
+		pg->pins = 0;
+		return NULL;
+	}
+	return pg;
+}
+
+/* allocate a new page of 'type' at the end of the index file */
+static struct isam_page *
+isam_page_new (struct isam_file *fp, const unsigned int type)
+{
+	struct isam_page	*pg = isam_cache_slot (fp, fp->page_count);
+
+	if (pg == NULL) {
+		return NULL;
+	}
+	fp->page_count++;
+	fp->hdr_dirty = 1;
+	memset (pg->data, 0, fp->page_size);
+	isam_put32 (pg->data, type);
+	pg->dirty = 1;
+	return pg;
+}
+
+static COB_INLINE void
+isam_page_put (struct isam_page *pg)
+{
+	pg->pins--;
+}
+
+#define	ISAM_TYPE(d)		isam_get32 (d)
+#define	ISAM_COUNT(d)		isam_get32 ((d) + 4)
+#define	ISAM_NEXT(d)		isam_get32 ((d) + 8)	/* leaf */
+#define	ISAM_PREV(d)		isam_get32 ((d) + 12)	/* leaf */
+#define	ISAM_CHILD0(d)		isam_get32 ((d) + 8)	/* branch */
+#define	ISAM_ENTRY(d,k,i)	((d) + ISAM_PAGE_HEADER + (size_t)(i) * (k)->entry_len)
+
+/* B+tree */
+
+/* number of entries in page 'd' whose first 'len' bytes are less
+   than 'key' (or not greater, with 'upper') */
+static int
+isam_page_search (const unsigned char *d, const struct isam_key *k,
+		  const unsigned char *key, const int len, const int upper)
+{
+	int	lo = 0;
+	int	hi = (int)ISAM_COUNT (d);
+
+	while (lo < hi) {
+		const int	mid = (lo + hi) / 2;
+		const int	c = memcmp (ISAM_ENTRY (d, k, mid), key, len);
+		if (c < 0 || (upper && c == 0)) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/* child page for entry 'i' of a branch, as found by isam_page_search */
+static COB_INLINE unsigned int
+isam_child (const unsigned char *d, const struct isam_key *k, const int i)
+{
+	if (i == 0) {
+		return ISAM_CHILD0 (d);
+	}
+	return isam_get32 (ISAM_ENTRY (d, k, i - 1) + k->cmp_len);
+}
+
+/* move from position '*pos' of leaf '*pg' by 'dir' (1 / -1) to the next
+   entry, skipping empty leaves; '*pos' may be one after the last entry
+   or -1 to start at the next / previous leaf; returns 0 if found,
+   else releases the leaf */
+static int
+isam_leaf_step (struct isam_file *fp, struct isam_page **pg, int *pos,
+		const int dir)
+{
+	*pos += dir;
+	while (*pos < 0 || *pos >= (int)ISAM_COUNT ((*pg)->data)) {
+		const unsigned int	next = dir > 0
+				? ISAM_NEXT ((*pg)->data) : ISAM_PREV ((*pg)->data);
+		isam_page_put (*pg);
+		if (next == 0) {
+			*pg = NULL;
+			fp->st->iserrno = EENDFILE;
+			return 1;
+		}
+		*pg = isam_page_get (fp, next);
+		if (*pg == NULL) {
+			return 1;
+		}
+		*pos = dir > 0 ? 0 : (int)ISAM_COUNT ((*pg)->data) - 1;
+	}
+	return 0;
+}
+
+/* find the first entry of key 'k' whose first 'len' bytes are not less
+   than 'key' (greater with 'upper'); 'key' NULL finds the first entry;
+   returns 0 with the leaf pinned in '*pg' and the position in '*pos',
+   else fp->st->iserrno is EENDFILE or an error */
+static int
+isam_find (struct isam_file *fp, const struct isam_key *k,
+	   const unsigned char *key, const int len, const int upper,
+	   struct isam_page **pg, int *pos)
+{
+	unsigned int	pageno = k->root;
+	int		depth = 0;
+
+	for (; ;) {
+		*pg = isam_page_get (fp, pageno);
+		if (*pg == NULL) {
+			return 1;
+		}
+		if (ISAM_TYPE ((*pg)->data) == ISAM_LEAF) {
+			break;
+		}
+		pageno = isam_child ((*pg)->data, k, key == NULL ? 0
+			: isam_page_search ((*pg)->data, k, key, len, upper));
+		isam_page_put (*pg);
+		/* LCOV_EXCL_START */
+		if (++depth > ISAM_MAX_DEPTH) {
+			fp->st->iserrno = EBADFILE;
+			return 1;
+		}
+		/* LCOV_EXCL_STOP */
+	}
+	*pos = key == NULL ? 0
+		: isam_page_search ((*pg)->data, k, key, len, upper);
+	if (*pos >= (int)ISAM_COUNT ((*pg)->data)) {
+		*pos = (int)ISAM_COUNT ((*pg)->data) - 1;
+		return isam_leaf_step (fp, pg, pos, 1);
+	}
+	return 0;
+}
+
+/* find the last entry of key 'k' */
+static int
+isam_find_last (struct isam_file *fp, const struct isam_key *k,
+		struct isam_page **pg, int *pos)
+{
+	unsigned int	pageno = k->root;
+	int		depth = 0;
+
+	for (; ;) {
+		*pg = isam_page_get (fp, pageno);
+		if (*pg == NULL) {
+			return 1;
+		}
+		if (ISAM_TYPE ((*pg)->data) == ISAM_LEAF) {
+			break;
+		}
+		pageno = isam_child ((*pg)->data, k, (int)ISAM_COUNT ((*pg)->data));
+		isam_page_put (*pg);
+		/* LCOV_EXCL_START */
+		if (++depth > ISAM_MAX_DEPTH) {
+			fp->st->iserrno = EBADFILE;
+			return 1;
+		}
+		/* LCOV_EXCL_STOP */
+	}
+	*pos = (int)ISAM_COUNT ((*pg)->data);
+	return isam_leaf_step (fp, pg, pos, -1);
+}
+
+/* insert 'entry' at position 'pos' of page 'd' */
+static void
+isam_page_insert (unsigned char *d, const struct isam_key *k, const int pos,
+		  const unsigned char *entry)
+{
+	const int	count = (int)ISAM_COUNT (d);
+	unsigned char	*p = ISAM_ENTRY (d, k, pos);
+
+	memmove (p + k->entry_len, p, (size_t)(count - pos) * k->entry_len);
+	memcpy (p, entry, k->entry_len);
+	isam_put32 (d + 4, (unsigned int)count + 1);
+}
+
+/* the rightmost leaf of key 'k', pinned, if known and not empty */
+static struct isam_page *
+isam_last_leaf (struct isam_file *fp, const struct isam_key *k)
+{
+	struct isam_page	*pg;
+
+	if (k->last_leaf == 0) {
+		return NULL;
+	}
+	pg = isam_page_get (fp, k->last_leaf);
+	if (pg == NULL) {
+		/* LCOV_EXCL_START */
+		fp->st->iserrno = 0;
+		return NULL;
+		/* LCOV_EXCL_STOP */
+	}
+	/* pages are not reused, but another process may have split it */
+	if (ISAM_TYPE (pg->data) != ISAM_LEAF
+	 || ISAM_NEXT (pg->data) != 0
+	 || ISAM_COUNT (pg->data) == 0) {
+		isam_page_put (pg);
+		return NULL;
+	}
+	return pg;
+}
+
+/* insert the separator 'up' (with room for the child number) to the new
+   page 'child' into the parents of the split leaf along 'path' / 'slot',
+   splitting those if full */
+static int
+isam_insert_separator (struct isam_file *fp, struct isam_key *k,
+		       const unsigned int *path, const int *slot, int depth,
+		       unsigned char *up, unsigned int child, const int append)
+{
+	struct isam_page	*pg, *right;
+	int			pos, half, count;
+
+	while (depth > 0) {
+		unsigned char	*e;
+		depth--;
+		pg = isam_page_get (fp, path[depth]);
+		if (pg == NULL) {
+			return 1;
+		}
+		pg->dirty = 1;
+		pos = slot[depth];
+		isam_put32 (up + k->cmp_len, child);
+		if ((int)ISAM_COUNT (pg->data) < k->capacity) {
+			isam_page_insert (pg->data, k, pos, up);
+			isam_page_put (pg);
+			return 0;
+		}
+		right = isam_page_new (fp, ISAM_BRANCH);
+		if (right == NULL) {
+			isam_page_put (pg);
+			return 1;
+		}
+		/* insert first, the page has room for one more entry */
+		isam_page_insert (pg->data, k, pos, up);
+		count = (int)ISAM_COUNT (pg->data);
+		half = append ? count - 1 : count / 2;
+		/* the middle entry moves up, its child starts the right page */
+		e = ISAM_ENTRY (pg->data, k, half);
+		isam_put32 (right->data + 8, isam_get32 (e + k->cmp_len));
+		memcpy (ISAM_ENTRY (right->data, k, 0), e + k->entry_len,
+			(size_t)(count - half - 1) * k->entry_len);
+		isam_put32 (right->data + 4, (unsigned int)(count - half - 1));
+		isam_put32 (pg->data + 4, (unsigned int)half);
+		memcpy (up, e, k->cmp_len);
+		child = right->pageno;
+		isam_page_put (right);
+		isam_page_put (pg);
+	}
+
+	/* the root was split: new root above both halves */
+	pg = isam_page_new (fp, ISAM_BRANCH);
+	if (pg == NULL) {
+		return 1;
+	}
+	isam_put32 (pg->data + 8, k->root);
+	isam_put32 (up + k->cmp_len, child);
+	isam_page_insert (pg->data, k, 0, up);
+	k->root = pg->pageno;
+	fp->hdr_dirty = 1;
+	isam_page_put (pg);
+	return 0;
+}
+
+/* insert 'entry' into the B+tree of key 'k', splitting full pages;
+   entries after the last one (as for ascending keys) are appended to
+   the rightmost leaf without a search, and pages on the right edge
+   are split at the end so that these are filled completely */
+static int
+isam_insert (struct isam_file *fp, struct isam_key *k,
+	     const unsigned char *entry)
+{
+	unsigned int		path[ISAM_MAX_DEPTH];
+	int			slot[ISAM_MAX_DEPTH];
+	unsigned char		*up;
+	struct isam_page	*pg, *right;
+	unsigned int		pageno = k->root;
+	unsigned int		child;
+	int			depth = 0;
+	int			pos, half, count, append;
+	int			ret;
+
+	pg = isam_last_leaf (fp, k);
+	if (pg != NULL) {
+		count = (int)ISAM_COUNT (pg->data);
+		if (count < k->capacity
+		 && memcmp (ISAM_ENTRY (pg->data, k, count - 1),
+			    entry, k->cmp_len) < 0) {
+			isam_page_insert (pg->data, k, count, entry);
+			pg->dirty = 1;
+			fp->changes++;
+			isam_page_put (pg);
+			return 0;
+		}
+		isam_page_put (pg);
+	}
+
+	/* find the leaf, remembering the path */
+	for (; ;) {
+		pg = isam_page_get (fp, pageno);
+		if (pg == NULL) {
+			return 1;
+		}
+		pos = isam_page_search (pg->data, k, entry, k->cmp_len, 1);
+		path[depth] = pageno;
+		slot[depth] = pos;
+		if (ISAM_TYPE (pg->data) == ISAM_LEAF) {
+			break;
+		}
+		pageno = isam_child (pg->data, k, pos);
+		isam_page_put (pg);
+		/* LCOV_EXCL_START */
+		if (++depth == ISAM_MAX_DEPTH) {
+			fp->st->iserrno = EBADFILE;
+			return 1;
+		}
+		/* LCOV_EXCL_STOP */
+	}
+	fp->changes++;
+	pg->dirty = 1;
+	count = (int)ISAM_COUNT (pg->data);
+	if (count < k->capacity) {
+		isam_page_insert (pg->data, k, pos, entry);
+		if (ISAM_NEXT (pg->data) == 0) {
+			k->last_leaf = pg->pageno;
+		}
+		isam_page_put (pg);
+		return 0;
+	}
+
+	/* split the leaf: the upper half moves to a new right sibling,
+	   appending to the rightmost leaf only the new entry does */
+	right = isam_page_new (fp, ISAM_LEAF);
+	if (right == NULL) {
+		isam_page_put (pg);
+		return 1;
+	}
+	append = ISAM_NEXT (pg->data) == 0 && pos == count;
+	if (ISAM_NEXT (pg->data) == 0) {
+		k->last_leaf = right->pageno;
+	}
+	half = append ? count : count / 2;
+	memcpy (ISAM_ENTRY (right->data, k, 0), ISAM_ENTRY (pg->data, k, half),
+		(size_t)(count - half) * k->entry_len);
+	isam_put32 (right->data + 4, (unsigned int)(count - half));
+	isam_put32 (pg->data + 4, (unsigned int)half);
+	isam_put32 (right->data + 8, ISAM_NEXT (pg->data));
+	isam_put32 (right->data + 12, pg->pageno);
+	if (ISAM_NEXT (pg->data) != 0) {
+		struct isam_page	*next = isam_page_get (fp, ISAM_NEXT (pg->data));
+		if (next == NULL) {
+			isam_page_put (right);
+			isam_page_put (pg);
+			return 1;
+		}
+		isam_put32 (next->data + 12, right->pageno);
+		next->dirty = 1;
+		isam_page_put (next);
+	}
+	isam_put32 (pg->data + 8, right->pageno);
+	if (pos <= half && !append) {
+		isam_page_insert (pg->data, k, pos, entry);
+	} else {
+		isam_page_insert (right->data, k, pos - half, entry);
+	}
+	/* the separator is the first entry of the right page */
+	up = cob_fast_malloc ((size_t)k->entry_len);
+	memcpy (up, ISAM_ENTRY (right->data, k, 0), k->cmp_len);
+	child = right->pageno;
+	isam_page_put (right);
+	isam_page_put (pg);
+
+	ret = isam_insert_separator (fp, k, path, slot, depth, up, child, append);
+	cob_free (up);
+	return ret;
+}
+
+/* remove 'entry' (compared including the record number) from key 'k' */
+static int
+isam_remove (struct isam_file *fp, const struct isam_key *k,
+	     const unsigned char *entry)
+{
+	struct isam_page	*pg;
+	int			pos;
+
+	if (isam_find (fp, k, entry, k->cmp_len, 0, &pg, &pos)) {
+		if (fp->st->iserrno == EENDFILE) {
+			fp->st->iserrno = EBADFILE;
+		}
+		return 1;
+	}
+	for (; ;) {
+		unsigned char	*p = ISAM_ENTRY (pg->data, k, pos);
+		if (memcmp (p, entry, k->cmp_len) != 0) {
+			isam_page_put (pg);
+			fp->st->iserrno = EBADFILE;
+			return 1;
+		}
+		if (!memcmp (p + k->cmp_len, entry + k->cmp_len, 4)) {
+			break;
+		}
+		/* only for damaged unique keys */
+		if (isam_leaf_step (fp, &pg, &pos, 1)) {
+			fp->st->iserrno = EBADFILE;
+			return 1;
+		}
+	}
+	{
+		unsigned char	*p = ISAM_ENTRY (pg->data, k, pos);
+		const int	count = (int)ISAM_COUNT (pg->data);
+		memmove (p, p + k->entry_len,
+			 (size_t)(count - pos - 1) * k->entry_len);
+		isam_put32 (pg->data + 4, (unsigned int)count - 1);
+	}
+	pg->dirty = 1;
+	fp->changes++;
+	isam_page_put (pg);
+	return 0;
+}
+
+/* Records */
+
+static COB_INLINE cob_s64_t
+isam_slot_offset (const struct isam_file *fp, const unsigned int recnum)
+{
+	return (cob_s64_t)(recnum - 1) * fp->slot_size;
+}
+
+/* read the slot of 'recnum' into fp->slot, checking that it is in use */
+static int
+isam_read_slot (struct isam_file *fp, const unsigned int recnum)
+{
+	if (recnum == 0 || recnum >= fp->next_recnum) {
+		fp->st->iserrno = ENOREC;
+		return 1;
+	}
+	fp->st->iserrno = isam_io (fp->dat_fd, isam_slot_offset (fp, recnum),
+			   fp->slot, fp->slot_size, 0);
+	if (fp->st->iserrno) {
+		return 1;
+	}
+	if (isam_get32 (fp->slot) != 1) {
+		fp->st->iserrno = ENOREC;
+		return 1;
+	}
+	return 0;
+}
+
+static COB_INLINE cob_u64_t
+isam_slot_seq (const struct isam_file *fp, const unsigned int k)
+{
+	cob_u64_t	seq;
+
+	memcpy (&seq, fp->slot + ISAM_SLOT_HEADER + 8 * k, 8);
+	return seq;
+}
+
+/* build the entry of key 'k' for 'record' */
+static void
+isam_make_entry (const struct isam_key *k, const unsigned char *record,
+		 cob_u64_t seq, const unsigned int recnum, unsigned char *entry)
+{
+	unsigned char	*p = entry;
+	int		part, i;
+
+	for (part = 0; part < k->desc.k_nparts; ++part) {
+		const struct keypart	*kp = &k->desc.k_part[part];
+		memcpy (p, record + kp->kp_start, kp->kp_leng);
+		p += kp->kp_leng;
+	}
+	if (k->desc.k_flags & ISDUPS) {
+		/* big-endian, to be compared with the key value */
+		for (i = 7; i >= 0; --i) {
+			p[i] = (unsigned char)(seq & 0xFF);
+			seq >>= 8;
+		}
+		p += 8;
+	}
+	isam_put32 (p, recnum);
+}
+
+/* check if key 'k' is a NULLKEY with all parts of 'record' holding
+   their null character, such a record has no entry for it */
+static int
+isam_null_key (const struct isam_key *k, const unsigned char *record)
+{
+	int	part, i;
+
+	if (!(k->desc.k_flags & NULLKEY)) {
+		return 0;
+	}
+	for (part = 0; part < k->desc.k_nparts; ++part) {
+		const struct keypart	*kp = &k->desc.k_part[part];
+		const unsigned char	c = (unsigned char)(kp->kp_type >> 8);
+		for (i = 0; i < kp->kp_leng; ++i) {
+			if (record[kp->kp_start + i] != c) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+/* check if key 'k' has an entry with the value of 'entry' */
+static int
+isam_key_exists (struct isam_file *fp, const struct isam_key *k,
+		 const unsigned char *entry, const unsigned int except)
+{
+	struct isam_page	*pg;
+	int			pos, found;
+
+	/* no search for values after the last one, as for ascending keys */
+	pg = isam_last_leaf (fp, k);
+	if (pg != NULL) {
+		found = memcmp (ISAM_ENTRY (pg->data, k,
+				(int)ISAM_COUNT (pg->data) - 1), entry, k->klen) < 0;
+		isam_page_put (pg);
+		if (found) {
+			return 0;
+		}
+	}
+	if (isam_find (fp, k, entry, k->klen, 0, &pg, &pos)) {
+		return fp->st->iserrno == EENDFILE ? 0 : -1;
+	}
+	found = !memcmp (ISAM_ENTRY (pg->data, k, pos), entry, k->klen)
+	     && isam_get32 (ISAM_ENTRY (pg->data, k, pos) + k->cmp_len) != except;
+	isam_page_put (pg);
+	return found;
+}
+
+/* Bulk load
+
+   Files created by isbuild with the runtime option COB_BULK_LOAD keep
+   the entries of the keys with duplicates in a buffer per key; these
+   are sorted and inserted when the buffer is full and before any call
+   other than iswrite, so that each batch is inserted in key order.
+   Records appended to a file opened with ISEXCLLOCK are written
+   together in the same way. */
+
+/* merge the sorted runs of 'n1' and 'n2' entries of 'size' bytes at 'src'
+   into 'dst', comparing the first 'len' bytes; equal ones keep their order */
+static void
+isam_merge (unsigned char *dst, const unsigned char *src, const size_t n1,
+	    const size_t n2, const size_t size, const size_t len)
+{
+	const unsigned char	*a = src;
+	const unsigned char	*a_end = src + n1 * size;
+	const unsigned char	*b = a_end;
+	const unsigned char	*b_end = b + n2 * size;
+
+	while (a < a_end && b < b_end) {
+		if (memcmp (b, a, len) < 0) {
+			memcpy (dst, b, size);
+			b += size;
+		} else {
+			memcpy (dst, a, size);
+			a += size;
+		}
+		dst += size;
+	}
+	if (a < a_end) {
+		memcpy (dst, a, (size_t)(a_end - a));
+	} else if (b < b_end) {
+		memcpy (dst, b, (size_t)(b_end - b));
+	}
+}
+
+/* sort the 'count' entries of 'size' bytes at 'base' by their first
+   'len' bytes; runs of 8 entries are sorted by insertion and then merged
+   through a buffer of the same size */
+static void
+isam_sort_entries (unsigned char *base, const size_t count,
+		   const size_t size, const size_t len)
+{
+	unsigned char	*tmp;
+	unsigned char	*src;
+	unsigned char	*dst;
+	unsigned char	*swap;
+	size_t		run;
+	size_t		i;
+	size_t		j;
+	size_t		m;
+	size_t		n1;
+	size_t		n2;
+
+	if (count < 2) {
+		return;
+	}
+	tmp = cob_fast_malloc (count * size);
+
+	for (i = 0; i < count; i += 8) {
+		const size_t	end = count - i > 8 ? i + 8 : count;
+		for (j = i + 1; j < end; ++j) {
+			if (memcmp (base + (j - 1) * size, base + j * size, len) <= 0) {
+				continue;
+			}
+			memcpy (tmp, base + j * size, size);
+			m = j - 1;
+			while (m > i
+			    && memcmp (base + (m - 1) * size, tmp, len) > 0) {
+				m--;
+			}
+			memmove (base + (m + 1) * size, base + m * size,
+				 (j - m) * size);
+			memcpy (base + m * size, tmp, size);
+		}
+	}
+
+	src = base;
+	dst = tmp;
+	for (run = 8; run < count; run *= 2) {
+		for (i = 0; i < count; i += 2 * run) {
+			n1 = count - i > run ? run : count - i;
+			n2 = count - i - n1 > run ? run : count - i - n1;
+			isam_merge (dst + i * size, src + i * size,
+				    n1, n2, size, len);
+		}
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+	if (src != base) {
+		memcpy (base, src, count * size);
+	}
+	cob_free (tmp);
+}
+
+/* insert the deferred entries of key 'k' in key order */
+static int
+isam_insert_pending (struct isam_file *fp, struct isam_key *k)
+{
+	const int	count = k->npending;
+	int		i;
+
+	k->npending = 0;
+	isam_sort_entries (k->pending, (size_t)count, (size_t)k->entry_len,
+			   (size_t)k->cmp_len);
+	for (i = 0; i < count; ++i) {
+		if (isam_insert (fp, k, k->pending + (size_t)i * k->entry_len)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* keep 'entry' of key 'k' to be inserted with the next batch */
+static int
+isam_defer (struct isam_file *fp, struct isam_key *k,
+	    const unsigned char *entry)
+{
+	if (k->pending == NULL) {
+		k->max_pending = ISAM_BULK_SIZE / k->entry_len;
+		k->pending = cob_fast_malloc ((size_t)k->max_pending * k->entry_len);
+	} else if (k->npending == k->max_pending
+		&& isam_insert_pending (fp, k)) {
+		return 1;
+	}
+	memcpy (k->pending + (size_t)k->npending * k->entry_len,
+		entry, k->entry_len);
+	k->npending++;
+	return 0;
+}
+
+/* write the slots collected in fp->wbuf */
+static int
+isam_write_slots (struct isam_file *fp)
+{
+	const unsigned int	count = fp->wbuf_count;
+
+	if (count == 0) {
+		return 0;
+	}
+	fp->wbuf_count = 0;
+	return isam_io (fp->dat_fd, isam_slot_offset (fp, fp->wbuf_first),
+			fp->wbuf, (size_t)count * fp->slot_size, 1);
+}
+
+/* write the slot in fp->slot for 'recnum', collecting appended ones */
+static int
+isam_write_slot (struct isam_file *fp, const unsigned int recnum,
+		 const int append)
+{
+	int	ret;
+
+	if (append && fp->excl) {
+		if (fp->wbuf == NULL) {
+			fp->wbuf_max = ISAM_WBUF_SIZE / fp->slot_size;
+			if (fp->wbuf_max > 1) {
+				fp->wbuf = cob_fast_malloc ((size_t)fp->wbuf_max
+							    * fp->slot_size);
+			}
+		}
+		if (fp->wbuf != NULL) {
+			if (fp->wbuf_count == fp->wbuf_max
+			 || recnum != fp->wbuf_first + fp->wbuf_count) {
+				ret = isam_write_slots (fp);
+				if (ret) {
+					/* LCOV_EXCL_LINE */
+					return ret;
+				}
+			}
+			if (fp->wbuf_count == 0) {
+				fp->wbuf_first = recnum;
+			}
+			memcpy (fp->wbuf + (size_t)fp->wbuf_count * fp->slot_size,
+				fp->slot, fp->slot_size);
+			fp->wbuf_count++;
+			return 0;
+		}
+	}
+	ret = isam_write_slots (fp);
+	if (ret) {
+		/* LCOV_EXCL_LINE */
+		return ret;
+	}
+	return isam_io (fp->dat_fd, isam_slot_offset (fp, recnum),
+			fp->slot, fp->slot_size, 1);
+}
+
+/* complete the deferred work of 'fp', returning the errno */
+static int
+isam_bulk_flush (struct isam_file *fp)
+{
+	unsigned int	k;
+
+	for (k = 0; k < fp->nkeys; ++k) {
+		if (fp->keys[k].npending > 0
+		 && isam_insert_pending (fp, &fp->keys[k])) {
+			return fp->st->iserrno ? fp->st->iserrno : EBADFILE;
+		}
+	}
+	return isam_write_slots (fp);
+}
+
+/* Handles and locking */
+
+/* the handle 'isfd', its file reports to 'st' for this call */
+static struct isam_handle *
+isam_handle (struct isam_status *st, const int isfd)
+{
+	if (isfd < 0 || isfd >= isam_nhandles || isam_handles[isfd] == NULL) {
+		st->iserrno = ENOTOPEN;
+		return NULL;
+	}
+	isam_handles[isfd]->fp->st = st;
+	return isam_handles[isfd];
+}
+
+/* start a call on 'isfd'; if the file is shared with other processes
+   lock it for reading / 'update' and drop the cache if it was changed;
+   calls other than iswrite (ISAM_APPEND) complete the deferred work */
+#define	ISAM_APPEND	2
+
+static struct isam_handle *
+isam_enter (struct isam_status *st, const int isfd, const int update)
+{
+	struct isam_handle	*h = isam_handle (st, isfd);
+	struct isam_file	*fp;
+	unsigned int		stamp;
+
+	st->isstat1 = '0';
+	st->isstat2 = '0';
+	if (h == NULL) {
+		return NULL;
+	}
+	st->iserrno = 0;
+	fp = h->fp;
+	if (update && (fp->readonly || (h->mode & 0x03) == ISINPUT)) {
+		fp->st->iserrno = EBADARG;
+		return NULL;
+	}
+	if (update != ISAM_APPEND && (fp->bulk || fp->wbuf_count)) {
+		fp->st->iserrno = isam_bulk_flush (fp);
+		if (fp->st->iserrno) {
+			return NULL;
+		}
+	}
+	if (fp->excl) {
+		return h;
+	}
+	fp->st->iserrno = cob_lock_byte (fp->idx_fd, ISAM_LOCK_UPDATE,
+		update ? COB_BYTE_WRITE_LOCK : COB_BYTE_READ_LOCK, 1);
+	if (fp->st->iserrno) {
+		return NULL;
+	}
+	fp->in_update = 1;
+	stamp = fp->stamp;
+	fp->st->iserrno = isam_read_header (fp, 1);
+	if (fp->st->iserrno) {
+		cob_lock_byte (fp->idx_fd, ISAM_LOCK_UPDATE, COB_BYTE_UNLOCK, 0);
+		fp->in_update = 0;
+		return NULL;
+	}
+	if (stamp != fp->stamp) {
+		isam_cache_drop (fp);
+	}
+	return h;
+}
+
+/* end a call, returning -1 if fp->st->iserrno is set */
+static int
+isam_leave (struct isam_handle *h, const int update)
+{
+	struct isam_file	*fp = h->fp;
+
+	if (update) {
+		fp->updates++;
+	}
+	if (fp->in_update) {
+		if (update) {
+			fp->stamp++;
+			fp->hdr_dirty = 1;
+			if (isam_cache_flush (fp) && fp->st->iserrno == 0) {
+				fp->st->iserrno = EBADFILE;
+			}
+		}
+		cob_lock_byte (fp->idx_fd, ISAM_LOCK_UPDATE, COB_BYTE_UNLOCK, 0);
+		fp->in_update = 0;
+	}
+	return fp->st->iserrno ? -1 : 0;
+}
+
+/* handle holding the lock on 'recnum', -1 if none in this process */
+static int
+isam_lock_owner (const struct isam_file *fp, const unsigned int recnum,
+		 const int isfd)
+{
+	size_t	i;
+	int	owner = -1;
+
+	for (i = 0; i < fp->nlocks; ++i) {
+		if (fp->locks[i].recnum == recnum) {
+			owner = fp->locks[i].isfd;
+			if (owner == isfd) {
+				break;
+			}
+		}
+	}
+	return owner;
+}
+
+/* check that no other handle or process holds a lock on 'recnum',
+   with 'wait' waiting up to COB_LOCK_WAIT for another process */
+static int
+isam_test_record (const struct isam_handle *h, const int isfd,
+		  const unsigned int recnum, const int wait)
+{
+	const struct isam_file	*fp = h->fp;
+	const int		owner = isam_lock_owner (fp, recnum, isfd);
+	int			ret;
+
+	if (owner >= 0 && owner != isfd) {
+		fp->st->iserrno = ELOCKED;
+		return 1;
+	}
+	if (owner < 0 && !fp->excl
+	 && cob_lock_byte_held (fp->dat_fd, recnum)) {
+		ret = EAGAIN;
+		if (wait && cobsetptr->cob_lock_wait) {
+			/* wait without blocking the index for others */
+			if (fp->in_update) {
+				cob_lock_byte (fp->idx_fd, ISAM_LOCK_UPDATE, COB_BYTE_UNLOCK, 0);
+			}
+			ret = cob_lock_byte_wait (fp->dat_fd, recnum, 1);
+			if (fp->in_update) {
+				cob_lock_byte (fp->idx_fd, ISAM_LOCK_UPDATE,
+					   COB_BYTE_READ_LOCK, 1);
+			}
+		}
+		if (ret) {
+			fp->st->iserrno = ELOCKED;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* lock record 'recnum' for handle 'isfd' */
+static int
+isam_lock_record (struct isam_handle *h, const int isfd,
+		  const unsigned int recnum, const int wait)
+{
+	struct isam_file	*fp = h->fp;
+	const int		owner = isam_lock_owner (fp, recnum, isfd);
+
+	if (owner == isfd) {
+		return 0;
+	}
+	if (owner >= 0) {
+		fp->st->iserrno = ELOCKED;
+		return 1;
+	}
+	if (!fp->excl && !fp->readonly) {
+		fp->st->iserrno = cob_lock_byte (fp->dat_fd, recnum, COB_BYTE_WRITE_LOCK, 0);
+		if (fp->st->iserrno == EAGAIN && (wait || cobsetptr->cob_lock_wait)) {
+			/* wait without blocking the index for others */
+			if (fp->in_update) {
+				cob_lock_byte (fp->idx_fd, ISAM_LOCK_UPDATE, COB_BYTE_UNLOCK, 0);
+			}
+			if (wait) {
+				fp->st->iserrno = cob_lock_byte (fp->dat_fd, recnum,
+					COB_BYTE_WRITE_LOCK, 1);
+			} else {
+				fp->st->iserrno = cob_lock_byte_wait (fp->dat_fd, recnum, 0);
+			}
+			if (fp->in_update) {
+				cob_lock_byte (fp->idx_fd, ISAM_LOCK_UPDATE,
+					   COB_BYTE_READ_LOCK, 1);
+			}
+		}
+		if (fp->st->iserrno) {
+			if (fp->st->iserrno != EDEADLK) {
+				fp->st->iserrno = ELOCKED;
+			}
+			return 1;
+		}
+	}
+	if (fp->locks == NULL) {
+		fp->alloc_locks = 8;
+		fp->locks = cob_malloc (fp->alloc_locks * sizeof (struct isam_lock));
+	} else if (fp->nlocks == fp->alloc_locks) {
+		fp->alloc_locks *= 2;
+		fp->locks = cob_realloc (fp->locks,
+			fp->nlocks * sizeof (struct isam_lock),
+			fp->alloc_locks * sizeof (struct isam_lock));
+	}
+	fp->locks[fp->nlocks].recnum = recnum;
+	fp->locks[fp->nlocks].isfd = isfd;
+	fp->nlocks++;
+	return 0;
+}
+
+/* release the record locks of handle 'isfd' */
+static void
+isam_unlock_records (struct isam_file *fp, const int isfd)
+{
+	size_t	i = 0;
+
+	while (i < fp->nlocks) {
+		if (fp->locks[i].isfd == isfd) {
+			const unsigned int	recnum = fp->locks[i].recnum;
+			fp->locks[i] = fp->locks[--fp->nlocks];
+			if (isam_lock_owner (fp, recnum, -1) < 0
+			 && !fp->excl && !fp->readonly) {
+				cob_lock_byte (fp->dat_fd, recnum, COB_BYTE_UNLOCK, 0);
+			}
+		} else {
+			i++;
+		}
+	}
+}
+
+/* Opening and closing */
+
+static char *
+isam_file_name (const char *name, const char *ext)
+{
+	const size_t	len = strlen (name);
+	char		*s = cob_malloc (len + 5);
+
+	memcpy (s, name, len);
+	memcpy (s + len, ext, 5);
+	return s;
+}
+
+static void
+isam_file_free (struct isam_file *fp)
+{
+	int	i;
+
+	cob_journal_remove_file (fp->idx_fd);
+	cob_journal_remove_file (fp->dat_fd);
+	if (fp->idx_fd >= 0) {
+		close (fp->idx_fd);
+	}
+	if (fp->dat_fd >= 0) {
+		close (fp->dat_fd);
+	}
+	if (fp->pages) {
+		for (i = 0; i < fp->npages; ++i) {
+			cob_free (fp->pages[i].data);
+		}
+		cob_free (fp->pages);
+		cob_free (fp->hash);
+	}
+	if (fp->keys) {
+		for (i = 0; i < (int)fp->nkeys; ++i) {
+			if (fp->keys[i].pending) {
+				cob_free (fp->keys[i].pending);
+			}
+		}
+		cob_free (fp->keys);
+	}
+	if (fp->slot) {
+		cob_free (fp->slot);
+	}
+	if (fp->wbuf) {
+		cob_free (fp->wbuf);
+	}
+	if (fp->locks) {
+		cob_free (fp->locks);
+	}
+	cob_free (fp->name);
+	cob_free (fp);
+}
+
+/* create a handle for 'fp', setting the lock for ISEXCLLOCK or sharing */
+static int
+isam_new_handle (struct isam_file *fp, const int mode)
+{
+	struct isam_handle	*h;
+	const int		excl = (mode & ISEXCLLOCK) != 0;
+	int			isfd;
+
+	if (fp->excl || (excl && fp->refs > 0)) {
+		fp->st->iserrno = EFLOCKED;
+		return -1;
+	}
+	if (fp->open_lock != (excl ? COB_BYTE_WRITE_LOCK : COB_BYTE_READ_LOCK)) {
+		fp->st->iserrno = cob_lock_byte (fp->idx_fd, ISAM_LOCK_OPEN,
+			excl && !fp->readonly ? COB_BYTE_WRITE_LOCK : COB_BYTE_READ_LOCK, 0);
+		if (fp->st->iserrno) {
+			fp->st->iserrno = fp->st->iserrno == EAGAIN ? EFLOCKED : fp->st->iserrno;
+			return -1;
+		}
+		fp->open_lock = excl ? COB_BYTE_WRITE_LOCK : COB_BYTE_READ_LOCK;
+	}
+	fp->excl = excl;
+	for (isfd = 0; isfd < isam_nhandles; ++isfd) {
+		if (isam_handles[isfd] == NULL) {
+			break;
+		}
+	}
+	if (isam_handles == NULL) {
+		isam_nhandles = 16;
+		isam_handles = cob_malloc (isam_nhandles * sizeof (struct isam_handle *));
+	} else if (isfd == isam_nhandles) {
+		isam_handles = cob_realloc (isam_handles,
+			isam_nhandles * sizeof (struct isam_handle *),
+			2 * isam_nhandles * sizeof (struct isam_handle *));
+		isam_nhandles *= 2;
+	}
+	h = cob_malloc (sizeof (struct isam_handle));
+	h->fp = fp;
+	h->mode = mode;
+	h->keyno = 0;
+	h->cur = cob_malloc (fp->rec_size + 12);
+	h->entry = cob_malloc (fp->rec_size + 12);
+	h->entry2 = cob_malloc (fp->rec_size + 12);
+	isam_handles[isfd] = h;
+	fp->refs++;
+	return isfd;
+}
+
+/* open the files of 'name', creating them with 'create' */
+static struct isam_file *
+isam_file_open (struct isam_status *st, const char *name, const int mode,
+		const int create)
+{
+	struct isam_file	*fp;
+	struct stat		sb;
+	char			*idx_name, *dat_name;
+	int			flags = O_RDWR | O_BINARY;
+
+	idx_name = isam_file_name (name, ".idx");
+	if (stat (idx_name, &sb)) {
+		sb.st_dev = 0;
+		sb.st_ino = 0;
+	}
+	for (fp = isam_files; fp; fp = fp->next) {
+		if (sb.st_ino != 0
+		 ? fp->dev == sb.st_dev && fp->ino == sb.st_ino
+		 : !strcmp (fp->name, name)) {
+			cob_free (idx_name);
+			if (create) {
+				st->iserrno = EFLOCKED;
+				return NULL;
+			}
+			fp->st = st;
+			return fp;
+		}
+	}
+	fp = cob_malloc (sizeof (struct isam_file));
+	fp->name = cob_strdup (name);
+	fp->st = st;
+	fp->idx_fd = fp->dat_fd = -1;
+	dat_name = isam_file_name (name, ".dat");
+	if (create) {
+		fp->idx_fd = open (idx_name, flags | O_CREAT | O_EXCL, COB_FILE_MODE);
+		if (fp->idx_fd >= 0) {
+			fp->dat_fd = open (dat_name, flags | O_CREAT | O_TRUNC,
+					   COB_FILE_MODE);
+		}
+	} else {
+		if ((mode & 0x03) == ISINPUT) {
+			fp->idx_fd = open (idx_name, flags);
+			if (fp->idx_fd < 0 && (errno == EACCES || errno == EROFS)) {
+				flags = O_RDONLY | O_BINARY;
+				fp->readonly = 1;
+				fp->idx_fd = open (idx_name, flags);
+			}
+		} else {
+			fp->idx_fd = open (idx_name, flags);
+		}
+		if (fp->idx_fd >= 0) {
+			fp->dat_fd = open (dat_name, flags);
+		}
+	}
+	st->iserrno = fp->dat_fd < 0 ? errno : 0;
+	cob_free (idx_name);
+	cob_free (dat_name);
+	if (!st->iserrno && !fstat (fp->idx_fd, &sb)) {
+		fp->dev = sb.st_dev;
+		fp->ino = sb.st_ino;
+	}
+	if (!st->iserrno && !create) {
+		st->iserrno = isam_read_header (fp, 0);
+	}
+	if (st->iserrno) {
+		isam_file_free (fp);
+		return NULL;
+	}
+	fp->next = isam_files;
+	isam_files = fp;
+	return fp;
+}
+
+int
+cob_isopen (struct isam_status *st, const char *name, int mode)
+{
+	struct isam_file	*fp;
+	int			isfd;
+
+	st->iserrno = 0;
+	fp = isam_file_open (st, name, mode, 0);
+	if (fp == NULL) {
+		return -1;
+	}
+	if (fp->refs == 0) {
+		isam_cache_init (fp);
+		fp->slot = cob_malloc (fp->slot_size);
+	}
+	/* records of a fixed-length file may be read with ISVARLEN,
+	   those of a variable-length file need it */
+	if (fp->varlen && !(mode & ISVARLEN)) {
+		st->iserrno = EBADARG;
+		isfd = -1;
+	} else {
+		isfd = isam_new_handle (fp, mode);
+	}
+	if (isfd < 0 && fp->refs == 0) {
+		const int	err = st->iserrno;
+		cob_isclose (st, -1);	/* unlink fp */
+		st->iserrno = err;
+	}
+	return isfd;
+}
+
+int
+cob_isbuild (struct isam_status *st, const char *name, int reclen,
+	     struct keydesc *key, int mode)
+{
+	struct isam_file	*fp;
+	struct isam_page	*pg;
+	int			isfd;
+
+	st->iserrno = 0;
+	if (reclen <= 0 || key->k_nparts < 1 || key->k_nparts > NPARTS) {
+		st->iserrno = EBADARG;
+		return -1;
+	}
+	fp = isam_file_open (st, name, mode, 1);
+	if (fp == NULL) {
+		return -1;
+	}
+	fp->rec_size = (unsigned int)reclen;
+	fp->varlen = (mode & ISVARLEN) != 0;
+	fp->bulk = cobsetptr->cob_bulk_load;
+	/* at least three entries of the largest possible key per page */
+	fp->page_size = ISAM_PAGE_MIN;
+	while (fp->page_size < ISAM_PAGE_HEADER + 4 * (fp->rec_size + 12)) {
+		fp->page_size *= 2;
+	}
+	fp->nkeys = 1;
+	fp->slot_size = ISAM_SLOT_HEADER + 8 + fp->rec_size;
+	fp->next_recnum = 1;
+	fp->page_count = 1;
+	fp->keys = cob_malloc (sizeof (struct isam_key));
+	fp->keys[0].desc = *key;
+	isam_key_sizes (fp, &fp->keys[0]);
+	isam_cache_init (fp);
+	fp->slot = cob_malloc (fp->slot_size);
+	pg = isam_page_new (fp, ISAM_LEAF);
+	if (pg) {
+		fp->keys[0].root = pg->pageno;
+		isam_page_put (pg);
+		st->iserrno = isam_cache_flush (fp);
+	}
+	if (st->iserrno == 0) {
+		isfd = isam_new_handle (fp, (mode & ~0x03) | ISINOUT);
+	} else {
+		isfd = -1;
+	}
+	if (isfd < 0) {
+		const int	err = st->iserrno;
+		cob_isclose (st, -1);
+		cob_iserase (st, name);
+		st->iserrno = err;
+	}
+	return isfd;
+}
+
+int
+cob_isaddindex (struct isam_status *st, int isfd, struct keydesc *key)
+{
+	struct isam_handle	*h = isam_handle (st, isfd);
+	struct isam_file	*fp;
+	struct isam_page	*pg;
+	struct isam_key		*k;
+	unsigned int		i;
+	int			part;
+
+	if (h == NULL) {
+		return -1;
+	}
+	st->iserrno = 0;
+	fp = h->fp;
+	if (!fp->excl) {
+		st->iserrno = ENOTEXCL;
+		return -1;
+	}
+	/* keys can only be added to an empty file */
+	if (fp->next_recnum != 1) {
+		st->iserrno = EBADARG;
+		return -1;
+	}
+	if (key->k_nparts < 1 || key->k_nparts > NPARTS) {
+		st->iserrno = EBADKEY;
+		return -1;
+	}
+	for (i = 0; i < fp->nkeys; ++i) {
+		const struct keydesc	*kd = &fp->keys[i].desc;
+		if (kd->k_nparts != key->k_nparts) {
+			continue;
+		}
+		for (part = 0; part < kd->k_nparts; ++part) {
+			if (kd->k_part[part].kp_start != key->k_part[part].kp_start
+			 || kd->k_part[part].kp_leng != key->k_part[part].kp_leng) {
+				break;
+			}
+		}
+		if (part == kd->k_nparts) {
+			st->iserrno = EKEXISTS;
+			return -1;
+		}
+	}
+	fp->keys = cob_realloc (fp->keys, fp->nkeys * sizeof (struct isam_key),
+		(fp->nkeys + 1) * sizeof (struct isam_key));
+	k = &fp->keys[fp->nkeys];
+	k->desc = *key;
+	isam_key_sizes (fp, k);
+	if (isam_header_size (fp, fp->nkeys + 1) > fp->page_size) {
+		st->iserrno = ETOOMANY;
+		return -1;
+	}
+	pg = isam_page_new (fp, ISAM_LEAF);
+	if (pg == NULL) {
+		return -1;
+	}
+	k->root = pg->pageno;
+	isam_page_put (pg);
+	fp->nkeys++;
+	fp->slot_size += 8;
+	cob_free (fp->slot);
+	fp->slot = cob_malloc (fp->slot_size);
+	fp->hdr_dirty = 1;
+	st->iserrno = isam_cache_flush (fp);
+	return st->iserrno ? -1 : 0;
+}
+
+int
+cob_isindexinfo (struct isam_status *st, int isfd, void *buff, int number)
+{
+	struct isam_handle	*h = isam_handle (st, isfd);
+	struct isam_file	*fp;
+
+	if (h == NULL) {
+		return -1;
+	}
+	st->iserrno = 0;
+	fp = h->fp;
+	if (number == 0) {
+		struct dictinfo	*di = buff;
+		di->di_nkeys = (int)fp->nkeys | (fp->varlen ? 0x80 : 0);
+		di->di_recsize = (int)fp->rec_size;
+		di->di_idxsize = (int)fp->page_size;
+		di->di_nrecords = (long)fp->nrecords;
+		return 0;
+	}
+	if (number < 0 || number > (int)fp->nkeys) {
+		st->iserrno = EBADKEY;
+		return -1;
+	}
+	memcpy (buff, &fp->keys[number - 1].desc, sizeof (struct keydesc));
+	return 0;
+}
+
+/* close 'isfd'; -1 unlinks and frees a file without handles */
+int
+cob_isclose (struct isam_status *st, int isfd)
+{
+	struct isam_file	*fp, **link;
+	int			ret = 0;
+
+	if (isfd >= 0) {
+		struct isam_handle	*h = isam_handle (st, isfd);
+		if (h == NULL) {
+			return -1;
+		}
+		fp = h->fp;
+		isam_unlock_records (fp, isfd);
+		cob_free (h->cur);
+		cob_free (h->entry);
+		cob_free (h->entry2);
+		if (h->ahead) {
+			cob_free (h->ahead);
+			cob_free (h->ahead_entries);
+			cob_free (h->ahead_slots);
+		}
+		cob_free (h);
+		isam_handles[isfd] = NULL;
+		fp->refs--;
+		if (fp->refs > 0) {
+			if (fp->excl) {
+				/* LCOV_EXCL_START */
+				fp->excl = 0;
+				fp->bulk = 0;
+				st->iserrno = isam_bulk_flush (fp);
+				return st->iserrno ? -1 : 0;
+				/* LCOV_EXCL_STOP */
+			}
+			return 0;
+		}
+		if (!fp->readonly && fp->pages) {
+			ret = isam_bulk_flush (fp);
+			if (ret == 0) {
+				ret = isam_cache_flush (fp);
+			}
+		}
+	}
+	for (link = &isam_files; *link; ) {
+		fp = *link;
+		if (fp->refs == 0) {
+			*link = fp->next;
+			isam_file_free (fp);
+		} else {
+			link = &fp->next;
+		}
+	}
+	st->iserrno = ret;
+	return ret ? -1 : 0;
+}
+
+int
+cob_iserase (struct isam_status *st, const char *name)
+{
+	char	*s;
+	int	ret;
+
+	st->iserrno = 0;
+	s = isam_file_name (name, ".idx");
+	ret = unlink (s);
+	if (ret) {
+		st->iserrno = errno;
+	}
+	cob_free (s);
+	s = isam_file_name (name, ".dat");
+	unlink (s);
+	cob_free (s);
+	return ret ? -1 : 0;
+}
+
+int
+cob_isrelease (struct isam_status *st, int isfd)
+{
+	struct isam_handle	*h = isam_handle (st, isfd);
+
+	if (h == NULL) {
+		return -1;
+	}
+	st->iserrno = 0;
+	isam_unlock_records (h->fp, isfd);
+	return 0;
+}
+
+int
+cob_isflush (struct isam_status *st, int isfd)
+{
+	struct isam_handle	*h = isam_handle (st, isfd);
+
+	if (h == NULL) {
+		return -1;
+	}
+	st->iserrno = 0;
+	if (!h->fp->readonly) {
+		st->iserrno = isam_bulk_flush (h->fp);
+		if (st->iserrno == 0) {
+			st->iserrno = isam_cache_flush (h->fp);
+		}
+	}
+	return st->iserrno ? -1 : 0;
+}
+
+int
+cob_iscleanup (void)
+{
+	struct isam_status	st;
+	int			isfd;
+
+	for (isfd = 0; isfd < isam_nhandles; ++isfd) {
+		if (isam_handles[isfd]) {
+			cob_isclose (&st, isfd);
+		}
+	}
+	if (isam_handles) {
+		cob_free (isam_handles);
+		isam_handles = NULL;
+		isam_nhandles = 0;
+	}
+	return 0;
+}
+
+/* Positioning and reading */
+
+/* find the key of handle 'h' that matches 'key' */
+static int
+isam_select_key (struct isam_handle *h, const struct keydesc *key)
+{
+	const struct isam_file	*fp = h->fp;
+	unsigned int		k;
+	int			part;
+
+	if (key->k_nparts == 0) {
+		h->keyno = -1;
+		return 0;
+	}
+	for (k = 0; k < fp->nkeys; ++k) {
+		const struct keydesc	*kd = &fp->keys[k].desc;
+		if (kd->k_nparts != key->k_nparts) {
+			continue;
+		}
+		for (part = 0; part < kd->k_nparts; ++part) {
+			if (kd->k_part[part].kp_start != key->k_part[part].kp_start
+			 || kd->k_part[part].kp_leng != key->k_part[part].kp_leng) {
+				break;
+			}
+		}
+		if (part == kd->k_nparts) {
+			if (h->keyno != (int)k) {
+				h->keyno = (int)k;
+				h->has_cur = 0;
+				h->at_end = 0;
+			}
+			return 0;
+		}
+	}
+	fp->st->iserrno = EBADKEY;
+	return 1;
+}
+
+/* position on the entry of the current key for 'mode', using the key
+   value of 'record' and its first 'len' bytes for ISEQUAL / ISGREAT /
+   ISGTEQ; returns 0 with the leaf pinned in '*pg' */
+static int
+isam_position (struct isam_handle *h, const int mode,
+	       const unsigned char *record, int len,
+	       struct isam_page **pg, int *pos)
+{
+	struct isam_file	*fp = h->fp;
+	const struct isam_key	*k = &fp->keys[h->keyno];
+
+	switch (mode) {
+	case ISFIRST:
+		return isam_find (fp, k, NULL, 0, 0, pg, pos);
+	case ISLAST:
+		return isam_find_last (fp, k, pg, pos);
+	case ISEQUAL:
+	case ISGREAT:
+	case ISGTEQ:
+		if (len <= 0 || len > k->klen) {
+			len = k->klen;
+		}
+		isam_make_entry (k, record, 0, 0, h->entry);
+		if (isam_find (fp, k, h->entry, len, mode == ISGREAT, pg, pos)) {
+			if (mode == ISEQUAL && fp->st->iserrno == EENDFILE) {
+				fp->st->iserrno = ENOREC;
+			}
+			return 1;
+		}
+		if (mode == ISEQUAL
+		 && memcmp (ISAM_ENTRY ((*pg)->data, k, *pos), h->entry, len)) {
+			isam_page_put (*pg);
+			fp->st->iserrno = ENOREC;
+			return 1;
+		}
+		return 0;
+	case ISNEXT:
+	case ISPREV:
+	case ISCURR:
+		if (!h->has_cur) {
+			if (mode == ISCURR) {
+				fp->st->iserrno = ENOCURR;
+				return 1;
+			}
+			if (h->at_end && mode == ISNEXT) {
+				fp->st->iserrno = EENDFILE;
+				return 1;
+			}
+			return isam_position (h, mode == ISNEXT ? ISFIRST : ISLAST,
+					      NULL, 0, pg, pos);
+		}
+		/* continue directly in the leaf if the B+tree is unchanged */
+		if (h->cur_changes == fp->changes && h->cur_page != 0) {
+			*pg = isam_page_get (fp, h->cur_page);
+			if (*pg == NULL) {
+				return 1;
+			}
+			*pos = h->cur_pos;
+		} else if (isam_find (fp, k, h->cur, k->cmp_len, 0, pg, pos)) {
+			/* everything from the current entry on was deleted */
+			if (fp->st->iserrno != EENDFILE || mode == ISNEXT) {
+				return 1;
+			}
+			if (isam_find_last (fp, k, pg, pos)) {
+				return 1;
+			}
+			return 0;
+		}
+		/* *pos is now the current entry, or the one after it */
+		if (memcmp (ISAM_ENTRY ((*pg)->data, k, *pos), h->cur, k->cmp_len)) {
+			if (mode == ISCURR) {
+				isam_page_put (*pg);
+				fp->st->iserrno = ENOCURR;
+				return 1;
+			}
+			if (mode == ISNEXT) {
+				return 0;
+			}
+		} else if (mode == ISNEXT && h->started) {
+			return 0;
+		}
+		if (mode == ISCURR) {
+			return 0;
+		}
+		return isam_leaf_step (fp, pg, pos, mode == ISNEXT ? 1 : -1);
+	default:
+		fp->st->iserrno = EBADARG;
+		return 1;
+	}
+}
+
+/* make the entry at 'pos' of leaf 'pg' the current one */
+static void
+isam_set_current (struct isam_handle *h, struct isam_page *pg, const int pos)
+{
+	struct isam_file	*fp = h->fp;
+	const struct isam_key	*k = &fp->keys[h->keyno];
+	const unsigned char	*e = ISAM_ENTRY (pg->data, k, pos);
+
+	memcpy (h->cur, e, k->entry_len);
+	h->recnum = isam_get32 (e + k->cmp_len);
+	h->has_cur = 1;
+	h->at_end = 0;
+	h->cur_page = pg->pageno;
+	h->cur_pos = pos;
+	h->cur_changes = fp->changes;
+}
+
+/* set fp->st->isstat2 to '2' if the entry after the current has the same key */
+static void
+isam_check_next_dup (struct isam_handle *h, struct isam_page *pg, int pos)
+{
+	struct isam_file	*fp = h->fp;
+	const struct isam_key	*k = &fp->keys[h->keyno];
+
+	if (!(k->desc.k_flags & ISDUPS)) {
+		return;
+	}
+	pg->pins++;
+	if (isam_leaf_step (fp, &pg, &pos, 1)) {
+		fp->st->iserrno = 0;
+		return;
+	}
+	if (!memcmp (ISAM_ENTRY (pg->data, k, pos), h->cur, k->klen)) {
+		fp->st->isstat2 = '2';
+	}
+	isam_page_put (pg);
+}
+
+int
+cob_isstart (struct isam_status *st, int isfd, struct keydesc *key, int len,
+	     void *record, int mode)
+{
+	struct isam_handle	*h = isam_enter (st, isfd, 0);
+	struct isam_page	*pg;
+	int			pos;
+
+	if (h == NULL) {
+		return -1;
+	}
+	h->started = 0;
+	h->at_end = 0;
+	h->ahead_count = 0;
+	if (isam_select_key (h, key) == 0) {
+		if (h->keyno < 0) {
+			h->recnum = (unsigned int)st->isrecnum;
+		} else if (mode != ISFIRST && mode != ISLAST
+			&& mode != ISEQUAL && mode != ISGREAT && mode != ISGTEQ) {
+			st->iserrno = EBADARG;
+		} else if (isam_position (h, mode, record, len, &pg, &pos)) {
+			h->has_cur = 0;
+			if (st->iserrno == EENDFILE) {
+				/* no entry at or after the key: ISNEXT is at the end */
+				h->at_end = mode != ISLAST;
+				st->iserrno = ENOREC;
+			}
+		} else {
+			isam_set_current (h, pg, pos);
+			h->started = 1;
+			isam_page_put (pg);
+		}
+	}
+	return isam_leave (h, 0);
+}
+
+/* copy the record in 'slot' to 'record' */
+static void
+isam_copy_record (const struct isam_file *fp, const unsigned char *slot,
+		  unsigned char *record)
+{
+	const unsigned char	*data = slot + ISAM_SLOT_HEADER + 8 * fp->nkeys;
+
+	fp->st->isreclen = (int)isam_get32 (slot + 4);
+	memcpy (record, data, fp->varlen ? (size_t)fp->st->isreclen : fp->rec_size);
+}
+
+/* Read-ahead
+
+   With the runtime option COB_READ_AHEAD an ISNEXT without ISLOCK
+   reads the entries after the current one up to this number together
+   with their records, those with consecutive numbers in one read; the
+   following ISNEXT calls of the handle return these without locking
+   the index, until the file is updated in this process or the handle
+   is used otherwise.  Changes of other processes are seen with the
+   next batch, as for records read without lock. */
+
+/* fill the read-ahead of 'h' from the entries after the current one */
+static void
+isam_read_ahead (struct isam_handle *h)
+{
+	struct isam_file	*fp = h->fp;
+	const struct isam_key	*k = &fp->keys[h->keyno];
+	const size_t		elen = fp->rec_size + 12;
+	const int		max = (int)cobsetptr->cob_read_ahead;
+	struct isam_page	*pg;
+	unsigned char		*e;
+	int			pos = h->cur_pos;
+	int			n, i, j;
+
+	h->ahead_count = h->ahead_next = 0;
+	if (h->cur_changes != fp->changes || h->cur_page == 0) {
+		return;
+	}
+	if (max > h->ahead_alloc) {
+		/* COB_READ_AHEAD may be raised while the file is open */
+		if (h->ahead) {
+			cob_free (h->ahead);
+			cob_free (h->ahead_entries);
+			cob_free (h->ahead_slots);
+		}
+		h->ahead_alloc = max;
+		h->ahead = cob_malloc ((size_t)max * sizeof (struct isam_ahead));
+		h->ahead_entries = cob_fast_malloc ((size_t)max * elen);
+		h->ahead_slots = cob_fast_malloc ((size_t)max * fp->slot_size);
+	}
+	pg = isam_page_get (fp, h->cur_page);
+	if (pg == NULL) {
+		/* LCOV_EXCL_START */
+		fp->st->iserrno = 0;
+		return;
+		/* LCOV_EXCL_STOP */
+	}
+	for (n = 0; n < max; ++n) {
+		if (isam_leaf_step (fp, &pg, &pos, 1)) {
+			pg = NULL;
+			break;
+		}
+		e = h->ahead_entries + n * elen;
+		memcpy (e, ISAM_ENTRY (pg->data, k, pos), k->entry_len);
+		h->ahead[n].pageno = pg->pageno;
+		h->ahead[n].pos = pos;
+		h->ahead[n].dup = 0;
+		if (n > 0 && (k->desc.k_flags & ISDUPS)
+		 && !memcmp (e - elen, e, k->klen)) {
+			h->ahead[n - 1].dup = 1;
+		}
+	}
+	if (pg != NULL) {
+		if (!(k->desc.k_flags & ISDUPS)) {
+			isam_page_put (pg);
+		} else if (isam_leaf_step (fp, &pg, &pos, 1) == 0) {
+			/* fp->st->isstat2 of the last one needs the entry after it */
+			h->ahead[n - 1].dup = !memcmp (ISAM_ENTRY (pg->data, k, pos),
+				h->ahead_entries + (n - 1) * elen, k->klen);
+			isam_page_put (pg);
+		}
+	}
+	fp->st->iserrno = 0;
+	/* read the records, consecutive record numbers at once */
+	for (i = 0; i < n; i = j) {
+		const unsigned int	recnum = isam_get32 (h->ahead_entries
+						+ i * elen + k->cmp_len);
+		for (j = i + 1; j < n; ++j) {
+			if (isam_get32 (h->ahead_entries + j * elen + k->cmp_len)
+			    != recnum + (unsigned int)(j - i)) {
+				break;
+			}
+		}
+		if (recnum == 0 || recnum + (unsigned int)(j - i) > fp->next_recnum
+		 || isam_io (fp->dat_fd, isam_slot_offset (fp, recnum),
+			     h->ahead_slots + (size_t)i * fp->slot_size,
+			     (size_t)(j - i) * fp->slot_size, 0)) {
+			/* LCOV_EXCL_LINE */
+			break;
+		}
+	}
+	for (j = 0; j < i; ++j) {
+		if (isam_get32 (h->ahead_slots + (size_t)j * fp->slot_size) != 1) {
+			/* LCOV_EXCL_LINE */
+			break;
+		}
+	}
+	h->ahead_count = j;
+	h->ahead_changes = fp->changes;
+	h->ahead_updates = fp->updates;
+	if (j > 0) {
+		h->batches++;
+	}
+}
+
+/* return the next record read ahead for ISNEXT in 'record',
+   1 if there is none */
+static int
+isam_read_next_ahead (struct isam_handle *h, const int isfd,
+		      unsigned char *record, const int mode)
+{
+	struct isam_file	*fp = h->fp;
+	const struct isam_key	*k;
+	const unsigned char	*e;
+	const int		i = h->ahead_next;
+	unsigned int		recnum;
+
+	if (i >= h->ahead_count
+	 || h->ahead_changes != fp->changes
+	 || h->ahead_updates != fp->updates
+	 || h->started) {
+		return 1;
+	}
+	k = &fp->keys[h->keyno];
+	e = h->ahead_entries + (size_t)i * (fp->rec_size + 12);
+	recnum = isam_get32 (e + k->cmp_len);
+	fp->st->isstat1 = '0';
+	fp->st->isstat2 = '0';
+	if (!(mode & ISSKIPLOCK)
+	 && (h->mode & 0x03) != ISINPUT
+	 && isam_test_record (h, isfd, recnum, 0)) {
+		/* read again, waiting as configured */
+		fp->st->iserrno = 0;
+		return 1;
+	}
+	fp->st->iserrno = 0;
+	memcpy (h->cur, e, k->entry_len);
+	h->recnum = recnum;
+	h->has_cur = 1;
+	h->at_end = 0;
+	h->cur_page = h->ahead[i].pageno;
+	h->cur_pos = h->ahead[i].pos;
+	h->cur_changes = fp->changes;
+	if (h->ahead[i].dup) {
+		fp->st->isstat2 = '2';
+	}
+	fp->st->isrecnum = (long)recnum;
+	isam_copy_record (fp, h->ahead_slots + (size_t)i * fp->slot_size, record);
+	h->ahead_next++;
+	h->reads_next++;
+	h->reads_ahead++;
+	return 0;
+}
+
+/* read by record number, ISNEXT / ISPREV in the order of the slots */
+static int
+isam_read_recnum (struct isam_handle *h, const int isfd,
+		  unsigned char *record, const int mode)
+{
+	struct isam_file	*fp = h->fp;
+	unsigned int		recnum = h->recnum;
+
+	switch (mode & 0xFF) {
+	case ISFIRST:
+		recnum = 0;
+		/* Fall-through */
+	case ISNEXT:
+		for (recnum++; recnum < fp->next_recnum; ++recnum) {
+			if (isam_read_slot (fp, recnum) == 0) {
+				break;
+			}
+		}
+		break;
+	case ISLAST:
+		recnum = fp->next_recnum;
+		/* Fall-through */
+	case ISPREV:
+		for (; recnum > 1; ) {
+			if (isam_read_slot (fp, --recnum) == 0) {
+				break;
+			}
+		}
+		break;
+	case ISEQUAL:
+	case ISGTEQ:
+		recnum = (unsigned int)fp->st->isrecnum;
+		/* Fall-through */
+	default:
+		if (isam_read_slot (fp, recnum)) {
+			return 1;
+		}
+		break;
+	}
+	if (recnum == 0 || recnum >= fp->next_recnum
+	 || isam_get32 (fp->slot) != 1) {
+		fp->st->iserrno = (mode & 0xFF) == ISNEXT || (mode & 0xFF) == ISPREV
+			? EENDFILE : ENOREC;
+		return 1;
+	}
+	h->recnum = recnum;
+	fp->st->isrecnum = (long)recnum;
+	if ((mode & ISLOCK) && isam_lock_record (h, isfd, recnum, mode & ISWAIT)) {
+		return 1;
+	}
+	isam_copy_record (fp, fp->slot, record);
+	return 0;
+}
+
+int
+cob_isread (struct isam_status *st, int isfd, void *record, int mode)
+{
+	struct isam_handle	*h = isam_handle (st, isfd);
+	struct isam_file	*fp;
+	struct isam_page	*pg;
+	int			pos;
+
+	if (h != NULL && h->ahead_count > 0) {
+		if ((mode & 0xFF) == ISNEXT && !(mode & ISLOCK)
+		 && isam_read_next_ahead (h, isfd, record, mode) == 0) {
+			return 0;
+		}
+		h->ahead_count = 0;
+	}
+	h = isam_enter (st, isfd, 0);
+	if (h == NULL) {
+		return -1;
+	}
+	fp = h->fp;
+	if (h->keyno < 0) {
+		isam_read_recnum (h, isfd, record, mode);
+		return isam_leave (h, 0);
+	}
+	if (isam_position (h, mode & 0xFF, record, 0, &pg, &pos)) {
+		return isam_leave (h, 0);
+	}
+	isam_set_current (h, pg, pos);
+	h->started = 0;
+	st->isrecnum = (long)h->recnum;
+	if ((mode & 0xFF) == ISNEXT || (mode & 0xFF) == ISCURR) {
+		isam_check_next_dup (h, pg, pos);
+	}
+	isam_page_put (pg);
+	if (isam_read_slot (fp, h->recnum)) {
+		/* LCOV_EXCL_LINE */
+		return isam_leave (h, 0);
+	}
+	if (mode & ISLOCK) {
+		if (isam_lock_record (h, isfd, h->recnum, mode & ISWAIT)) {
+			return isam_leave (h, 0);
+		}
+		/* the record may have been changed while waiting */
+		if ((mode & ISWAIT || cobsetptr->cob_lock_wait)
+		 && isam_read_slot (fp, h->recnum)) {
+			return isam_leave (h, 0);
+		}
+	} else if (!(mode & ISSKIPLOCK)
+		&& (h->mode & 0x03) != ISINPUT) {
+		if (isam_test_record (h, isfd, h->recnum, 1)) {
+			return isam_leave (h, 0);
+		}
+		/* the record may have been changed while waiting */
+		if (cobsetptr->cob_lock_wait
+		 && isam_read_slot (fp, h->recnum)) {
+			return isam_leave (h, 0);
+		}
+	}
+	isam_copy_record (fp, fp->slot, record);
+	if ((mode & 0xFF) == ISNEXT) {
+		h->reads_next++;
+		if (!(mode & ISLOCK) && cobsetptr->cob_read_ahead > 1) {
+			isam_read_ahead (h);
+		}
+	}
+	return isam_leave (h, 0);
+}
+
+/* statistics of ISNEXT on 'isfd' for COB_READ_AHEAD_STATS */
+void
+cob_isam_read_stats (struct isam_status *st, const int isfd,
+		     const char *select_name)
+{
+	struct isam_handle	*h = isam_handle (st, isfd);
+
+	if (h == NULL || h->reads_next == 0) {
+		return;
+	}
+	fprintf (stderr, _("READ NEXT %s: %lu records, %lu read ahead in %lu batches"),
+		select_name, h->reads_next, h->reads_ahead, h->batches);
+	putc ('\n', stderr);
+}
+
+/* Updates */
+
+/* check the keys of 'record' (to replace the record in fp->slot if
+   'recnum' is not 0) for duplicates; sets fp->st->isstat2 for duplicates */
+static int
+isam_check_keys (struct isam_handle *h, const unsigned char *record,
+		 const unsigned int recnum)
+{
+	struct isam_file	*fp = h->fp;
+	const unsigned char	*old = fp->slot + ISAM_SLOT_HEADER + 8 * fp->nkeys;
+	unsigned int		k;
+
+	for (k = 0; k < fp->nkeys; ++k) {
+		const struct isam_key	*key = &fp->keys[k];
+		int			found;
+		if ((fp->bulk && (key->desc.k_flags & ISDUPS))
+		 || isam_null_key (key, record)) {
+			/* not searched while loading or not indexed,
+			   no status 02 */
+			continue;
+		}
+		isam_make_entry (key, record, 0, 0, h->entry);
+		if (recnum != 0) {
+			isam_make_entry (key, old, 0, 0, h->entry2);
+			if (!memcmp (h->entry, h->entry2, key->klen)) {
+				continue;
+			}
+		}
+		found = isam_key_exists (fp, key, h->entry, recnum);
+		if (found < 0) {
+			return 1;
+		}
+		if (found) {
+			if (!(key->desc.k_flags & ISDUPS)) {
+				fp->st->iserrno = EDUPL;
+				return 1;
+			}
+			fp->st->isstat2 = '2';
+		}
+	}
+	return 0;
+}
+
+/* write 'record' to the slot of 'recnum', insert the entries of the
+   keys that changed against the record in fp->slot ('rewrite') */
+static int
+isam_store (struct isam_handle *h, const unsigned char *record,
+	    const unsigned int recnum, const int rewrite)
+{
+	struct isam_file	*fp = h->fp;
+	unsigned char		*slot = fp->slot;
+	unsigned char		*data = slot + ISAM_SLOT_HEADER + 8 * fp->nkeys;
+	unsigned int		len = fp->rec_size;
+	unsigned int		k;
+
+	if (fp->varlen) {
+		if (fp->st->isreclen <= 0 || fp->st->isreclen > (int)fp->rec_size) {
+			fp->st->iserrno = EBADARG;
+			return 1;
+		}
+		len = (unsigned int)fp->st->isreclen;
+	}
+	for (k = 0; k < fp->nkeys; ++k) {
+		struct isam_key	*key = &fp->keys[k];
+		cob_u64_t	seq = rewrite ? isam_slot_seq (fp, k) : 0;
+		if (rewrite) {
+			isam_make_entry (key, data, seq, recnum, h->entry2);
+			isam_make_entry (key, record, seq, recnum, h->entry);
+			if (!memcmp (h->entry, h->entry2, key->klen)) {
+				continue;
+			}
+			if (!isam_null_key (key, data)
+			 && isam_remove (fp, key, h->entry2)) {
+				return 1;
+			}
+		}
+		if (isam_null_key (key, record)) {
+			continue;
+		}
+		if (key->desc.k_flags & ISDUPS) {
+			/* new values go after the existing duplicates */
+			seq = ++fp->dup_seq;
+			fp->hdr_dirty = 1;
+			memcpy (slot + ISAM_SLOT_HEADER + 8 * k, &seq, 8);
+		}
+		isam_make_entry (key, record, seq, recnum, h->entry);
+		if (fp->bulk && !rewrite && (key->desc.k_flags & ISDUPS)) {
+			if (isam_defer (fp, key, h->entry)) {
+				return 1;
+			}
+		} else if (isam_insert (fp, key, h->entry)) {
+			return 1;
+		}
+	}
+	isam_put32 (slot, 1);
+	isam_put32 (slot + 4, len);
+	memcpy (data, record, len);
+	if (len < fp->rec_size) {
+		memset (data + len, 0, fp->rec_size - len);
+	}
+	fp->st->iserrno = isam_write_slot (fp, recnum, !rewrite);
+	return fp->st->iserrno != 0;
+}
+
+int
+cob_iswrite (struct isam_status *st, int isfd, void *record)
+{
+	struct isam_handle	*h = isam_enter (st, isfd, ISAM_APPEND);
+	struct isam_file	*fp;
+	unsigned int		recnum;
+
+	if (h == NULL) {
+		return -1;
+	}
+	fp = h->fp;
+	if (isam_check_keys (h, record, 0)) {
+		return isam_leave (h, 1);
+	}
+	/* reuse a deleted slot */
+	recnum = fp->free_rec;
+	if (recnum != 0) {
+		st->iserrno = isam_write_slots (fp);
+		if (st->iserrno) {
+			/* LCOV_EXCL_LINE */
+			return isam_leave (h, 1);
+		}
+		st->iserrno = isam_io (fp->dat_fd, isam_slot_offset (fp, recnum),
+				   fp->slot, fp->slot_size, 0);
+		if (st->iserrno) {
+			return isam_leave (h, 1);
+		}
+		fp->free_rec = isam_get32 (fp->slot + 4);
+	} else {
+		recnum = fp->next_recnum++;
+	}
+	memset (fp->slot, 0, ISAM_SLOT_HEADER + 8 * fp->nkeys);
+	fp->nrecords++;
+	fp->hdr_dirty = 1;
+	st->isrecnum = (long)recnum;
+	isam_store (h, record, recnum, 0);
+	return isam_leave (h, 1);
+}
+
+/* replace record 'recnum' (in fp->slot) by 'record' */
+static int
+isam_rewrite (struct isam_handle *h, const int isfd,
+	      const unsigned char *record, const unsigned int recnum)
+{
+	if (isam_test_record (h, isfd, recnum, 0)
+	 || isam_check_keys (h, record, recnum)
+	 || isam_store (h, record, recnum, 1)) {
+		return 1;
+	}
+	h->fp->st->isrecnum = (long)recnum;
+	return 0;
+}
+
+/* find the record with the primary key of 'record' into fp->slot */
+static int
+isam_find_primary (struct isam_handle *h, const unsigned char *record,
+		   unsigned int *recnum)
+{
+	struct isam_file	*fp = h->fp;
+	const struct isam_key	*k = &fp->keys[0];
+	struct isam_page	*pg;
+	int			pos;
+
+	isam_make_entry (k, record, 0, 0, h->entry);
+	if (isam_find (fp, k, h->entry, k->klen, 0, &pg, &pos)) {
+		if (fp->st->iserrno == EENDFILE) {
+			fp->st->iserrno = ENOREC;
+		}
+		return 1;
+	}
+	if (memcmp (ISAM_ENTRY (pg->data, k, pos), h->entry, k->klen)) {
+		isam_page_put (pg);
+		fp->st->iserrno = ENOREC;
+		return 1;
+	}
+	*recnum = isam_get32 (ISAM_ENTRY (pg->data, k, pos) + k->cmp_len);
+	isam_page_put (pg);
+	return isam_read_slot (fp, *recnum);
+}
+
+int
+cob_isrewrite (struct isam_status *st, int isfd, void *record)
+{
+	struct isam_handle	*h = isam_enter (st, isfd, 1);
+	unsigned int		recnum;
+
+	if (h == NULL) {
+		return -1;
+	}
+	if (isam_find_primary (h, record, &recnum) == 0) {
+		isam_rewrite (h, isfd, record, recnum);
+	}
+	return isam_leave (h, 1);
+}
+
+int
+cob_isrewcurr (struct isam_status *st, int isfd, void *record)
+{
+	struct isam_handle	*h = isam_enter (st, isfd, 1);
+
+	if (h == NULL) {
+		return -1;
+	}
+	if (h->recnum == 0) {
+		st->iserrno = ENOCURR;
+	} else if (isam_read_slot (h->fp, h->recnum) == 0) {
+		isam_rewrite (h, isfd, record, h->recnum);
+	}
+	return isam_leave (h, 1);
+}
+
+int
+cob_isdelete (struct isam_status *st, int isfd, void *record)
+{
+	struct isam_handle	*h = isam_enter (st, isfd, 1);
+	struct isam_file	*fp;
+	unsigned int		recnum;
+	unsigned int		k;
+
+	if (h == NULL) {
+		return -1;
+	}
+	fp = h->fp;
+	if (isam_find_primary (h, record, &recnum)
+	 || isam_test_record (h, isfd, recnum, 0)) {
+		return isam_leave (h, 1);
+	}
+	for (k = 0; k < fp->nkeys; ++k) {
+		const struct isam_key	*key = &fp->keys[k];
+		const unsigned char	*data
+			= fp->slot + ISAM_SLOT_HEADER + 8 * fp->nkeys;
+		if (isam_null_key (key, data)) {
+			continue;
+		}
+		isam_make_entry (key, data, isam_slot_seq (fp, k), recnum, h->entry);
+		if (isam_remove (fp, key, h->entry)) {
+			return isam_leave (h, 1);
+		}
+	}
+	/* chain the slot for reuse */
+	isam_put32 (fp->slot, 0);
+	isam_put32 (fp->slot + 4, fp->free_rec);
+	st->iserrno = isam_io (fp->dat_fd, isam_slot_offset (fp, recnum),
+			   fp->slot, ISAM_SLOT_HEADER, 1);
+	if (st->iserrno == 0) {
+		fp->free_rec = recnum;
+		fp->nrecords--;
+		fp->hdr_dirty = 1;
+		st->isrecnum = (long)recnum;
+	}
+	return isam_leave (h, 1);
+}
+
+/* Journal */
+
+/* journal the changes of the files of 'isfd', see cob_journal_before */
+void
+cob_isam_journal_add (struct isam_status *st, const int isfd)
+{
+	struct isam_handle	*h = isam_handle (st, isfd);
+	char			*name;
+
+	if (h == NULL || h->fp->readonly) {
+		return;
+	}
+	name = isam_file_name (h->fp->name, ".idx");
+	cob_journal_add_file (h->fp->idx_fd, name, NULL);
+	cob_free (name);
+	name = isam_file_name (h->fp->name, ".dat");
+	cob_journal_add_file (h->fp->dat_fd, name, NULL);
+	cob_free (name);
+}
+
+/* write the changed pages of all files */
+void
+cob_isam_journal_flush (void)
+{
+	struct isam_status	st;
+	struct isam_file	*fp;
+
+	for (fp = isam_files; fp; fp = fp->next) {
+		fp->st = &st;
+		if (!fp->readonly && fp->pages
+		 && isam_bulk_flush (fp) == 0) {
+			(void)isam_cache_flush (fp);
+		}
+	}
+}
+
+/* forget the cached pages and counters after ROLLBACK */
+void
+cob_isam_journal_reload (void)
+{
+	struct isam_status	st;
+	struct isam_file	*fp;
+
+	for (fp = isam_files; fp; fp = fp->next) {
+		fp->st = &st;
+		if (!fp->readonly && fp->pages) {
+			isam_cache_drop (fp);
+			(void)isam_read_header (fp, 1);
+			fp->hdr_dirty = 0;
+		}
+	}
+}
+
+void
+cob_init_isam (cob_settings *sptr)
+{
+	cobsetptr = sptr;
+}
+
+#endif	/* built-in ISAM */
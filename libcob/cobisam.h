@@ -0,0 +1,107 @@
+/*
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of GnuCOBOL.
+
+   The GnuCOBOL runtime library is free software: you can redistribute it
+   and/or modify it under the terms of the GNU Lesser General Public License
+   as published by the Free Software Foundation, either version 3 of the
+   License, or (at your option) any later version.
+
+   GnuCOBOL is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with GnuCOBOL.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef COB_ISAM_H
+#define COB_ISAM_H
+
+/* Built-in ISAM, used when no external INDEXED handler is configured;
+   it provides the part of the C-ISAM interface used by fileio.c, but
+   reports the result of each call in the caller's 'struct isam_status'
+   instead of the global iserrno, see cobisam.c for the implementation
+   and coblocal.h for the prototypes */
+
+#define	NPARTS		COB_MAX_KEYCOMP
+
+struct keypart {
+	int		kp_start;	/* Offset of the part in the record */
+	int		kp_leng;	/* Length of the part */
+	int		kp_type;	/* Type, CHARTYPE | null character << 8 */
+};
+
+struct keydesc {
+	int		k_flags;	/* ISDUPS / ISNODUPS, NULLKEY */
+	int		k_nparts;	/* Number of parts, 0 = record number */
+	struct keypart	k_part[NPARTS];
+	int		k_len;		/* Total length of the key */
+};
+#define	k_start		k_part[0].kp_start
+#define	k_leng		k_part[0].kp_leng
+#define	k_type		k_part[0].kp_type
+
+struct dictinfo {
+	int		di_nkeys;	/* Number of keys, 0x80 set for ISVARLEN */
+	int		di_recsize;	/* Maximal record size */
+	int		di_idxsize;	/* Size of an index page */
+	long		di_nrecords;	/* Number of records */
+};
+
+/* Result of the last call, kept by the caller per handle */
+struct isam_status {
+	int		iserrno;	/* Error of the last call */
+	long		isrecnum;	/* Record number of the last call */
+	int		isreclen;	/* Record length for ISVARLEN */
+	char		isstat1;	/* '0' and isstat2 '2' after a duplicate */
+	char		isstat2;
+};
+
+#define	CHARTYPE	0
+#define	ISNODUPS	0
+#define	ISDUPS		1
+#define	NULLKEY		0x20	/* No entry if all parts hold their null
+				   character, kp_type >> 8 (SUPPRESS) */
+
+/* Modes for isopen / isbuild */
+#define	ISINPUT		0
+#define	ISOUTPUT	1
+#define	ISINOUT		2
+#define	ISAUTOLOCK	0x200
+#define	ISMANULOCK	0x400
+#define	ISEXCLLOCK	0x800
+#define	ISVARLEN	0x1000
+
+/* Modes for isread / isstart */
+#define	ISFIRST		0
+#define	ISLAST		1
+#define	ISNEXT		2
+#define	ISPREV		3
+#define	ISCURR		4
+#define	ISEQUAL		5
+#define	ISGREAT		6
+#define	ISGTEQ		7
+#define	ISLOCK		0x100
+#define	ISSKIPLOCK	0x200	/* Ignore locks of other users */
+#define	ISWAIT		0x400
+#define	ISLCKW		(ISLOCK | ISWAIT)
+
+/* Error codes in iserrno, besides those of errno */
+#define	EDUPL		100
+#define	ENOTOPEN	101
+#define	EBADARG		102
+#define	EBADKEY		103
+#define	ETOOMANY	104
+#define	EBADFILE	105
+#define	ENOTEXCL	106
+#define	ELOCKED		107
+#define	EKEXISTS	108
+#define	EENDFILE	110
+#define	ENOREC		111
+#define	ENOCURR		112
+#define	EFLOCKED	113
+
+#endif	/* COB_ISAM_H */
@@ -243,6 +243,13 @@ Note: also defined together with __clang__ in both frontends:
 #define COB_D2I(x)		((x) & 0x0F)
 #define COB_I2D(x)		(char) ('0' + (x))
 
+/* SSE2 is part of x86-64, SIMD code using it needs <emmintrin.h>;
+   define COB_NO_SIMD to use the scalar code only */
+#if	!defined (COB_NO_SIMD) \
+ && (defined (__x86_64__) || defined (_M_X64) || defined (__SSE2__))
+#define COB_SIMD_SSE2
+#endif
+
 #define	COB_MODULE_PTR		cobglobptr->cob_current_module
 #define	COB_TERM_BUFF		cobglobptr->cob_term_buff
 #define	COB_ACCEPT_STATUS	cobglobptr->cob_accept_status
@@ -302,6 +309,7 @@ typedef struct __cob_settings {
 	char		*cob_preload_str;
 	char		*cob_library_path;
 	char		*cob_preload_str_set;
+	unsigned int	cob_resolve_check;	/* Seconds between checks of COB_LIBRARY_PATH */
 
 	size_t		*resolve_size;	/* Array size of resolve_path*/
 	char		*cob_preload_resolved;
@@ -319,9 +327,26 @@ typedef struct __cob_settings {
 	unsigned int	cob_concat_name;	/* Concatenated sequential input file names */
 	unsigned char	cob_concat_sep[4];	/* Concatenated sequential file name separator (+)*/
 	char 		*cob_file_path;
+	char		*cob_file_journal;	/* Journal of before-images for ROLLBACK */
+	unsigned int	cob_lock_wait;		/* Milliseconds to wait for a record lock */
+	unsigned int	cob_bulk_load;		/* Defer index entries on OPEN OUTPUT */
+	unsigned int	cob_read_ahead;		/* Records read ahead by READ NEXT */
+	unsigned int	cob_read_ahead_stats;	/* Statistics of READ NEXT on CLOSE */
 	char		*bdb_home;
+	size_t		bdb_cache_size;		/* Size of the BDB cache */
+	unsigned int	bdb_cache_count;	/* Number of BDB cache regions */
+	size_t		bdb_mmap_size;		/* Max. size of BDB files mapped, 0 = BDB default */
+	size_t		bdb_page_size;		/* Page size of new BDB files, 0 = BDB default */
+	unsigned int	bdb_stats;		/* Report BDB cache hits / misses on stderr */
 	size_t		cob_sort_memory;
 	size_t		cob_sort_chunk;
+	unsigned int	cob_sort_stats;		/* Report SORT runs / passes on stderr */
+	unsigned int	cob_sort_threads;	/* Threads for sorting in memory */
+	unsigned int	cob_sort_radix;		/* SORT by encoded keys with radix sort */
+	size_t		cob_sort_block_size;	/* Blocks of SORT temporary files, 0 = chunk */
+	unsigned int	cob_sort_compress;	/* Compression level of SORT temporary files */
+	size_t		cob_seq_buffer_size;	/* Block buffer for SEQUENTIAL files, 0 = unbuffered */
+	unsigned int	cob_file_mmap;		/* Map SEQUENTIAL / RELATIVE files opened INPUT */
 
 	/* move.c */
 	unsigned int	cob_local_edit;
@@ -477,6 +502,64 @@ COB_HIDDEN void		cob_exit_intrinsic	(void);
 COB_HIDDEN void		cob_exit_strings	(void);
 COB_HIDDEN void		cob_exit_mlio		(void);
 
+/* byte locks of fileio.c, used by RELATIVE files, LMDB and the built-in ISAM */
+#define	COB_BYTE_UNLOCK		0
+#define	COB_BYTE_READ_LOCK	1
+#define	COB_BYTE_WRITE_LOCK	2
+
+COB_HIDDEN int		cob_lock_byte		(const int, const unsigned int,
+						 const int, const int);
+COB_HIDDEN int		cob_lock_byte_held	(const int, const unsigned int);
+COB_HIDDEN int		cob_lock_byte_wait	(const int, const unsigned int,
+						 const int);
+
+/* COB_FILE_JOURNAL of fileio.c, also used by the built-in ISAM */
+COB_HIDDEN void		cob_journal_add_file	(const int, const char *,
+						 cob_file *);
+COB_HIDDEN void		cob_journal_remove_file	(const int);
+COB_HIDDEN int		cob_journal_before	(const int, const cob_s64_t,
+						 size_t);
+
+/* built-in ISAM, see cobisam.h */
+struct isam_status;
+struct keydesc;
+COB_HIDDEN int		cob_isopen		(struct isam_status *,
+						 const char *, int);
+COB_HIDDEN int		cob_isbuild		(struct isam_status *,
+						 const char *, int,
+						 struct keydesc *, int);
+COB_HIDDEN int		cob_isaddindex		(struct isam_status *, int,
+						 struct keydesc *);
+COB_HIDDEN int		cob_isindexinfo		(struct isam_status *, int,
+						 void *, int);
+COB_HIDDEN int		cob_isclose		(struct isam_status *, int);
+COB_HIDDEN int		cob_iserase		(struct isam_status *,
+						 const char *);
+COB_HIDDEN int		cob_isstart		(struct isam_status *, int,
+						 struct keydesc *, int, void *,
+						 int);
+COB_HIDDEN int		cob_isread		(struct isam_status *, int,
+						 void *, int);
+COB_HIDDEN int		cob_iswrite		(struct isam_status *, int,
+						 void *);
+COB_HIDDEN int		cob_isrewrite		(struct isam_status *, int,
+						 void *);
+COB_HIDDEN int		cob_isrewcurr		(struct isam_status *, int,
+						 void *);
+COB_HIDDEN int		cob_isdelete		(struct isam_status *, int,
+						 void *);
+COB_HIDDEN int		cob_isrelease		(struct isam_status *, int);
+COB_HIDDEN int		cob_isflush		(struct isam_status *, int);
+COB_HIDDEN int		cob_iscleanup		(void);
+
+COB_HIDDEN void		cob_init_isam		(cob_settings *);
+COB_HIDDEN void		cob_isam_read_stats	(struct isam_status *,
+						 const int, const char *);
+COB_HIDDEN void		cob_isam_journal_add	(struct isam_status *,
+						 const int);
+COB_HIDDEN void		cob_isam_journal_flush	(void);
+COB_HIDDEN void		cob_isam_journal_reload	(void);
+
 COB_HIDDEN FILE		*cob_create_tmpfile	(const char *);
 COB_HIDDEN int		cob_check_numval_f	(const cob_field *);
 
@@ -493,6 +576,12 @@ COB_HIDDEN void		cob_decimal_setget_fld	(cob_field *, cob_field *,
 COB_HIDDEN void		cob_decimal_move_temp	(cob_field *, cob_field *);
 COB_HIDDEN void		cob_move_display_to_packed (cob_field *, cob_field *);
 COB_HIDDEN void		cob_move_packed_to_display (cob_field *, cob_field *);
+COB_HIDDEN int		cob_check_digits	(const unsigned char *, size_t);
+COB_HIDDEN void		cob_pack_digits		(unsigned char *,
+						 const unsigned char *, size_t);
+COB_HIDDEN void		cob_unpack_digits	(unsigned char *,
+						 const unsigned char *, size_t);
+COB_HIDDEN cob_u64_t	cob_digits_to_u64	(const unsigned char *, size_t);
 
 COB_HIDDEN void		cob_display_common	(const cob_field *, FILE *);
 COB_HIDDEN void		cob_print_ieeedec	(const cob_field *, FILE *);
@@ -508,10 +597,48 @@ COB_HIDDEN int		cob_check_env_false	(char*);
 COB_HIDDEN const char	*cob_get_last_exception_name	(void);
 COB_HIDDEN void		cob_parameter_check	(const char *, const int);
 COB_HIDDEN char*        cob_get_strerror (void);
+COB_HIDDEN void		cob_sleep_msec		(const unsigned int);
 
 COB_HIDDEN int		cob_cmp_strings (unsigned char*, unsigned char*,
 						 size_t, size_t, const unsigned char*);
 
+/* SORT key, prepared once by cob_sort_key_init for comparing records */
+enum cob_sort_key_type {
+	COB_SORT_KEY_MEMCMP,		/* bytes compare (alphanumeric, unsigned
+					   big-endian binary, unsigned packed) */
+	COB_SORT_KEY_COLLATE,		/* alphanumeric with collating sequence */
+	COB_SORT_KEY_DIGITS,		/* unsigned numeric DISPLAY */
+	COB_SORT_KEY_BINARY_S,		/* signed big-endian binary */
+	COB_SORT_KEY_NATIVE_U,		/* unsigned native binary (COMP-5) */
+	COB_SORT_KEY_NATIVE_S,		/* signed native binary (COMP-5) */
+	COB_SORT_KEY_NUMERIC		/* any other numeric: cob_numeric_cmp */
+};
+
+struct cob_sort_key {
+	cob_field		*field;		/* Key field */
+	const unsigned char	*col;		/* Collating sequence */
+	unsigned int		offset;		/* Offset of field in record */
+	unsigned int		size;		/* Size of field */
+	enum cob_sort_key_type	type;
+	int			descending;
+	int			thread_safe;	/* Compare only reads the records */
+	unsigned int		encoded_size;	/* Size of the key encoded by
+						   cob_sort_key_encode, 0 if
+						   it can't be encoded */
+};
+
+COB_HIDDEN void		cob_sort_key_init	(struct cob_sort_key *, cob_field *,
+						 const int, const unsigned int,
+						 const unsigned char *);
+COB_HIDDEN int		cob_sort_key_cmp	(const struct cob_sort_key *,
+						 const size_t, const unsigned char *,
+						 const unsigned char *);
+COB_HIDDEN cob_u64_t	cob_sort_key_prefix	(const struct cob_sort_key *,
+						 const unsigned char *);
+COB_HIDDEN void		cob_sort_key_encode	(const struct cob_sort_key *,
+						 const unsigned char *,
+						 unsigned char *);
+
 enum cob_case_modifier {
 	CCM_NONE,
 	CCM_LOWER,
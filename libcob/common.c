@@ -92,6 +92,11 @@
 #include <locale.h>
 #endif
 
+#ifdef	HAVE_PTHREAD
+#include <pthread.h>
+#define	COB_TABLE_SORT_USE_THREADS
+#endif
+
 /* library headers for version output */
 #ifdef _WIN32
 #ifndef __GMP_LIBGMP_DLL
@@ -108,6 +113,8 @@
 
 #ifdef	WITH_DB
 #include <db.h>
+#elif	defined(WITH_LMDB)
+#include <lmdb.h>
 #endif
 
 #if defined (HAVE_NCURSESW_NCURSES_H)
@@ -335,9 +342,46 @@ static size_t			cob_local_env_size = 0;
 
 static struct cob_external	*basext = NULL;
 
-static size_t			sort_nkeys = 0;
-static cob_file_key		*sort_keys = NULL;
-static const unsigned char	*sort_collate = NULL;
+/* keys of the table SORT being set up, per thread so that
+   programs in different threads may sort at the same time */
+struct cob_table_sort_state {
+	struct cob_sort_key	*keys;
+	size_t			nkeys;
+	size_t			alloc;		/* allocated keys */
+	const unsigned char	*collate;
+};
+COB_TLS struct cob_table_sort_state	table_sort_state;
+
+/* tables with less entries are searched without index */
+#define	COB_SEARCH_INDEX_MIN	32
+/* number of indexes kept, per thread */
+#define	COB_SEARCH_INDEX_MAX	8
+
+/* hash index on the key of a table: the entries are chained by the hash
+   of their key in ascending order, along with a copy of the keys to
+   find out if the table was changed since the index was built; that
+   is only checked after a statement that may change the table, which
+   is told by cob_search_index_changed */
+struct cob_search_index {
+	const unsigned char	*data;		/* key in the first entry */
+	size_t			stride;		/* size of an entry */
+	size_t			size;		/* size of the key */
+	int			type;		/* type of search_all_ctx */
+	int			sign;		/* native key is signed */
+	unsigned int		gen;		/* search_index_gen when checked */
+	int			count;		/* indexed entries */
+	int			alloc;		/* allocated entries */
+	unsigned int		mask;		/* number of buckets - 1 */
+	int			*head;		/* first entry per bucket */
+	int			*tail;		/* last entry per bucket */
+	int			*chain;		/* next entry in the bucket */
+	unsigned char		*keys;		/* copy of the indexed keys */
+};
+
+COB_TLS struct cob_search_index	*search_index[COB_SEARCH_INDEX_MAX];
+COB_TLS unsigned int		search_index_next;
+COB_TLS unsigned int		search_index_gen;
+static void	search_index_free (struct cob_search_index *);
 
 static const char		*cob_source_file = NULL;
 static unsigned int		cob_source_line = 0;
@@ -494,6 +538,7 @@ static struct config_tbl gc_conf[] = {
 	{"LOGICAL_CANCELS", "logical_cancels", 	NULL, NULL, GRP_HIDE, ENV_BOOL | ENV_NOT, SETPOS (cob_physical_cancel)},
 	{"COB_LIBRARY_PATH", "library_path", 	NULL, 	NULL, GRP_CALL, ENV_PATH, SETPOS (cob_library_path)}, /* default value set in cob_init_call() */
 	{"COB_PRE_LOAD", "pre_load", 		NULL, 	NULL, GRP_CALL, ENV_STR, SETPOS (cob_preload_str)},
+	{"COB_RESOLVE_CHECK", "resolve_check", 	"0", 	NULL, GRP_CALL, ENV_UINT, SETPOS (cob_resolve_check)},
 	{"COB_BELL", "bell", 			"0", 	beepopts, GRP_SCREEN, ENV_UINT | ENV_ENUMVAL, SETPOS (cob_beep_value)},
 	{"COB_DEBUG_LOG", "debug_log", 		NULL, 	NULL, GRP_HIDE, ENV_FILE, SETPOS (cob_debug_log)},
 	{"COB_DISABLE_WARNINGS", "disable_warnings", "0", 	NULL, GRP_MISC, ENV_BOOL | ENV_NOT, SETPOS (cob_display_warn)},
@@ -547,11 +592,28 @@ static struct config_tbl gc_conf[] = {
 	{"COB_LS_SPLIT", "ls_split", 		"1", 	NULL, GRP_FILE, ENV_BOOL, SETPOS (cob_ls_split)},
     {"COB_SEQ_CONCAT_NAME","seq_concat_name","0",NULL,GRP_FILE,ENV_BOOL,SETPOS(cob_concat_name)},
     {"COB_SEQ_CONCAT_SEP","seq_concat_sep","+",NULL,GRP_FILE,ENV_CHAR,SETPOS(cob_concat_sep),1},
+	{"COB_SEQ_BUFFER_SIZE", "seq_buffer_size", 	"0", 	NULL, GRP_FILE, ENV_SIZE, SETPOS (cob_seq_buffer_size), 0, (16 * 1024 * 1024)},
+	{"COB_FILE_MMAP", "file_mmap", 		"0", 	NULL, GRP_FILE, ENV_BOOL, SETPOS (cob_file_mmap)},
 	{"COB_SORT_CHUNK", "sort_chunk", 		"256K", 	NULL, GRP_FILE, ENV_SIZE, SETPOS (cob_sort_chunk), (128 * 1024), (16 * 1024 * 1024)},
 	{"COB_SORT_MEMORY", "sort_memory", 	"128M", 	NULL, GRP_FILE, ENV_SIZE, SETPOS (cob_sort_memory), (1024*1024), 4294967294UL /* max. guaranteed - 1 */},
+	{"COB_SORT_STATS", "sort_stats", 		"0", 	NULL, GRP_FILE, ENV_BOOL, SETPOS (cob_sort_stats)},
+	{"COB_SORT_THREADS", "sort_threads", 	"1", 	NULL, GRP_FILE, ENV_UINT, SETPOS (cob_sort_threads), 1, 64},
+	{"COB_SORT_RADIX", "sort_radix", 		"0", 	NULL, GRP_FILE, ENV_BOOL, SETPOS (cob_sort_radix)},
+	{"COB_SORT_BLOCK_SIZE", "sort_block_size", 	"0", 	NULL, GRP_FILE, ENV_SIZE, SETPOS (cob_sort_block_size), 0, (16 * 1024 * 1024)},
+	{"COB_SORT_COMPRESS", "sort_compress", 	"0", 	NULL, GRP_FILE, ENV_UINT, SETPOS (cob_sort_compress), 0, 9},
 	{"COB_SYNC", "sync", 			"0", 	syncopts, GRP_FILE, ENV_BOOL, SETPOS (cob_do_sync)},
+	{"COB_FILE_JOURNAL", "file_journal", 	NULL, 	NULL, GRP_FILE, ENV_FILE, SETPOS (cob_file_journal)},
+	{"COB_LOCK_WAIT", "lock_wait", 		"0", 	NULL, GRP_FILE, ENV_UINT, SETPOS (cob_lock_wait), 0, 3600000},
+	{"COB_BULK_LOAD", "bulk_load", 		"0", 	NULL, GRP_FILE, ENV_BOOL, SETPOS (cob_bulk_load)},
+	{"COB_READ_AHEAD", "read_ahead", 		"0", 	NULL, GRP_FILE, ENV_UINT, SETPOS (cob_read_ahead), 0, 4096},
+	{"COB_READ_AHEAD_STATS", "read_ahead_stats", 	"0", 	NULL, GRP_FILE, ENV_BOOL, SETPOS (cob_read_ahead_stats)},
 #ifdef  WITH_DB
 	{"DB_HOME", "db_home", 			NULL, 	NULL, GRP_FILE, ENV_FILE, SETPOS (bdb_home)},
+	{"COB_BDB_CACHE_SIZE", "bdb_cache_size", 	"2M", 	NULL, GRP_FILE, ENV_SIZE, SETPOS (bdb_cache_size), (32 * 1024), 4294967294UL},
+	{"COB_BDB_CACHE_COUNT", "bdb_cache_count", 	"1", 	NULL, GRP_FILE, ENV_UINT, SETPOS (bdb_cache_count), 1, 64},
+	{"COB_BDB_MMAP_SIZE", "bdb_mmap_size", 	"0", 	NULL, GRP_FILE, ENV_SIZE, SETPOS (bdb_mmap_size), 0, 4294967294UL},
+	{"COB_BDB_PAGE_SIZE", "bdb_page_size", 	"0", 	NULL, GRP_FILE, ENV_SIZE, SETPOS (bdb_page_size), 0, (64 * 1024)},
+	{"COB_BDB_STATS", "bdb_stats", 		"0", 	NULL, GRP_FILE, ENV_BOOL, SETPOS (bdb_stats)},
 #endif
 	{"COB_COL_JUST_LRC", "col_just_lrc", "true", 	NULL, GRP_FILE, ENV_BOOL, SETPOS (cob_col_just_lrc)},
 	{"COB_DISPLAY_PRINT_PIPE", "display_print_pipe",		NULL,	NULL, GRP_SCREEN, ENV_STR, SETPOS (cob_display_print_pipe)},
@@ -700,6 +762,20 @@ cob_exit_common (void)
 	if (cob_local_env) {
 		cob_free (cob_local_env);
 	}
+	if (table_sort_state.keys) {
+		cob_free (table_sort_state.keys);
+		table_sort_state.keys = NULL;
+		table_sort_state.alloc = 0;
+	}
+	{
+		int	i;
+		for (i = 0; i < COB_SEARCH_INDEX_MAX; ++i) {
+			if (search_index[i]) {
+				search_index_free (search_index[i]);
+				search_index[i] = NULL;
+			}
+		}
+	}
 
 	/* Free library routine stuff */
 
@@ -2038,58 +2114,417 @@ cob_cmp_alnum (cob_field *f1, cob_field *f2)
 	);
 }
 
-/* comparision of all key fields for SORT (without explicit collation)
-   in records pointed to by 'data1' and 'data2' */
-static int
-sort_compare (const void *data1, const void *data2)
+/* size of SORT key 'k' when encoded by cob_sort_key_encode,
+   0 for types without encoding */
+static unsigned int
+sort_key_encoded_size (const struct cob_sort_key *k)
 {
-	size_t		i;
-	int		res;
-	cob_field	f1;
-	cob_field	f2;
-
-	for (i = 0; i < sort_nkeys; ++i) {
-		f1 = f2 = *sort_keys[i].field;
-		f1.data = (unsigned char *)data1 + sort_keys[i].offset;
-		f2.data = (unsigned char *)data2 + sort_keys[i].offset;
-		if (COB_FIELD_IS_NUMERIC (&f1)) {
-			res = cob_numeric_cmp (&f1, &f2);
+	const cob_field	*field = k->field;
+
+	if (k->type != COB_SORT_KEY_NUMERIC) {
+		return k->size;
+	}
+	switch (COB_FIELD_TYPE (field)) {
+	case COB_TYPE_NUMERIC_DISPLAY:
+		/* sign class, then the digits */
+		if (field->size > COB_MAX_DIGITS + 1) {
+			return 0;
+		}
+		return 1 + (unsigned int)COB_FIELD_SIZE (field);
+	case COB_TYPE_NUMERIC_PACKED:
+		if (COB_FIELD_SCALE (field) < 0) {
+			return 0;
+		}
+		return COB_FIELD_HAVE_SIGN (field) ? 1 + k->size : k->size;
+	case COB_TYPE_NUMERIC_FLOAT:
+	case COB_TYPE_NUMERIC_DOUBLE:
+	case COB_TYPE_NUMERIC_L_DOUBLE:
+		return sizeof (double);
+	default:
+		return 0;
+	}
+}
+
+/* prepare SORT key 'k' for 'field' at 'offset' in the records with
+   ASCENDING/DESCENDING 'flag', 'col' is the collating sequence to use
+   for alphanumeric keys (or NULL); the key type selects the compare
+   done by cob_sort_key_cmp */
+void
+cob_sort_key_init (struct cob_sort_key *k, cob_field *field, const int flag,
+		   const unsigned int offset, const unsigned char *col)
+{
+	k->field = field;
+	k->col = NULL;
+	k->offset = offset;
+	k->size = (unsigned int)field->size;
+	k->descending = flag != COB_ASCENDING;
+	k->thread_safe = 1;
+
+	switch (COB_FIELD_TYPE (field)) {
+	case COB_TYPE_NUMERIC_DISPLAY:
+		if (COB_FIELD_HAVE_SIGN (field)) {
+			/* note: getting the sign temporarily changes the data */
+			k->type = COB_SORT_KEY_NUMERIC;
+			k->thread_safe = 0;
 		} else {
-			res = memcmp (f1.data, f2.data, f1.size);
+			k->type = COB_SORT_KEY_DIGITS;
 		}
-		if (res != 0) {
-			return (sort_keys[i].flag == COB_ASCENDING) ? res : -res;
+		break;
+	case COB_TYPE_NUMERIC_PACKED:
+		if (COB_FIELD_SCALE (field) < 0) {
+			/* compared via the (static) decimals */
+			k->type = COB_SORT_KEY_NUMERIC;
+			k->thread_safe = 0;
+		} else if (COB_FIELD_NO_SIGN_NIBBLE (field)) {
+			k->type = COB_SORT_KEY_MEMCMP;
+		} else {
+			k->type = COB_SORT_KEY_NUMERIC;
+		}
+		break;
+	case COB_TYPE_NUMERIC_BINARY:
+	case COB_TYPE_NUMERIC_COMP5:
+		/* binary keys of the same field can be compared
+		   as integers, independent of scale and digits */
+#ifndef	WORDS_BIGENDIAN
+		if (!COB_FIELD_BINARY_SWAP (field)) {
+			k->type = COB_FIELD_HAVE_SIGN (field)
+				? COB_SORT_KEY_NATIVE_S : COB_SORT_KEY_NATIVE_U;
+			break;
+		}
+#endif
+		k->type = COB_FIELD_HAVE_SIGN (field)
+			? COB_SORT_KEY_BINARY_S : COB_SORT_KEY_MEMCMP;
+		break;
+	default:
+		if (COB_FIELD_IS_NUMERIC (field)) {
+			/* floating-point / decimal types */
+			k->type = COB_SORT_KEY_NUMERIC;
+			k->thread_safe = 0;
+		} else if (col) {
+			k->type = COB_SORT_KEY_COLLATE;
+			k->col = col;
+		} else {
+			k->type = COB_SORT_KEY_MEMCMP;
+		}
+		break;
+	}
+	k->encoded_size = sort_key_encoded_size (k);
+}
+
+/* value of unsigned native binary data 'p' */
+static COB_INLINE COB_A_INLINE cob_u64_t
+sort_key_native_u (const unsigned char *p, const size_t size)
+{
+	cob_u64_t	n = 0;
+
+#ifndef	WORDS_BIGENDIAN
+	memcpy (&n, p, size);
+#else
+	memcpy ((unsigned char *)&n + sizeof (n) - size, p, size);
+#endif
+	return n;
+}
+
+/* value of signed native binary data 'p' */
+static COB_INLINE COB_A_INLINE cob_s64_t
+sort_key_native_s (const unsigned char *p, const size_t size)
+{
+	cob_s64_t	n = 0;
+
+	switch (size) {
+	case 1:
+		return *(const signed char *)p;
+	case 2:
+		{
+			cob_s16_t	n16;
+			memcpy (&n16, p, sizeof (n16));
+			return n16;
+		}
+	case 4:
+		{
+			cob_s32_t	n32;
+			memcpy (&n32, p, sizeof (n32));
+			return n32;
+		}
+	default:
+		/* shift with sign */
+#ifndef	WORDS_BIGENDIAN
+		memcpy ((unsigned char *)&n + sizeof (n) - size, p, size);
+#else
+		memcpy (&n, p, size);
+#endif
+		return n >> (8 * (sizeof (n) - size));
+	}
+}
+
+/* compare unsigned numeric DISPLAY data by digit values, as done by
+   cob_numeric_cmp for two fields of the same definition */
+static COB_INLINE COB_A_INLINE int
+sort_key_digits (const unsigned char *p1, const unsigned char *p2,
+		 const size_t size)
+{
+	const unsigned char	*end = p1 + size;
+
+	for (; p1 < end; ++p1, ++p2) {
+		if (*p1 != *p2) {
+			const int	ret = COB_D2I (*p1) - COB_D2I (*p2);
+			if (ret != 0) {
+				return ret;
+			}
 		}
 	}
 	return 0;
 }
 
-/* comparision of all key fields for SORT (with explicit collation)
-   in records pointed to by 'data1' and 'data2' */
-static int
-sort_compare_collate (const void *data1, const void *data2)
+/* comparision of the 'nkeys' SORT keys 'k' in the records
+   pointed to by 'data1' and 'data2' */
+int
+cob_sort_key_cmp (const struct cob_sort_key *k, const size_t nkeys,
+		  const unsigned char *data1, const unsigned char *data2)
 {
-	size_t		i;
-	int		res;
-	cob_field	f1;
-	cob_field	f2;
-
-	for (i = 0; i < sort_nkeys; ++i) {
-		f1 = f2 = *sort_keys[i].field;
-		f1.data = (unsigned char *)data1 + sort_keys[i].offset;
-		f2.data = (unsigned char *)data2 + sort_keys[i].offset;
-		if (COB_FIELD_IS_NUMERIC (&f1)) {
-			res = cob_numeric_cmp (&f1, &f2);
-		} else {
-			res = cob_cmps (f1.data, f2.data, f1.size, sort_collate);
+	const struct cob_sort_key	*end = k + nkeys;
+
+	for (; k < end; ++k) {
+		const unsigned char	*p1 = data1 + k->offset;
+		const unsigned char	*p2 = data2 + k->offset;
+		int			res;
+
+		switch (k->type) {
+		case COB_SORT_KEY_MEMCMP:
+			res = memcmp (p1, p2, k->size);
+			break;
+		case COB_SORT_KEY_COLLATE:
+			res = cob_cmps (p1, p2, k->size, k->col);
+			break;
+		case COB_SORT_KEY_DIGITS:
+			res = sort_key_digits (p1, p2, k->size);
+			break;
+		case COB_SORT_KEY_BINARY_S:
+			res = (int)*(const signed char *)p1 - (int)*(const signed char *)p2;
+			if (res == 0 && k->size > 1) {
+				res = memcmp (p1 + 1, p2 + 1, k->size - 1);
+			}
+			break;
+		case COB_SORT_KEY_NATIVE_U:
+			{
+				const cob_u64_t	n1 = sort_key_native_u (p1, k->size);
+				const cob_u64_t	n2 = sort_key_native_u (p2, k->size);
+				res = (n1 < n2) ? -1 : (n1 > n2);
+			}
+			break;
+		case COB_SORT_KEY_NATIVE_S:
+			{
+				const cob_s64_t	n1 = sort_key_native_s (p1, k->size);
+				const cob_s64_t	n2 = sort_key_native_s (p2, k->size);
+				res = (n1 < n2) ? -1 : (n1 > n2);
+			}
+			break;
+		default:
+			{
+				cob_field	f1;
+				cob_field	f2;
+				f1 = f2 = *k->field;
+				f1.data = (unsigned char *)p1;
+				f2.data = (unsigned char *)p2;
+				res = cob_numeric_cmp (&f1, &f2);
+			}
+			break;
 		}
 		if (res != 0) {
-			return (sort_keys[i].flag == COB_ASCENDING) ? res : -res;
+			return k->descending ? -res : res;
 		}
 	}
 	return 0;
 }
 
+/* up to eight bytes of SORT key 'k' in the record 'data' as integer,
+   ordered like the key, so that most compares of records are done by
+   comparing two integers; records with the same prefix are compared by
+   cob_sort_key_cmp, which is always needed for keys without prefix (0) */
+cob_u64_t
+cob_sort_key_prefix (const struct cob_sort_key *k, const unsigned char *data)
+{
+	const unsigned char	*p = data + k->offset;
+	const size_t		n = k->size < sizeof (cob_u64_t)
+				  ? k->size : sizeof (cob_u64_t);
+	cob_u64_t		prefix = 0;
+	size_t			i;
+
+	switch (k->type) {
+	case COB_SORT_KEY_NATIVE_U:
+		prefix = sort_key_native_u (p, k->size);
+		break;
+	case COB_SORT_KEY_NATIVE_S:
+		/* flip the sign bit to order negative values first */
+		prefix = (cob_u64_t)sort_key_native_s (p, k->size)
+		       ^ ((cob_u64_t)1 << 63);
+		break;
+	case COB_SORT_KEY_NUMERIC:
+		return 0;
+	default:
+		/* data compared by bytes, left-justified */
+		for (i = 0; i < n; ++i) {
+			unsigned int	c = p[i];
+			if (k->type == COB_SORT_KEY_COLLATE) {
+				c = k->col[c];
+			} else if (k->type == COB_SORT_KEY_DIGITS) {
+				c = COB_D2I (c);
+			}
+			prefix = (prefix << 8) | c;
+		}
+		if (n < sizeof (cob_u64_t)) {
+			prefix <<= 8 * (sizeof (cob_u64_t) - n);
+		}
+		if (k->type == COB_SORT_KEY_BINARY_S) {
+			prefix ^= (cob_u64_t)1 << 63;
+		}
+		break;
+	}
+	if (k->descending) {
+		prefix = ~prefix;
+	}
+	return prefix;
+}
+
+/* store 'n' bytes of 'val' to 'dest', most significant first */
+static void
+sort_key_put_be (unsigned char *dest, cob_u64_t val, size_t n)
+{
+	while (n > 0) {
+		dest[--n] = (unsigned char)val;
+		val >>= 8;
+	}
+}
+
+/* store SORT key 'k' of the record 'data' to 'dest', encoded into
+   k->encoded_size bytes which compare with memcmp like the key;
+   the order of negative numbers is turned by a sign class byte and
+   inverting their digits, DESCENDING by inverting all bytes */
+void
+cob_sort_key_encode (const struct cob_sort_key *k, const unsigned char *data,
+		     unsigned char *dest)
+{
+	const unsigned char	*p = data + k->offset;
+	size_t			i;
+
+	switch (k->type) {
+	case COB_SORT_KEY_MEMCMP:
+		memcpy (dest, p, k->size);
+		break;
+	case COB_SORT_KEY_COLLATE:
+		for (i = 0; i < k->size; ++i) {
+			dest[i] = k->col[p[i]];
+		}
+		break;
+	case COB_SORT_KEY_DIGITS:
+		for (i = 0; i < k->size; ++i) {
+			dest[i] = COB_D2I (p[i]);
+		}
+		break;
+	case COB_SORT_KEY_BINARY_S:
+		memcpy (dest, p, k->size);
+		dest[0] ^= 0x80;
+		break;
+	case COB_SORT_KEY_NATIVE_U:
+		sort_key_put_be (dest, sort_key_native_u (p, k->size), k->size);
+		break;
+	case COB_SORT_KEY_NATIVE_S:
+		sort_key_put_be (dest, (cob_u64_t)sort_key_native_s (p, k->size),
+				 k->size);
+		dest[0] ^= 0x80;
+		break;
+	default:
+		switch (COB_FIELD_TYPE (k->field)) {
+		case COB_TYPE_NUMERIC_DISPLAY:
+			{
+				/* get the sign as cob_numeric_display_cmp does,
+				   on a copy as this may change the data */
+				unsigned char	buff[COB_MAX_DIGITS + 1];
+				cob_field	temp;
+				cob_field	*f = &temp;
+				const unsigned char	*d;
+				size_t		n;
+				int		negative;
+				memcpy (buff, p, k->size);
+				temp = *k->field;
+				temp.data = buff;
+				negative = cob_real_get_sign (f, 1) < 0;
+				d = COB_FIELD_DATA (f);
+				n = COB_FIELD_SIZE (f);
+				if (negative) {
+					/* negative zero compares as zero */
+					for (i = 0; i < n && COB_D2I (d[i]) == 0; ++i);
+					negative = i < n;
+				}
+				dest[0] = negative ? 0 : 1;
+				for (i = 0; i < n; ++i) {
+					dest[i + 1] = negative
+						? 0x0F - COB_D2I (d[i]) : COB_D2I (d[i]);
+				}
+			}
+			break;
+		case COB_TYPE_NUMERIC_PACKED:
+			{
+				/* as cob_bcd_cmp: bytes, ignoring the sign nibble */
+				const size_t	last = k->size - 1;
+				unsigned char	*out = dest;
+				int		negative = 0;
+				if (COB_FIELD_HAVE_SIGN (k->field)) {
+					if ((p[last] & 0x0F) == 0x0D) {
+						/* negative zero compares as zero */
+						for (i = 0; i < last && p[i] == 0; ++i);
+						negative = i < last || p[last] != 0x0D;
+					}
+					*out++ = negative ? 0 : 1;
+				}
+				memcpy (out, p, last);
+				out[last] = p[last] & 0xF0;
+				if (negative) {
+					for (i = 0; i <= last; ++i) {
+						out[i] = ~out[i];
+					}
+				}
+			}
+			break;
+		default:
+			{
+				cob_u64_t	bits;
+				double		d;
+				if (COB_FIELD_TYPE (k->field) == COB_TYPE_NUMERIC_FLOAT) {
+					float	fl;
+					memcpy (&fl, p, sizeof (float));
+					d = fl;
+				} else if (COB_FIELD_TYPE (k->field) == COB_TYPE_NUMERIC_DOUBLE) {
+					memcpy (&d, p, sizeof (double));
+				} else {
+					long double	ld;
+					memcpy (&ld, p, sizeof (long double));
+					d = (double)ld;
+				}
+				if (d == 0.0) {
+					d = 0.0;	/* no negative zero */
+				}
+				memcpy (&bits, &d, sizeof (bits));
+				/* negative values: all bits inverted,
+				   others: sign bit set */
+				if (bits & ((cob_u64_t)1 << 63)) {
+					bits = ~bits;
+				} else {
+					bits |= (cob_u64_t)1 << 63;
+				}
+				sort_key_put_be (dest, bits, sizeof (bits));
+			}
+			break;
+		}
+		break;
+	}
+	if (k->descending) {
+		for (i = 0; i < k->encoded_size; ++i) {
+			dest[i] = ~dest[i];
+		}
+	}
+}
+
 /* intermediate move using USAGE DISPLAY field to 'dst' using
    buffer 'src' with given 'size' as source */
 static void
@@ -3290,6 +3725,10 @@ cob_module_global_enter (cob_module **module, cob_global **mglobal,
 
 	(*module)->module_num_params = cobglobptr->cob_call_params;
 
+	/* the tables of a program with SEARCH lookups may have been changed
+	   by others since its last call */
+	search_index_gen++;
+
 	/* Push module pointer */
 	(*module)->next = COB_MODULE_PTR;
 	COB_MODULE_PTR = *module;
@@ -3311,6 +3750,8 @@ void
 cob_module_leave (cob_module *module)
 {
 	COB_UNUSED (module);
+	/* tables of the caller with SEARCH lookups may have been changed */
+	search_index_gen++;
 	/* Pop module pointer */
 	COB_MODULE_PTR = COB_MODULE_PTR->next;
 }
@@ -3721,13 +4162,10 @@ cob_check_numdisp (const cob_field *f)
 		}
 	}
 
-	while (p < end) {
-		if (IS_INVALID_DIGIT_DATA (*p)) {
-			return 0;
-		}
-		p++;
+	if (p >= end) {
+		return 1;
 	}
-	return 1;
+	return cob_check_digits (p, (size_t)(end - p));
 }
 
 /* Sign */
@@ -4077,18 +4515,7 @@ cob_is_numeric (const cob_field *f)
 		return (f->data[15] & 0x78U) != 0x78U;
 #endif
 	default:
-		{
-			register const unsigned char *p = f->data;
-			const unsigned char *end = p + f->size;
-
-			while (p < end) {
-				if (IS_INVALID_DIGIT_DATA (*p)) {
-					return 0;
-				}
-				p++;
-			}
-			return 1;
-		}
+		return cob_check_digits (f->data, f->size);
 	}
 }
 
@@ -4145,15 +4572,228 @@ cob_is_lower (const cob_field *f)
 
 /* Table sort */
 
+/* entry of a table SORT: the record and its key prefix,
+   see cob_sort_key_prefix */
+struct table_sort_entry {
+	cob_u64_t		prefix;
+	const unsigned char	*data;
+};
+
+/* keys of the table SORT, 'rest' are the keys to compare when the
+   prefixes are equal: all keys, or all but the first one if the
+   prefix holds the complete first key */
+struct table_sort_ctx {
+	const struct cob_sort_key	*rest;
+	size_t				nrest;
+};
+
+static COB_INLINE int
+table_sort_cmp (const struct table_sort_ctx *ctx,
+		const struct table_sort_entry *e1,
+		const struct table_sort_entry *e2)
+{
+	if (e1->prefix != e2->prefix) {
+		return e1->prefix < e2->prefix ? -1 : 1;
+	}
+	return cob_sort_key_cmp (ctx->rest, ctx->nrest, e1->data, e2->data);
+}
+
+/* stable merge sort of the entries, 'tmp' has room for n / 2 */
+static void
+table_sort_entries (const struct table_sort_ctx *ctx,
+		    struct table_sort_entry *a,
+		    struct table_sort_entry *tmp, const size_t n)
+{
+	struct table_sort_entry	*l, *l_end, *r, *r_end, *dest;
+	size_t			i, j, mid;
+
+	if (n <= 16) {
+		for (i = 1; i < n; ++i) {
+			struct table_sort_entry	x = a[i];
+			for (j = i; j > 0 && table_sort_cmp (ctx, &x, &a[j - 1]) < 0; --j) {
+				a[j] = a[j - 1];
+			}
+			a[j] = x;
+		}
+		return;
+	}
+	mid = n / 2;
+	table_sort_entries (ctx, a, tmp, mid);
+	table_sort_entries (ctx, a + mid, tmp, n - mid);
+	if (table_sort_cmp (ctx, &a[mid - 1], &a[mid]) <= 0) {
+		/* already in order */
+		return;
+	}
+	memcpy (tmp, a, mid * sizeof (struct table_sort_entry));
+	l = tmp;
+	l_end = tmp + mid;
+	r = a + mid;
+	r_end = a + n;
+	dest = a;
+	while (l < l_end && r < r_end) {
+		if (table_sort_cmp (ctx, r, l) < 0) {
+			*dest++ = *r++;
+		} else {
+			*dest++ = *l++;
+		}
+	}
+	/* the rest of r is already in place */
+	while (l < l_end) {
+		*dest++ = *l++;
+	}
+}
+
+#ifdef	COB_TABLE_SORT_USE_THREADS
+/* minimal number of entries sorted by one thread */
+#define	COB_TABLE_SORT_MIN_PART	16384
+
+/* part of a parallel table SORT, either sorting 'n' entries of 'src'
+   or merging them with the following 'n2' entries into 'dest' */
+struct table_sort_task {
+	const struct table_sort_ctx	*ctx;
+	struct table_sort_entry		*src;
+	struct table_sort_entry		*dest;
+	size_t				n;
+	size_t				n2;
+};
+
+static void *
+table_sort_task_sort (void *data)
+{
+	struct table_sort_task	*t = data;
+
+	/* 'dest' is used as scratch area */
+	table_sort_entries (t->ctx, t->src, t->dest, t->n);
+	return NULL;
+}
+
+static void *
+table_sort_task_merge (void *data)
+{
+	struct table_sort_task	*t = data;
+	struct table_sort_entry	*a = t->src;
+	struct table_sort_entry	*a_end = a + t->n;
+	struct table_sort_entry	*b = a_end;
+	struct table_sort_entry	*b_end = b + t->n2;
+	struct table_sort_entry	*dest = t->dest;
+
+	while (a < a_end && b < b_end) {
+		if (table_sort_cmp (t->ctx, b, a) < 0) {
+			*dest++ = *b++;
+		} else {
+			*dest++ = *a++;
+		}
+	}
+	while (a < a_end) {
+		*dest++ = *a++;
+	}
+	while (b < b_end) {
+		*dest++ = *b++;
+	}
+	return NULL;
+}
+
+/* run the tasks, all but the first one in their own thread;
+   a task that can't get a thread is done here afterwards */
+static void
+table_sort_run_tasks (void *(*func) (void *), struct table_sort_task *task,
+		      const size_t count)
+{
+	pthread_t	*tid = cob_malloc (count * sizeof (pthread_t));
+	int		*started = cob_malloc (count * sizeof (int));
+	size_t		i;
+
+	for (i = 1; i < count; ++i) {
+		started[i] = pthread_create (&tid[i], NULL, func, &task[i]) == 0;
+	}
+	func (&task[0]);
+	for (i = 1; i < count; ++i) {
+		if (started[i]) {
+			pthread_join (tid[i], NULL);
+		} else {
+			func (&task[i]);
+		}
+	}
+	cob_free (started);
+	cob_free (tid);
+}
+
+/* sort the entries with 'parts' threads, each sorting one consecutive
+   part, then merge neighbouring parts; as ties are taken from the left
+   part the result is the same as of table_sort_entries;
+   returns the sorted entries, either 'a' or 'tmp' */
+static struct table_sort_entry *
+table_sort_parallel (const struct table_sort_ctx *ctx,
+		     struct table_sort_entry *a,
+		     struct table_sort_entry *tmp, const size_t n,
+		     size_t parts)
+{
+	struct table_sort_task	*task = cob_malloc (parts * sizeof (struct table_sort_task));
+	size_t			*bound = cob_malloc ((parts + 1) * sizeof (size_t));
+	struct table_sort_entry	*src = a;
+	struct table_sort_entry	*dest = tmp;
+	size_t			i;
+
+	for (i = 0; i <= parts; ++i) {
+		bound[i] = n / parts * i + n % parts * i / parts;
+	}
+	for (i = 0; i < parts; ++i) {
+		task[i].ctx = ctx;
+		task[i].src = src + bound[i];
+		task[i].dest = dest + bound[i];
+		task[i].n = bound[i + 1] - bound[i];
+	}
+	table_sort_run_tasks (table_sort_task_sort, task, parts);
+
+	while (parts > 1) {
+		const size_t		pairs = parts / 2;
+		struct table_sort_entry	*swap;
+
+		for (i = 0; i < pairs; ++i) {
+			task[i].ctx = ctx;
+			task[i].src = src + bound[2 * i];
+			task[i].n = bound[2 * i + 1] - bound[2 * i];
+			task[i].n2 = bound[2 * i + 2] - bound[2 * i + 1];
+			task[i].dest = dest + bound[2 * i];
+		}
+		if (parts % 2) {
+			memcpy (dest + bound[parts - 1], src + bound[parts - 1],
+				(n - bound[parts - 1]) * sizeof (struct table_sort_entry));
+		}
+		table_sort_run_tasks (table_sort_task_merge, task, pairs);
+		for (i = 0; i < (parts + 1) / 2; ++i) {
+			bound[i] = bound[2 * i];
+		}
+		parts = (parts + 1) / 2;
+		bound[parts] = n;
+		swap = src;
+		src = dest;
+		dest = swap;
+	}
+
+	cob_free (bound);
+	cob_free (task);
+	return src;
+}
+#endif
+
 void
 cob_table_sort_init (const size_t nkeys, const unsigned char *collating_sequence)
 {
-	sort_nkeys = 0;
-	sort_keys = cob_malloc (nkeys * sizeof (cob_file_key));
+	struct cob_table_sort_state	*st = &table_sort_state;
+
+	if (nkeys > st->alloc) {
+		if (st->keys) {
+			cob_free (st->keys);
+		}
+		st->keys = cob_malloc (nkeys * sizeof (struct cob_sort_key));
+		st->alloc = nkeys;
+	}
+	st->nkeys = 0;
 	if (collating_sequence) {
-		sort_collate = collating_sequence;
+		st->collate = collating_sequence;
 	} else {
-		sort_collate = COB_MODULE_PTR->collating_sequence;
+		st->collate = COB_MODULE_PTR->collating_sequence;
 	}
 }
 
@@ -4161,21 +4801,467 @@ void
 cob_table_sort_init_key (cob_field *field, const int flag,
 			 const unsigned int offset)
 {
-	sort_keys[sort_nkeys].field = field;
-	sort_keys[sort_nkeys].flag = flag;
-	sort_keys[sort_nkeys].offset = offset;
-	sort_nkeys++;
+	struct cob_table_sort_state	*st = &table_sort_state;
+
+	cob_sort_key_init (&st->keys[st->nkeys], field, flag, offset,
+			   st->collate);
+	st->nkeys++;
 }
 
+/* stable sort of the 'n' table entries 'f' by the keys set up by
+   cob_table_sort_init_key: the entries are sorted as pointers along
+   with the prefix of the first key, then moved in place */
 void
 cob_table_sort (cob_field *f, const int n)
 {
-	if (sort_collate) {
-		qsort (f->data, (size_t) n, f->size, sort_compare_collate);
+	const struct cob_table_sort_state	*st = &table_sort_state;
+	const struct cob_sort_key	*k = st->keys;
+	const size_t			size = f->size;
+	struct table_sort_ctx		ctx;
+	struct table_sort_entry		*entries;
+	struct table_sort_entry		*tmp;
+	struct table_sort_entry		*sorted;
+	unsigned char			*buff;
+	unsigned char			*p;
+	size_t				i;
+#ifdef	COB_TABLE_SORT_USE_THREADS
+	size_t				parts = 1;
+#endif
+
+	if (n < 2 || st->nkeys == 0) {
+		return;
+	}
+
+	/* if the prefix holds the complete first key, it
+	   doesn't need to be compared again on equal prefixes */
+	ctx.rest = k;
+	ctx.nrest = st->nkeys;
+	if (k->type == COB_SORT_KEY_NATIVE_U
+	 || k->type == COB_SORT_KEY_NATIVE_S
+	 || (k->type != COB_SORT_KEY_NUMERIC
+	  && k->size <= sizeof (cob_u64_t))) {
+		ctx.rest++;
+		ctx.nrest--;
+	}
+
+	entries = cob_fast_malloc ((size_t)n * sizeof (struct table_sort_entry));
+	tmp = cob_fast_malloc ((size_t)n * sizeof (struct table_sort_entry));
+	for (i = 0, p = f->data; i < (size_t)n; ++i, p += size) {
+		entries[i].prefix = cob_sort_key_prefix (k, p);
+		entries[i].data = p;
+	}
+
+	sorted = entries;
+#ifdef	COB_TABLE_SORT_USE_THREADS
+	if (cobsetptr->cob_sort_threads > 1
+	 && (size_t)n >= 2 * COB_TABLE_SORT_MIN_PART) {
+		parts = cobsetptr->cob_sort_threads;
+		if (parts > (size_t)n / COB_TABLE_SORT_MIN_PART) {
+			parts = (size_t)n / COB_TABLE_SORT_MIN_PART;
+		}
+		for (i = 0; i < st->nkeys; ++i) {
+			if (!k[i].thread_safe) {
+				parts = 1;
+				break;
+			}
+		}
+	}
+	if (parts > 1) {
+		sorted = table_sort_parallel (&ctx, entries, tmp, (size_t)n, parts);
+	} else {
+		table_sort_entries (&ctx, entries, tmp, (size_t)n);
+	}
+#else
+	table_sort_entries (&ctx, entries, tmp, (size_t)n);
+#endif
+
+	/* move the entries in sorted order */
+	buff = cob_fast_malloc ((size_t)n * size);
+	for (i = 0, p = buff; i < (size_t)n; ++i, p += size) {
+		memcpy (p, sorted[i].data, size);
+	}
+	memcpy (f->data, buff, (size_t)n * size);
+
+	cob_free (buff);
+	cob_free (tmp);
+	cob_free (entries);
+}
+
+/* Table search */
+
+#if	defined (__GNUC__) && (__GNUC__ >= 4) || defined (__clang__)
+#define	COB_PREFETCH(p)	__builtin_prefetch (p)
+#else
+#define	COB_PREFETCH(p)
+#endif
+
+/* comparison of the SEARCH ALL key with the value, as done by cob_cmp */
+struct search_all_ctx {
+	enum {
+		SEARCH_ALL_CMP_STRING,		/* non-numeric: cob_cmp_strings */
+		SEARCH_ALL_CMP_NATIVE,		/* native binary with the value
+						   as integer of the key's scale */
+		SEARCH_ALL_CMP_FIELD		/* any other: cob_cmp */
+	}			type;
+	cob_field		key;		/* the key, data set per entry */
+	cob_field		*val;
+	const unsigned char	*col;
+	cob_s64_t		ival;
+};
+
+/* setup of 'ctx' to compare 'key' with 'val' */
+static void
+search_all_init (struct search_all_ctx *ctx, cob_field *key, cob_field *val)
+{
+	const int	key_type = COB_FIELD_TYPE (key);
+	const int	val_type = COB_FIELD_TYPE (val);
+
+	ctx->type = SEARCH_ALL_CMP_FIELD;
+	ctx->key = *key;
+	ctx->val = val;
+	ctx->col = NULL;
+	ctx->ival = 0;
+
+	if (!COB_FIELD_IS_NUMERIC (key) && !COB_FIELD_IS_NUMERIC (val)) {
+		if (key_type != COB_TYPE_ALPHANUMERIC_ALL
+		 && val_type != COB_TYPE_ALPHANUMERIC_ALL) {
+			ctx->type = SEARCH_ALL_CMP_STRING;
+			ctx->col = COB_MODULE_PTR->collating_sequence;
+		}
+		return;
+	}
+
+	/* native binary key, the value converted to an integer
+	   of the key's scale if that is exact */
+	if (key_type == COB_TYPE_NUMERIC_BINARY
+	 && !COB_FIELD_BINARY_SWAP (key)
+	 && (key->size < 8 || (key->size == 8 && COB_FIELD_HAVE_SIGN (key)))
+	 && (val_type == COB_TYPE_NUMERIC_DISPLAY
+	  || val_type == COB_TYPE_NUMERIC_PACKED
+	  || (val_type == COB_TYPE_NUMERIC_BINARY && val->size <= 4))
+	 && COB_FIELD_SCALE (val) >= 0
+	 && COB_FIELD_SCALE (val) <= COB_FIELD_SCALE (key)) {
+		const int	digits = val_type == COB_TYPE_NUMERIC_BINARY
+				? 10 : COB_FIELD_DIGITS (val);
+		if (digits - COB_FIELD_SCALE (val) + COB_FIELD_SCALE (key) <= 18) {
+			cob_field_attr	attr;
+			cob_field	temp;
+			COB_ATTR_INIT (COB_TYPE_NUMERIC_BINARY, 18,
+				       COB_FIELD_SCALE (key),
+				       COB_FLAG_HAVE_SIGN | COB_FLAG_REAL_BINARY, NULL);
+			temp.size = sizeof (cob_s64_t);
+			temp.data = (unsigned char *)&ctx->ival;
+			temp.attr = &attr;
+			cob_move (val, &temp);
+			ctx->type = SEARCH_ALL_CMP_NATIVE;
+		}
+	}
+}
+
+static COB_INLINE int
+search_all_cmp (struct search_all_ctx *ctx, const unsigned char *data)
+{
+	switch (ctx->type) {
+	case SEARCH_ALL_CMP_STRING:
+		return cob_cmp_strings ((unsigned char *)data, ctx->val->data,
+					ctx->key.size, ctx->val->size, ctx->col);
+	case SEARCH_ALL_CMP_NATIVE:
+		{
+			const cob_s64_t	n = COB_FIELD_HAVE_SIGN (&ctx->key)
+				? sort_key_native_s (data, ctx->key.size)
+				: (cob_s64_t)sort_key_native_u (data, ctx->key.size);
+			return (n > ctx->ival) - (n < ctx->ival);
+		}
+	default:
+		ctx->key.data = (unsigned char *)data;
+		return cob_cmp (&ctx->key, ctx->val);
+	}
+}
+
+/* SEARCH ALL of 'val' in the 'n' entries of 'table' which are ordered by
+   'key' at 'offset' (ASCENDING or DESCENDING as by 'flag'): branchless
+   binary search for the first entry not ordered before the value, with
+   prefetch of both possible next probes; returns its position, limited to
+   'n' (the caller checks the WHEN condition there), or 0 if 'n' is 0 */
+int
+cob_search_all (cob_field *table, cob_field *key, const unsigned int offset,
+		const int n, cob_field *val, const int flag)
+{
+	struct search_all_ctx	ctx;
+	const size_t		size = table->size;
+	const unsigned char	*base = table->data + offset;
+	const int		dir = flag == COB_DESCENDING ? -1 : 1;
+	size_t			pos = 0;
+	size_t			len;
+
+	if (n <= 0) {
+		return 0;
+	}
+	search_all_init (&ctx, key, val);
+	len = (size_t)n;
+	while (len > 1) {
+		const size_t	half = len / 2;
+		const size_t	next = (len - half) / 2;
+		COB_PREFETCH (base + (pos + next) * size);
+		COB_PREFETCH (base + (pos + half + next) * size);
+		pos = search_all_cmp (&ctx, base + (pos + half) * size) * dir < 0
+		    ? pos + half : pos;
+		len -= half;
+	}
+	if (pos < (size_t)n - 1
+	 && search_all_cmp (&ctx, base + pos * size) * dir < 0) {
+		pos++;
+	}
+	return (int)pos + 1;
+}
+
+/* Table index for serial SEARCH (cobc -fsearch-index) */
+
+static void
+search_index_free (struct cob_search_index *ix)
+{
+	if (ix->head) {
+		cob_free (ix->head);
+		cob_free (ix->tail);
+		cob_free (ix->chain);
+		cob_free (ix->keys);
+	}
+	cob_free (ix);
+}
+
+static COB_INLINE unsigned int
+search_index_hash_u64 (const cob_u64_t val)
+{
+	return (unsigned int)((val * COB_U64_C (0x9E3779B97F4A7C15)) >> 32);
+}
+
+/* FNV-1a hash of 'size' bytes */
+static COB_INLINE unsigned int
+search_index_hash_bytes (const unsigned char *p, size_t size)
+{
+	unsigned int	h = 2166136261U;
+
+	while (size--) {
+		h = (h ^ *p++) * 16777619U;
+	}
+	return h;
+}
+
+/* size of 'p' without trailing spaces */
+static COB_INLINE size_t
+search_index_trim (const unsigned char *p, size_t size)
+{
+	while (size > 0 && p[size - 1] == ' ') {
+		size--;
+	}
+	return size;
+}
+
+static COB_INLINE cob_s64_t
+search_index_native (const struct cob_search_index *ix, const unsigned char *p)
+{
+	return ix->sign ? sort_key_native_s (p, ix->size)
+		: (cob_s64_t)sort_key_native_u (p, ix->size);
+}
+
+static void
+search_index_add (struct cob_search_index *ix, const unsigned char *p)
+{
+	const int	i = ix->count++;
+	unsigned int	h;
+
+	if (ix->type == SEARCH_ALL_CMP_NATIVE) {
+		h = search_index_hash_u64 ((cob_u64_t)search_index_native (ix, p));
+	} else {
+		h = search_index_hash_bytes (p, search_index_trim (p, ix->size));
+	}
+	h &= ix->mask;
+	ix->chain[i] = -1;
+	if (ix->head[h] < 0) {
+		ix->head[h] = i;
+	} else {
+		ix->chain[ix->tail[h]] = i;
+	}
+	ix->tail[h] = i;
+	memcpy (ix->keys + (size_t)i * ix->size, p, ix->size);
+}
+
+/* whether 'f' is compared by its bytes, padded with spaces */
+static int
+search_index_alnum (const cob_field *f)
+{
+	switch (COB_FIELD_TYPE (f)) {
+	case COB_TYPE_GROUP:
+	case COB_TYPE_ALPHANUMERIC:
+	case COB_TYPE_ALPHANUMERIC_EDITED:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/* whether the 'size' bytes at 'p' and 'k' differ; keys up to 16 bytes
+   are compared as two overlapping integers */
+static COB_INLINE int
+search_index_differs (const unsigned char *p, const unsigned char *k,
+		      const size_t size)
+{
+	if (size >= 8 && size <= 16) {
+		cob_u64_t	p1, p2, k1, k2;
+		memcpy (&p1, p, 8);
+		memcpy (&k1, k, 8);
+		memcpy (&p2, p + size - 8, 8);
+		memcpy (&k2, k + size - 8, 8);
+		return ((p1 ^ k1) | (p2 ^ k2)) != 0;
+	}
+	if (size >= 4 && size < 8) {
+		unsigned int	p1, p2, k1, k2;
+		memcpy (&p1, p, 4);
+		memcpy (&k1, k, 4);
+		memcpy (&p2, p + size - 4, 4);
+		memcpy (&k2, k + size - 4, 4);
+		return ((p1 ^ k1) | (p2 ^ k2)) != 0;
+	}
+	return memcmp (p, k, size) != 0;
+}
+
+/* the index for the 'n' keys at 'data', built or updated as needed */
+static struct cob_search_index *
+search_index_get (const unsigned char *data, const size_t stride,
+		  const struct search_all_ctx *ctx, const int n)
+{
+	struct cob_search_index	*ix = NULL;
+	const unsigned char	*p;
+	const unsigned char	*k;
+	int			i;
+	int			m;
+
+	for (i = 0; i < COB_SEARCH_INDEX_MAX; ++i) {
+		ix = search_index[i];
+		if (ix
+		 && ix->data == data
+		 && ix->stride == stride
+		 && ix->size == ctx->key.size
+		 && ix->type == (int)ctx->type
+		 && ix->sign == (COB_FIELD_HAVE_SIGN (&ctx->key) != 0)) {
+			break;
+		}
+	}
+	if (i == COB_SEARCH_INDEX_MAX) {
+		i = search_index_next++ % COB_SEARCH_INDEX_MAX;
+		if (search_index[i]) {
+			search_index_free (search_index[i]);
+		}
+		ix = cob_malloc (sizeof (struct cob_search_index));
+		ix->data = data;
+		ix->stride = stride;
+		ix->size = ctx->key.size;
+		ix->type = ctx->type;
+		ix->sign = COB_FIELD_HAVE_SIGN (&ctx->key) != 0;
+		ix->gen = search_index_gen;
+		search_index[i] = ix;
+	}
+
+	/* start again if one of the indexed keys was changed, which is only
+	   possible if a statement that may change the table was executed */
+	m = 0;
+	if (ix->gen != search_index_gen) {
+		m = ix->count < n ? ix->count : n;
+		ix->gen = search_index_gen;
+	}
+	for (i = 0, p = data, k = ix->keys; i < m;
+	     ++i, p += stride, k += ix->size) {
+		if (search_index_differs (p, k, ix->size)) {
+			break;
+		}
+	}
+	if (i < m || n > ix->alloc) {
+		if (n > ix->alloc) {
+			if (ix->head) {
+				cob_free (ix->head);
+				cob_free (ix->tail);
+				cob_free (ix->chain);
+				cob_free (ix->keys);
+			}
+			ix->alloc = n < 2 * ix->alloc ? 2 * ix->alloc : n;
+			for (ix->mask = 64; ix->mask < 2U * ix->alloc; ix->mask *= 2) ;
+			ix->head = cob_fast_malloc (ix->mask * sizeof (int));
+			ix->tail = cob_fast_malloc (ix->mask * sizeof (int));
+			ix->chain = cob_fast_malloc ((size_t)ix->alloc * sizeof (int));
+			ix->keys = cob_fast_malloc ((size_t)ix->alloc * ix->size);
+			ix->mask--;
+		}
+		memset (ix->head, 0xFF, (ix->mask + 1) * sizeof (int));
+		ix->count = 0;
+	}
+
+	for (p = data + (size_t)ix->count * stride; ix->count < n; p += stride) {
+		search_index_add (ix, p);
+	}
+	return ix;
+}
+
+/* tell cob_search_index that tables may have been changed, so its
+   indexes are checked against these on next use */
+void
+cob_search_index_changed (void)
+{
+	search_index_gen++;
+}
+
+/* serial SEARCH for the first of the 'n' entries of 'table' from
+   position 'start' on with 'key' at 'offset' equal to 'val', using a
+   hash index on the key that is kept until the table changes;
+   returns its position or 'n' + 1 if there is none; returns 'start'
+   unchanged if that isn't a valid position, the table is small or
+   the comparison is not indexed, so the caller checks all entries */
+int
+cob_search_index (cob_field *table, cob_field *key, const unsigned int offset,
+		  const int n, const int start, cob_field *val)
+{
+	struct search_all_ctx		ctx;
+	const struct cob_search_index	*ix;
+	const size_t		stride = table->size;
+	const unsigned char	*base = table->data + offset;
+	int			i;
+
+	if (start < 1 || start > n) {
+		return start;
+	}
+	if (n < COB_SEARCH_INDEX_MIN) {
+		return start;
+	}
+	search_all_init (&ctx, key, val);
+	/* only plain byte or native integer equality is indexed */
+	if (ctx.type == SEARCH_ALL_CMP_FIELD
+	 || (ctx.type == SEARCH_ALL_CMP_STRING
+	  && (ctx.col != NULL
+	   || !search_index_alnum (key) || !search_index_alnum (val)))) {
+		return start;
+	}
+
+	ix = search_index_get (base, stride, &ctx, n);
+	if (ix->type == SEARCH_ALL_CMP_NATIVE) {
+		const unsigned int	h = search_index_hash_u64 ((cob_u64_t)ctx.ival);
+		for (i = ix->head[h & ix->mask]; i >= 0 && i < n; i = ix->chain[i]) {
+			if (i >= start - 1
+			 && search_index_native (ix, ix->keys + (size_t)i * ix->size) == ctx.ival) {
+				return i + 1;
+			}
+		}
 	} else {
-		qsort (f->data, (size_t) n, f->size, sort_compare);
+		const size_t		vsize = search_index_trim (val->data, val->size);
+		const unsigned int	h = search_index_hash_bytes (val->data, vsize);
+		for (i = ix->head[h & ix->mask]; i >= 0 && i < n; i = ix->chain[i]) {
+			const unsigned char	*k = ix->keys + (size_t)i * ix->size;
+			if (i >= start - 1
+			 && search_index_trim (k, ix->size) == vsize
+			 && memcmp (k, val->data, vsize) == 0) {
+				return i + 1;
+			}
+		}
 	}
-	cob_free (sort_keys);
+	return n + 1;
 }
 
 /* Run-time error checking */
@@ -6981,6 +8067,13 @@ internal_nanosleep (cob_s64_t nsecs)
 #endif
 }
 
+/* pause for 'msecs' milliseconds, used while waiting for a lock */
+void
+cob_sleep_msec (const unsigned int msecs)
+{
+	internal_nanosleep ((cob_s64_t)msecs * 1000000);
+}
+
 /* CBL_GC_NANOSLEEP / CBL_OC_NANOSLEEP, origin: OpenCOBOL */
 int
 cob_sys_oc_nanosleep (const void *data)
@@ -9664,6 +10757,10 @@ print_version_summary (void)
 	printf (", BDB %d.%d.%d",
 		DB_VERSION_MAJOR, DB_VERSION_MINOR, DB_VERSION_PATCH);
 #endif
+#if defined	(WITH_LMDB)
+	printf (", LMDB %d.%d.%d",
+		MDB_VERSION_MAJOR, MDB_VERSION_MINOR, MDB_VERSION_PATCH);
+#endif
 #if defined	(WITH_CISAM)
 	printf (", C-ISAM");
 #endif
@@ -9815,6 +10912,14 @@ print_info_detailed (const int verbose)
 		}
 	}
 	var_print (_("indexed file handler"), 		buff, "", 0);
+#elif defined	(WITH_LMDB)
+	{
+		int	major, minor, patch;
+		mdb_version (&major, &minor, &patch);
+		snprintf (buff, 55, _("%s, version %d.%d.%d"),
+			"LMDB", major, minor, patch);
+	}
+	var_print (_("indexed file handler"), 		buff, "", 0);
 #elif defined	(WITH_CISAM)
 	var_print (_("indexed file handler"), 		"C-ISAM", "", 0);
 #elif defined	(WITH_DISAM)
@@ -9826,7 +10931,7 @@ print_info_detailed (const int verbose)
 	var_print (_("indexed file handler"), 		"VBISAM", "", 0);
 #endif
 #else
-	var_print (_("indexed file handler"), 		_("disabled"), "", 0);
+	var_print (_("indexed file handler"), 		"built-in", "", 0);
 #endif
 
 	{
@@ -10278,13 +11383,10 @@ cob_init (const int argc, char **argv)
 	cob_last_sfile = NULL;
 	commlnptr = NULL;
 	basext = NULL;
-	sort_keys = NULL;
-	sort_collate = NULL;
 	cob_source_file = NULL;
 	exit_hdlrs = NULL;
 	hdlrs = NULL;
 	commlncnt = 0;
-	sort_nkeys = 0;
 	cob_source_line = 0;
 	cob_local_env_size = 0;
 
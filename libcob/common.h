@@ -1902,6 +1902,16 @@ COB_EXPIMP void	cob_table_sort_init_key	(cob_field *, const int,
 					 const unsigned int);
 COB_EXPIMP void	cob_table_sort		(cob_field *, const int);
 
+/* Table search */
+
+COB_EXPIMP int	cob_search_all		(cob_field *, cob_field *,
+					 const unsigned int, const int,
+					 cob_field *, const int);
+COB_EXPIMP int	cob_search_index	(cob_field *, cob_field *,
+					 const unsigned int, const int,
+					 const int, cob_field *);
+COB_EXPIMP void	cob_search_index_changed	(void);
+
 /* Run-time error checking */
 
 COB_EXPIMP void	cob_check_numeric	(const cob_field *, const char *);
@@ -1975,6 +1985,11 @@ COB_EXPIMP const char *COB_ZEROES_ALPHABETIC;	/* PIC X/A/U ZEROES */
 
 COB_EXPIMP void		cob_move	(cob_field *, cob_field *);
 COB_EXPIMP void		cob_move_ibm	(void *, void *, const int);
+COB_EXPIMP void		cob_move_pad	(void *, void *, const int, const int);
+COB_EXPIMP void		cob_move_display_to_bcd	(cob_field *, cob_field *,
+						 const int, const int, const int);
+COB_EXPIMP void		cob_move_bcd_to_display	(cob_field *, cob_field *,
+						 const int, const int, const int);
 COB_EXPIMP void		cob_init_table	(void *, const size_t, const size_t);
 COB_EXPIMP void		cob_set_int	(cob_field *, const int);
 COB_EXPIMP int		cob_get_int	(cob_field *);
@@ -2018,6 +2033,8 @@ COB_EXPIMP void	cob_decimal_init	(cob_decimal *);
 COB_EXPIMP void	cob_decimal_clear	(cob_decimal *);
 COB_EXPIMP void cob_decimal_set_llint	(cob_decimal *, const cob_s64_t);
 COB_EXPIMP void cob_decimal_set_ullint	(cob_decimal *, const cob_u64_t);
+COB_EXPIMP void cob_decimal_set_llint_scaled	(cob_decimal *, const cob_s64_t,
+					 const int);
 COB_EXPIMP void	cob_decimal_set_field	(cob_decimal *, cob_field *);
 COB_EXPIMP int	cob_decimal_get_field	(cob_decimal *, cob_field *, const int);
 COB_EXPIMP void	cob_decimal_set		(cob_decimal *, cob_decimal *);	/* to be removed in 4.x */
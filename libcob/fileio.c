@@ -52,6 +52,16 @@
 #include <fcntl.h>
 #endif
 
+#if defined (HAVE_SYS_MMAN_H) && defined (HAVE_MMAP)
+#include <sys/mman.h>
+#define	COB_FILE_USE_MMAP
+#endif
+
+#ifdef	HAVE_PTHREAD
+#include <pthread.h>
+#define	COB_SORT_USE_THREADS
+#endif
+
 #ifdef	_WIN32
 
 #define WIN32_LEAN_AND_MEAN
@@ -63,6 +73,7 @@
 #else
 #define	fdcobsync	_commit
 #endif
+#define	fdcobtruncate(fd,size)	_chsize_s (fd, size)
 #if !defined(__BORLANDC__) && !defined(__WATCOMC__) && !defined(__ORANGEC__)
 #define	getcwd		_getcwd
 #define	chdir		_chdir
@@ -92,6 +103,7 @@ int fdatasync(int fd);
 #else
 #define	fdcobsync	fsync
 #endif
+#define	fdcobtruncate	ftruncate
 
 #ifndef	O_BINARY
 #define	O_BINARY	0
@@ -111,6 +123,10 @@ int fdatasync(int fd);
 
 #include <db.h>
 
+#elif	defined(WITH_LMDB)
+
+#include <lmdb.h>
+
 #elif	defined(WITH_CISAM) || defined(WITH_DISAM) || defined(WITH_VBISAM)
 
 #define	WITH_ANY_ISAM
@@ -158,12 +174,51 @@ static	vb_rtd_t *vbisam_rtd = NULL;
 #endif
 #endif
 
+#elif	!defined(WITH_INDEX_EXTFH)
+
+/* no external handler: INDEXED files use the built-in ISAM below */
+#define	COB_NATIVE_ISAM
+#define	WITH_ANY_ISAM
+#define	COB_WITH_STATUS_02
+
 #endif
 
 /* include internal and external libcob definitions, forcing exports */
 #define	COB_LIB_EXPIMP
 #include "coblocal.h"
 
+#ifdef	COB_NATIVE_ISAM
+
+/* Built-in ISAM, used when no external INDEXED handler is configured;
+   its status is kept per file in 'struct indexfile', so the names below
+   are only valid where 'fh' is */
+#include "cobisam.h"
+
+#define	ISRECNUM	fh->isstat.isrecnum
+#define	ISERRNO		fh->isstat.iserrno
+#define	ISRECLEN	fh->isstat.isreclen
+#define	isstat1		fh->isstat.isstat1
+#define	isstat2		fh->isstat.isstat2
+
+#define	isopen(n,m)		cob_isopen (&fh->isstat, n, m)
+#define	isbuild(n,l,k,m)	cob_isbuild (&fh->isstat, n, l, k, m)
+#define	isaddindex(d,k)		cob_isaddindex (&fh->isstat, d, k)
+#define	isindexinfo(d,b,n)	cob_isindexinfo (&fh->isstat, d, b, n)
+#define	isclose(d)		cob_isclose (&fh->isstat, d)
+#define	isfullclose(d)		cob_isclose (&fh->isstat, d)
+#define	iserase(n)		cob_iserase (&fh->isstat, n)
+#define	isstart(d,k,l,r,m)	cob_isstart (&fh->isstat, d, k, l, r, m)
+#define	isread(d,r,m)		cob_isread (&fh->isstat, d, r, m)
+#define	iswrite(d,r)		cob_iswrite (&fh->isstat, d, r)
+#define	isrewrite(d,r)		cob_isrewrite (&fh->isstat, d, r)
+#define	isrewcurr(d,r)		cob_isrewcurr (&fh->isstat, d, r)
+#define	isdelete(d,r)		cob_isdelete (&fh->isstat, d, r)
+#define	isrelease(d)		cob_isrelease (&fh->isstat, d)
+#define	isflush(d)		cob_isflush (&fh->isstat, d)
+#define	iscleanup()		cob_iscleanup ()
+
+#endif
+
 #ifdef	WITH_ANY_ISAM
 
 /* Isam File handler packet */
@@ -186,6 +241,9 @@ struct indexfile {
 	int		startiscur;	/* The 'start' record is current */
 	int		wrkhasrec;	/* 'recwrk' holds the next|prev record */
 	int		partial_key_length;	/* new field for partial key on START verb */
+#ifdef	COB_NATIVE_ISAM
+	struct isam_status	isstat;	/* Result of the last call */
+#endif
 	struct keydesc	key[1];		/* Table of key information */
 					/* keydesc is defined in (d|c|vb)isam.h */
 };
@@ -322,7 +380,7 @@ indexed_keydesc (cob_file *f, struct keydesc *kd, cob_file_key *key)
 		}
 		kd->k_nparts = part;
 	}
-#if defined(WITH_DISAM) || defined(WITH_VBISAM)
+#if defined(WITH_DISAM) || defined(WITH_VBISAM) || defined(COB_NATIVE_ISAM)
 	kd->k_len = keylen;		/* Total length of this key */
 #endif
 	return keylen;
@@ -413,6 +471,22 @@ struct file_list {
 	cob_file		*file;
 };
 
+/* Block buffer for (record) SEQUENTIAL files, see COB_SEQ_BUFFER_SIZE,
+   for LINE SEQUENTIAL files opened INPUT (COB_LS_BUFFER_SIZE),
+   or mapping of a SEQUENTIAL / RELATIVE file opened INPUT, see COB_FILE_MMAP */
+#define COB_LS_BUFFER_SIZE	32768
+struct seq_buffer {
+	struct seq_buffer	*next;
+	cob_file		*file;		/* File the buffer belongs to */
+	unsigned char		*data;
+	size_t			size;		/* Allocated size of data */
+	size_t			len;		/* Bytes valid (read) / pending (write) */
+	size_t			pos;		/* Current read position in data */
+	cob_s64_t		offset;		/* File position of data[0] */
+	int			for_write;	/* Buffer collects data for WRITE */
+	int			mapped;		/* data is the complete file, mapped */
+};
+
 #ifdef	WORDS_BIGENDIAN
 #define	COB_MAYSWAP_16(x)	((unsigned short)(x))
 #define	COB_MAYSWAP_32(x)	((unsigned int)(x))
@@ -429,41 +503,78 @@ struct file_list {
 #define COBSORTNOTOPEN		4
 
 
-/* Sort item */
+/* Sort item, the record with its sequence number for a stable sort;
+   this is also the layout of a record in the temporary files */
 struct cobitem {
-	struct cobitem		*next;
-	unsigned char		end_of_block;
-	unsigned char		block_byte;
 	unsigned char		unique[sizeof (size_t)];
 	unsigned char		item[1];
 };
 
+/* Sort entry, the first bytes of the first key (see cob_sort_key_prefix)
+   for a fast compare and the item; while generating runs the entries
+   form a heap ordered by run number, then key */
+struct sort_entry {
+	cob_u64_t		prefix;
+	struct cobitem		*item;
+	size_t			run;
+};
+
 /* Sort memory chunk */
 struct sort_mem_struct {
 	struct sort_mem_struct	*next;
 	unsigned char		*mem_ptr;
 };
 
-/* Sort queue structure */
-struct queue_struct {
-	struct cobitem		*first;
-	struct cobitem		*last;
-	size_t			count;
-};
-
 /* Sort temporary file structure */
 struct file_struct {
 	FILE			*fp;
-	size_t			count;	/* Count of blocks in temporary files */
+	cob_s64_t		size;	/* Bytes written */
+};
+
+/* Sorted run within a temporary file */
+struct sort_run {
+	cob_s64_t		start;
+	cob_s64_t		end;
+};
+
+/* Input of a run during the merge */
+struct sort_input {
+	unsigned char		*buff;
+	cob_s64_t		offset;	/* File position of next data */
+	cob_s64_t		end;	/* File position after the run */
+	size_t			len;	/* Bytes in buff */
+	size_t			pos;	/* Current record in buff */
+};
+
+/* Hash chains to find matches for the compression of temporary files */
+#define	SORT_LZ_HASH_BITS	14
+#define	SORT_LZ_WINDOW		65535	/* Maximal offset of a match */
+#define	SORT_LZ_MIN_MATCH	4
+
+struct sort_lz {
+	unsigned int		head[1 << SORT_LZ_HASH_BITS];	/* Last position + 1 */
+	unsigned int		prev[SORT_LZ_WINDOW + 1];	/* Previous position + 1
+								   with the same hash */
+};
+
+/* Header of a compressed block in a temporary file */
+struct sort_block {
+	unsigned int		stored;	/* Bytes following, compressed or not */
+	unsigned int		raw;	/* Bytes after decompression */
 };
 
 /* Sort base structure */
 struct cobsort {
 	void			*pointer;
-	struct cobitem		*empty;
 	void			*sort_return;
 	cob_field		*fnstatus;
+	struct cob_sort_key	*keys;		/* Prepared keys */
 	struct sort_mem_struct	*mem_base;
+	struct sort_entry	*entries;
+	struct sort_run		*runs;
+	struct sort_input	*input;
+	size_t			*tree;		/* Loser tree over input */
+	unsigned char		*wbuf;		/* Output buffer for runs */
 	size_t			unique;
 	size_t			size;
 	size_t			alloc_size;
@@ -471,16 +582,42 @@ struct cobsort {
 	size_t			mem_used;
 	size_t			mem_total;
 	size_t			chunk_size;
-	size_t			r_size;
 	size_t			w_size;
+	size_t			key_len;	/* Size of the encoded keys after
+						   each record, 0 if not used */
+	size_t			buff_size;	/* Size of wbuf and each input buff */
+	unsigned char		*cbuf;		/* Compressed block */
+	struct sort_lz		*lz;		/* Match finder of the compression */
+	unsigned int		compress;	/* Compression level, 0 = none */
 	size_t			switch_to_file;
+	size_t			entry_count;
+	size_t			entry_alloc;
+	size_t			run_count;
+	size_t			run_alloc;
+	size_t			input_count;
+	size_t			wlen;
+	size_t			cur_run;
+	size_t			retrieval_pos;
+	size_t			initial_runs;	/* Statistics */
+	size_t			passes;
+	cob_s64_t		spilled;
+	cob_u64_t		last_prefix;
 	unsigned int		retrieving;
 	unsigned int		files_used;
-	int			destination_file;
-	int			retrieval_queue;
-	struct queue_struct	queue[4];
-	struct file_struct	file[4];
+	int			use_prefix;
+	int			merge_file;
+	struct file_struct	file[2];
 	int			flag_merge;
+	unsigned int		threads;	/* Threads for sorting in memory */
+	size_t			mem_limit;	/* Memory for records in memory */
+#ifdef	COB_SORT_USE_THREADS
+	pthread_t		writer;		/* Thread writing the last batch */
+	int			writer_active;
+	int			writer_error;
+	struct sort_mem_struct	*w_mem_base;	/* Batch of records to write */
+	struct sort_entry	*w_entries;
+	size_t			w_count;
+#endif
 };
 
 /* End SORT definitions */
@@ -495,8 +632,10 @@ static unsigned int	eop_status = 0;
 static unsigned int	check_eop_status = 0;
 static int		cob_vsq_len = 0;
 static int		last_operation_open = 0;
+static int		journal_fd = -1;	/* COB_FILE_JOURNAL */
 
 static struct file_list	*file_cache = NULL;
+static struct seq_buffer	*seqbuf_list = NULL;
 
 static char		*file_open_env = NULL;
 static char		*file_open_name = NULL;
@@ -532,6 +671,10 @@ static int cob_file_close	(cob_file *, const int);
 static int cob_savekey (cob_file *f, int idx, unsigned char *data);
 static int cob_file_write_opt	(cob_file *, const int);
 
+static struct seq_buffer	*seqbuf_get	(cob_file *);
+static int seqbuf_flush		(cob_file *);
+static void seqbuf_free		(cob_file *);
+
 static int sequential_read	(cob_file *, const int);
 static int set_sequential_variable_length (cob_file *);
 static int sequential_write	(cob_file *, const int);
@@ -656,6 +799,8 @@ static const char	**bdb_data_dir = NULL;
 static void		*record_lock_object = NULL;
 static size_t		rlo_size = 0;
 static unsigned int	bdb_lock_id = 0;
+static cob_u64_t	bdb_cache_hit = 0;	/* cache statistics of closed */
+static cob_u64_t	bdb_cache_miss = 0;	/* files without environment */
 
 #define DB_PUT(db,key,data,flags)	db->put (db, NULL, key, data, flags)
 #define DB_GET(db,key,data,flags)	db->get (db, NULL, key, data, flags)
@@ -672,6 +817,7 @@ static unsigned int	bdb_lock_id = 0;
 #define DB_CLOSE(db)		db->close (db, 0)
 #define DB_SYNC(db)		db->sync (db, 0)
 #define	cob_dbtsize_t		u_int32_t
+#define	BDB_GIGABYTE		((size_t)1024 * 1024 * 1024)
 
 #if	defined(WORDS_BIGENDIAN)
 /* Big Endian then leave 'int' alone */
@@ -717,13 +863,14 @@ struct indexed_file {
 	int			key_index;
 	unsigned int	bdb_lock_id;
 	int		write_cursor_open;
-	int		record_locked;
 	int		filenamelen;
 	int		file_lock_set;
 	DBT		key;
 	DBT		data;
 	DB_LOCK		bdb_file_lock;
-	DB_LOCK		bdb_record_lock;
+	DB_LOCK		*bdb_record_locks;	/* Record locks held */
+	size_t		nlocks;
+	size_t		alloc_locks;
 };
 
 /* collation aware key comparision,
@@ -738,6 +885,10 @@ indexed_key_compare (const unsigned char *k1, const unsigned char *k2,
 	return memcmp (k1, k2, sz);
 }
 
+#endif	/* WITH_DB */
+
+#if	defined(WITH_DB) || defined(WITH_LMDB)
+
 /* Return total length of the key */
 static int
 bdb_keylen (cob_file *f, int idx)
@@ -778,26 +929,6 @@ bdb_savekey (cob_file *f, unsigned char *keyarea, unsigned char *record, int idx
 	return (int)f->keys[idx].field->size;
 }
 
-static COB_INLINE void
-bdb_setkeycol (cob_file *f, int idx)
-{
-	struct indexed_file	*p = f->file;
-	DBT_SET_APP_DATA(&p->key, (void *)f->keys[idx].collating_sequence);
-}
-
-static void
-bdb_setkey (cob_file *f, int idx)
-{
-	struct indexed_file	*p = f->file;
-	int	len;
-
-	memset (p->savekey, 0, p->maxkeylen);
-	len = bdb_savekey (f, p->savekey, f->record->data, idx);
-	p->key.data = p->savekey;
-	p->key.size = (cob_dbtsize_t) len;
-	bdb_setkeycol (f, idx);
-}
-
 /* Compare key for given index 'keyarea' to 'record'.
 	 returns compare status */
 static int
@@ -834,6 +965,30 @@ bdb_cmpkey (cob_file *f, unsigned char *keyarea, unsigned char *record, int idx,
 	return memcmp (keyarea, record  + f->keys[idx].offset, cl);
 }
 
+#endif	/* WITH_DB || WITH_LMDB */
+
+#ifdef	WITH_DB
+
+static COB_INLINE void
+bdb_setkeycol (cob_file *f, int idx)
+{
+	struct indexed_file	*p = f->file;
+	DBT_SET_APP_DATA(&p->key, (void *)f->keys[idx].collating_sequence);
+}
+
+static void
+bdb_setkey (cob_file *f, int idx)
+{
+	struct indexed_file	*p = f->file;
+	int	len;
+
+	memset (p->savekey, 0, p->maxkeylen);
+	len = bdb_savekey (f, p->savekey, f->record->data, idx);
+	p->key.data = p->savekey;
+	p->key.size = (cob_dbtsize_t) len;
+	bdb_setkeycol (f, idx);
+}
+
 /* Is given key data all SUPPRESS char,
 	 returns 1 if key has all SUPPRESS char */
 static int
@@ -943,6 +1098,164 @@ bdb_bt_compare (DB *db, const DBT *k1, const DBT *k2
 
 #endif	/* WITH_DB */
 
+#ifdef	WITH_LMDB
+
+/* LMDB: an INDEXED file is an LMDB environment in a single file (plus
+   its "-lock" file), each key being a named sub-database; the primary
+   one holds the records, the alternate ones the primary key and for
+   keys with duplicates (DUPSORT) a big-endian sequence number before
+   it, so that duplicates are read in the order they were written.
+   Reads copy the record directly out of the memory map within a
+   read-only transaction, which never blocks a writer; each update is
+   a single write transaction. The environment is shared by all open
+   files of the process, file and record locks are byte locks on the
+   data file as the ones of the built-in ISAM. */
+
+#define	LMDB_DUPNO_LEN		4
+#define	LMDB_LOCK_OPEN		0x40000000U
+#define	LMDB_LOCK_RECORD	(LMDB_LOCK_OPEN + 1)
+#define	LMDB_LOCK_HASH		0x1FFFFFFFU
+#ifdef	COB_64_BIT_POINTER
+#define	LMDB_MAPSIZE		((size_t)1 << 30)
+#else
+#define	LMDB_MAPSIZE		((size_t)1 << 26)
+#endif
+
+struct indexed_file;
+
+struct lmdb_env {
+	struct lmdb_env		*next;
+	struct indexed_file	*users;		/* Open files of this environment */
+	MDB_env			*env;
+	dev_t			dev;
+	ino_t			ino;
+	int			lock_fd;	/* Data file, for the byte locks */
+	int			exclusive;	/* Opened exclusively */
+};
+
+static struct lmdb_env	*lmdb_env_list = NULL;
+
+struct indexed_file {
+	struct indexed_file	*next_user;
+	struct lmdb_env		*envp;
+	MDB_dbi			*dbi;		/* Sub-database per key */
+	MDB_txn			*rtxn;		/* Read transaction, reset between reads */
+	MDB_val			key;
+	unsigned char		*savekey;	/* Work area for key values */
+	unsigned char		*suppkey;	/* Work area for old key values */
+	unsigned char		*primdata;	/* Sequence number and primary key */
+	unsigned char		*saverec;	/* Copy of the record to be replaced */
+	unsigned char		*last_key;	/* The last primary key written */
+	unsigned char		*pos_key;	/* Index entry of the current position */
+	unsigned char		*pos_data;
+	unsigned char		*prim_key;	/* Primary key of the record read */
+	size_t			pos_keylen;
+	size_t			pos_datalen;
+	int			key_index;
+	int			maxkeylen;
+	int			primekeylen;
+	int			pos_valid;
+	unsigned int		*lock_hash;	/* Bytes of the record locks held */
+	size_t			nlocks;
+	size_t			alloc_locks;
+	int			last_rc;	/* LMDB error of the last update */
+};
+
+/* Set p->key to the key 'idx' of the record */
+static void
+lmdb_setkey (cob_file *f, int idx)
+{
+	struct indexed_file	*p = f->file;
+
+	p->key.mv_data = p->savekey;
+	p->key.mv_size = (size_t)bdb_savekey (f, p->savekey, f->record->data, idx);
+}
+
+/* Is the key value all SUPPRESS char, returns 1 if it is */
+static int
+lmdb_suppresskey (cob_file *f, int idx, const unsigned char *keyarea,
+		  const size_t len)
+{
+	unsigned char	ch_sprs;
+	size_t		i;
+
+	if (!f->keys[idx].tf_suppress) {
+		return 0;
+	}
+	ch_sprs = f->keys[idx].char_suppress & 0xFF;
+	for (i = 0; i < len; i++) {
+		if (keyarea[i] != ch_sprs) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* Does the index 'idx' store duplicates */
+static COB_INLINE int
+lmdb_hasdups (cob_file *f, int idx)
+{
+	return idx > 0 && f->keys[idx].tf_duplicates;
+}
+
+/* Primary key stored in the index entry 'data' of index 'idx' */
+static COB_INLINE void
+lmdb_primkey (cob_file *f, int idx, const MDB_val *data, MDB_val *prim)
+{
+	struct indexed_file	*p = f->file;
+
+	prim->mv_data = (unsigned char *)data->mv_data
+		+ (lmdb_hasdups (f, idx) ? LMDB_DUPNO_LEN : 0);
+	prim->mv_size = (size_t)p->primekeylen;
+}
+
+static unsigned int
+lmdb_getdupno (const MDB_val *data)
+{
+	const unsigned char	*d = data->mv_data;
+
+	return ((unsigned int)d[0] << 24) | ((unsigned int)d[1] << 16)
+	     | ((unsigned int)d[2] << 8) | (unsigned int)d[3];
+}
+
+static void
+lmdb_putdupno (unsigned char *d, const unsigned int dupno)
+{
+	d[0] = (unsigned char)(dupno >> 24);
+	d[1] = (unsigned char)(dupno >> 16);
+	d[2] = (unsigned char)(dupno >> 8);
+	d[3] = (unsigned char)dupno;
+}
+
+/* Map an LMDB error to a file status */
+static int
+lmdb_status (const int rc)
+{
+	switch (rc) {
+	case 0:
+		return COB_STATUS_00_SUCCESS;
+	case MDB_NOTFOUND:
+		return COB_STATUS_23_KEY_NOT_EXISTS;
+	case MDB_KEYEXIST:
+		return COB_STATUS_22_KEY_EXISTS;
+	case MDB_MAP_FULL:
+		return COB_STATUS_24_KEY_BOUNDARY;
+	case EACCES:
+	case EPERM:
+	case EROFS:
+		return COB_STATUS_37_PERMISSION_DENIED;
+	case MDB_INCOMPATIBLE:
+	case MDB_INVALID:
+	case MDB_VERSION_MISMATCH:
+	case MDB_BAD_VALSIZE:
+		return COB_STATUS_39_CONFLICT_ATTRIBUTE;
+	default:
+		return COB_STATUS_30_PERMANENT_ERROR;
+	}
+}
+
+#endif	/* WITH_LMDB */
+
 
 /* Local functions */
 
@@ -1328,6 +1641,8 @@ cob_sync (cob_file *f)
 #ifdef	WITH_DB
 	struct indexed_file	*p;
 	size_t			i;
+#elif	defined(WITH_LMDB)
+	struct indexed_file	*p;
 #elif	defined(WITH_ANY_ISAM)
 	struct indexfile	*fh;
 #endif
@@ -1342,6 +1657,11 @@ cob_sync (cob_file *f)
 				}
 			}
 		}
+#elif	defined(WITH_LMDB)
+		p = f->file;
+		if (p) {
+			mdb_env_sync (p->envp->env, 1);
+		}
 #elif	defined(WITH_ANY_ISAM)
 		fh = f->file;
 		if (fh) {
@@ -1354,6 +1674,7 @@ cob_sync (cob_file *f)
 		if (f->file) {
 			fflush ((FILE *)f->file);
 		}
+		(void)seqbuf_flush (f);
 		if (f->fd >= 0) {
 			fdcobsync (f->fd);
 		}
@@ -1451,7 +1772,8 @@ save_status (cob_file *f, cob_field *fnstatus, const int status)
 		}
 		if (cobsetptr->cob_do_sync
 		 && !last_operation_open
-		 && f->open_mode != COB_OPEN_CLOSED) {
+		 && f->open_mode != COB_OPEN_CLOSED
+		 && journal_fd == -1) {	/* else synced on COMMIT */
 			cob_sync (f);
 		}
 	} else {
@@ -1507,83 +1829,740 @@ errno_cob_sts (const int default_status)
 		} \
 	} ONCE_COB /* LCOV_EXCL_LINE */
 
-static size_t
-file_linage_check (cob_file *f)
+/* write to a (record) SEQUENTIAL file, either directly or into its buffer */
+#define COB_CHECKED_SEQ_WRITE(f,string,length_to_write)	do { \
+		const size_t length = (size_t)(length_to_write); \
+		if (unlikely (seq_write (f, string, length) != 0)) { \
+			return errno_cob_sts (COB_STATUS_30_PERMANENT_ERROR); \
+		} \
+	} ONCE_COB /* LCOV_EXCL_LINE */
+
+/* Journal for COMMIT and ROLLBACK, active with COB_FILE_JOURNAL:
+   before data of a SEQUENTIAL, RELATIVE or (built-in) INDEXED file
+   is overwritten, it is appended to the journal as before-image,
+   together with the size the file had at the start of the unit of
+   work - data written after that size needs no image;
+   ROLLBACK writes the images back, newest first, and cuts the files
+   to their old size, COMMIT syncs each changed file once and empties
+   the journal; a journal left by a program that was killed is rolled
+   back when the next program using it starts */
+
+struct journal_region {
+	cob_s64_t		offset;
+	size_t			len;		/* 0 = unused */
+};
+
+struct journal_file {
+	struct journal_file	*next;
+	char			*name;
+	int			fd;		/* -1 after CLOSE */
+	cob_file		*f;		/* NULL for INDEXED files */
+	int			touched;	/* Changed in this unit of work */
+	cob_s64_t		size;		/* Size at the start of the unit */
+	struct journal_region	*regions;	/* Hash of the images taken */
+	size_t			nregions;
+	size_t			alloc_regions;
+};
+
+/* Header of a journal entry, followed by the file name and the image */
+struct journal_entry {
+	unsigned int		magic;
+	unsigned int		name_len;
+	cob_s64_t		offset;
+	cob_s64_t		size;		/* Size of the file before the unit */
+	cob_s64_t		len;		/* Length of the image */
+};
+
+#define	JOURNAL_MAGIC		0x314C4E4A	/* "JNL1" */
+
+static cob_s64_t		journal_size = 0;
+static struct journal_file	*journal_files = NULL;
+static struct journal_file	*journal_last = NULL;
+static unsigned char		*journal_buff = NULL;
+static size_t			journal_buff_size = 0;
+
+static void	journal_commit	(void);
+
+static struct journal_file *
+journal_find (const int fd)
 {
-	cob_linage	*lingptr;
+	struct journal_file	*jf;
 
-	lingptr = f->linorkeyptr;
-	lingptr->lin_lines = cob_get_int (lingptr->linage);
-	if (lingptr->lin_lines < 1) {
-		goto linerr;
+	if (journal_last && journal_last->fd == fd) {
+		return journal_last;
 	}
-	if (lingptr->latfoot) {
-		lingptr->lin_foot = cob_get_int (lingptr->latfoot);
-		if (lingptr->lin_foot < 1 ||
-		    lingptr->lin_foot > lingptr->lin_lines) {
-			goto linerr;
+	for (jf = journal_files; jf; jf = jf->next) {
+		if (jf->fd == fd) {
+			journal_last = jf;
+			return jf;
 		}
-	} else {
-		lingptr->lin_foot = 0;
 	}
-	if (lingptr->lattop) {
-		lingptr->lin_top = cob_get_int (lingptr->lattop);
-		if (lingptr->lin_top < 0) {
-			goto linerr;
-		}
-	} else {
-		lingptr->lin_top = 0;
+	return NULL;
+}
+
+/* start journaling the changes of 'fd', opened for output as 'name' */
+void
+cob_journal_add_file (const int fd, const char *name, cob_file *f)
+{
+	struct journal_file	*jf;
+	char			*full_name;
+
+	if (journal_fd == -1 || fd < 0
+	 || journal_find (fd) != NULL) {
+		return;
 	}
-	if (lingptr->latbot) {
-		lingptr->lin_bot = cob_get_int (lingptr->latbot);
-		if (lingptr->lin_bot < 0) {
-			goto linerr;
+	/* the journal may be rolled back from another directory */
+#ifndef	_WIN32
+	if (name[0] != '/') {
+		char	*cwd = getcwd (NULL, (size_t)0);
+		if (cwd) {
+			full_name = cob_malloc (strlen (cwd) + strlen (name) + 2);
+			sprintf (full_name, "%s/%s", cwd, name);
+			cob_free (cwd);
+		} else {
+			full_name = cob_strdup (name);
+		}
+	} else
+#endif
+	full_name = cob_strdup (name);
+	/* a file reopened within the unit keeps its images */
+	for (jf = journal_files; jf; jf = jf->next) {
+		if (jf->fd == -1
+		 && !strcmp (jf->name, full_name)) {
+			break;
 		}
+	}
+	if (jf == NULL) {
+		jf = cob_malloc (sizeof (struct journal_file));
+		jf->name = full_name;
+		jf->next = journal_files;
+		journal_files = jf;
 	} else {
-		lingptr->lin_bot = 0;
+		cob_free (full_name);
 	}
-	return 0;
-linerr:
-	cob_set_int (lingptr->linage_ctr, 0);
-	return 1;
+	jf->fd = fd;
+	jf->f = f;
 }
 
-static int
-cob_linage_write_opt (cob_file *f, const int opt)
+static void
+journal_free_file (struct journal_file *jf)
 {
-	cob_linage		*lingptr;
-	FILE		*fp = (FILE *)f->file;
-	int			i;
-	int			n;
+	if (journal_last == jf) {
+		journal_last = NULL;
+	}
+	if (jf->regions) {
+		cob_free (jf->regions);
+	}
+	cob_free (jf->name);
+	cob_free (jf);
+}
 
-	lingptr = f->linorkeyptr;
-	if (unlikely (opt & COB_WRITE_PAGE)) {
-		i = cob_get_int (lingptr->linage_ctr);
-		if (i == 0) {
-			return COB_STATUS_57_I_O_LINAGE;
+/* stop journaling 'fd' before it is closed; a changed file is synced,
+   its images are kept for a ROLLBACK until the unit ends */
+void
+cob_journal_remove_file (const int fd)
+{
+	struct journal_file	*jf, **link;
+
+	if (journal_fd == -1 || fd < 0) {
+		return;
+	}
+	for (link = &journal_files; *link; link = &(*link)->next) {
+		jf = *link;
+		if (jf->fd != fd) {
+			continue;
 		}
-		n = lingptr->lin_lines;
-		for (; i < n; ++i) {
-			COB_CHECKED_FPUTC ('\n', fp);
+		if (jf->touched) {
+			if (jf->f
+			 && jf->f->organization == COB_ORG_LINE_SEQUENTIAL
+			 && jf->f->file) {
+				fflush ((FILE *)jf->f->file);
+			}
+			fdcobsync (fd);
+			jf->fd = -1;
+			jf->f = NULL;
+		} else {
+			*link = jf->next;
+			journal_free_file (jf);
 		}
-		for (i = 0; i < lingptr->lin_bot; ++i) {
-			COB_CHECKED_FPUTC ('\n', fp);
+		if (journal_last == jf) {
+			journal_last = NULL;
 		}
-		if (file_linage_check (f)) {
-			return COB_STATUS_57_I_O_LINAGE;
+		return;
+	}
+}
+
+/* remember the image of 'len' bytes at 'offset', returns 1 if an image
+   of these bytes was taken before in this unit */
+static int
+journal_region_add (struct journal_file *jf, const cob_s64_t offset,
+		    const size_t len)
+{
+	struct journal_region	*r;
+	size_t			i, mask;
+
+	if (jf->nregions * 2 >= jf->alloc_regions) {
+		struct journal_region	*old = jf->regions;
+		const size_t		old_size = jf->alloc_regions;
+		jf->alloc_regions = old_size ? old_size * 2 : 64;
+		jf->regions = cob_malloc (jf->alloc_regions
+					  * sizeof (struct journal_region));
+		jf->nregions = 0;
+		for (i = 0; i < old_size; ++i) {
+			if (old[i].len) {
+				(void)journal_region_add (jf, old[i].offset, old[i].len);
+			}
 		}
-		for (i = 0; i < lingptr->lin_top; ++i) {
-			COB_CHECKED_FPUTC ('\n', fp);
+		if (old) {
+			cob_free (old);
 		}
-		cob_set_int (lingptr->linage_ctr, 1);
-	} else if (opt & COB_WRITE_LINES) {
-		n = cob_get_int (lingptr->linage_ctr);
-		if (n == 0) {
-			return COB_STATUS_57_I_O_LINAGE;
+	}
+	mask = jf->alloc_regions - 1;
+	i = (size_t)(((cob_u64_t)offset * COB_U64_C(0x9E3779B97F4A7C15)) >> 40) & mask;
+	for (;;) {
+		r = &jf->regions[i];
+		if (r->len == 0) {
+			r->offset = offset;
+			r->len = len;
+			jf->nregions++;
+			return 0;
 		}
-		cob_add_int (lingptr->linage_ctr, opt & COB_WRITE_MASK, 0);
-		i = cob_get_int (lingptr->linage_ctr);
-		/* Set EOP status if requested */
+		if (r->offset == offset) {
+			if (r->len >= len) {
+				return 1;
+			}
+			r->len = len;
+			return 0;
+		}
+		i = (i + 1) & mask;
+	}
+}
+
+/* append the before-image of 'len' bytes at 'offset' of 'fd' to the
+   journal, if that file is journaled; returns zero on success,
+   -1 otherwise - with COB_SYNC the journal is synced before the data
+   is changed; a negative 'offset' stands for data appended */
+int
+cob_journal_before (const int fd, const cob_s64_t offset, size_t len)
+{
+	struct journal_file	*jf = journal_find (fd);
+	struct journal_entry	e;
+	struct stat		st;
+	size_t			total, done;
+	off_t			pos;
+
+	if (jf == NULL) {
+		return 0;
+	}
+	if (!jf->touched) {
+		if (fstat (fd, &st)) {
+			return -1;
+		}
+		jf->size = (cob_s64_t)st.st_size;
+		jf->touched = 1;
+	} else if (offset < 0 || offset >= jf->size) {
+		/* beyond the old end, removed by ROLLBACK */
+		return 0;
+	}
+	if (offset < 0 || offset >= jf->size) {
+		len = 0;
+	} else {
+		if (offset + (cob_s64_t)len > jf->size) {
+			len = (size_t)(jf->size - offset);
+		}
+		if (journal_region_add (jf, offset, len)) {
+			return 0;
+		}
+	}
+
+	memset (&e, 0, sizeof (e));
+	e.magic = JOURNAL_MAGIC;
+	e.name_len = (unsigned int)strlen (jf->name);
+	e.offset = offset;
+	e.size = jf->size;
+	e.len = (cob_s64_t)len;
+	total = sizeof (e) + e.name_len + len;
+	if (total > journal_buff_size) {
+		if (journal_buff) {
+			cob_free (journal_buff);
+		}
+		journal_buff_size = total < COB_FILE_BUFF ? COB_FILE_BUFF : total;
+		journal_buff = cob_fast_malloc (journal_buff_size);
+	}
+	memcpy (journal_buff, &e, sizeof (e));
+	memcpy (journal_buff + sizeof (e), jf->name, e.name_len);
+	if (len) {
+		unsigned char	*p = journal_buff + sizeof (e) + e.name_len;
+		pos = lseek (fd, (off_t)0, SEEK_CUR);
+		if (pos == (off_t)-1
+		 || lseek (fd, (off_t)offset, SEEK_SET) == (off_t)-1) {
+			return -1;
+		}
+		for (done = 0; done < len; ) {
+			const int	n = (int)read (fd, p + done, len - done);
+			if (n <= 0) {
+				break;
+			}
+			done += n;
+		}
+		if (lseek (fd, pos, SEEK_SET) == (off_t)-1
+		 || done != len) {
+			return -1;
+		}
+	}
+	if (write (journal_fd, journal_buff, total) != (int)total) {
+		return -1;
+	}
+	journal_size += total;
+	if (cobsetptr->cob_do_sync) {
+		fdcobsync (journal_fd);
+	}
+	return 0;
+}
+
+/* check before the data of a file is changed, see cob_journal_before */
+#define	JOURNAL_BEFORE(fd,offset,len) \
+	(journal_fd != -1 \
+	 && cob_journal_before (fd, (cob_s64_t)(offset), (size_t)(len)))
+
+/* Block buffer for (record) SEQUENTIAL files;
+   READ and WRITE are served from memory, the file position
+   is tracked logically as offset of the buffer + position within;
+   the buffers are kept in seqbuf_list, not in cob_file, so that its
+   layout stays as is */
+
+/* the buffer of the file, NULL if it has none; the one found is moved
+   to the front, as the same file is mostly used for several calls */
+static struct seq_buffer *
+seqbuf_get (cob_file *f)
+{
+	struct seq_buffer	*b;
+	struct seq_buffer	*prev = NULL;
+
+	for (b = seqbuf_list; b; prev = b, b = b->next) {
+		if (b->file == f) {
+			if (prev) {
+				prev->next = b->next;
+				b->next = seqbuf_list;
+				seqbuf_list = b;
+			}
+			return b;
+		}
+	}
+	return NULL;
+}
+
+static void
+seqbuf_add (cob_file *f, struct seq_buffer *b)
+{
+	b->file = f;
+	b->next = seqbuf_list;
+	seqbuf_list = b;
+}
+
+static void
+seqbuf_alloc (cob_file *f, const size_t size)
+{
+	struct seq_buffer	*b;
+	off_t			pos;
+
+	b = cob_malloc (sizeof (struct seq_buffer));
+	b->size = size;
+	b->data = cob_fast_malloc (b->size);
+	b->for_write = f->open_mode == COB_OPEN_OUTPUT
+	            || f->open_mode == COB_OPEN_EXTEND;
+	pos = lseek (f->fd, (off_t)0, SEEK_CUR);
+	b->offset = pos == (off_t)-1 ? 0 : (cob_s64_t)pos;
+	seqbuf_add (f, b);
+}
+
+#ifdef	COB_FILE_USE_MMAP
+/* map a regular file opened for INPUT completely into memory,
+   returns zero if this is not possible (leaving the file as-is) */
+static int
+seqbuf_map (cob_file *f)
+{
+	struct seq_buffer	*b;
+	struct stat		st;
+	void			*map;
+	off_t			pos;
+
+	if (fstat (f->fd, &st) != 0
+	 || !S_ISREG (st.st_mode)
+	 || st.st_size == 0
+	 || (cob_u64_t)st.st_size > (cob_u64_t)(size_t)-1) {
+		return 0;
+	}
+	map = mmap (NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, f->fd, 0);
+	if (map == MAP_FAILED) {
+		return 0;
+	}
+#ifdef	MADV_SEQUENTIAL
+	if (f->access_mode == COB_ACCESS_SEQUENTIAL) {
+		(void)madvise (map, (size_t)st.st_size, MADV_SEQUENTIAL);
+	}
+#endif
+	pos = lseek (f->fd, (off_t)0, SEEK_CUR);
+	b = cob_malloc (sizeof (struct seq_buffer));
+	b->data = map;
+	b->size = b->len = (size_t)st.st_size;
+	b->pos = pos == (off_t)-1 ? 0 : (size_t)pos;
+	b->mapped = 1;
+	seqbuf_add (f, b);
+	return 1;
+}
+#endif
+
+static void
+seqbuf_free (cob_file *f)
+{
+	/* the buffer is at the front after seqbuf_get */
+	struct seq_buffer	*b = seqbuf_get (f);
+
+	if (b) {
+		seqbuf_list = b->next;
+#ifdef	COB_FILE_USE_MMAP
+		if (b->mapped) {
+			munmap ((void *)b->data, b->size);
+		} else
+#endif
+		cob_free (b->data);
+		cob_free (b);
+	}
+}
+
+/* write out pending data, returns zero on success (or without buffer),
+   -1 otherwise; data that could not be written stays in the buffer */
+static int
+seqbuf_flush (cob_file *f)
+{
+	struct seq_buffer	*b = seqbuf_get (f);
+	size_t			done = 0;
+
+	if (!b
+	 || !b->for_write
+	 || b->len == 0) {
+		return 0;
+	}
+	if (JOURNAL_BEFORE (f->fd, b->offset, b->len)) {
+		return -1;
+	}
+	while (done < b->len) {
+		const int	n = (int)write (f->fd, b->data + done, b->len - done);
+		if (n <= 0) {
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		done += n;
+	}
+	b->offset += done;
+	b->len -= done;
+	if (b->len != 0) {
+		memmove (b->data, b->data + done, b->len);
+		return -1;
+	}
+	return 0;
+}
+
+/* drop buffered input, used after the file descriptor changed */
+static void
+seqbuf_reset (cob_file *f)
+{
+	struct seq_buffer	*b = seqbuf_get (f);
+
+	if (!b) {
+		return;
+	}
+#ifdef	COB_FILE_USE_MMAP
+	if (b->mapped) {
+		seqbuf_free (f);
+		if (f->fd != -1) {
+			(void)seqbuf_map (f);
+		}
+		return;
+	}
+#endif
+	b->offset = 0;
+	b->len = b->pos = 0;
+}
+
+/* current logical file position */
+static cob_s64_t
+seq_tell (cob_file *f)
+{
+	struct seq_buffer	*b = seqbuf_get (f);
+
+	if (b) {
+		if (b->for_write) {
+			return b->offset + b->len;
+		}
+		return b->offset + b->pos;
+	}
+	return lseek (f->fd, (off_t)0, SEEK_CUR);
+}
+
+/* read up to size bytes, returns the number of bytes read (zero at end)
+   or -1 on error - same as read() but serviced from the buffer if active */
+static int
+seq_read (cob_file *f, void *dest, const size_t size)
+{
+	struct seq_buffer	*b = seqbuf_get (f);
+	unsigned char		*p = dest;
+	size_t			done;
+	int			bytesread = 0;
+
+	if (!b) {
+		return read (f->fd, dest, size);
+	}
+
+	if (b->mapped) {
+		/* no refill possible, the mapping is the complete file */
+		done = b->pos < b->len ? b->len - b->pos : 0;
+		if (done > size) {
+			done = size;
+		}
+		memcpy (p, b->data + b->pos, done);
+		b->pos += done;
+		return (int)done;
+	}
+
+	done = b->len - b->pos;
+	if (size <= done) {
+		memcpy (p, b->data + b->pos, size);
+		b->pos += size;
+		return (int)size;
+	}
+	/* take the rest of the buffer, then refill */
+	memcpy (p, b->data + b->pos, done);
+	b->offset += b->len;
+	b->len = b->pos = 0;
+	while (done < size) {
+		if (size - done >= b->size) {
+			/* record bigger than the buffer, read directly */
+			bytesread = read (f->fd, p + done, size - done);
+			if (bytesread <= 0) {
+				break;
+			}
+			b->offset += bytesread;
+			done += bytesread;
+			continue;
+		}
+		bytesread = read (f->fd, b->data, b->size);
+		if (bytesread <= 0) {
+			break;
+		}
+		b->len = bytesread;
+		b->pos = size - done;
+		if (b->pos > b->len) {
+			b->pos = b->len;
+		}
+		memcpy (p + done, b->data, b->pos);
+		done += b->pos;
+		if (b->pos < b->len) {
+			break;
+		}
+		b->offset += b->len;
+		b->len = b->pos = 0;
+	}
+	if (done == 0 && bytesread < 0) {
+		return -1;
+	}
+	return (int)done;
+}
+
+/* write size bytes, returns zero on success, -1 otherwise */
+static int
+seq_write (cob_file *f, const void *src, const size_t size)
+{
+	struct seq_buffer	*b = seqbuf_get (f);
+
+	if (!b) {
+		/* WRITE appends, REWRITE does not come here */
+		if (JOURNAL_BEFORE (f->fd, -1, 0)) {
+			return -1;
+		}
+		return write (f->fd, src, size) == (int)size ? 0 : -1;
+	}
+
+	if (b->len + size > b->size) {
+		if (seqbuf_flush (f)) {
+			return -1;
+		}
+		if (size >= b->size) {
+			/* record bigger than the buffer, write directly */
+			if (JOURNAL_BEFORE (f->fd, b->offset, size)
+			 || write (f->fd, src, size) != (int)size) {
+				return -1;
+			}
+			b->offset += size;
+			return 0;
+		}
+	}
+	memcpy (b->data + b->len, src, size);
+	b->len += size;
+	return 0;
+}
+
+/* reposition, same as lseek() */
+static off_t
+seq_seek (cob_file *f, const off_t offset, const int whence)
+{
+	struct seq_buffer	*b = seqbuf_get (f);
+	off_t			pos;
+
+	if (!b) {
+		return lseek (f->fd, offset, whence);
+	}
+	if (b->mapped) {
+		switch (whence) {
+		case SEEK_SET:
+			pos = offset;
+			break;
+		case SEEK_CUR:
+			pos = (off_t)b->pos + offset;
+			break;
+		default:
+			pos = (off_t)b->len + offset;
+			break;
+		}
+		if (pos < 0) {
+			errno = EINVAL;
+			return (off_t)-1;
+		}
+		b->pos = (size_t)pos;
+		return pos;
+	}
+	if (whence == SEEK_CUR) {
+		pos = (off_t)seq_tell (f) + offset;
+	} else {
+		pos = offset;
+	}
+	if (seqbuf_flush (f)) {
+		return (off_t)-1;
+	}
+	pos = lseek (f->fd, pos, whence == SEEK_CUR ? SEEK_SET : whence);
+	if (pos != (off_t)-1) {
+		b->offset = pos;
+		b->len = b->pos = 0;
+	}
+	return pos;
+}
+
+/* get the current size of the file, returns zero on success */
+static int
+seq_size (cob_file *f, cob_s64_t *size)
+{
+	struct seq_buffer	*b = seqbuf_get (f);
+	struct stat		st;
+
+	if (b && b->mapped) {
+		*size = (cob_s64_t)b->len;
+		return 0;
+	}
+	if (fstat (f->fd, &st) != 0) {
+		return -1;
+	}
+	*size = (cob_s64_t)st.st_size;
+	return 0;
+}
+
+/* skip size bytes of input */
+static void
+seq_skip (cob_file *f, const size_t size)
+{
+	struct seq_buffer	*b = seqbuf_get (f);
+
+	if (!b) {
+		lseek (f->fd, (off_t)size, SEEK_CUR);
+	} else if (b->mapped
+	        || b->len - b->pos >= size) {
+		b->pos += size;
+	} else {
+		b->offset += b->pos + size;
+		b->len = b->pos = 0;
+		lseek (f->fd, (off_t)b->offset, SEEK_SET);
+	}
+}
+
+static size_t
+file_linage_check (cob_file *f)
+{
+	cob_linage	*lingptr;
+
+	lingptr = f->linorkeyptr;
+	lingptr->lin_lines = cob_get_int (lingptr->linage);
+	if (lingptr->lin_lines < 1) {
+		goto linerr;
+	}
+	if (lingptr->latfoot) {
+		lingptr->lin_foot = cob_get_int (lingptr->latfoot);
+		if (lingptr->lin_foot < 1 ||
+		    lingptr->lin_foot > lingptr->lin_lines) {
+			goto linerr;
+		}
+	} else {
+		lingptr->lin_foot = 0;
+	}
+	if (lingptr->lattop) {
+		lingptr->lin_top = cob_get_int (lingptr->lattop);
+		if (lingptr->lin_top < 0) {
+			goto linerr;
+		}
+	} else {
+		lingptr->lin_top = 0;
+	}
+	if (lingptr->latbot) {
+		lingptr->lin_bot = cob_get_int (lingptr->latbot);
+		if (lingptr->lin_bot < 0) {
+			goto linerr;
+		}
+	} else {
+		lingptr->lin_bot = 0;
+	}
+	return 0;
+linerr:
+	cob_set_int (lingptr->linage_ctr, 0);
+	return 1;
+}
+
+static int
+cob_linage_write_opt (cob_file *f, const int opt)
+{
+	cob_linage		*lingptr;
+	FILE		*fp = (FILE *)f->file;
+	int			i;
+	int			n;
+
+	lingptr = f->linorkeyptr;
+	if (unlikely (opt & COB_WRITE_PAGE)) {
+		i = cob_get_int (lingptr->linage_ctr);
+		if (i == 0) {
+			return COB_STATUS_57_I_O_LINAGE;
+		}
+		n = lingptr->lin_lines;
+		for (; i < n; ++i) {
+			COB_CHECKED_FPUTC ('\n', fp);
+		}
+		for (i = 0; i < lingptr->lin_bot; ++i) {
+			COB_CHECKED_FPUTC ('\n', fp);
+		}
+		if (file_linage_check (f)) {
+			return COB_STATUS_57_I_O_LINAGE;
+		}
+		for (i = 0; i < lingptr->lin_top; ++i) {
+			COB_CHECKED_FPUTC ('\n', fp);
+		}
+		cob_set_int (lingptr->linage_ctr, 1);
+	} else if (opt & COB_WRITE_LINES) {
+		n = cob_get_int (lingptr->linage_ctr);
+		if (n == 0) {
+			return COB_STATUS_57_I_O_LINAGE;
+		}
+		cob_add_int (lingptr->linage_ctr, opt & COB_WRITE_MASK, 0);
+		i = cob_get_int (lingptr->linage_ctr);
+		/* Set EOP status if requested */
 		if (check_eop_status && lingptr->lin_foot) {
 			if (i >= lingptr->lin_foot) {
 				eop_status = COB_EC_I_O_EOP;
@@ -1625,14 +2604,14 @@ cob_seq_write_opt (cob_file *f, const int opt)
 		i = opt & COB_WRITE_MASK;
 		if (!i) {
 			/* AFTER/BEFORE 0 */
-			COB_CHECKED_WRITE (f->fd, "\r", 1);
+			COB_CHECKED_SEQ_WRITE (f, "\r", 1);
 		} else {
 			for (i = opt & COB_WRITE_MASK; i > 0; --i) {
-				COB_CHECKED_WRITE (f->fd, "\n", 1);
+				COB_CHECKED_SEQ_WRITE (f, "\n", 1);
 			}
 		}
 	} else if (opt & COB_WRITE_PAGE) {
-		COB_CHECKED_WRITE (f->fd, "\f", 1);
+		COB_CHECKED_SEQ_WRITE (f, "\f", 1);
 	}
 	return 0;
 }
@@ -1666,9 +2645,24 @@ cob_file_write_opt (cob_file *f, const int opt)
  * Open (record) Sequential and Relative files
  *  with just an 'fd' (No FILE *)
  */
-static int
-cob_fd_file_open (cob_file *f, char *filename,
-		const enum cob_open_mode mode, const int sharing,
+/* RELATIVE files opened I-O with LOCK MODE MANUAL or AUTOMATIC are shared
+   with other processes: the OPEN sets a read lock on the bytes before
+   REL_LOCK_BASE only, the record locks are write locks on the byte
+   REL_LOCK_BASE + record number (wrapped with REL_LOCK_MASK) */
+#define	REL_LOCK_BASE	0x40000000U
+#define	REL_LOCK_MASK	0x3FFFFFFFU
+#ifdef	HAVE_FCNTL
+#define	REL_SHARED(f)	((f)->organization == COB_ORG_RELATIVE \
+			 && (f)->open_mode == COB_OPEN_I_O \
+			 && ((f)->lock_mode & (COB_LOCK_MANUAL | COB_LOCK_AUTOMATIC)) \
+			 && !((f)->lock_mode & COB_FILE_EXCLUSIVE))
+#else
+#define	REL_SHARED(f)	0
+#endif
+
+static int
+cob_fd_file_open (cob_file *f, char *filename,
+		const enum cob_open_mode mode, const int sharing,
 		unsigned int	nonexistent)
 {
 	int		fd;
@@ -1802,6 +2796,12 @@ cob_fd_file_open (cob_file *f, char *filename,
 		lock.l_whence = SEEK_SET;
 		lock.l_start = 0;
 		lock.l_len = 0;
+		if (f->organization == COB_ORG_RELATIVE
+		 && (mode == COB_OPEN_INPUT || REL_SHARED (f))) {
+			/* leave the record locks to the shared users */
+			lock.l_type = F_RDLCK;
+			lock.l_len = (off_t)REL_LOCK_BASE;
+		}
 		errno = 0;
 		if (fcntl (fd, F_SETLK, &lock) < 0) {
 			int		ret = errno;
@@ -1836,6 +2836,17 @@ cob_fd_file_open (cob_file *f, char *filename,
 #endif
 	f->fd = fd;
 	f->record_off = -1;
+#ifdef	COB_FILE_USE_MMAP
+	if (cobsetptr->cob_file_mmap
+	 && mode == COB_OPEN_INPUT
+	 && seqbuf_map (f)) {
+		/* READs are served from the mapping */
+	} else
+#endif
+	if (cobsetptr->cob_seq_buffer_size != 0
+	 && f->organization == COB_ORG_SEQUENTIAL) {
+		seqbuf_alloc (f, cobsetptr->cob_seq_buffer_size);
+	}
 #if 0	/* Simon: disabled, this function is expected to not use a FILE* */
 	{
 		const char *fopen_flags;
@@ -1938,7 +2949,11 @@ cob_file_open (cob_file *f, char *filename,
 	f->fd = -1;
 
 	if (f->organization != COB_ORG_LINE_SEQUENTIAL) {
-		return cob_fd_file_open (f, filename, mode, sharing, nonexistent);
+		const int	ret = cob_fd_file_open (f, filename, mode, sharing, nonexistent);
+		if (ret == 0 && mode != COB_OPEN_INPUT) {
+			cob_journal_add_file (f->fd, filename, f);
+		}
+		return ret;
 	}
 
 	/* Open the file */
@@ -2097,6 +3112,12 @@ cob_file_open (cob_file *f, char *filename,
 	}
 #endif
 	f->file = fp;
+	if (fp && mode == COB_OPEN_INPUT) {
+		/* READ scans blocks of the file instead of single characters */
+		seqbuf_alloc (f, COB_LS_BUFFER_SIZE);
+	} else if (fp) {
+		cob_journal_add_file (f->fd, filename, f);
+	}
 	if (f->flag_optional && nonexistent) {
 		return COB_STATUS_05_SUCCESS_OPTIONAL;
 	}
@@ -2111,6 +3132,7 @@ cob_file_close (cob_file *f, const int opt)
 #ifdef	WITH_SEQRA_EXTFH
 	return extfh_cob_file_close (f, opt);
 #else
+	int	ret = 0;
 
 	switch (opt) {
 	case COB_CLOSE_LOCK:
@@ -2127,12 +3149,24 @@ cob_file_close (cob_file *f, const int opt)
 				f->flag_needs_nl = 0;
 				putc ('\n', (FILE *)f->file);
 			}
-		} else if (f->flag_needs_nl) {
-			f->flag_needs_nl = 0;
-			if (f->fd >= 0) {
-				COB_CHECKED_WRITE (f->fd, "\n", 1);
+			seqbuf_free (f);
+		} else {
+			/* an error is returned after the file is closed and
+			   unlocked as usual */
+			if (f->flag_needs_nl) {
+				f->flag_needs_nl = 0;
+				if (f->fd >= 0
+				 && seq_write (f, "\n", 1) != 0) {
+					ret = errno_cob_sts (COB_STATUS_30_PERMANENT_ERROR);
+				}
+			}
+			if (seqbuf_flush (f) != 0
+			 && ret == 0) {
+				ret = errno_cob_sts (COB_STATUS_30_PERMANENT_ERROR);
 			}
+			seqbuf_free (f);
 		}
+		cob_journal_remove_file (f->fd);
 		/* Unlock the file */
 		if (f->fd >= 0) {
 #ifdef	HAVE_FCNTL
@@ -2183,12 +3217,18 @@ cob_file_close (cob_file *f, const int opt)
 				f->fd = -1;
 			}
 		}
+		if (ret != 0) {
+			return ret;
+		}
 		if (opt == COB_CLOSE_NO_REWIND) {
 			f->open_mode = COB_OPEN_CLOSED;
 			return COB_STATUS_07_SUCCESS_NO_UNIT;
 		}
 		return COB_STATUS_00_SUCCESS;
 	default:
+		if (seqbuf_flush (f)) {
+			return errno_cob_sts (COB_STATUS_30_PERMANENT_ERROR);
+		}
 		if (f->fd >= 0 && f->open_mode != COB_OPEN_INPUT) {
 			fdcobsync (f->fd);
 		}
@@ -2239,6 +3279,7 @@ open_next (cob_file *f)
 				f->org_filename = NULL;
 			}
 		}
+		seqbuf_reset (f);
 		if (f->fd == -1) {
 			f->file = NULL;
 		} else {
@@ -2278,7 +3319,7 @@ static int set_sequential_variable_length (cob_file *f)
 		unsigned short	sshort[2];
 		unsigned int	sint;
 	} recsize;
-	bytesread = read (f->fd, recsize.sbuff, cob_vsq_len);
+	bytesread = seq_read (f, recsize.sbuff, cob_vsq_len);
 	if (unlikely (bytesread != cob_vsq_len)) {
 		if (bytesread == 0) {
 			return COB_STATUS_10_END_OF_FILE;
@@ -2329,7 +3370,7 @@ again:
 	if (unlikely (f->flag_operation != 0)) {
 		f->flag_operation = 0;
 		/* Get current file position */
-		f->record_off = lseek (f->fd, (off_t)0, SEEK_CUR);
+		f->record_off = seq_tell (f);
 	}
 
 	if (unlikely (f->record_min != f->record_max)) {
@@ -2359,7 +3400,11 @@ again:
 	}
 
 	/* Read record */
-	bytesread = read (f->fd, f->record->data, f->record->size);
+	if (seqbuf_get (f)) {
+		/* position is known without a syscall, used for REWRITE */
+		f->record_off = seq_tell (f);
+	}
+	bytesread = seq_read (f, f->record->data, f->record->size);
 	if (bytesread == 0
 	 && f->record_min == f->record_max /* otherwise checked above */
 	 && open_next (f)) {
@@ -2414,7 +3459,7 @@ again:
 		/* we truncated the record, on to the next length indicator
 			(a follow-on rewrite will use the stored offset,
 			a follow-on read will get an end of file if this is too far */
-		lseek (f->fd, bytes_to_skip, SEEK_CUR);
+		seq_skip (f, bytes_to_skip);
 	} else {
 		/* note: we leave the data not read as-is = undefined, we _may_
 				    add a setting to set it to binary zero/space [or even
@@ -2445,7 +3490,7 @@ sequential_write (cob_file *f, const int opt)
 	if (unlikely (f->flag_operation == 0)) {
 		f->flag_operation = 1;
 		/* Get current file position */
-		f->record_off = lseek (f->fd, (off_t)0, SEEK_CUR);
+		f->record_off = seq_tell (f);
 	}
 
 	/* WRITE AFTER */
@@ -2471,11 +3516,11 @@ sequential_write (cob_file *f, const int opt)
 			recsize.sshort[0] = COB_MAYSWAP_16 (f->record->size);
 			break;
 		}
-		COB_CHECKED_WRITE (f->fd, recsize.sbuff, cob_vsq_len);
+		COB_CHECKED_SEQ_WRITE (f, recsize.sbuff, cob_vsq_len);
 	}
 
 	/* Write record */
-	COB_CHECKED_WRITE (f->fd, f->record->data, f->record->size);
+	COB_CHECKED_SEQ_WRITE (f, f->record->data, f->record->size);
 
 	/* WRITE BEFORE */
 	if (unlikely (opt & COB_WRITE_BEFORE)) {
@@ -2491,6 +3536,7 @@ sequential_write (cob_file *f, const int opt)
 static int
 sequential_rewrite (cob_file *f, const int opt)
 {
+	struct seq_buffer	*b;
 #ifdef	WITH_SEQRA_EXTFH
 	int	extfh_ret;
 
@@ -2502,6 +3548,34 @@ sequential_rewrite (cob_file *f, const int opt)
 	COB_UNUSED (opt);
 #endif
 	f->flag_operation = 1;
+	b = seqbuf_get (f);
+	if (b) {
+		/* buffered: write at the logical position of the last READ,
+		   keep the buffered copy current and go back to the physical
+		   position of the file that follows the buffer */
+		cob_s64_t	start = f->record_off;
+		cob_s64_t	end = f->record_off + (cob_s64_t)f->record->size;
+		if (lseek (f->fd, (off_t)f->record_off, SEEK_SET) == (off_t)-1
+		 || JOURNAL_BEFORE (f->fd, f->record_off, f->record->size)) {
+			return COB_STATUS_30_PERMANENT_ERROR;
+		}
+		COB_CHECKED_WRITE (f->fd, f->record->data, f->record->size);
+		if (start < b->offset) {
+			start = b->offset;
+		}
+		if (end > b->offset + (cob_s64_t)b->len) {
+			end = b->offset + (cob_s64_t)b->len;
+		}
+		if (start < end) {
+			memcpy (b->data + (start - b->offset),
+				f->record->data + (start - f->record_off),
+				(size_t)(end - start));
+		}
+		if (lseek (f->fd, (off_t)(b->offset + b->len), SEEK_SET) == (off_t)-1) {
+			return COB_STATUS_30_PERMANENT_ERROR;
+		}
+		return COB_STATUS_00_SUCCESS;
+	}
 #if 1 /* old operation, going backwards */
 	if (lseek (f->fd, -(off_t) f->record->size, SEEK_CUR) == (off_t)-1) {
 #else /* new one 4x, from the known file position */
@@ -2509,6 +3583,9 @@ sequential_rewrite (cob_file *f, const int opt)
 #endif
 		return COB_STATUS_30_PERMANENT_ERROR;
 	}
+	if (JOURNAL_BEFORE (f->fd, lseek (f->fd, (off_t)0, SEEK_CUR), f->record->size)) {
+		return COB_STATUS_30_PERMANENT_ERROR;
+	}
 	/* note: we checked for correct rcord->size in the caller */
 	COB_CHECKED_WRITE (f->fd, f->record->data, f->record->size);
 	return COB_STATUS_00_SUCCESS;
@@ -2527,10 +3604,162 @@ sequential_rewrite (cob_file *f, const int opt)
 #endif
 #endif
 
+/* refill the buffer of a LINE SEQUENTIAL file opened INPUT, keeping
+   the unread data and up to two bytes before it, so that a look-ahead
+   can be taken back; returns the number of bytes read, zero at the end
+   of the file or -1 on error - same as read() */
+static int
+ls_fill (cob_file *f, struct seq_buffer *b)
+{
+	const size_t	keep = b->pos < 2 ? b->pos : 2;
+	const size_t	start = b->pos - keep;
+	int		bytesread;
+
+	if (start > 0) {
+		memmove (b->data, b->data + start, b->len - start);
+		b->offset += start;
+		b->len -= start;
+		b->pos = keep;
+	}
+	if (f->fd < 0) {
+		return 0;
+	}
+	bytesread = read (f->fd, b->data + b->len, b->size - b->len);
+	if (bytesread > 0) {
+		b->len += bytesread;
+	}
+	return bytesread;
+}
+
+/* get next character, from the buffer b if active */
+static COB_INLINE int
+ls_getc (cob_file *f, struct seq_buffer *b, FILE *fp)
+{
+	if (!b) {
+		return getc (fp);
+	}
+	if (b->pos == b->len
+	 && ls_fill (f, b) <= 0) {
+		return EOF;
+	}
+	return b->data[b->pos++];
+}
+
+/* go back the given number of characters after a look-ahead */
+static void
+ls_unget (struct seq_buffer *b, FILE *fp, const int count)
+{
+	if (count == 0) {
+		return;
+	}
+	if (!b) {
+		fseek (fp, -(long)count, SEEK_CUR);
+	} else {
+		b->pos -= count;
+	}
+}
+
+/* READ of a LINE SEQUENTIAL file from the block buffer; instead of
+   checking every character on its own this looks for the line end
+   and takes over the data in between as a whole, with the same rules
+   as the character loop in lineseq_read, which is still used for
+   LS_NULLS; stores the data length in len and returns the io status */
+static int
+lineseq_read_block (cob_file *f, size_t *len)
+{
+	struct seq_buffer	*b = seqbuf_get (f);
+	unsigned char	*dataptr = f->record->data;
+	const int	convert = f->sort_collating && !f->nconvert_fields;
+	int		validate = cobsetptr->cob_ls_validate
+			 && !f->flag_line_adv && !f->nconvert_fields;
+	int		at_end = 0;
+	size_t		i = 0;
+	int		sts = COB_STATUS_00_SUCCESS;
+
+	for (; ;) {
+		unsigned char	*start, *nl, *p;
+		size_t		avail, span, take;
+
+		avail = b->len - b->pos;
+		/* a CR as last byte may be the start of CR LF */
+		if (!at_end
+		 && (avail == 0 || (avail == 1 && b->data[b->pos] == '\r'))) {
+			int bytesread = ls_fill (f, b);
+			if (bytesread < 0) {
+				return errno_cob_sts (COB_STATUS_30_PERMANENT_ERROR);
+			}
+			if (bytesread == 0) {
+				at_end = 1;
+			}
+			continue;
+		}
+		if (avail == 0) {
+			if (!i) {
+				return COB_STATUS_10_END_OF_FILE;
+			}
+			break;
+		}
+
+		start = b->data + b->pos;
+		nl = memchr (start, '\n', avail);
+		span = nl ? (size_t)(nl - start) : avail;
+		if (span > 0
+		 && start[span - 1] == '\r'
+		 && (nl || !at_end)) {
+			/* CR before LF is part of the line end */
+			span--;
+		}
+
+		take = f->record_max - i;
+		if (take > span) {
+			take = span;
+		}
+		if (convert) {
+			/* CODE-SET conversion for complete record */
+			unsigned char	*q = dataptr + i;
+			for (p = start; p < start + take; p++, q++) {
+				*q = *p < UCHAR_MAX ? f->code_set_read[*p] : *p;
+			}
+		} else {
+			memcpy (dataptr + i, start, take);
+		}
+		if (validate) {
+			for (p = dataptr + i; p < dataptr + i + take; p++) {
+				if (IS_BAD_CHAR (*p)) {
+					sts = COB_STATUS_09_READ_DATA_BAD;
+					validate = 0;
+					break;
+				}
+			}
+		}
+		i += take;
+
+		if (take < span) {
+			if (cobsetptr->cob_ls_split) {
+				/* If record is too long, then simulate end
+				 * so balance becomes the next record read */
+				b->pos += take;
+				sts = COB_STATUS_06_READ_TRUNCATE;
+				break;
+			}
+			/* skip the balance of the line */
+			sts = COB_STATUS_04_SUCCESS_INCOMPLETE;
+		}
+		if (nl) {
+			b->pos = (size_t)(nl - b->data) + 1;
+			break;
+		}
+		b->pos += span;
+	}
+	*len = i;
+	return sts;
+}
+
 static int
 lineseq_read (cob_file *f, const int read_opts)
 {
 	FILE	*fp;
+	struct seq_buffer	*b;
 	unsigned char	*dataptr;
 	size_t		i = 0;
 	int		n;
@@ -2563,6 +3792,7 @@ lineseq_read (cob_file *f, const int read_opts)
 	dataptr = f->record->data;
 again:
 	fp = (FILE *)f->file;
+	b = seqbuf_get (f);
 	/* save last position at start of line; needed for REWRITE (I-O only) */
 	if (f->open_mode == COB_OPEN_I_O) {
 		f->record_off = ftell (fp);
@@ -2571,8 +3801,28 @@ again:
 		   we could increment the record_off field on each read/write; this would
 		   possibly improve performance, too */
 	}
+	if (b
+#if defined (COB_EXPERIMENTAL)
+	 && cobsetptr->cob_ls_validate < 2
+#endif
+	 && (!cobsetptr->cob_ls_nulls
+	  || (cobsetptr->cob_ls_validate
+	   && !f->flag_line_adv
+	   && !f->nconvert_fields))) {
+		sts = lineseq_read_block (f, &i);
+		if (sts == COB_STATUS_10_END_OF_FILE) {
+			if (open_next (f)) {
+				goto again;
+			}
+			goto End;
+		}
+		if (sts == COB_STATUS_30_PERMANENT_ERROR) {
+			goto End;
+		}
+		goto Convert;
+	}
 	for (; ;) {
-		n = getc (fp);
+		n = ls_getc (f, b, fp);
 		if (unlikely (n == EOF)) {
 			if (!i) {
 				if (open_next (f)) {
@@ -2585,15 +3835,15 @@ again:
 			}
 		}
 		if (n == '\r') {
-			int next = getc (fp);
+			int next = ls_getc (f, b, fp);
 			if (next == '\n') {
 				/* next is LF -> so ignore CR */
 				n = '\n';
-			} else {
+			} else if (next != EOF) {
 				/* looks like \r was part of the data,
 				   re-position and pass to COBOL data
 				   after validation */
-				fseek (fp, -1, SEEK_CUR);
+				ls_unget (b, fp, 1);
 			}
 		}
 		if (n == '\n') {
@@ -2621,7 +3871,7 @@ again:
 		} else
 		if (cobsetptr->cob_ls_nulls) {
 			if (n == 0) {
-				n = getc (fp);
+				n = ls_getc (f, b, fp);
 				/* NULL-Encoded -> should be less than a space */
 				if (n == EOF || (unsigned char)n >= ' ') {
 					sts = COB_STATUS_71_BAD_CHAR;
@@ -2647,16 +3897,20 @@ again:
 			 && (cobsetptr->cob_ls_split)) {
 				/* If record is too long, then simulate end
 				 * so balance becomes the next record read */
-				long	k;
-				n = getc (fp);
+				int	k;
+				n = ls_getc (f, b, fp);
 				if (n == '\r') {
-					n = getc (fp);
-					k = -2;
+					n = ls_getc (f, b, fp);
+					k = 2;
 				} else {
-					k = -1;
+					k = 1;
 				}
-				if (n != '\n') {
-					fseek (fp, k, SEEK_CUR);
+				if (n == EOF) {
+					/* nothing to re-position for */
+					k--;
+				}
+				if (n != '\n' && k != 0) {
+					ls_unget (b, fp, k);
 					sts = COB_STATUS_06_READ_TRUNCATE;
 				}
 				break;
@@ -2666,6 +3920,7 @@ again:
 			sts = COB_STATUS_04_SUCCESS_INCOMPLETE;
 		}
 	}
+Convert:
 	/* CODE-SET FOR - convert specific area only */
 	if (f->sort_collating && f->nconvert_fields) {
 		const unsigned char *rec_end = f->record->data + i;
@@ -2768,6 +4023,11 @@ lineseq_write (cob_file *f, const int opt)
 	}
 #endif
 
+	/* records are appended, the journal only needs the old size */
+	if (JOURNAL_BEFORE (f->fd, -1, 0)) {
+		return COB_STATUS_30_PERMANENT_ERROR;
+	}
+
 	if (unlikely (f->flag_select_features & COB_SELECT_LINAGE)) {
 		if (f->flag_needs_top) {
 			const cob_linage		*lingptr = f->linorkeyptr;
@@ -2911,7 +4171,8 @@ lineseq_rewrite (cob_file *f, const int opt)
 		return COB_STATUS_44_RECORD_OVERFLOW;
 	}
 
-	if (fseek (fp, (off_t)f->record_off, SEEK_SET) != 0) {
+	if (fseek (fp, (off_t)f->record_off, SEEK_SET) != 0
+	 || JOURNAL_BEFORE (f->fd, f->record_off, slotlen)) {
 		return COB_STATUS_30_PERMANENT_ERROR;
 	}
 
@@ -2979,8 +4240,209 @@ lineseq_rewrite (cob_file *f, const int opt)
 	return COB_STATUS_00_SUCCESS;
 }
 
+/* Byte locks, used for record locks of RELATIVE files, by the built-in ISAM
+   (cobisam.c) and for LMDB */
+
+/* set (COB_BYTE_READ_LOCK / COB_BYTE_WRITE_LOCK) or release
+   (COB_BYTE_UNLOCK) the lock on byte 'offset' of 'fd', for other
+   processes; returns the errno */
+int
+cob_lock_byte (const int fd, const unsigned int offset, const int type,
+	       const int wait)
+{
+#ifdef	HAVE_FCNTL
+	struct flock	lock;
+
+	memset (&lock, 0, sizeof (lock));
+	switch (type) {
+	case COB_BYTE_READ_LOCK:
+		lock.l_type = F_RDLCK;
+		break;
+	case COB_BYTE_WRITE_LOCK:
+		lock.l_type = F_WRLCK;
+		break;
+	default:
+		lock.l_type = F_UNLCK;
+		break;
+	}
+	lock.l_whence = SEEK_SET;
+	lock.l_start = (off_t)offset;
+	lock.l_len = 1;
+	while (fcntl (fd, wait ? F_SETLKW : F_SETLK, &lock) == -1) {
+		if (errno != EINTR) {
+			return errno == EACCES ? EAGAIN : errno;
+		}
+	}
+	return 0;
+#elif defined _WIN32
+	/* locked bytes after 4 GB, as locks on Windows are mandatory */
+	HANDLE		osHandle = (HANDLE)_get_osfhandle (fd);
+	OVERLAPPED	pos = { 0 };
+
+	if (osHandle == INVALID_HANDLE_VALUE) {
+		return EBADF;
+	}
+	pos.Offset = offset;
+	pos.OffsetHigh = 1;
+	if (type == COB_BYTE_UNLOCK) {
+		UnlockFileEx (osHandle, 0, 1, 0, &pos);
+		return 0;
+	}
+	if (!LockFileEx (osHandle,
+			(type == COB_BYTE_WRITE_LOCK ? LOCKFILE_EXCLUSIVE_LOCK : 0)
+			| (wait ? 0 : LOCKFILE_FAIL_IMMEDIATELY),
+			0, 1, 0, &pos)) {
+		return EAGAIN;
+	}
+	return 0;
+#else
+	COB_UNUSED (fd);
+	COB_UNUSED (offset);
+	COB_UNUSED (type);
+	COB_UNUSED (wait);
+	return 0;
+#endif
+}
+
+/* check if another process holds a lock on byte 'offset' of 'fd' */
+int
+cob_lock_byte_held (const int fd, const unsigned int offset)
+{
+#ifdef	HAVE_FCNTL
+	struct flock	lock;
+
+	memset (&lock, 0, sizeof (lock));
+	lock.l_type = F_WRLCK;
+	lock.l_whence = SEEK_SET;
+	lock.l_start = (off_t)offset;
+	lock.l_len = 1;
+	if (fcntl (fd, F_GETLK, &lock) == -1) {
+		return 0;
+	}
+	return lock.l_type != F_UNLCK;
+#else
+	if (cob_lock_byte (fd, offset, COB_BYTE_WRITE_LOCK, 0)) {
+		return 1;
+	}
+	cob_lock_byte (fd, offset, COB_BYTE_UNLOCK, 0);
+	return 0;
+#endif
+}
+
+/* wait up to COB_LOCK_WAIT milliseconds for another process to release its
+   lock on byte 'offset' of 'fd', pausing between the attempts; with 'test'
+   only check that no other process holds a lock on it, otherwise set
+   the write lock; returns the errno, EAGAIN if it is still locked */
+int
+cob_lock_byte_wait (const int fd, const unsigned int offset, const int test)
+{
+	unsigned int	waited = 0;
+	unsigned int	pause = 1;
+
+	for (;;) {
+		if (test) {
+			if (!cob_lock_byte_held (fd, offset)) {
+				return 0;
+			}
+		} else {
+			const int	ret
+				= cob_lock_byte (fd, offset, COB_BYTE_WRITE_LOCK, 0);
+			if (ret != EAGAIN) {
+				return ret;
+			}
+		}
+		if (waited >= cobsetptr->cob_lock_wait) {
+			return EAGAIN;
+		}
+		if (pause > cobsetptr->cob_lock_wait - waited) {
+			pause = cobsetptr->cob_lock_wait - waited;
+		}
+		cob_sleep_msec (pause);
+		waited += pause;
+		if (pause < 64) {
+			pause *= 2;
+		}
+	}
+}
+
 /* RELATIVE */
 
+/* release the record locks of a shared RELATIVE file */
+static void
+relative_unlock_records (cob_file *f)
+{
+#ifdef	HAVE_FCNTL
+	struct flock	lock;
+
+	memset (&lock, 0, sizeof (lock));
+	lock.l_type = F_UNLCK;
+	lock.l_whence = SEEK_SET;
+	lock.l_start = (off_t)REL_LOCK_BASE;
+	lock.l_len = 0;
+	fcntl (f->fd, F_SETLK, &lock);
+#else
+	COB_UNUSED (f);
+#endif
+}
+
+/* release the lock on the record 'relnum' (starting at 0)
+   of a shared RELATIVE file */
+static void
+relative_unlock_record (cob_file *f, const int relnum)
+{
+	cob_lock_byte (f->fd,
+		REL_LOCK_BASE + ((unsigned int)relnum & REL_LOCK_MASK),
+		COB_BYTE_UNLOCK, 0);
+}
+
+/* lock (with 'lock') or check for locks of other processes on the record
+   'relnum' (starting at 0) of a shared RELATIVE file, waiting for them
+   as configured; returns the status */
+static int
+relative_lock_record (cob_file *f, const int relnum, const int lock,
+		      const int wait)
+{
+	const unsigned int	offset
+		= REL_LOCK_BASE + ((unsigned int)relnum & REL_LOCK_MASK);
+	int			ret;
+
+	if (!lock) {
+		ret = cob_lock_byte_wait (f->fd, offset, 1);
+	} else if (wait) {
+		ret = cob_lock_byte (f->fd, offset, COB_BYTE_WRITE_LOCK, 1);
+	} else {
+		ret = cob_lock_byte_wait (f->fd, offset, 0);
+	}
+	switch (ret) {
+	case 0:
+		return COB_STATUS_00_SUCCESS;
+	case EDEADLK:
+		return COB_STATUS_52_DEAD_LOCK;
+	default:
+		return COB_STATUS_51_RECORD_LOCKED;
+	}
+}
+
+/* handle the record locks of a READ of record 'relnum' of a shared
+   RELATIVE file, before the record is read */
+static int
+relative_read_lock (cob_file *f, const int relnum, const int read_opts)
+{
+	if (!(f->lock_mode & COB_LOCK_MULTIPLE)) {
+		relative_unlock_records (f);
+	}
+	if (read_opts & (COB_READ_LOCK | COB_READ_WAIT_LOCK)
+	 || ((f->lock_mode & COB_LOCK_AUTOMATIC)
+	  && !(read_opts & COB_READ_NO_LOCK))) {
+		return relative_lock_record (f, relnum, 1,
+			read_opts & COB_READ_WAIT_LOCK);
+	}
+	if (read_opts & COB_READ_IGNORE_LOCK) {
+		return COB_STATUS_00_SUCCESS;
+	}
+	return relative_lock_record (f, relnum, 0, 0);
+}
+
 static int
 relative_start (cob_file *f, const int cond, cob_field *k)
 {
@@ -2989,7 +4451,7 @@ relative_start (cob_file *f, const int cond, cob_field *k)
 	int		kindex;
 	int		ksindex;
 	int		kcond;
-	struct stat	st;
+	cob_s64_t	filesize;
 
 #ifdef	WITH_SEQRA_EXTFH
 	int	extfh_ret;
@@ -3000,7 +4462,7 @@ relative_start (cob_file *f, const int cond, cob_field *k)
 	}
 #endif
 
-	if (fstat (f->fd, &st) != 0 || st.st_size == 0) {
+	if (seq_size (f, &filesize) != 0 || filesize == 0) {
 		return COB_STATUS_23_KEY_NOT_EXISTS;
 	}
 
@@ -3014,7 +4476,7 @@ relative_start (cob_file *f, const int cond, cob_field *k)
 		break;
 	case COB_LA:
 		kcond = COB_LE;
-		kindex = st.st_size / relsize;
+		kindex = filesize / relsize;
 		kindex--;
 		break;
 	case COB_LT:
@@ -3022,7 +4484,7 @@ relative_start (cob_file *f, const int cond, cob_field *k)
 		kcond = cond;
 		kindex = cob_get_int (k) - 1;
 		/* Check against current file size */
-		ksindex = st.st_size / relsize;
+		ksindex = filesize / relsize;
 		ksindex--;
 		if (kindex > ksindex) {
 			kindex = ksindex;
@@ -3070,24 +4532,24 @@ relative_start (cob_file *f, const int cond, cob_field *k)
 			break;
 		}
 		off = (off_t)kindex * relsize;
-		if (off >= st.st_size) {
+		if (off >= filesize) {
 			if (kcond == COB_LT || kcond == COB_LE) {
 				kindex--;
 				continue;
 			}
 			break;
 		}
-		if (lseek (f->fd, off, SEEK_SET) == (off_t)-1) {
+		if (seq_seek (f, off, SEEK_SET) == (off_t)-1) {
 			break;
 		}
 
 		/* Check if a valid record */
-		if (read (f->fd, &f->record->size, sizeof (f->record->size))
+		if (seq_read (f, &f->record->size, sizeof (f->record->size))
 		    == sizeof (f->record->size) && f->record->size > 0) {
 #if	0	/* RXWRXW - Set key - COBOL standards */
 			cob_set_int (k, kindex + 1);
 #endif
-			lseek (f->fd, off, SEEK_SET);
+			seq_seek (f, off, SEEK_SET);
 			return COB_STATUS_00_SUCCESS;
 		}
 
@@ -3120,33 +4582,41 @@ relative_read (cob_file *f, cob_field *k, const int read_opts)
 	if (extfh_ret != COB_NOT_CONFIGURED) {
 		return extfh_ret;
 	}
-#else
-	COB_UNUSED (read_opts);
 #endif
 
 	if (unlikely (f->flag_operation != 0)) {
 		f->flag_operation = 0;
-		lseek (f->fd, (off_t)0, SEEK_CUR);
+		seq_seek (f, (off_t)0, SEEK_CUR);
 	}
 
 	relnum = cob_get_int (k) - 1;
 	if (relnum < 0) {
 		return COB_STATUS_23_KEY_NOT_EXISTS;
 	}
+	if (REL_SHARED (f)) {
+		const int	ret = relative_read_lock (f, relnum, read_opts);
+		if (ret) {
+			return ret;
+		}
+	}
 	relsize = f->record_max + sizeof (f->record->size);
 	off = (off_t)relnum * relsize;
-	if (lseek (f->fd, off, SEEK_SET) == (off_t)-1 ||
-	    read (f->fd, &f->record->size, sizeof (f->record->size))
+	if (seq_seek (f, off, SEEK_SET) == (off_t)-1 ||
+	    seq_read (f, &f->record->size, sizeof (f->record->size))
 		   != sizeof (f->record->size)) {
-			return COB_STATUS_23_KEY_NOT_EXISTS;
+		f->record->size = 0;
 	}
 
 	if (f->record->size == 0) {
-		lseek (f->fd, off, SEEK_SET);
+		seq_seek (f, off, SEEK_SET);
+		if (REL_SHARED (f)
+		 && !(f->lock_mode & COB_LOCK_MULTIPLE)) {
+			relative_unlock_records (f);
+		}
 		return COB_STATUS_23_KEY_NOT_EXISTS;
 	}
 
-	if (read (f->fd, f->record->data, f->record_max) != (int)f->record_max) {
+	if (seq_read (f, f->record->data, f->record_max) != (int)f->record_max) {
 		return COB_STATUS_30_PERMANENT_ERROR;
 	}
 	return COB_STATUS_00_SUCCESS;
@@ -3160,7 +4630,8 @@ relative_read_next (cob_file *f, const int read_opts)
 	int		relnum;
 	int		bytesread;
 	cob_u32_t	moveback;
-	struct stat	st;
+	cob_s64_t	filesize;
+	int		ret;
 
 #ifdef	WITH_SEQRA_EXTFH
 	int		extfh_ret;
@@ -3173,29 +4644,29 @@ relative_read_next (cob_file *f, const int read_opts)
 
 	if (unlikely (f->flag_operation != 0)) {
 		f->flag_operation = 0;
-		lseek (f->fd, (off_t)0, SEEK_CUR);
+		seq_seek (f, (off_t)0, SEEK_CUR);
 	}
 
 	relsize = ((off_t) f->record_max) + sizeof (f->record->size);
-	if (fstat (f->fd, &st) != 0 || st.st_size == 0) {
+	if (seq_size (f, &filesize) != 0 || filesize == 0) {
 		return COB_STATUS_10_END_OF_FILE;
 	}
 	/* LCOV_EXCL_START */
-	if (st.st_size < relsize) {
+	if (filesize < relsize) {
 		return COB_STATUS_30_PERMANENT_ERROR;
 	}
 	/* LCOV_EXCL_STOP */
 
-	curroff = lseek (f->fd, (off_t)0, SEEK_CUR);
+	curroff = seq_seek (f, (off_t)0, SEEK_CUR);
 	moveback = 0;
 
 	switch (read_opts & COB_READ_MASK) {
 	case COB_READ_FIRST:
-		curroff = lseek (f->fd, (off_t)0, SEEK_SET);
+		curroff = seq_seek (f, (off_t)0, SEEK_SET);
 		break;
 	case COB_READ_LAST:
-		curroff = st.st_size - relsize;
-		curroff = lseek (f->fd, curroff, SEEK_SET);
+		curroff = filesize - relsize;
+		curroff = seq_seek (f, curroff, SEEK_SET);
 		moveback = 1;
 		break;
 	case COB_READ_PREVIOUS:
@@ -3203,7 +4674,7 @@ relative_read_next (cob_file *f, const int read_opts)
 			break;
 		} else if (curroff > relsize) {
 			curroff -= (relsize * 2);
-			curroff = lseek (f->fd, curroff, SEEK_SET);
+			curroff = seq_seek (f, curroff, SEEK_SET);
 		} else {
 			return COB_STATUS_10_END_OF_FILE;
 		}
@@ -3215,7 +4686,7 @@ relative_read_next (cob_file *f, const int read_opts)
 	}
 
 	for (;;) {
-		bytesread = read (f->fd, &f->record->size, sizeof (f->record->size));
+		bytesread = seq_read (f, &f->record->size, sizeof (f->record->size));
 		if (bytesread != sizeof (f->record->size)) {
 			if (bytesread != 0) {
 				return COB_STATUS_30_PERMANENT_ERROR;
@@ -3224,8 +4695,21 @@ relative_read_next (cob_file *f, const int read_opts)
 			}
 		}
 
+		if (f->record->size > 0 && REL_SHARED (f)) {
+			ret = relative_read_lock (f, (int)(curroff / relsize), read_opts);
+			if (ret) {
+				(void) seq_seek (f, curroff, SEEK_SET);
+				return ret;
+			}
+			/* the record may have been deleted while waiting */
+			if (seq_seek (f, curroff, SEEK_SET) == (off_t)-1
+			 || seq_read (f, &f->record->size, sizeof (f->record->size))
+			    != sizeof (f->record->size)) {
+				return COB_STATUS_30_PERMANENT_ERROR;
+			}
+		}
 		if (f->record->size > 0) {
-			if (read (f->fd, f->record->data, f->record_max) != (int)f->record_max) {
+			if (seq_read (f, f->record->data, f->record_max) != (int)f->record_max) {
 				return COB_STATUS_30_PERMANENT_ERROR;
 			}
 			if (f->keys[0].field) {
@@ -3234,38 +4718,61 @@ relative_read_next (cob_file *f, const int read_opts)
 				if (cob_add_int (f->keys[0].field, relnum,
 						 COB_STORE_KEEP_ON_OVERFLOW) != 0) {
 					/* reset position after read */
-					(void) lseek (f->fd, curroff, SEEK_SET);
+					(void) seq_seek (f, curroff, SEEK_SET);
 					return COB_STATUS_14_OUT_OF_KEY_RANGE;
 				}
 			}
 			if (moveback) {
 				curroff -= relsize;
-				curroff = lseek (f->fd, curroff, SEEK_SET);
+				curroff = seq_seek (f, curroff, SEEK_SET);
 			}
 			return COB_STATUS_00_SUCCESS;
 		}
 		if (moveback) {
 			if (curroff > relsize) {
 				curroff -= (relsize * 2);
-				curroff = lseek (f->fd, curroff, SEEK_SET);
+				curroff = seq_seek (f, curroff, SEEK_SET);
 			} else {
 				break;
 			}
 		} else {
-			curroff = lseek (f->fd, (off_t) f->record_max, SEEK_CUR);
+			curroff = seq_seek (f, (off_t) f->record_max, SEEK_CUR);
 		}
 	}
 	return COB_STATUS_10_END_OF_FILE;
 }
 
+/* check if the record at 'off' of a RELATIVE file is in use, leaving
+   the position there; returns the status */
+static int
+relative_slot_used (cob_file *f, const off_t off)
+{
+	size_t	size;
+
+	if (lseek (f->fd, off, SEEK_SET) == (off_t)-1) {
+		return COB_STATUS_24_KEY_BOUNDARY;
+	}
+	if (read (f->fd, &size, sizeof (size)) > 0) {
+		if (size > 0) {
+			return COB_STATUS_22_KEY_EXISTS;
+		}
+	}
+	/* reset position after read;
+	   TODO: add a test case (when disabled: internal tests pass,
+	   NIST IX fail) */
+	(void)lseek (f->fd, off, SEEK_SET);
+	return COB_STATUS_00_SUCCESS;
+}
+
 static int
 relative_write (cob_file *f, const int opt)
 {
 	off_t	off;
-	size_t	size;
 	size_t	relsize;
 	int	i;
 	int	kindex;
+	int	relnum = 0;
+	int	ret;
 #ifdef	WITH_SEQRA_EXTFH
 	int	extfh_ret;
 
@@ -3273,8 +4780,6 @@ relative_write (cob_file *f, const int opt)
 	if (extfh_ret != COB_NOT_CONFIGURED) {
 		return extfh_ret;
 	}
-#else
-	COB_UNUSED (opt);
 #endif
 
 	if (unlikely (f->flag_operation == 0)) {
@@ -3289,29 +4794,51 @@ relative_write (cob_file *f, const int opt)
 			return COB_STATUS_24_KEY_BOUNDARY;
 		}
 		off = ((off_t)relsize * kindex);
-		if (lseek (f->fd, off, SEEK_SET) == (off_t)-1) {
-			return COB_STATUS_24_KEY_BOUNDARY;
-		}
-		if (read (f->fd, &size, sizeof (size)) > 0) {
-			if (size > 0) {
-				return COB_STATUS_22_KEY_EXISTS;
-			}
+		ret = relative_slot_used (f, off);
+		if (ret) {
+			return ret;
 		}
 	} else {
 		off = lseek (f->fd, (off_t)0, SEEK_CUR);
 	}
-	/* reset position after read;
-	   TODO: add a test case (when disabled: internal tests pass,
-	   NIST IX fail) */
-	(void)lseek (f->fd, off, SEEK_SET);
-
-	COB_CHECKED_WRITE (f->fd, &f->record->size, sizeof (f->record->size));
-	COB_CHECKED_WRITE (f->fd, f->record->data, f->record_max);
 
-	/* Update RELATIVE KEY */
-	if (f->access_mode == COB_ACCESS_SEQUENTIAL) {
-		if (f->keys[0].field) {
-			off += relsize;
+	if (REL_SHARED (f)) {
+		/* lock the free record and check again that it is free, so
+		   that of two processes writing it only one gets 00 */
+		relnum = (int)(off / (off_t)relsize);
+		ret = relative_lock_record (f, relnum, 1, 0);
+		if (ret) {
+			return ret;
+		}
+		if (f->access_mode != COB_ACCESS_SEQUENTIAL) {
+			ret = relative_slot_used (f, off);
+		}
+		if (!ret && JOURNAL_BEFORE (f->fd, off, relsize)) {
+			ret = COB_STATUS_30_PERMANENT_ERROR;
+		}
+		if (ret) {
+			/* the record was free before, so we did not hold its
+			   lock from an earlier READ WITH LOCK */
+			relative_unlock_record (f, relnum);
+			return ret;
+		}
+	} else {
+		if (JOURNAL_BEFORE (f->fd, off, relsize)) {
+			return COB_STATUS_30_PERMANENT_ERROR;
+		}
+	}
+	COB_CHECKED_WRITE (f->fd, &f->record->size, sizeof (f->record->size));
+	COB_CHECKED_WRITE (f->fd, f->record->data, f->record_max);
+	if (REL_SHARED (f)
+	 && !(opt & COB_WRITE_LOCK)
+	 && !(f->lock_mode & COB_LOCK_MULTIPLE)) {
+		relative_unlock_record (f, relnum);
+	}
+
+	/* Update RELATIVE KEY */
+	if (f->access_mode == COB_ACCESS_SEQUENTIAL) {
+		if (f->keys[0].field) {
+			off += relsize;
 			i = (int)(off / relsize);
 			cob_set_int (f->keys[0].field, i);
 		}
@@ -3338,10 +4865,11 @@ relative_rewrite (cob_file *f, const int opt)
 #endif
 
 	f->flag_operation = 1;
+	relsize = f->record_max + sizeof (f->record->size);
 	if (f->access_mode == COB_ACCESS_SEQUENTIAL) {
-		lseek (f->fd, -(off_t) f->record_max, SEEK_CUR);
+		off = lseek (f->fd, -(off_t) f->record_max, SEEK_CUR);
+		relnum = (int)(off / (off_t)relsize);
 	} else {
-		relsize = f->record_max + sizeof (f->record->size);
 		relnum = cob_get_int (f->keys[0].field) - 1;
 		if (relnum < 0) {
 			return COB_STATUS_24_KEY_BOUNDARY;
@@ -3355,7 +4883,21 @@ relative_rewrite (cob_file *f, const int opt)
 		lseek (f->fd, (off_t)0, SEEK_CUR);
 	}
 
+	if (REL_SHARED (f)) {
+		const int	ret = relative_lock_record (f, relnum, 0, 0);
+		if (ret) {
+			return ret;
+		}
+	}
+	if (JOURNAL_BEFORE (f->fd, lseek (f->fd, (off_t)0, SEEK_CUR), f->record_max)) {
+		return COB_STATUS_30_PERMANENT_ERROR;
+	}
 	COB_CHECKED_WRITE (f->fd, f->record->data, f->record_max);
+	if (REL_SHARED (f)
+	 && (f->lock_mode & COB_LOCK_AUTOMATIC)
+	 && !(f->lock_mode & COB_LOCK_MULTIPLE)) {
+		relative_unlock_records (f);
+	}
 	return COB_STATUS_00_SUCCESS;
 }
 
@@ -3391,9 +4933,23 @@ relative_delete (cob_file *f)
 	   NIST IX fail) */
 	(void)lseek (f->fd, off, SEEK_SET);
 
+	if (REL_SHARED (f)) {
+		const int	ret = relative_lock_record (f, relnum, 0, 0);
+		if (ret) {
+			return ret;
+		}
+	}
+	if (JOURNAL_BEFORE (f->fd, off, sizeof (f->record->size))) {
+		return COB_STATUS_30_PERMANENT_ERROR;
+	}
 	f->record->size = 0;
 	COB_CHECKED_WRITE (f->fd, &f->record->size, sizeof (f->record->size));
 	lseek (f->fd, (off_t) f->record_max, SEEK_CUR);
+	if (REL_SHARED (f)
+	 && (f->lock_mode & COB_LOCK_AUTOMATIC)
+	 && !(f->lock_mode & COB_LOCK_MULTIPLE)) {
+		relative_unlock_records (f);
+	}
 	return COB_STATUS_00_SUCCESS;
 }
 
@@ -3401,10 +4957,13 @@ relative_delete (cob_file *f)
 
 #ifdef	WITH_ANY_ISAM
 
-/* Translate ISAM status to COBOL status */
+/* Translate ISAM status of 'fh' to COBOL status */
 static int
-fisretsts (const int default_status)
+fisretsts (struct indexfile *fh, const int default_status)
 {
+#ifndef	COB_NATIVE_ISAM
+	COB_UNUSED (fh);
+#endif
 	switch (ISERRNO) {
 	case 0:
 		return COB_STATUS_00_SUCCESS;
@@ -3583,7 +5142,15 @@ join_environment (void)
 	bdb_env->set_msgfile (bdb_env, stderr);
 #endif
 #endif
-	bdb_env->set_cachesize (bdb_env, 0, 2*1024*1024, 0);
+	/* cache and mapping are only set up when the environment is created,
+	   otherwise the values of the existing environment are used */
+	bdb_env->set_cachesize (bdb_env,
+		(cob_u32_t)(cobsetptr->bdb_cache_size / BDB_GIGABYTE),
+		(cob_u32_t)(cobsetptr->bdb_cache_size % BDB_GIGABYTE),
+		(int)cobsetptr->bdb_cache_count);
+	if (cobsetptr->bdb_mmap_size) {
+		bdb_env->set_mp_mmapsize (bdb_env, cobsetptr->bdb_mmap_size);
+	}
 	bdb_env->set_alloc (bdb_env, cob_malloc, realloc, cob_free);
 	flags = DB_CREATE | DB_INIT_MPOOL | DB_INIT_CDB;
 	ret = bdb_env->open (bdb_env, cobsetptr->bdb_home, flags, 0);
@@ -3599,9 +5166,33 @@ join_environment (void)
 #endif
 	bdb_env->lock_id (bdb_env, &bdb_lock_id);
 	bdb_env->set_lk_detect (bdb_env, DB_LOCK_DEFAULT);
+#if DB_VERSION_MAJOR > 3
+	if (cobsetptr->cob_lock_wait) {
+		/* record locks wait up to COB_LOCK_WAIT for other processes */
+		bdb_env->set_timeout (bdb_env,
+			(db_timeout_t)cobsetptr->cob_lock_wait * 1000,
+			DB_SET_LOCK_TIMEOUT);
+#ifdef	DB_TIME_NOTGRANTED
+		bdb_env->set_flags (bdb_env, DB_TIME_NOTGRANTED, 1);
+#endif
+	}
+#endif
 	return 0;
 }
 
+/* add the cache statistics of 'env' to the ones reported at exit */
+static void
+bdb_add_cache_stats (DB_ENV *env)
+{
+	DB_MPOOL_STAT	*gsp;
+
+	if (env->memp_stat (env, &gsp, NULL, 0) == 0) {
+		bdb_cache_hit += (cob_u64_t)gsp->st_cache_hit;
+		bdb_cache_miss += (cob_u64_t)gsp->st_cache_miss;
+		cob_free (gsp);
+	}
+}
+
 static void
 set_dbt (struct indexed_file *p, DBT *dbt, const char *key, const unsigned int keylen)
 {
@@ -3650,23 +5241,40 @@ lock_file (cob_file *f, char *filename, int lock_mode)
 	return ret;
 }
 
-/* Impose lock on record */
+/* flags for requesting record locks: wait for them with COB_LOCK_WAIT */
+#define	BDB_RECORD_LOCK_FLAGS	(cobsetptr->cob_lock_wait ? 0 : DB_LOCK_NOWAIT)
+
+/* Impose lock on record, in addition to the ones held */
 static int
 lock_record (cob_file *f, const char *key, const unsigned int keylen)
 {
 	struct indexed_file	*p = f->file;
 	DBT			dbt;
+	DB_LOCK			lock;
 	int			ret;
 
 	set_dbt (p, &dbt, key, keylen);
-	ret = bdb_env->lock_get (bdb_env, p->bdb_lock_id, DB_LOCK_NOWAIT,
-				&dbt, DB_LOCK_WRITE, &p->bdb_record_lock);
+	ret = bdb_env->lock_get (bdb_env, p->bdb_lock_id, BDB_RECORD_LOCK_FLAGS,
+				&dbt, DB_LOCK_WRITE, &lock);
 	if (!ret) {
-		p->record_locked = 1;
+		if (p->bdb_record_locks == NULL) {
+			p->alloc_locks = 8;
+			p->bdb_record_locks
+				= cob_malloc (p->alloc_locks * sizeof (DB_LOCK));
+		} else if (p->nlocks == p->alloc_locks) {
+			p->alloc_locks *= 2;
+			p->bdb_record_locks = cob_realloc (p->bdb_record_locks,
+				p->nlocks * sizeof (DB_LOCK),
+				p->alloc_locks * sizeof (DB_LOCK));
+		}
+		p->bdb_record_locks[p->nlocks++] = lock;
 	}
 	if (ret == DB_LOCK_NOTGRANTED) {
 		return COB_STATUS_51_RECORD_LOCKED;
 	}
+	if (ret == DB_LOCK_DEADLOCK) {
+		return COB_STATUS_52_DEAD_LOCK;
+	}
 	if (ret) {
 		cob_runtime_error (_("BDB (%s), error: %d %s"),
 			"lock_get", ret, db_strerror (ret));
@@ -3684,7 +5292,7 @@ test_record_lock (cob_file *f, const char *key, const unsigned int keylen)
 	int			ret;
 
 	set_dbt (p, &dbt, key, keylen);
-	ret = bdb_env->lock_get (bdb_env, p->bdb_lock_id, DB_LOCK_NOWAIT,
+	ret = bdb_env->lock_get (bdb_env, p->bdb_lock_id, BDB_RECORD_LOCK_FLAGS,
 				&dbt, DB_LOCK_WRITE, &test_lock);
 	if (!ret) {
 		/* Release lock just acquired */
@@ -3693,6 +5301,9 @@ test_record_lock (cob_file *f, const char *key, const unsigned int keylen)
 	if (ret == DB_LOCK_NOTGRANTED) {
 		return COB_STATUS_51_RECORD_LOCKED;
 	}
+	if (ret == DB_LOCK_DEADLOCK) {
+		return COB_STATUS_52_DEAD_LOCK;
+	}
 	if (ret) {
 		cob_runtime_error (_ ("BDB (%s), error: %d %s"),
 			"lock_get", ret, db_strerror (ret));
@@ -3701,23 +5312,23 @@ test_record_lock (cob_file *f, const char *key, const unsigned int keylen)
 	return ret;
 }
 
+/* Release all record locks of the file */
 static int
 unlock_record (cob_file *f)
 {
 	struct indexed_file	*p = f->file;
 	int ret;
 
-	if (p->record_locked == 0) {
-		return 0;
-	}
-	p->record_locked = 0;
-	ret = bdb_env->lock_put (bdb_env, &p->bdb_record_lock);
-	if (ret) {
-		cob_runtime_error (_ ("BDB (%s), error: %d %s"),
-			"lock_put", ret, db_strerror (ret));
-		return COB_STATUS_30_PERMANENT_ERROR;
+	while (p->nlocks > 0) {
+		ret = bdb_env->lock_put (bdb_env,
+			&p->bdb_record_locks[--p->nlocks]);
+		if (ret) {
+			cob_runtime_error (_ ("BDB (%s), error: %d %s"),
+				"lock_put", ret, db_strerror (ret));
+			return COB_STATUS_30_PERMANENT_ERROR;
+		}
 	}
-	return ret;
+	return 0;
 }
 
 static int
@@ -4025,7 +5636,8 @@ indexed_delete_internal (cob_file *f, const int rewrite)
 	cob_u32_t		flags;
 	int			close_cursor;
 
-	if (bdb_env != NULL) {
+	if (bdb_env != NULL
+	 && !(f->lock_mode & COB_LOCK_MULTIPLE)) {
 		unlock_record (f);
 	}
 	/* Find the primary key */
@@ -4171,3925 +5783,6449 @@ bdb_nofile (const char *filename)
 
 #endif	/* WITH_DB */
 
-/* Delete file */
+#ifdef	WITH_LMDB
 
-static void
-indexed_file_delete (cob_file *f, const char *filename)
-{
-#ifdef	WITH_ANY_ISAM
-	COB_UNUSED (f);
+#define	LMDB_MAX_DBS		256
+#define	LMDB_RETRY		-1
 
-	snprintf (file_open_buff, (size_t)COB_FILE_MAX, "%s.idx", filename);
-	file_open_buff[COB_FILE_MAX] = 0;
-	unlink (file_open_buff);
-	snprintf (file_open_buff, (size_t)COB_FILE_MAX, "%s.dat", filename);
-	file_open_buff[COB_FILE_MAX] = 0;
-	unlink (file_open_buff);
-#elif	defined(WITH_DB)
-	size_t	i;
+static int
+lmdb_txn_begin (struct lmdb_env *e, const unsigned int flags, MDB_txn **txn)
+{
+	int	rc;
 
-	for (i = 0; i < f->nkeys; ++i) {
-		if (i == 0) {
-			snprintf (file_open_buff, (size_t)COB_FILE_MAX, "%s",
-				  filename);
-		} else {
-			snprintf (file_open_buff, (size_t)COB_FILE_MAX, "%s.%d",
-				  filename, (int)i);
-		}
-		file_open_buff[COB_FILE_MAX] = 0;
-		errno = 0;
-		unlink (file_open_buff);
+	rc = mdb_txn_begin (e->env, NULL, flags, txn);
+	if (rc == MDB_MAP_RESIZED) {
+		/* Another process has grown the map, adopt its size */
+		mdb_env_set_mapsize (e->env, 0);
+		rc = mdb_txn_begin (e->env, NULL, flags, txn);
 	}
-#else
-	COB_UNUSED (f);
-	COB_UNUSED (filename);
-#endif
+	return rc;
 }
 
+/* Renew the read transaction, for a snapshot of the current data */
+static int
+lmdb_read_begin (struct indexed_file *p)
+{
+	int	rc;
 
-/* OPEN INDEXED file */
+	rc = mdb_txn_renew (p->rtxn);
+	if (rc == MDB_MAP_RESIZED) {
+		mdb_env_set_mapsize (p->envp->env, 0);
+		rc = mdb_txn_renew (p->rtxn);
+	}
+	return rc;
+}
 
+/* Double the map size after MDB_MAP_FULL, returns 0 if done */
 static int
-indexed_open (cob_file *f, char *filename,
-		const enum cob_open_mode mode, const int sharing)
+lmdb_grow (struct lmdb_env *e)
 {
-	/* Note filename points to file_open_name */
-	/* cob_chk_file_mapping manipulates file_open_name directly */
+	MDB_envinfo	info;
 
-#ifdef	WITH_INDEX_EXTFH
-	int		ret;
+	if (mdb_env_info (e->env, &info)
+	 || info.me_mapsize > ((size_t)-1) / 4) {
+		return 1;
+	}
+	return mdb_env_set_mapsize (e->env, info.me_mapsize * 2);
+}
 
-	ret = extfh_indexed_locate (f, filename);
-	switch (ret) {
-	case COB_NOT_CONFIGURED:
-		cob_chk_file_mapping ();
-		errno = 0;
-		if (access (filename, F_OK) && errno == ENOENT) {
-			if (mode != COB_OPEN_OUTPUT && f->flag_optional == 0) {
-				return COB_STATUS_35_NOT_EXISTS;
-			}
-		}
-		break;
-	case COB_STATUS_00_SUCCESS:
-		break;
-	default:
-		return ret;
+/* Close the environment when its last file is closed */
+static void
+lmdb_env_release (struct lmdb_env *e)
+{
+	struct lmdb_env	**l;
+
+	if (e->users != NULL) {
+		return;
 	}
-	ret = extfh_indexed_open (f, filename, mode, sharing);
-	switch (ret) {
-	case COB_STATUS_00_SUCCESS:
-		f->open_mode = mode;
-		break;
-	case COB_STATUS_35_NOT_EXISTS:
-		if (f->flag_optional) {
-			f->open_mode = mode;
-			f->flag_nonexistent = 1;
-			f->flag_end_of_file = 1;
-			f->flag_begin_of_file = 1;
-			return COB_STATUS_05_SUCCESS_OPTIONAL;
+	for (l = &lmdb_env_list; *l; l = &(*l)->next) {
+		if (*l == e) {
+			*l = e->next;
+			break;
 		}
-		break;
 	}
-	return ret;
-
-#elif	defined(WITH_ANY_ISAM)
+	/* note: this drops all byte locks of the process on the file */
+	if (e->lock_fd != -1) {
+		close (e->lock_fd);
+	}
+	if (e->env) {
+		mdb_env_close (e->env);
+	}
+	cob_free (e);
+}
 
-	struct indexfile	*fh;
-	size_t			k;
-	int			ret, len;
-	int			omode;
-	int			lmode;
-	int			vmode;
-	int			dobld;
-	int			isfd;
-	int			checkvalue;
+/* Check the key sizes of 'f' against the limit of the environment:
+   status 39 if a key is too long, status 30 if the primary key with
+   the sequence number, stored as DUPSORT data, is */
+static int
+lmdb_check_keysize (cob_file *f, struct lmdb_env *e, const int primekeylen)
+{
+	const int	maxkeysize = mdb_env_get_maxkeysize (e->env);
+	int		i;
 
-	COB_UNUSED (sharing);
+	for (i = 0; i < (int)f->nkeys; ++i) {
+		if (bdb_keylen (f, i) > maxkeysize) {
+			return COB_STATUS_39_CONFLICT_ATTRIBUTE;
+		}
+	}
+	for (i = 1; i < (int)f->nkeys; ++i) {
+		if (lmdb_hasdups (f, i)
+		 && primekeylen + LMDB_DUPNO_LEN > maxkeysize) {
+			return COB_STATUS_30_PERMANENT_ERROR;
+		}
+	}
+	return 0;
+}
 
-	cob_chk_file_mapping ();
+/* Byte to lock for the record with the given primary key */
+static unsigned int
+lmdb_lock_offset (const MDB_val *prim)
+{
+	const unsigned char	*k = prim->mv_data;
+	unsigned int		h = 2166136261U;
+	size_t			i;
 
-	if (mode == COB_OPEN_INPUT) {
-		checkvalue = R_OK;
-	} else {
-		checkvalue = R_OK | W_OK;
+	for (i = 0; i < prim->mv_size; i++) {
+		h = (h ^ k[i]) * 16777619U;
 	}
+	return LMDB_LOCK_RECORD + (h & LMDB_LOCK_HASH);
+}
 
-	snprintf (file_open_buff, (size_t)COB_FILE_MAX, "%s.idx", filename);
-	file_open_buff[COB_FILE_MAX] = 0;
-	errno = 0;
-	if (access (file_open_buff, checkvalue)) {
-		if (!(errno == ENOENT &&
-		      (mode == COB_OPEN_OUTPUT || f->flag_optional == 1))) {
-			switch (errno) {
-			case ENOENT:
-				return COB_STATUS_35_NOT_EXISTS;
-			case EACCES:
-				return COB_STATUS_37_PERMISSION_DENIED;
-			default:
-				return COB_STATUS_30_PERMANENT_ERROR;
-			}
+/* Does the open file hold the lock on byte 'offset' */
+static int
+lmdb_lock_owned (const struct indexed_file *p, const unsigned int offset)
+{
+	size_t	i;
+
+	for (i = 0; i < p->nlocks; ++i) {
+		if (p->lock_hash[i] == offset) {
+			return 1;
 		}
 	}
+	return 0;
+}
 
-	snprintf (file_open_buff, (size_t)COB_FILE_MAX, "%s.dat", filename);
-	file_open_buff[COB_FILE_MAX] = 0;
-	errno = 0;
-	if (access (file_open_buff, checkvalue)) {
-		if (!(errno == ENOENT &&
-		      (mode == COB_OPEN_OUTPUT || f->flag_optional == 1))) {
-			switch (errno) {
-			case ENOENT:
-				return COB_STATUS_35_NOT_EXISTS;
-			case EACCES:
-				return COB_STATUS_37_PERMISSION_DENIED;
-			default:
-				return COB_STATUS_30_PERMANENT_ERROR;
-			}
+/* Is the record lock held by another open file of this process */
+static int
+lmdb_lock_inprocess (struct indexed_file *p, const unsigned int offset)
+{
+	struct indexed_file	*u;
+
+	for (u = p->envp->users; u; u = u->next_user) {
+		if (u != p && lmdb_lock_owned (u, offset)) {
+			return 1;
 		}
 	}
+	return 0;
+}
 
-	ret = COB_STATUS_00_SUCCESS;
-	omode = 0;
-	lmode = 0;
-	vmode = 0;
-	dobld = 0;
-	isfd = -1;
-#ifdef	ISVARLEN
-	if (f->record_min != f->record_max) {
-		vmode = ISVARLEN;
-		ISRECLEN = f->record_min;
+/* Release all record locks of the file */
+static void
+lmdb_unlock_record (cob_file *f)
+{
+	struct indexed_file	*p = f->file;
+
+	while (p->nlocks > 0) {
+		cob_lock_byte (p->envp->lock_fd, p->lock_hash[--p->nlocks],
+			       COB_BYTE_UNLOCK, 0);
 	}
-#endif
-	if (!f->lock_mode) {
-		if (mode != COB_OPEN_INPUT) {
-			lmode = ISEXCLLOCK;
-		} else {
-			lmode = ISMANULOCK;
+}
+
+/* Lock the record, in addition to the locks held before
+   with LOCK MODE MULTIPLE, otherwise replacing them */
+static int
+lmdb_lock_record (cob_file *f, const MDB_val *prim, const int wait)
+{
+	struct indexed_file	*p = f->file;
+	const unsigned int	offset = lmdb_lock_offset (prim);
+
+	if (lmdb_lock_owned (p, offset)) {
+		return 0;
+	}
+	if (!(f->lock_mode & COB_LOCK_MULTIPLE)) {
+		lmdb_unlock_record (f);
+	}
+	if (lmdb_lock_inprocess (p, offset)) {
+		return COB_STATUS_51_RECORD_LOCKED;
+	}
+	if (wait) {
+		if (cob_lock_byte (p->envp->lock_fd, offset,
+				   COB_BYTE_WRITE_LOCK, 1)) {
+			return COB_STATUS_51_RECORD_LOCKED;
 		}
-	} else if ((f->lock_mode & COB_FILE_EXCLUSIVE)) {
-		lmode = ISEXCLLOCK;
-	} else if ((f->lock_mode & COB_LOCK_AUTOMATIC) && mode != COB_OPEN_INPUT) {
-		lmode = ISAUTOLOCK;
-	} else {
-		lmode = ISMANULOCK;
+	} else
+	if (cob_lock_byte_wait (p->envp->lock_fd, offset, 0)) {
+		return COB_STATUS_51_RECORD_LOCKED;
 	}
-	switch (mode) {
-	case COB_OPEN_INPUT:
-		omode = ISINPUT;
-		break;
-	case COB_OPEN_OUTPUT:
-		lmode = ISEXCLLOCK;
-		omode = ISOUTPUT;
-		ISERRNO = 0;
-		isfd = isopen ((void *)filename, ISINPUT | ISEXCLLOCK | vmode);
-		if (ISERRNO == EFLOCKED) {
-			return COB_STATUS_61_FILE_SHARING;
-		} else {
-			if (isfd >= 0) {
-				isfullclose (isfd);
-			}
-			iserase ((void *)filename);
-			ISERRNO = 0;
-		}
-		dobld = 1;
-		break;
-	case COB_OPEN_I_O:
-		omode = ISINOUT;
-		break;
-	case COB_OPEN_EXTEND:
-		lmode = ISEXCLLOCK;
-		omode = ISINOUT;
-		break;
-	default:
-		/* CLOSED / LOCKED-CLOSED */
-		break;
+	if (p->lock_hash == NULL) {
+		p->alloc_locks = 8;
+		p->lock_hash = cob_malloc (p->alloc_locks * sizeof (unsigned int));
+	} else if (p->nlocks == p->alloc_locks) {
+		p->alloc_locks *= 2;
+		p->lock_hash = cob_realloc (p->lock_hash,
+			p->nlocks * sizeof (unsigned int),
+			p->alloc_locks * sizeof (unsigned int));
 	}
-	fh = cob_malloc (sizeof (struct indexfile) +
-			 ((sizeof (struct keydesc)) * (f->nkeys + 1)));
-	ISERRNO = 0;
-	fh->lmode = 0;
-	if (dobld) {
-dobuild:
-		/* copy index information cob_file_key -> keydesc */
-		for (k = 0; k < f->nkeys; ++k) {
-			len = indexed_keydesc (f, &fh->key[k], &f->keys[k]);
-			if (fh->lenkey < len) {
-				fh->lenkey = len;
-			}
-		}
-		isfd = isbuild ((void *)filename, (int)f->record_max, &fh->key[0],
-				vmode | ISINOUT | ISEXCLLOCK);
-#if 0 /* activate on later merge of locking enhancements */
-		f->flag_file_lock = 1;
-#endif
-		if (ISERRNO == EEXIST
-#if 1 /* CHECKME: guard added by Simon, needed ? */
-		 && omode == ISOUTPUT
-#endif
-		 && isfd < 0) {
-			/* Erase file and redo the 'isbuild' */
-			iserase ((void *)filename);
-			isfd = isbuild ((void *)filename, (int)f->record_max, &fh->key[0],
-					vmode | ISINOUT | ISEXCLLOCK);
-#if 0 /* activate on later merge of locking enhancements */
-			f->flag_file_lock = 1;
-#endif
-		}
-	} else {
-		if (lmode == ISAUTOLOCK) {
-			fh->lmode = ISLOCK;
-			lmode = ISMANULOCK;
-		}
-		isfd = isopen ((void *)filename, omode | lmode | vmode);
-		if (isfd >= 0) {
-			struct dictinfo		di = { 0 };		/* Defined in (c|d|vb)isam.h */
-			isindexinfo (isfd, (void *)&di, 0);
-			/* Mask off ISVARLEN */
-			fh->nkeys = di.di_nkeys & 0x7F;
-			if (fh->nkeys != f->nkeys
-			 || f->record_max != di.di_recsize) {
-				ret = COB_STATUS_39_CONFLICT_ATTRIBUTE;
-			}
-			for (k = 0; k < fh->nkeys && !ret; ++k) {
-				struct keydesc	kd = { 0 };
-				/* get key info from ISAM */
-				struct keydesc	key = { 0 }; /* init to prevent analyzer warning */
-				int len_key;
-				isindexinfo (isfd, &key, (int)(k + 1));
-				len = indexed_keylen (&key);
-				if (fh->lenkey < len) {
-					fh->lenkey = len;
-				}
-				/* get key info from cob_key */
-				len_key = indexed_keydesc (f, &kd, &f->keys[k]);
-				/* verify that COBOL keys match exactly to real ISAM keys */
-				if (len_key != len
-				 || indexed_keycmp (&kd, &key) != 0) {
-					ret = COB_STATUS_39_CONFLICT_ATTRIBUTE;
-					break;
-				}
-				/* store ISAM key definition */
-				memcpy (&fh->key[k], &key, sizeof (struct keydesc));
-			}
-		} else {	/* opening the file is not possible */
-			if (ISERRNO == EFLOCKED) {
-				freefh (fh);
-				return COB_STATUS_61_FILE_SHARING;
-			}
-			if (f->flag_optional) {
-				if (mode == COB_OPEN_EXTEND
-				 || mode == COB_OPEN_I_O) {
-					dobld = 1;
-					ret = COB_STATUS_05_SUCCESS_OPTIONAL;
-					goto dobuild;
-				}
-				freefh (fh);
-				f->open_mode = mode;
-				f->flag_end_of_file = 1;
-				f->flag_begin_of_file = 1;
-				if (f->flag_nonexistent) {
-					return COB_STATUS_00_SUCCESS;
-				}
-				f->flag_nonexistent = 1;
-				return COB_STATUS_05_SUCCESS_OPTIONAL;
-			}
-		}
+	p->lock_hash[p->nlocks++] = offset;
+	return 0;
+}
+
+static int
+lmdb_test_record_lock (cob_file *f, const MDB_val *prim)
+{
+	struct indexed_file	*p = f->file;
+	const unsigned int	offset = lmdb_lock_offset (prim);
+
+	if (lmdb_lock_owned (p, offset)) {
+		return 0;
 	}
-	if (isfd < 0) {
-		ret = fisretsts (COB_STATUS_30_PERMANENT_ERROR);
-		freefh (fh);
-		return ret;
+	return lmdb_lock_inprocess (p, offset)
+	    || (cob_lock_byte_held (p->envp->lock_fd, offset)
+	     && cob_lock_byte_wait (p->envp->lock_fd, offset, 1));
+}
+
+/* Adjust the lock options of a READ, returns 1 if locks are to be checked */
+static int
+lmdb_read_opts (cob_file *f, int *read_opts)
+{
+	struct indexed_file	*p = f->file;
+
+	if (p->envp->exclusive) {
+		*read_opts &= ~(COB_READ_LOCK | COB_READ_WAIT_LOCK);
+		return 0;
 	}
-	if (ret > 9) {
-		isfullclose (isfd);
-		freefh (fh);
-		return ret;
+	if (f->open_mode != COB_OPEN_I_O) {
+		*read_opts &= ~(COB_READ_LOCK | COB_READ_WAIT_LOCK);
+	} else
+	if ((f->lock_mode & COB_LOCK_AUTOMATIC)
+	 && !(*read_opts & COB_READ_NO_LOCK)) {
+		*read_opts |= COB_READ_LOCK;
 	}
-	if (dobld) {
-		for (k = 1; k < f->nkeys; ++k) {
-			ISERRNO = 0;
-			if (isaddindex (isfd, &fh->key[k])) {
-				ret = COB_STATUS_39_CONFLICT_ATTRIBUTE;
-			}
-		}
-		if (ret > 9) {
-			isfullclose (isfd);
-			iserase ((void *)filename);
-			freefh (fh);
-			return ret;
-		}
+	if (!(f->lock_mode & COB_LOCK_MULTIPLE)) {
+		lmdb_unlock_record (f);
 	}
-	f->file = fh;
-	f->open_mode = mode;
-	fh->isfd = isfd;
-	fh->filename = cob_strdup (filename);
-	fh->savekey = cob_malloc ((size_t)(fh->lenkey + 1));
-	fh->recwrk = cob_malloc ((size_t)(f->record_max + 1));
-	/* Active index is unknown at this time */
-	f->curkey = -1;
-	f->flag_nonexistent = 0;
-	f->flag_end_of_file = 0;
-	f->flag_begin_of_file = 0;
-	return ret;
+	return 1;
+}
 
-#elif	defined(WITH_DB)
+/* Primary key of the current record: the one last read
+   for sequential access, otherwise the one in the record area */
+static void
+lmdb_curkey (cob_file *f, MDB_val *prim)
+{
+	struct indexed_file	*p = f->file;
 
-	struct indexed_file	*p;
-	size_t			i;
-	size_t			j;
-	size_t			maxsize;
-	db_lockmode_t		lock_mode;
-	int			handle_created;
-	cob_u32_t		flags = 0;
-	int			ret = 0;
-	int			nonexistent;
-#if	0	/* RXWRXW - Access check BDB Human */
-	int			checkvalue;
-#endif
-	struct stat	st;
+	if (f->access_mode == COB_ACCESS_SEQUENTIAL) {
+		prim->mv_data = p->prim_key;
+		prim->mv_size = (size_t)p->primekeylen;
+	} else {
+		lmdb_setkey (f, 0);
+		*prim = p->key;
+	}
+}
 
-	COB_UNUSED (sharing);
-	if (cobsetptr->bdb_home != NULL
-	 && bdb_env == NULL) {		/* Join BDB, on first OPEN of INDEXED file */
-		if (join_environment ()) {
-#if 0	/* better return a permanent or sharing error */
-			cob_hard_failure ();
-#else
-			return COB_STATUS_61_FILE_SHARING;
-#endif
-		}
+/* Save the index entry as current position in index 'idx' */
+static void
+lmdb_savepos (cob_file *f, const int idx, const MDB_val *key,
+	      const MDB_val *data)
+{
+	struct indexed_file	*p = f->file;
+
+	p->key_index = idx;
+	f->curkey = (short)idx;
+	memcpy (p->pos_key, key->mv_data, key->mv_size);
+	p->pos_keylen = key->mv_size;
+	if (idx > 0) {
+		/* the primary key, preceded by the sequence number for duplicates */
+		memcpy (p->pos_data, data->mv_data, data->mv_size);
+		p->pos_datalen = data->mv_size;
 	}
-	cob_chk_file_mapping ();
+	p->pos_valid = 1;
+}
 
-#if	0	/* RXWRXW - Access check BDB Human */
-	if (mode == COB_OPEN_INPUT) {
-		checkvalue = R_OK;
+/* Set 'cursor' on the first index entry after the current position,
+   or the last one before it with 'prev'; with 'inclusive' on
+   the entry of the current position itself if it still exists */
+static int
+lmdb_position (cob_file *f, MDB_cursor *cursor, const int prev,
+	       const int inclusive)
+{
+	struct indexed_file	*p = f->file;
+	MDB_val			key, data;
+	int			rc, found;
+
+	key.mv_data = p->pos_key;
+	key.mv_size = p->pos_keylen;
+	if (lmdb_hasdups (f, p->key_index)) {
+		data.mv_data = p->pos_data;
+		data.mv_size = p->pos_datalen;
+		rc = mdb_cursor_get (cursor, &key, &data, MDB_GET_BOTH_RANGE);
+		if (rc == MDB_NOTFOUND) {
+			/* no such key, or all of its duplicates are before */
+			key.mv_data = p->pos_key;
+			key.mv_size = p->pos_keylen;
+			rc = mdb_cursor_get (cursor, &key, &data, MDB_SET_RANGE);
+			if (rc == 0
+			 && key.mv_size == p->pos_keylen
+			 && memcmp (key.mv_data, p->pos_key, p->pos_keylen) == 0) {
+				rc = mdb_cursor_get (cursor, &key, &data, MDB_NEXT_NODUP);
+			}
+		}
+		found = rc == 0
+		     && key.mv_size == p->pos_keylen
+		     && memcmp (key.mv_data, p->pos_key, p->pos_keylen) == 0
+		     && data.mv_size == p->pos_datalen
+		     && memcmp (data.mv_data, p->pos_data, p->pos_datalen) == 0;
 	} else {
-		checkvalue = R_OK | W_OK;
+		rc = mdb_cursor_get (cursor, &key, &data, MDB_SET_RANGE);
+		found = rc == 0
+		     && key.mv_size == p->pos_keylen
+		     && memcmp (key.mv_data, p->pos_key, p->pos_keylen) == 0;
 	}
-#endif
-
-	nonexistent = 0;
-	if (stat(filename, &st) != -1
-	 && S_ISDIR(st.st_mode)) {	/* Filename is a directory */
-#if 0	/* not merged yet */
-		return COB_XSTATUS_IS_DIR;
-#else
-		return COB_STATUS_30_PERMANENT_ERROR;
-#endif
+	if (rc != 0 && rc != MDB_NOTFOUND) {
+		return rc;
 	}
-	if (bdb_nofile (filename)) {
-		nonexistent = 1;
-		if (mode != COB_OPEN_OUTPUT && f->flag_optional == 0) {
-			return COB_STATUS_35_NOT_EXISTS;
+	if (!prev) {
+		if (found && !inclusive) {
+			rc = mdb_cursor_get (cursor, &key, &data, MDB_NEXT);
 		}
+	} else if (rc == MDB_NOTFOUND) {
+		rc = mdb_cursor_get (cursor, &key, &data, MDB_LAST);
+	} else if (!found || !inclusive) {
+		rc = mdb_cursor_get (cursor, &key, &data, MDB_PREV);
 	}
+	return rc;
+}
 
-	/* broken definition, may happen with EXTFH */
-	if (f->nkeys == 0) {
-		return COB_STATUS_30_PERMANENT_ERROR;
+/* Read the record of the entry at 'cursor' in index 'idx' directly
+   from the map into the record area, returns LMDB_RETRY if a record
+   lock had to be waited for, as the snapshot is then outdated;
+   with 'next' status 02 is returned if a duplicate follows, as
+   for BDB only on sequential reads */
+static int
+lmdb_fetch (cob_file *f, const int idx, MDB_cursor *cursor,
+	    const int read_opts, const int test_lock, const int next)
+{
+	struct indexed_file	*p = f->file;
+	MDB_val			key, data, prim, rec;
+	int			ret;
+
+	if (mdb_cursor_get (cursor, &key, &data, MDB_GET_CURRENT)) {
+		return COB_STATUS_23_KEY_NOT_EXISTS;
+	}
+	if (idx == 0) {
+		prim = key;
+		rec = data;
+	} else {
+		lmdb_primkey (f, idx, &data, &prim);
+		if (mdb_get (p->rtxn, p->dbi[0], &prim, &rec)) {
+			return COB_STATUS_23_KEY_NOT_EXISTS;
+		}
+	}
+	if (test_lock) {
+		if (read_opts & (COB_READ_LOCK | COB_READ_WAIT_LOCK)) {
+			if (lmdb_lock_record (f, &prim, 0)) {
+				if (!(read_opts & COB_READ_WAIT_LOCK)
+				 || lmdb_lock_record (f, &prim, 1)) {
+					return COB_STATUS_51_RECORD_LOCKED;
+				}
+				return LMDB_RETRY;
+			}
+		} else
+		if (!(read_opts & COB_READ_IGNORE_LOCK)
+		 && lmdb_test_record_lock (f, &prim)) {
+			return COB_STATUS_51_RECORD_LOCKED;
+		}
 	}
 
-	p = cob_malloc (sizeof (struct indexed_file));
-	f->file = p;
-	f->curkey = -1;
-	if (bdb_env != NULL) {
-		if (mode == COB_OPEN_OUTPUT
-		 || mode == COB_OPEN_EXTEND
-		 || (f->lock_mode & COB_FILE_EXCLUSIVE)
-		 || (mode == COB_OPEN_I_O && !f->lock_mode)) {
-			lock_mode = DB_LOCK_WRITE;
-		} else {
-			lock_mode = DB_LOCK_READ;
-		}
-		ret = lock_file (f, filename, lock_mode);
-		if (ret) {
-			cob_free (p);
-			f->file = NULL;
-			return ret;
-		} else {
-			p->file_lock_set = 1;
-		}
+	lmdb_savepos (f, idx, &key, &data);
+	memcpy (p->prim_key, prim.mv_data, prim.mv_size);
+	if (rec.mv_size > f->record_max) {
+		f->record->size = f->record_max;
+		ret = COB_STATUS_43_READ_NOT_DONE;
+	} else {
+		f->record->size = rec.mv_size;
+		ret = COB_STATUS_00_SUCCESS;
 	}
+	memcpy (f->record->data, rec.mv_data, f->record->size);
 
-	switch (mode) {
-	case COB_OPEN_INPUT:
-		flags |= DB_RDONLY;
+	if (ret == COB_STATUS_00_SUCCESS
+	 && next
+	 && lmdb_hasdups (f, idx)
+	 && mdb_cursor_get (cursor, &key, &data, MDB_NEXT_DUP) == 0) {
+		ret = COB_STATUS_02_SUCCESS_DUPLICATE;
+	}
+	return ret;
+}
+
+/* Open a cursor of the read transaction on the index of 'key' and
+   set it on the entry for 'cond' and the key value in the record */
+static int
+lmdb_start_internal (cob_file *f, const int cond, cob_field *key,
+		     int *idx, MDB_cursor **cursor)
+{
+	struct indexed_file	*p = f->file;
+	MDB_val			k, d;
+	int			rc, fullkeylen, partlen;
+
+	*cursor = NULL;
+	*idx = f->mapkey = cob_findkey_attr (f, key, &fullkeylen, &partlen);
+	if (*idx < 0) {
+		return COB_STATUS_23_KEY_NOT_EXISTS;
+	}
+	rc = mdb_cursor_open (p->rtxn, p->dbi[*idx], cursor);
+	if (rc) {
+		*cursor = NULL;
+		return lmdb_status (rc);
+	}
+
+	/* Search, the key may be partial */
+	lmdb_setkey (f, *idx);
+	k.mv_data = p->savekey;
+	k.mv_size = (size_t)partlen;
+	if (cond == COB_FI) {
+		rc = mdb_cursor_get (*cursor, &k, &d, MDB_FIRST);
+	} else if (cond == COB_LA) {
+		rc = mdb_cursor_get (*cursor, &k, &d, MDB_LAST);
+	} else {
+		rc = mdb_cursor_get (*cursor, &k, &d, MDB_SET_RANGE);
+	}
+	switch (cond) {
+	case COB_EQ:
+		if (rc == 0
+		 && bdb_cmpkey (f, k.mv_data, f->record->data, *idx, partlen) != 0) {
+			rc = MDB_NOTFOUND;
+		}
 		break;
-	case COB_OPEN_OUTPUT:
-		flags |= DB_CREATE;
+	case COB_LT:
+		rc = mdb_cursor_get (*cursor, &k, &d, rc ? MDB_LAST : MDB_PREV);
 		break;
-	case COB_OPEN_I_O:
-	case COB_OPEN_EXTEND:
-		flags |= DB_CREATE;
+	case COB_LE:
+		while (rc == 0
+		    && bdb_cmpkey (f, k.mv_data, f->record->data, *idx, partlen) == 0) {
+			rc = mdb_cursor_get (*cursor, &k, &d, MDB_NEXT_NODUP);
+		}
+		rc = mdb_cursor_get (*cursor, &k, &d, rc ? MDB_LAST : MDB_PREV);
+		break;
+	case COB_GT:
+		while (rc == 0
+		    && bdb_cmpkey (f, k.mv_data, f->record->data, *idx, partlen) == 0) {
+			rc = mdb_cursor_get (*cursor, &k, &d, MDB_NEXT_NODUP);
+		}
 		break;
-	/* LCOV_EXCL_START */
 	default:
-		cob_runtime_error (_("invalid internal call of %s"), "indexed_open");
-		cob_fatal_error (COB_FERROR_CODEGEN);
-	/* LCOV_EXCL_STOP */
+		/* COB_GE, COB_FI, COB_LA: nothing */
+		break;
 	}
+	return rc ? COB_STATUS_23_KEY_NOT_EXISTS : COB_STATUS_00_SUCCESS;
+}
 
-	p->db = cob_malloc (sizeof (DB *) * f->nkeys);
-	p->cursor = cob_malloc (sizeof (DBC *) * f->nkeys);
-	p->filenamelen = (int) strlen (filename);
-	p->last_readkey = cob_malloc (sizeof (unsigned char *) * 2 * f->nkeys);
-	p->last_dupno = cob_malloc (sizeof (unsigned int) * f->nkeys);
-	p->rewrite_sec_key = cob_malloc (sizeof (int) * f->nkeys);
-	maxsize = p->primekeylen = bdb_keylen(f, 0);
-	for (i = 1; i < f->nkeys; ++i) {
-		j = bdb_keylen(f, i);
-		if( j > maxsize)
-			maxsize = j;
+/* Add the entry of alternate key 'idx' for the record area,
+   p->primdata holds the primary key after the sequence number */
+static int
+lmdb_put_alt (cob_file *f, MDB_txn *txn, const int idx, int *dupl)
+{
+	struct indexed_file	*p = f->file;
+	MDB_cursor		*cursor;
+	MDB_val			key, data;
+	unsigned int		dupno;
+	int			rc;
+
+	lmdb_setkey (f, idx);
+	if (lmdb_suppresskey (f, idx, p->savekey, p->key.mv_size)) {
+		return 0;
+	}
+	if (!f->keys[idx].tf_duplicates) {
+		data.mv_data = p->primdata + LMDB_DUPNO_LEN;
+		data.mv_size = (size_t)p->primekeylen;
+		return mdb_put (txn, p->dbi[idx], &p->key, &data, MDB_NOOVERWRITE);
 	}
-	p->maxkeylen = maxsize;
 
-	for (i = 0; i < f->nkeys; ++i) {
-		/* File name */
-		runtime_buffer[COB_FILE_MAX] = 0;
-		if (i == 0) {
-			snprintf (runtime_buffer, (size_t)COB_FILE_MAX, "%s",
-				  filename);
-		} else {
-			snprintf (runtime_buffer, (size_t)COB_FILE_MAX, "%s.%d",
-				 filename, (int)i);
-		}
-#if	0	/* RXWRXW - Access check BDB Human */
-		ret = access (runtime_buffer, checkvalue);
-		if (ret != 0) {
-			if (errno == ENOENT &&
-			    (mode == COB_OPEN_OUTPUT || f->flag_optional == 1)) {
-				ret = 0;
-				/* Check here if the directory exists ? */
-#if	0	/* RXWRXW - Check dir */
-				if (!directory exists) {
-					ret = ENOENT;
-				} else {
-					ret = 0;
-				}
-#endif
-			} else {
-				ret = errno;
-			}
-			if (ret != 0) {
-				switch (ret) {
-				case ENOENT:
-					ret = COB_STATUS_35_NOT_EXISTS;
-					break;
-				case EACCES:
-					ret = COB_STATUS_37_PERMISSION_DENIED;
-					break;
-				default:
-					ret = COB_STATUS_30_PERMANENT_ERROR;
-					break;
-				}
-				/* Note: BDB cleanup done below */
-			}
+	/* Next sequence number of the duplicates */
+	rc = mdb_cursor_open (txn, p->dbi[idx], &cursor);
+	if (rc) {
+		return rc;
+	}
+	dupno = 1;
+	key = p->key;
+	rc = mdb_cursor_get (cursor, &key, &data, MDB_SET_KEY);
+	if (rc == 0) {
+		rc = mdb_cursor_get (cursor, &key, &data, MDB_LAST_DUP);
+		if (rc == 0) {
+			dupno = lmdb_getdupno (&data) + 1;
+			*dupl = 1;
 		}
-#endif
+	}
+	mdb_cursor_close (cursor);
+	if (rc && rc != MDB_NOTFOUND) {
+		return rc;
+	}
+	lmdb_putdupno (p->primdata, dupno);
+	data.mv_data = p->primdata;
+	data.mv_size = (size_t)p->primekeylen + LMDB_DUPNO_LEN;
+	return mdb_put (txn, p->dbi[idx], &p->key, &data, 0);
+}
 
-		/* btree info */
-		if (!ret) {
-			ret = db_create (&p->db[i], bdb_env, 0);
-		}
-		if (!ret) {
-			handle_created = 1;
-			if (mode == COB_OPEN_OUTPUT) {
-				if (bdb_env) {
-					ret = bdb_env->dbremove (bdb_env, NULL, runtime_buffer, NULL, 0);
-					if (ret == ENOENT) {
-						ret = 0;
-					}
-				} else {
-					/* FIXME: test "First READ on empty SEQUENTIAL INDEXED file ..."
-					   on OPEN-OUTPUT results with MinGW & BDB 6 in
-					   BDB1565 DB->pget: method not permitted before handle's open method
-					*/
-					/* CHECKME: the following only "works" if the file is an actual BDB database,
-					   otherwise a message may be returned, like BDB 5.3.21:
-					   BDB0004 fop_read_meta: /path/to/file: unexpected file type or format */
-					p->db[i]->remove (p->db[i], runtime_buffer, NULL, 0);
-					/* consider to use   unlink(runtime_buffer);   instead */
-					ret = db_create (&p->db[i], bdb_env, 0);
-				}
-			}
-			if (!ret) {
-				if (f->keys[i].tf_duplicates) {
-					p->db[i]->set_flags (p->db[i], DB_DUP);
-				}
-				/* TODO: add national compare function later */
-#ifdef USE_BDB_KEYDIFF
-				p->db[i]->set_bt_compare(p->db[i], bdb_bt_compare);
-#else
-				if (f->keys[i].collating_sequence) {
-					p->db[i]->set_bt_compare(p->db[i], bdb_bt_compare);
-				}
-#endif
-			}
-		} else {
-			handle_created = 0;
-		}
-		/* Open db */
-		if (!ret) {
-			/* FIXME: test "First READ on empty SEQUENTIAL INDEXED file ..."
-			   on OPEN-OUTPUT results with MinGW & BDB 6 in
-			   BDB0588 At least one secondary cursor must be specified to DB->join
-			*/
-			ret = p->db[i]->open (p->db[i], NULL, runtime_buffer, NULL,
-						DB_BTREE, flags, COB_FILE_MODE);
-		}
-		if (ret) {
-			for (j = 0; j < i; ++j) {
-				DB_CLOSE (p->db[j]);
-			}
-			if (handle_created) {
-				DB_CLOSE (p->db[i]);
-			}
-			cob_free (p->db);
-			cob_free (p->last_readkey);
-			cob_free (p->last_dupno);
-			cob_free (p->rewrite_sec_key);
-			cob_free (p->cursor);
-			if (bdb_env != NULL) {
-				unlock_file (f);
-			}
-			cob_free (p);
-			switch (ret) {
-			case DB_LOCK_NOTGRANTED:
-				return COB_STATUS_61_FILE_SHARING;
-			case ENOENT:
-			case ENOTDIR:
-				if (mode == COB_OPEN_EXTEND
-				 || mode == COB_OPEN_OUTPUT) {
-					return COB_STATUS_35_NOT_EXISTS;
-				}
-				if (f->flag_optional) {
-					if (mode == COB_OPEN_I_O) {
-						return COB_STATUS_35_NOT_EXISTS;
-					}
-					f->open_mode = mode;
-					f->flag_nonexistent = 1;
-					f->flag_end_of_file = 1;
-					f->flag_begin_of_file = 1;
-					/* RXWRXW - Check directory exists? */
-					return COB_STATUS_05_SUCCESS_OPTIONAL;
-				}
-				return COB_STATUS_35_NOT_EXISTS;
-			default:
-				return COB_STATUS_30_PERMANENT_ERROR;
-			}
+/* Remove the entry of alternate key 'idx' with the value in 'keyarea'
+   for the record with the primary key in p->primdata */
+static int
+lmdb_del_alt (cob_file *f, MDB_txn *txn, const int idx,
+	      unsigned char *keyarea, const size_t keylen)
+{
+	struct indexed_file	*p = f->file;
+	MDB_cursor		*cursor;
+	MDB_val			key, data, prim;
+	int			rc;
 
+	if (lmdb_suppresskey (f, idx, keyarea, keylen)) {
+		return 0;
+	}
+	key.mv_data = keyarea;
+	key.mv_size = keylen;
+	if (!f->keys[idx].tf_duplicates) {
+		rc = mdb_del (txn, p->dbi[idx], &key, NULL);
+		return rc == MDB_NOTFOUND ? 0 : rc;
+	}
+	rc = mdb_cursor_open (txn, p->dbi[idx], &cursor);
+	if (rc) {
+		return rc;
+	}
+	rc = mdb_cursor_get (cursor, &key, &data, MDB_SET_KEY);
+	while (rc == 0) {
+		lmdb_primkey (f, idx, &data, &prim);
+		if (memcmp (prim.mv_data, p->primdata + LMDB_DUPNO_LEN,
+			    (size_t)p->primekeylen) == 0) {
+			rc = mdb_cursor_del (cursor, 0);
+			break;
 		}
-
-		p->last_readkey[i] = cob_malloc (maxsize);
-		p->last_readkey[f->nkeys + i] = cob_malloc (maxsize);
+		rc = mdb_cursor_get (cursor, &key, &data, MDB_NEXT_DUP);
 	}
+	mdb_cursor_close (cursor);
+	return rc == MDB_NOTFOUND ? 0 : rc;
+}
 
-	p->temp_key = cob_malloc (maxsize + sizeof (unsigned long));
-	p->savekey  = cob_malloc (maxsize + sizeof (unsigned long));
-	p->suppkey  = cob_malloc (maxsize + sizeof (unsigned long));
-	p->saverec  = cob_malloc (f->record_max + sizeof (unsigned long));
-	f->file = p;
-	p->key_index = 0;
-	p->last_key = NULL;
+static int
+lmdb_write_internal (cob_file *f, MDB_txn *txn)
+{
+	struct indexed_file	*p = f->file;
+	MDB_val			data;
+	int			i, rc;
+	int			dupl = 0;
 
-	memset ((void *)&p->key, 0, sizeof (DBT));
-	memset ((void *)&p->data, 0, sizeof (DBT));
-	p->filename = cob_malloc (strlen (filename) + 1);
-	strcpy (p->filename, filename);
-	p->write_cursor_open = 0;
-	p->record_locked = 0;
-	if (bdb_env != NULL) {
-		bdb_env->lock_id (bdb_env, &p->bdb_lock_id);
+	lmdb_setkey (f, 0);
+	memcpy (p->primdata + LMDB_DUPNO_LEN, p->savekey, p->key.mv_size);
+	data.mv_data = f->record->data;
+	data.mv_size = f->record->size;
+	rc = mdb_put (txn, p->dbi[0], &p->key, &data, MDB_NOOVERWRITE);
+	for (i = 1; rc == 0 && i < (int)f->nkeys; ++i) {
+		rc = lmdb_put_alt (f, txn, i, &dupl);
+	}
+	if (rc) {
+		p->last_rc = rc;
+		return lmdb_status (rc);
 	}
+	return dupl ? COB_STATUS_02_SUCCESS_DUPLICATE : COB_STATUS_00_SUCCESS;
+}
 
-	bdb_setkey (f, 0);
-	p->db[0]->cursor (p->db[0], NULL, &p->cursor[0], 0);
-	ret = DB_SEQ (p->cursor[0], &p->key, &p->data, DB_FIRST);
-	bdb_close_cursor (f);
-	if (!ret) {
-		memcpy (p->last_readkey[0], p->key.data, (size_t)p->key.size);
-		if (p->data.data != NULL
-		 && p->data.size > 0
-		 && p->data.size > f->record_max) {
-			return COB_STATUS_39_CONFLICT_ATTRIBUTE;
-		}
-	} else {
-		p->data.data = NULL;
-	}
+static int
+lmdb_rewrite_internal (cob_file *f, MDB_txn *txn)
+{
+	struct indexed_file	*p = f->file;
+	MDB_val			data;
+	size_t			len;
+	int			i, rc;
+	int			dupl = 0;
 
-	f->open_mode = mode;
-	if (f->flag_optional
-	 && nonexistent
-	 && mode != COB_OPEN_OUTPUT) {
-		return COB_STATUS_05_SUCCESS_OPTIONAL;
+	lmdb_setkey (f, 0);
+	if (f->access_mode == COB_ACCESS_SEQUENTIAL
+	 && memcmp (p->savekey, p->prim_key, (size_t)p->primekeylen) != 0) {
+		return COB_STATUS_21_KEY_INVALID;
 	}
-	return 0;
-
-#else
-	static int first_idx_open = 1;
-
-	COB_UNUSED (f);
-	COB_UNUSED (filename);
-	COB_UNUSED (sharing);
-	COB_UNUSED (mode);
-
-	if (first_idx_open) {
-		first_idx_open = 0;
-		cob_runtime_warning (_("runtime is not configured to support %s"),
-			"ORGANIZATION INDEXED");
+	memcpy (p->primdata + LMDB_DUPNO_LEN, p->savekey, p->key.mv_size);
+	rc = mdb_get (txn, p->dbi[0], &p->key, &data);
+	if (rc == MDB_NOTFOUND) {
+		return COB_STATUS_21_KEY_INVALID;
 	}
-	return COB_STATUS_91_NOT_AVAILABLE;
-#endif
+	if (rc == 0) {
+		/* Save old record image, the map changes with the update */
+		len = data.mv_size > f->record_max ? f->record_max : data.mv_size;
+		memcpy (p->saverec, data.mv_data, len);
+		data.mv_data = f->record->data;
+		data.mv_size = f->record->size;
+		rc = mdb_put (txn, p->dbi[0], &p->key, &data, 0);
+	}
+	for (i = 1; rc == 0 && i < (int)f->nkeys; ++i) {
+		/* No change if the alternate key is unchanged */
+		len = (size_t)bdb_savekey (f, p->suppkey, p->saverec, i);
+		if (bdb_cmpkey (f, p->suppkey, f->record->data, i, 0) == 0) {
+			continue;
+		}
+		rc = lmdb_del_alt (f, txn, i, p->suppkey, len);
+		if (rc == 0) {
+			rc = lmdb_put_alt (f, txn, i, &dupl);
+		}
+	}
+	if (rc) {
+		p->last_rc = rc;
+		return lmdb_status (rc);
+	}
+	return dupl ? COB_STATUS_02_SUCCESS_DUPLICATE : COB_STATUS_00_SUCCESS;
 }
 
-/* Close the INDEXED file */
-
 static int
-indexed_close (cob_file *f, const int opt)
+lmdb_delete_internal (cob_file *f, MDB_txn *txn)
 {
-#ifdef	WITH_INDEX_EXTFH
-
-	return extfh_indexed_close (f, opt);
-
-#elif	defined(WITH_ANY_ISAM)
-
-	struct indexfile	*fh = f->file;
-
-	COB_UNUSED (opt);
-
-	if (fh == NULL) {
-		/* should we raise COB_STATUS_42_NOT_OPEN ? */
-		return COB_STATUS_30_PERMANENT_ERROR;
+	struct indexed_file	*p = f->file;
+	MDB_val			prim, data;
+	size_t			len;
+	int			i, rc;
+
+	lmdb_curkey (f, &prim);
+	memcpy (p->primdata + LMDB_DUPNO_LEN, prim.mv_data, prim.mv_size);
+	prim.mv_data = p->primdata + LMDB_DUPNO_LEN;
+	rc = mdb_get (txn, p->dbi[0], &prim, &data);
+	if (rc == MDB_NOTFOUND) {
+		return COB_STATUS_23_KEY_NOT_EXISTS;
 	}
-	if (fh->isfd >= 0) {
-		isfullclose (fh->isfd);
+	if (rc == 0) {
+		len = data.mv_size > f->record_max ? f->record_max : data.mv_size;
+		memcpy (p->saverec, data.mv_data, len);
+	}
+	for (i = 1; rc == 0 && i < (int)f->nkeys; ++i) {
+		len = (size_t)bdb_savekey (f, p->suppkey, p->saverec, i);
+		rc = lmdb_del_alt (f, txn, i, p->suppkey, len);
+	}
+	if (rc == 0) {
+		rc = mdb_del (txn, p->dbi[0], &prim, NULL);
+	}
+	if (rc) {
+		p->last_rc = rc;
+		return lmdb_status (rc);
 	}
-	freefh (fh);
-	f->file = NULL;
 	return COB_STATUS_00_SUCCESS;
+}
 
-#elif	defined(WITH_DB)
-
+/* Do the update in a write transaction, growing the map when full */
+static int
+lmdb_update (cob_file *f, int (*func) (cob_file *, MDB_txn *))
+{
 	struct indexed_file	*p = f->file;
-	int			i;
+	MDB_txn			*txn;
+	int			ret, rc;
 
-	COB_UNUSED (opt);
-
-	/* Close DB's */
-	if (p == NULL) {
-		/* should we raise COB_STATUS_42_NOT_OPEN ? */
-		return COB_STATUS_30_PERMANENT_ERROR;
-	}
-	for (i = 0; i < (int)f->nkeys; ++i) {
-		if (p->cursor[i]) {
-			bdb_close_index (f, i);
+	for (;;) {
+		p->last_rc = 0;
+		rc = lmdb_txn_begin (p->envp, 0, &txn);
+		if (rc) {
+			return lmdb_status (rc);
 		}
-	}
-	for (i = (int)f->nkeys - 1; i >= 0; --i) {
-		if (p->db[i]) {
-			DB_CLOSE (p->db[i]);
+		ret = func (f, txn);
+		if (ret == COB_STATUS_00_SUCCESS
+		 || ret == COB_STATUS_02_SUCCESS_DUPLICATE) {
+			rc = mdb_txn_commit (txn);
+			if (rc == 0) {
+				return ret;
+			}
+			p->last_rc = rc;
+			ret = lmdb_status (rc);
+		} else {
+			mdb_txn_abort (txn);
+		}
+		if (p->last_rc != MDB_MAP_FULL
+		 || lmdb_grow (p->envp)) {
+			return ret;
 		}
-		cob_free (p->last_readkey[i]);
-		cob_free (p->last_readkey[f->nkeys + i]);
 	}
+}
 
-	if (p->last_key) {
-		cob_free (p->last_key);
-	}
-	cob_free (p->temp_key);
-	cob_free (p->savekey);
-	cob_free (p->suppkey);
-	cob_free (p->saverec);
-	cob_free (p->db);
-	cob_free (p->last_readkey);
-	cob_free (p->last_dupno);
-	cob_free (p->rewrite_sec_key);
-	cob_free (p->filename);
-	cob_free (p->cursor);
-	if (bdb_env != NULL) {
-#if 1	/* CHECMKE: removed in RW-Branch with r1313 */
-		unlock_record (f);
-		unlock_file (f);
-#endif
-		bdb_env->lock_id_free (bdb_env, p->bdb_lock_id);
-	}
-	cob_free (p);
-	f->file = NULL;
+#endif	/* WITH_LMDB */
 
-	return COB_STATUS_00_SUCCESS;
+/* Delete file */
 
-#else
+static void
+indexed_file_delete (cob_file *f, const char *filename)
+{
+#ifdef	WITH_ANY_ISAM
 	COB_UNUSED (f);
-	COB_UNUSED (opt);
 
-	return COB_STATUS_91_NOT_AVAILABLE;
+	snprintf (file_open_buff, (size_t)COB_FILE_MAX, "%s.idx", filename);
+	file_open_buff[COB_FILE_MAX] = 0;
+	unlink (file_open_buff);
+	snprintf (file_open_buff, (size_t)COB_FILE_MAX, "%s.dat", filename);
+	file_open_buff[COB_FILE_MAX] = 0;
+	unlink (file_open_buff);
+#elif	defined(WITH_DB)
+	size_t	i;
+
+	for (i = 0; i < f->nkeys; ++i) {
+		if (i == 0) {
+			snprintf (file_open_buff, (size_t)COB_FILE_MAX, "%s",
+				  filename);
+		} else {
+			snprintf (file_open_buff, (size_t)COB_FILE_MAX, "%s.%d",
+				  filename, (int)i);
+		}
+		file_open_buff[COB_FILE_MAX] = 0;
+		errno = 0;
+		unlink (file_open_buff);
+	}
+#elif	defined(WITH_LMDB)
+	int	err;
+
+	COB_UNUSED (f);
 
+	/* the status is set from the data file only */
+	errno = 0;
+	unlink (filename);
+	err = errno;
+	snprintf (file_open_buff, (size_t)COB_FILE_MAX, "%s-lock", filename);
+	file_open_buff[COB_FILE_MAX] = 0;
+	unlink (file_open_buff);
+	errno = err;
+#else
+	COB_UNUSED (f);
+	COB_UNUSED (filename);
 #endif
 }
 
 
-/* START INDEXED file with positioning */
+/* OPEN INDEXED file */
 
 static int
-indexed_start (cob_file *f, const int cond, cob_field *key)
+indexed_open (cob_file *f, char *filename,
+		const enum cob_open_mode mode, const int sharing)
 {
+	/* Note filename points to file_open_name */
+	/* cob_chk_file_mapping manipulates file_open_name directly */
+
 #ifdef	WITH_INDEX_EXTFH
+	int		ret;
 
-	return extfh_indexed_start (f, cond, key);
+	ret = extfh_indexed_locate (f, filename);
+	switch (ret) {
+	case COB_NOT_CONFIGURED:
+		cob_chk_file_mapping ();
+		errno = 0;
+		if (access (filename, F_OK) && errno == ENOENT) {
+			if (mode != COB_OPEN_OUTPUT && f->flag_optional == 0) {
+				return COB_STATUS_35_NOT_EXISTS;
+			}
+		}
+		break;
+	case COB_STATUS_00_SUCCESS:
+		break;
+	default:
+		return ret;
+	}
+	ret = extfh_indexed_open (f, filename, mode, sharing);
+	switch (ret) {
+	case COB_STATUS_00_SUCCESS:
+		f->open_mode = mode;
+		break;
+	case COB_STATUS_35_NOT_EXISTS:
+		if (f->flag_optional) {
+			f->open_mode = mode;
+			f->flag_nonexistent = 1;
+			f->flag_end_of_file = 1;
+			f->flag_begin_of_file = 1;
+			return COB_STATUS_05_SUCCESS_OPTIONAL;
+		}
+		break;
+	}
+	return ret;
 
 #elif	defined(WITH_ANY_ISAM)
 
-	struct indexfile	*fh = f->file;
-	int			k;
-	int			mode;
-	int			klen,fullkeylen,partlen;
-	int			savecond;
-	struct keydesc *keyd;
-
-	f->flag_read_done = 0;
-	f->flag_first_read = 0;
-	fh->readdone = 0;
-	fh->eofpending = 0;
-	fh->startiscur = 0;
-	fh->wrkhasrec = 0;
-	if (f->flag_nonexistent) {
-		return COB_STATUS_23_KEY_NOT_EXISTS;
-	}
-	k = cob_findkey_attr (f, key, &fullkeylen, &partlen);
+	struct indexfile	*fh;
+	size_t			k;
+	int			ret, len;
+	int			omode;
+	int			lmode;
+	int			vmode;
+	int			dobld;
+	int			isfd;
+	int			checkvalue;
 
-			 /************************************************************/
-			 /*                                                          */
-			 /*  here we are storing the partial key length in the       */
-			 /*  indexfile structure so that the indexed read next       */
-			 /*  functions can position the file based on the partial    */
-			 /*  key length.                                             */
-			 /*                                                          */
-			 /*  note the indexed_cmpkey function expects a partial key  */
-			 /*  length of zero if it is to use the full key length.     */
-			 /*                                                          */
-			 /************************************************************/
+	COB_UNUSED (sharing);
 
-	if (fullkeylen == partlen)
-			fh->partial_key_length  = 0;
-	else
-			fh->partial_key_length  = partlen;
+	cob_chk_file_mapping ();
 
-	if (k < 0) {
-		return COB_STATUS_23_KEY_NOT_EXISTS;
-	}
-	f->mapkey = k;
-	keyd = &fh->key[k];
-	/* Use size of data field; This may indicate a partial key */
-	klen = partlen;
-	if (klen < 1 || klen > fullkeylen) {
-		/* Max key length for this index */
-		klen = fullkeylen;
+	if (mode == COB_OPEN_INPUT) {
+		checkvalue = R_OK;
+	} else {
+		checkvalue = R_OK | W_OK;
 	}
-	mode = ISGTEQ;
-	fh->startiscur = 1;
-	savecond = cond;
-	switch (cond) {
-	case COB_EQ:
-		mode = ISEQUAL;
-		fh->readdir = ISNEXT;
-		break;
-	case COB_GE:
-		mode = ISGTEQ;
-		fh->readdir = ISNEXT;
-		break;
-	case COB_GT:
-		mode = ISGREAT;
-		fh->readdir = ISNEXT;
-		break;
-	case COB_LE:
-		mode = ISGTEQ;
-		fh->readdir = ISPREV;
-		break;
-	case COB_LT:
-		mode = ISGTEQ;
-		fh->readdir = ISPREV;
-		break;
-	case COB_FI:
-		mode = ISFIRST;
-		fh->readdir = ISNEXT;
-		break;
-	case COB_LA:
-		mode = ISLAST;
-		fh->readdir = ISPREV;
-		break;
-	default:
-		return COB_STATUS_21_KEY_INVALID;
-	}
-	if (isstart (fh->isfd, keyd, klen, (void *)f->record->data, mode)) {
-		if (cond == COB_LE || cond == COB_LT) {
-			if (isstart (fh->isfd, keyd, klen, (void *)f->record->data, ISLAST)) {
-				f->curkey = -1;
-				f->mapkey = -1;
-				fh->startcond = -1;
-				fh->readdir = -1;
-				fh->startiscur = 0;
-				return fisretsts (COB_STATUS_23_KEY_NOT_EXISTS);
-			} else {
-				savecond = COB_LA;
+
+	snprintf (file_open_buff, (size_t)COB_FILE_MAX, "%s.idx", filename);
+	file_open_buff[COB_FILE_MAX] = 0;
+	errno = 0;
+	if (access (file_open_buff, checkvalue)) {
+		if (!(errno == ENOENT &&
+		      (mode == COB_OPEN_OUTPUT || f->flag_optional == 1))) {
+			switch (errno) {
+			case ENOENT:
+			case ENOTDIR:
+				return COB_STATUS_35_NOT_EXISTS;
+			case EACCES:
+				return COB_STATUS_37_PERMISSION_DENIED;
+			default:
+				return COB_STATUS_30_PERMANENT_ERROR;
 			}
-		} else {
-			f->curkey = -1;
-			f->mapkey = -1;
-			fh->startcond = -1;
-			fh->readdir = -1;
-			fh->startiscur = 0;
-			return fisretsts (COB_STATUS_23_KEY_NOT_EXISTS);
 		}
 	}
-	fh->startcond = savecond;
-	indexed_savekey (fh, f->record->data, k);
-	f->curkey = k;
-	f->flag_end_of_file = 0;
-	f->flag_begin_of_file = 0;
-	f->flag_first_read = 1;
-	return COB_STATUS_00_SUCCESS;
-
-#elif	defined(WITH_DB)
-
-	return indexed_start_internal (f, cond, key, 0, 0);
-
-#else
-	COB_UNUSED (f);
-	COB_UNUSED (cond);
-	COB_UNUSED (key);
-
-	return COB_STATUS_91_NOT_AVAILABLE;
-#endif
-}
-
-/* Random READ of the INDEXED file  */
-
-static int
-indexed_read (cob_file *f, cob_field *key, const int read_opts)
-{
-#ifdef	WITH_INDEX_EXTFH
-
-	return extfh_indexed_read (f, key, read_opts);
-
-#elif	defined(WITH_ANY_ISAM)
-
-	struct indexfile	*fh;
-	int			k,fullkeylen,partlen;
-	int			ret;
-	int			lmode;
 
-	fh = f->file;
-	fh->eofpending = 0;
-	fh->startiscur = 0;
-	fh->wrkhasrec = 0;
-	if (f->flag_nonexistent) {
-		return COB_STATUS_23_KEY_NOT_EXISTS;
-	}
-	k = cob_findkey_attr (f, key, &fullkeylen, &partlen);
-	if (k < 0) {
-		return COB_STATUS_23_KEY_NOT_EXISTS;
-	}
-	f->mapkey = k;
-	if (f->curkey != (int)k) {
-		/* Switch to this index */
-		isstart (fh->isfd, &fh->key[k], 0,
-			 (void *)f->record->data, ISEQUAL);
-		f->curkey = k;
-		fh->wrkhasrec = 0;
-	}
-	fh->startcond = -1;
-	lmode = 0;
-	if (read_opts & COB_READ_LOCK) {
-		lmode = ISLOCK;
-	} else if (read_opts & COB_READ_WAIT_LOCK) {
-		lmode = ISLCKW;
-	} else if ((f->lock_mode & COB_LOCK_AUTOMATIC)) {
-		if (f->open_mode != COB_OPEN_INPUT) {
-			if (!(read_opts & COB_READ_IGNORE_LOCK)) {
-				lmode = ISLOCK;
+	snprintf (file_open_buff, (size_t)COB_FILE_MAX, "%s.dat", filename);
+	file_open_buff[COB_FILE_MAX] = 0;
+	errno = 0;
+	if (access (file_open_buff, checkvalue)) {
+		if (!(errno == ENOENT &&
+		      (mode == COB_OPEN_OUTPUT || f->flag_optional == 1))) {
+			switch (errno) {
+			case ENOENT:
+			case ENOTDIR:
+				return COB_STATUS_35_NOT_EXISTS;
+			case EACCES:
+				return COB_STATUS_37_PERMISSION_DENIED;
+			default:
+				return COB_STATUS_30_PERMANENT_ERROR;
 			}
 		}
 	}
-#ifdef	ISSKIPLOCK
-	if (read_opts & COB_READ_IGNORE_LOCK) {
-		lmode = ISSKIPLOCK;
-	}
-#endif
-	if ((fh->lmode & ISLOCK) && !(f->lock_mode & COB_LOCK_MULTIPLE)) {
-		isrelease (fh->isfd);
-	}
-	ISERRNO = 0;
-	fh->readdir = -1;
+
 	ret = COB_STATUS_00_SUCCESS;
-	if (isread (fh->isfd, (void *)f->record->data, ISEQUAL | lmode)) {
-		ret = fisretsts (COB_STATUS_21_KEY_INVALID);
-	}
-	if (unlikely (ret != 0)) {
-		memset (fh->savekey, 0, fh->lenkey);
-		fh->recnum = 0;
-		fh->readdone = 0;
-		return ret;
-	}
-	f->flag_first_read = 0;
-	f->flag_read_done = 1;
-	fh->readdone = 1;
-	f->flag_end_of_file = 0;
-	f->flag_begin_of_file = 0;
-	indexed_savekey (fh, f->record->data, 0);
-	fh->recnum = ISRECNUM;
+	omode = 0;
+	lmode = 0;
+	vmode = 0;
+	dobld = 0;
+	isfd = -1;
+	fh = cob_malloc (sizeof (struct indexfile) +
+			 ((sizeof (struct keydesc)) * (f->nkeys + 1)));
 #ifdef	ISVARLEN
 	if (f->record_min != f->record_max) {
-		f->record->size = ISRECLEN;
+		vmode = ISVARLEN;
+		ISRECLEN = f->record_min;
 	}
 #endif
-	return 0;
-
-#elif	defined(WITH_DB)
-
-	struct indexed_file	*p = f->file;
-	int			ret;
-	int			bdb_opts;
-	int			test_lock;
-
-	test_lock = 0;
-	bdb_opts = read_opts;
-	if (bdb_env != NULL) {
-		if (f->open_mode != COB_OPEN_I_O
-		 ||(f->lock_mode & COB_FILE_EXCLUSIVE)) {
-			bdb_opts &= ~COB_READ_LOCK;
-		} else
-		if ((f->lock_mode & COB_LOCK_AUTOMATIC)
-		 && !(bdb_opts & COB_READ_NO_LOCK)) {
-			bdb_opts |= COB_READ_LOCK;
+	if (!f->lock_mode) {
+		if (mode != COB_OPEN_INPUT) {
+			lmode = ISEXCLLOCK;
+		} else {
+			lmode = ISMANULOCK;
 		}
-		unlock_record (f);
-		test_lock = 1;
+	} else if ((f->lock_mode & COB_FILE_EXCLUSIVE)) {
+		lmode = ISEXCLLOCK;
+	} else if ((f->lock_mode & COB_LOCK_AUTOMATIC) && mode != COB_OPEN_INPUT) {
+		lmode = ISAUTOLOCK;
 	} else {
-		bdb_opts &= ~COB_READ_LOCK;
-	}
-
-	ret = indexed_start_internal (f, COB_EQ, key, bdb_opts, test_lock);
-	if (ret != COB_STATUS_00_SUCCESS) {
-		return ret;
+		lmode = ISMANULOCK;
 	}
-
-	f->record->size = p->data.size;
-	if (f->record->size > f->record_max) {
-		f->record->size = f->record_max;
-		ret = COB_STATUS_43_READ_NOT_DONE;
-	} else {
-		ret = COB_STATUS_00_SUCCESS;
+	switch (mode) {
+	case COB_OPEN_INPUT:
+		omode = ISINPUT;
+		break;
+	case COB_OPEN_OUTPUT:
+		lmode = ISEXCLLOCK;
+		omode = ISOUTPUT;
+		ISERRNO = 0;
+		isfd = isopen ((void *)filename, ISINPUT | ISEXCLLOCK | vmode);
+		if (ISERRNO == EFLOCKED) {
+			freefh (fh);
+			return COB_STATUS_61_FILE_SHARING;
+		} else {
+			if (isfd >= 0) {
+				isfullclose (isfd);
+			}
+			iserase ((void *)filename);
+			ISERRNO = 0;
+		}
+		dobld = 1;
+		break;
+	case COB_OPEN_I_O:
+		omode = ISINOUT;
+		break;
+	case COB_OPEN_EXTEND:
+		lmode = ISEXCLLOCK;
+		omode = ISINOUT;
+		break;
+	default:
+		/* CLOSED / LOCKED-CLOSED */
+		break;
 	}
-	memcpy (f->record->data, p->data.data, f->record->size);
-
-	return ret;
-
+	ISERRNO = 0;
+	fh->lmode = 0;
+	if (dobld) {
+dobuild:
+		/* copy index information cob_file_key -> keydesc */
+		for (k = 0; k < f->nkeys; ++k) {
+			len = indexed_keydesc (f, &fh->key[k], &f->keys[k]);
+			if (fh->lenkey < len) {
+				fh->lenkey = len;
+			}
+		}
+		isfd = isbuild ((void *)filename, (int)f->record_max, &fh->key[0],
+				vmode | ISINOUT | ISEXCLLOCK);
+#if 0 /* activate on later merge of locking enhancements */
+		f->flag_file_lock = 1;
+#endif
+		if (ISERRNO == EEXIST
+#if 1 /* CHECKME: guard added by Simon, needed ? */
+		 && omode == ISOUTPUT
+#endif
+		 && isfd < 0) {
+			/* Erase file and redo the 'isbuild' */
+			iserase ((void *)filename);
+			isfd = isbuild ((void *)filename, (int)f->record_max, &fh->key[0],
+					vmode | ISINOUT | ISEXCLLOCK);
+#if 0 /* activate on later merge of locking enhancements */
+			f->flag_file_lock = 1;
+#endif
+		}
+	} else {
+		if (lmode == ISAUTOLOCK) {
+			fh->lmode = ISLOCK;
+			lmode = ISMANULOCK;
+		}
+		isfd = isopen ((void *)filename, omode | lmode | vmode);
+		if (isfd >= 0) {
+			struct dictinfo		di = { 0 };		/* Defined in (c|d|vb)isam.h */
+			isindexinfo (isfd, (void *)&di, 0);
+			/* Mask off ISVARLEN */
+			fh->nkeys = di.di_nkeys & 0x7F;
+			if (fh->nkeys != f->nkeys
+			 || f->record_max != di.di_recsize) {
+				ret = COB_STATUS_39_CONFLICT_ATTRIBUTE;
+			}
+			for (k = 0; k < fh->nkeys && !ret; ++k) {
+				struct keydesc	kd = { 0 };
+				/* get key info from ISAM */
+				struct keydesc	key = { 0 }; /* init to prevent analyzer warning */
+				int len_key;
+				isindexinfo (isfd, &key, (int)(k + 1));
+				len = indexed_keylen (&key);
+				if (fh->lenkey < len) {
+					fh->lenkey = len;
+				}
+				/* get key info from cob_key */
+				len_key = indexed_keydesc (f, &kd, &f->keys[k]);
+				/* verify that COBOL keys match exactly to real ISAM keys */
+				if (len_key != len
+				 || indexed_keycmp (&kd, &key) != 0) {
+					ret = COB_STATUS_39_CONFLICT_ATTRIBUTE;
+					break;
+				}
+				/* store ISAM key definition */
+				memcpy (&fh->key[k], &key, sizeof (struct keydesc));
+			}
+		} else {	/* opening the file is not possible */
+			if (ISERRNO == EFLOCKED) {
+				freefh (fh);
+				return COB_STATUS_61_FILE_SHARING;
+			}
+			if (f->flag_optional) {
+				if (mode == COB_OPEN_EXTEND
+				 || mode == COB_OPEN_I_O) {
+					dobld = 1;
+					ret = COB_STATUS_05_SUCCESS_OPTIONAL;
+					goto dobuild;
+				}
+				freefh (fh);
+				f->open_mode = mode;
+				f->flag_end_of_file = 1;
+				f->flag_begin_of_file = 1;
+				if (f->flag_nonexistent) {
+					return COB_STATUS_00_SUCCESS;
+				}
+				f->flag_nonexistent = 1;
+				return COB_STATUS_05_SUCCESS_OPTIONAL;
+			}
+		}
+	}
+	if (isfd < 0) {
+		ret = fisretsts (fh, COB_STATUS_30_PERMANENT_ERROR);
+		freefh (fh);
+		return ret;
+	}
+	if (ret > 9) {
+		isfullclose (isfd);
+		freefh (fh);
+		return ret;
+	}
+	if (dobld) {
+		for (k = 1; k < f->nkeys; ++k) {
+			ISERRNO = 0;
+			if (isaddindex (isfd, &fh->key[k])) {
+				ret = COB_STATUS_39_CONFLICT_ATTRIBUTE;
+			}
+		}
+		if (ret > 9) {
+			isfullclose (isfd);
+			iserase ((void *)filename);
+			freefh (fh);
+			return ret;
+		}
+	}
+	f->file = fh;
+	f->open_mode = mode;
+	fh->isfd = isfd;
+	fh->filename = cob_strdup (filename);
+#ifdef	COB_NATIVE_ISAM
+	if (mode != COB_OPEN_INPUT) {
+		cob_isam_journal_add (&fh->isstat, isfd);
+	}
+#endif
+	fh->savekey = cob_malloc ((size_t)(fh->lenkey + 1));
+	fh->recwrk = cob_malloc ((size_t)(f->record_max + 1));
+	/* Active index is unknown at this time */
+	f->curkey = -1;
+	f->flag_nonexistent = 0;
+	f->flag_end_of_file = 0;
+	f->flag_begin_of_file = 0;
+	return ret;
+
+#elif	defined(WITH_DB)
+
+	struct indexed_file	*p;
+	size_t			i;
+	size_t			j;
+	size_t			maxsize;
+	db_lockmode_t		lock_mode;
+	int			handle_created;
+	cob_u32_t		flags = 0;
+	int			ret = 0;
+	int			nonexistent;
+#if	0	/* RXWRXW - Access check BDB Human */
+	int			checkvalue;
+#endif
+	struct stat	st;
+
+	COB_UNUSED (sharing);
+	if (cobsetptr->bdb_home != NULL
+	 && bdb_env == NULL) {		/* Join BDB, on first OPEN of INDEXED file */
+		if (join_environment ()) {
+#if 0	/* better return a permanent or sharing error */
+			cob_hard_failure ();
+#else
+			return COB_STATUS_61_FILE_SHARING;
+#endif
+		}
+	}
+	cob_chk_file_mapping ();
+
+#if	0	/* RXWRXW - Access check BDB Human */
+	if (mode == COB_OPEN_INPUT) {
+		checkvalue = R_OK;
+	} else {
+		checkvalue = R_OK | W_OK;
+	}
+#endif
+
+	nonexistent = 0;
+	if (stat(filename, &st) != -1
+	 && S_ISDIR(st.st_mode)) {	/* Filename is a directory */
+#if 0	/* not merged yet */
+		return COB_XSTATUS_IS_DIR;
+#else
+		return COB_STATUS_30_PERMANENT_ERROR;
+#endif
+	}
+	if (bdb_nofile (filename)) {
+		nonexistent = 1;
+		if (mode != COB_OPEN_OUTPUT && f->flag_optional == 0) {
+			return COB_STATUS_35_NOT_EXISTS;
+		}
+	}
+
+	/* broken definition, may happen with EXTFH */
+	if (f->nkeys == 0) {
+		return COB_STATUS_30_PERMANENT_ERROR;
+	}
+
+	p = cob_malloc (sizeof (struct indexed_file));
+	f->file = p;
+	f->curkey = -1;
+	if (bdb_env != NULL) {
+		if (mode == COB_OPEN_OUTPUT
+		 || mode == COB_OPEN_EXTEND
+		 || (f->lock_mode & COB_FILE_EXCLUSIVE)
+		 || (mode == COB_OPEN_I_O && !f->lock_mode)) {
+			lock_mode = DB_LOCK_WRITE;
+		} else {
+			lock_mode = DB_LOCK_READ;
+		}
+		ret = lock_file (f, filename, lock_mode);
+		if (ret) {
+			cob_free (p);
+			f->file = NULL;
+			return ret;
+		} else {
+			p->file_lock_set = 1;
+		}
+	}
+
+	switch (mode) {
+	case COB_OPEN_INPUT:
+		flags |= DB_RDONLY;
+		break;
+	case COB_OPEN_OUTPUT:
+		flags |= DB_CREATE;
+		break;
+	case COB_OPEN_I_O:
+	case COB_OPEN_EXTEND:
+		flags |= DB_CREATE;
+		break;
+	/* LCOV_EXCL_START */
+	default:
+		cob_runtime_error (_("invalid internal call of %s"), "indexed_open");
+		cob_fatal_error (COB_FERROR_CODEGEN);
+	/* LCOV_EXCL_STOP */
+	}
+
+	p->db = cob_malloc (sizeof (DB *) * f->nkeys);
+	p->cursor = cob_malloc (sizeof (DBC *) * f->nkeys);
+	p->filenamelen = (int) strlen (filename);
+	p->last_readkey = cob_malloc (sizeof (unsigned char *) * 2 * f->nkeys);
+	p->last_dupno = cob_malloc (sizeof (unsigned int) * f->nkeys);
+	p->rewrite_sec_key = cob_malloc (sizeof (int) * f->nkeys);
+	maxsize = p->primekeylen = bdb_keylen(f, 0);
+	for (i = 1; i < f->nkeys; ++i) {
+		j = bdb_keylen(f, i);
+		if( j > maxsize)
+			maxsize = j;
+	}
+	p->maxkeylen = maxsize;
+
+	for (i = 0; i < f->nkeys; ++i) {
+		/* File name */
+		runtime_buffer[COB_FILE_MAX] = 0;
+		if (i == 0) {
+			snprintf (runtime_buffer, (size_t)COB_FILE_MAX, "%s",
+				  filename);
+		} else {
+			snprintf (runtime_buffer, (size_t)COB_FILE_MAX, "%s.%d",
+				 filename, (int)i);
+		}
+#if	0	/* RXWRXW - Access check BDB Human */
+		ret = access (runtime_buffer, checkvalue);
+		if (ret != 0) {
+			if (errno == ENOENT &&
+			    (mode == COB_OPEN_OUTPUT || f->flag_optional == 1)) {
+				ret = 0;
+				/* Check here if the directory exists ? */
+#if	0	/* RXWRXW - Check dir */
+				if (!directory exists) {
+					ret = ENOENT;
+				} else {
+					ret = 0;
+				}
+#endif
+			} else {
+				ret = errno;
+			}
+			if (ret != 0) {
+				switch (ret) {
+				case ENOENT:
+					ret = COB_STATUS_35_NOT_EXISTS;
+					break;
+				case EACCES:
+					ret = COB_STATUS_37_PERMISSION_DENIED;
+					break;
+				default:
+					ret = COB_STATUS_30_PERMANENT_ERROR;
+					break;
+				}
+				/* Note: BDB cleanup done below */
+			}
+		}
+#endif
+
+		/* btree info */
+		if (!ret) {
+			ret = db_create (&p->db[i], bdb_env, 0);
+		}
+		if (!ret) {
+			handle_created = 1;
+			if (mode == COB_OPEN_OUTPUT) {
+				if (bdb_env) {
+					ret = bdb_env->dbremove (bdb_env, NULL, runtime_buffer, NULL, 0);
+					if (ret == ENOENT) {
+						ret = 0;
+					}
+				} else {
+					/* FIXME: test "First READ on empty SEQUENTIAL INDEXED file ..."
+					   on OPEN-OUTPUT results with MinGW & BDB 6 in
+					   BDB1565 DB->pget: method not permitted before handle's open method
+					*/
+					/* CHECKME: the following only "works" if the file is an actual BDB database,
+					   otherwise a message may be returned, like BDB 5.3.21:
+					   BDB0004 fop_read_meta: /path/to/file: unexpected file type or format */
+					p->db[i]->remove (p->db[i], runtime_buffer, NULL, 0);
+					/* consider to use   unlink(runtime_buffer);   instead */
+					ret = db_create (&p->db[i], bdb_env, 0);
+				}
+			}
+			if (!ret) {
+				if (f->keys[i].tf_duplicates) {
+					p->db[i]->set_flags (p->db[i], DB_DUP);
+				}
+				/* only used when the file is created */
+				if (cobsetptr->bdb_page_size
+				 && mode != COB_OPEN_INPUT) {
+					p->db[i]->set_pagesize (p->db[i],
+						(cob_u32_t)cobsetptr->bdb_page_size);
+				}
+				/* without environment: a cache for each file */
+				if (i == 0
+				 && bdb_env == NULL) {
+					p->db[i]->set_cachesize (p->db[i],
+						(cob_u32_t)(cobsetptr->bdb_cache_size / BDB_GIGABYTE),
+						(cob_u32_t)(cobsetptr->bdb_cache_size % BDB_GIGABYTE),
+						(int)cobsetptr->bdb_cache_count);
+				}
+				/* TODO: add national compare function later */
+#ifdef USE_BDB_KEYDIFF
+				p->db[i]->set_bt_compare(p->db[i], bdb_bt_compare);
+#else
+				if (f->keys[i].collating_sequence) {
+					p->db[i]->set_bt_compare(p->db[i], bdb_bt_compare);
+				}
+#endif
+			}
+		} else {
+			handle_created = 0;
+		}
+		/* Open db */
+		if (!ret) {
+			/* FIXME: test "First READ on empty SEQUENTIAL INDEXED file ..."
+			   on OPEN-OUTPUT results with MinGW & BDB 6 in
+			   BDB0588 At least one secondary cursor must be specified to DB->join
+			*/
+			ret = p->db[i]->open (p->db[i], NULL, runtime_buffer, NULL,
+						DB_BTREE, flags, COB_FILE_MODE);
+		}
+		if (ret) {
+			for (j = 0; j < i; ++j) {
+				DB_CLOSE (p->db[j]);
+			}
+			if (handle_created) {
+				DB_CLOSE (p->db[i]);
+			}
+			cob_free (p->db);
+			cob_free (p->last_readkey);
+			cob_free (p->last_dupno);
+			cob_free (p->rewrite_sec_key);
+			cob_free (p->cursor);
+			if (bdb_env != NULL) {
+				unlock_file (f);
+			}
+			cob_free (p);
+			switch (ret) {
+			case DB_LOCK_NOTGRANTED:
+				return COB_STATUS_61_FILE_SHARING;
+			case ENOENT:
+			case ENOTDIR:
+				if (mode == COB_OPEN_EXTEND
+				 || mode == COB_OPEN_OUTPUT) {
+					return COB_STATUS_35_NOT_EXISTS;
+				}
+				if (f->flag_optional) {
+					if (mode == COB_OPEN_I_O) {
+						return COB_STATUS_35_NOT_EXISTS;
+					}
+					f->open_mode = mode;
+					f->flag_nonexistent = 1;
+					f->flag_end_of_file = 1;
+					f->flag_begin_of_file = 1;
+					/* RXWRXW - Check directory exists? */
+					return COB_STATUS_05_SUCCESS_OPTIONAL;
+				}
+				return COB_STATUS_35_NOT_EXISTS;
+			default:
+				return COB_STATUS_30_PERMANENT_ERROR;
+			}
+
+		}
+
+		p->last_readkey[i] = cob_malloc (maxsize);
+		p->last_readkey[f->nkeys + i] = cob_malloc (maxsize);
+	}
+
+	p->temp_key = cob_malloc (maxsize + sizeof (unsigned long));
+	p->savekey  = cob_malloc (maxsize + sizeof (unsigned long));
+	p->suppkey  = cob_malloc (maxsize + sizeof (unsigned long));
+	p->saverec  = cob_malloc (f->record_max + sizeof (unsigned long));
+	f->file = p;
+	p->key_index = 0;
+	p->last_key = NULL;
+
+	memset ((void *)&p->key, 0, sizeof (DBT));
+	memset ((void *)&p->data, 0, sizeof (DBT));
+	p->filename = cob_malloc (strlen (filename) + 1);
+	strcpy (p->filename, filename);
+	p->write_cursor_open = 0;
+	p->nlocks = 0;
+	if (bdb_env != NULL) {
+		bdb_env->lock_id (bdb_env, &p->bdb_lock_id);
+	}
+
+	bdb_setkey (f, 0);
+	p->db[0]->cursor (p->db[0], NULL, &p->cursor[0], 0);
+	ret = DB_SEQ (p->cursor[0], &p->key, &p->data, DB_FIRST);
+	bdb_close_cursor (f);
+	if (!ret) {
+		memcpy (p->last_readkey[0], p->key.data, (size_t)p->key.size);
+		if (p->data.data != NULL
+		 && p->data.size > 0
+		 && p->data.size > f->record_max) {
+			return COB_STATUS_39_CONFLICT_ATTRIBUTE;
+		}
+	} else {
+		p->data.data = NULL;
+	}
+
+	f->open_mode = mode;
+	if (f->flag_optional
+	 && nonexistent
+	 && mode != COB_OPEN_OUTPUT) {
+		return COB_STATUS_05_SUCCESS_OPTIONAL;
+	}
+	return 0;
+
+#elif	defined(WITH_LMDB)
+
+	struct indexed_file	*p;
+	struct lmdb_env		*e;
+	struct stat		st;
+	MDB_txn			*txn;
+	MDB_cursor		*cursor;
+	MDB_val			key, data;
+	char			name[16];
+	int			i;
+	int			maxsize;
+	int			exclusive;
+	int			readonly;
+	int			nonexistent;
+	int			fd;
+	int			rc;
+	int			status;
+
+	COB_UNUSED (sharing);
+
+	cob_chk_file_mapping ();
+
+	/* broken definition, may happen with EXTFH */
+	if (f->nkeys == 0) {
+		return COB_STATUS_30_PERMANENT_ERROR;
+	}
+
+	nonexistent = 0;
+	readonly = 0;
+	if (stat (filename, &st) == -1) {
+		nonexistent = 1;
+		if (mode != COB_OPEN_OUTPUT && f->flag_optional == 0) {
+			return COB_STATUS_35_NOT_EXISTS;
+		}
+		if (mode == COB_OPEN_INPUT) {
+			f->open_mode = mode;
+			f->flag_nonexistent = 1;
+			f->flag_end_of_file = 1;
+			f->flag_begin_of_file = 1;
+			return COB_STATUS_05_SUCCESS_OPTIONAL;
+		}
+	} else if (S_ISDIR (st.st_mode)) {
+		return COB_STATUS_30_PERMANENT_ERROR;
+	} else if (access (filename, W_OK)) {
+		if (mode != COB_OPEN_INPUT) {
+			return COB_STATUS_37_PERMISSION_DENIED;
+		}
+		readonly = 1;
+	}
+	if (mode == COB_OPEN_OUTPUT
+	 || (f->lock_mode & COB_FILE_EXCLUSIVE)
+	 || (!f->lock_mode && mode != COB_OPEN_INPUT)) {
+		exclusive = 1;
+	} else {
+		exclusive = 0;
+	}
+
+	/* Share the environment of the file if it is open already */
+	e = NULL;
+	if (!nonexistent) {
+		for (e = lmdb_env_list; e; e = e->next) {
+			if (e->dev == st.st_dev && e->ino == st.st_ino) {
+				break;
+			}
+		}
+	}
+	if (e != NULL
+	 && (exclusive || e->exclusive)) {
+		return COB_STATUS_61_FILE_SHARING;
+	}
+	if (mode == COB_OPEN_OUTPUT && !nonexistent) {
+		/* Recreate the file, unless another process has it open */
+		fd = open (filename, O_RDWR);
+		if (fd == -1) {
+			return COB_STATUS_30_PERMANENT_ERROR;
+		}
+		if (cob_lock_byte (fd, LMDB_LOCK_OPEN, COB_BYTE_WRITE_LOCK, 0)) {
+			close (fd);
+			return COB_STATUS_61_FILE_SHARING;
+		}
+		indexed_file_delete (f, filename);
+		close (fd);
+		nonexistent = 1;
+	}
+
+	if (e == NULL) {
+		e = cob_malloc (sizeof (struct lmdb_env));
+		e->lock_fd = -1;
+		rc = mdb_env_create (&e->env);
+		if (rc) {
+			e->env = NULL;
+		} else {
+			rc = mdb_env_set_maxdbs (e->env, (MDB_dbi)LMDB_MAX_DBS);
+		}
+		if (!rc) {
+			rc = mdb_env_set_mapsize (e->env, LMDB_MAPSIZE);
+		}
+		if (!rc) {
+			rc = mdb_env_open (e->env, filename,
+				MDB_NOSUBDIR | MDB_NOTLS
+				| (cobsetptr->cob_do_sync ? 0 : MDB_NOSYNC)
+				| (readonly ? MDB_RDONLY : 0), COB_FILE_MODE);
+		}
+		if (!rc) {
+			e->lock_fd = open (filename, readonly ? O_RDONLY : O_RDWR);
+			if (e->lock_fd == -1
+			 || fstat (e->lock_fd, &st) == -1) {
+				rc = errno;
+			}
+		}
+		if (rc) {
+			lmdb_env_release (e);
+			return rc == ENOENT || rc == ENOTDIR
+				? COB_STATUS_35_NOT_EXISTS : lmdb_status (rc);
+		}
+		e->dev = st.st_dev;
+		e->ino = st.st_ino;
+		e->next = lmdb_env_list;
+		lmdb_env_list = e;
+	}
+	if (e->users == NULL
+	 && cob_lock_byte (e->lock_fd, LMDB_LOCK_OPEN,
+			exclusive && !readonly
+			? COB_BYTE_WRITE_LOCK : COB_BYTE_READ_LOCK, 0)) {
+		lmdb_env_release (e);
+		return COB_STATUS_61_FILE_SHARING;
+	}
+
+	p = cob_malloc (sizeof (struct indexed_file));
+	p->dbi = cob_malloc (sizeof (MDB_dbi) * f->nkeys);
+	maxsize = p->primekeylen = bdb_keylen (f, 0);
+	for (i = 1; i < (int)f->nkeys; ++i) {
+		if (bdb_keylen (f, i) > maxsize) {
+			maxsize = bdb_keylen (f, i);
+		}
+	}
+	p->maxkeylen = maxsize;
+
+	/* LMDB limits the size of keys and of the data of DUPSORT entries */
+	status = lmdb_check_keysize (f, e, p->primekeylen);
+	if (status) {
+		cob_free (p->dbi);
+		cob_free (p);
+		lmdb_env_release (e);
+		if (nonexistent) {
+			indexed_file_delete (f, filename);
+		}
+		return status;
+	}
+
+	/* The sub-database of each key, created if needed */
+	rc = lmdb_txn_begin (e, readonly ? MDB_RDONLY : 0, &txn);
+	if (!rc) {
+		for (i = 0; !rc && i < (int)f->nkeys; ++i) {
+			snprintf (name, sizeof (name), "key%d", i);
+			rc = mdb_dbi_open (txn, name,
+				(readonly ? 0 : MDB_CREATE)
+				| (lmdb_hasdups (f, i) ? MDB_DUPSORT : 0), &p->dbi[i]);
+		}
+		if (!rc) {
+			rc = mdb_txn_commit (txn);
+		} else {
+			mdb_txn_abort (txn);
+		}
+	}
+	if (!rc) {
+		rc = lmdb_txn_begin (e, MDB_RDONLY, &p->rtxn);
+	}
+	if (!rc) {
+		/* as for BDB, the first record must fit into the record area */
+		rc = mdb_cursor_open (p->rtxn, p->dbi[0], &cursor);
+		if (!rc) {
+			if (mdb_cursor_get (cursor, &key, &data, MDB_FIRST) == 0
+			 && data.mv_size > f->record_max) {
+				rc = MDB_BAD_VALSIZE;
+			}
+			mdb_cursor_close (cursor);
+		}
+		if (rc) {
+			mdb_txn_abort (p->rtxn);
+		}
+	}
+	if (rc) {
+		cob_free (p->dbi);
+		cob_free (p);
+		lmdb_env_release (e);
+		return rc == MDB_NOTFOUND ? COB_STATUS_39_CONFLICT_ATTRIBUTE : lmdb_status (rc);
+	}
+	mdb_txn_reset (p->rtxn);
+
+	p->savekey  = cob_malloc ((size_t)maxsize);
+	p->suppkey  = cob_malloc ((size_t)maxsize);
+	p->pos_key  = cob_malloc ((size_t)maxsize);
+	p->pos_data = cob_malloc ((size_t)p->primekeylen + LMDB_DUPNO_LEN);
+	p->primdata = cob_malloc ((size_t)p->primekeylen + LMDB_DUPNO_LEN);
+	p->prim_key = cob_malloc ((size_t)p->primekeylen);
+	p->saverec  = cob_malloc (f->record_max + 1);
+	p->envp = e;
+	p->next_user = e->users;
+	e->users = p;
+	e->exclusive = exclusive;
+	f->file = p;
+	f->curkey = -1;
+
+	f->open_mode = mode;
+	if (f->flag_optional
+	 && nonexistent
+	 && mode != COB_OPEN_OUTPUT) {
+		return COB_STATUS_05_SUCCESS_OPTIONAL;
+	}
+	return 0;
+
+#else
+	static int first_idx_open = 1;
+
+	COB_UNUSED (f);
+	COB_UNUSED (filename);
+	COB_UNUSED (sharing);
+	COB_UNUSED (mode);
+
+	if (first_idx_open) {
+		first_idx_open = 0;
+		cob_runtime_warning (_("runtime is not configured to support %s"),
+			"ORGANIZATION INDEXED");
+	}
+	return COB_STATUS_91_NOT_AVAILABLE;
+#endif
+}
+
+/* Close the INDEXED file */
+
+static int
+indexed_close (cob_file *f, const int opt)
+{
+#ifdef	WITH_INDEX_EXTFH
+
+	return extfh_indexed_close (f, opt);
+
+#elif	defined(WITH_ANY_ISAM)
+
+	struct indexfile	*fh = f->file;
+
+	COB_UNUSED (opt);
+
+	if (fh == NULL) {
+		/* should we raise COB_STATUS_42_NOT_OPEN ? */
+		return COB_STATUS_30_PERMANENT_ERROR;
+	}
+	if (fh->isfd >= 0) {
+#ifdef	COB_NATIVE_ISAM
+		if (cobsetptr->cob_read_ahead_stats) {
+			cob_isam_read_stats (&fh->isstat, fh->isfd,
+					     f->select_name);
+		}
+#endif
+		isfullclose (fh->isfd);
+	}
+	freefh (fh);
+	f->file = NULL;
+	return COB_STATUS_00_SUCCESS;
+
+#elif	defined(WITH_DB)
+
+	struct indexed_file	*p = f->file;
+	int			i;
+
+	COB_UNUSED (opt);
+
+	/* Close DB's */
+	if (p == NULL) {
+		/* should we raise COB_STATUS_42_NOT_OPEN ? */
+		return COB_STATUS_30_PERMANENT_ERROR;
+	}
+	for (i = 0; i < (int)f->nkeys; ++i) {
+		if (p->cursor[i]) {
+			bdb_close_index (f, i);
+		}
+	}
+	for (i = (int)f->nkeys - 1; i >= 0; --i) {
+		if (p->db[i]) {
+			if (cobsetptr->bdb_stats
+			 && bdb_env == NULL) {
+				bdb_add_cache_stats (p->db[i]->get_env (p->db[i]));
+			}
+			DB_CLOSE (p->db[i]);
+		}
+		cob_free (p->last_readkey[i]);
+		cob_free (p->last_readkey[f->nkeys + i]);
+	}
+
+	if (p->last_key) {
+		cob_free (p->last_key);
+	}
+	cob_free (p->temp_key);
+	cob_free (p->savekey);
+	cob_free (p->suppkey);
+	cob_free (p->saverec);
+	cob_free (p->db);
+	cob_free (p->last_readkey);
+	cob_free (p->last_dupno);
+	cob_free (p->rewrite_sec_key);
+	cob_free (p->filename);
+	cob_free (p->cursor);
+	if (bdb_env != NULL) {
+#if 1	/* CHECMKE: removed in RW-Branch with r1313 */
+		unlock_record (f);
+		unlock_file (f);
+#endif
+		bdb_env->lock_id_free (bdb_env, p->bdb_lock_id);
+	}
+	if (p->bdb_record_locks) {
+		cob_free (p->bdb_record_locks);
+	}
+	cob_free (p);
+	f->file = NULL;
+
+	return COB_STATUS_00_SUCCESS;
+
+#elif	defined(WITH_LMDB)
+
+	struct indexed_file	*p = f->file;
+	struct indexed_file	**u;
+
+	COB_UNUSED (opt);
+
+	if (p == NULL) {
+		/* should we raise COB_STATUS_42_NOT_OPEN ? */
+		return COB_STATUS_30_PERMANENT_ERROR;
+	}
+	lmdb_unlock_record (f);
+	mdb_txn_abort (p->rtxn);
+	for (u = &p->envp->users; *u; u = &(*u)->next_user) {
+		if (*u == p) {
+			*u = p->next_user;
+			break;
+		}
+	}
+	lmdb_env_release (p->envp);
+
+	if (p->last_key) {
+		cob_free (p->last_key);
+	}
+	cob_free (p->savekey);
+	cob_free (p->suppkey);
+	cob_free (p->pos_key);
+	cob_free (p->pos_data);
+	cob_free (p->primdata);
+	cob_free (p->prim_key);
+	cob_free (p->saverec);
+	cob_free (p->dbi);
+	if (p->lock_hash) {
+		cob_free (p->lock_hash);
+	}
+	cob_free (p);
+	f->file = NULL;
+
+	return COB_STATUS_00_SUCCESS;
+
+#else
+	COB_UNUSED (f);
+	COB_UNUSED (opt);
+
+	return COB_STATUS_91_NOT_AVAILABLE;
+
+#endif
+}
+
+
+/* START INDEXED file with positioning */
+
+static int
+indexed_start (cob_file *f, const int cond, cob_field *key)
+{
+#ifdef	WITH_INDEX_EXTFH
+
+	return extfh_indexed_start (f, cond, key);
+
+#elif	defined(WITH_ANY_ISAM)
+
+	struct indexfile	*fh = f->file;
+	int			k;
+	int			mode;
+	int			klen,fullkeylen,partlen;
+	int			savecond;
+	struct keydesc *keyd;
+
+	f->flag_read_done = 0;
+	f->flag_first_read = 0;
+	fh->readdone = 0;
+	fh->eofpending = 0;
+	fh->startiscur = 0;
+	fh->wrkhasrec = 0;
+	if (f->flag_nonexistent) {
+		return COB_STATUS_23_KEY_NOT_EXISTS;
+	}
+	k = cob_findkey_attr (f, key, &fullkeylen, &partlen);
+
+			 /************************************************************/
+			 /*                                                          */
+			 /*  here we are storing the partial key length in the       */
+			 /*  indexfile structure so that the indexed read next       */
+			 /*  functions can position the file based on the partial    */
+			 /*  key length.                                             */
+			 /*                                                          */
+			 /*  note the indexed_cmpkey function expects a partial key  */
+			 /*  length of zero if it is to use the full key length.     */
+			 /*                                                          */
+			 /************************************************************/
+
+	if (fullkeylen == partlen)
+			fh->partial_key_length  = 0;
+	else
+			fh->partial_key_length  = partlen;
+
+	if (k < 0) {
+		return COB_STATUS_23_KEY_NOT_EXISTS;
+	}
+	f->mapkey = k;
+	keyd = &fh->key[k];
+	/* Use size of data field; This may indicate a partial key */
+	klen = partlen;
+	if (klen < 1 || klen > fullkeylen) {
+		/* Max key length for this index */
+		klen = fullkeylen;
+	}
+	mode = ISGTEQ;
+	fh->startiscur = 1;
+	savecond = cond;
+	switch (cond) {
+	case COB_EQ:
+		mode = ISEQUAL;
+		fh->readdir = ISNEXT;
+		break;
+	case COB_GE:
+		mode = ISGTEQ;
+		fh->readdir = ISNEXT;
+		break;
+	case COB_GT:
+		mode = ISGREAT;
+		fh->readdir = ISNEXT;
+		break;
+	case COB_LE:
+		mode = ISGTEQ;
+		fh->readdir = ISPREV;
+		break;
+	case COB_LT:
+		mode = ISGTEQ;
+		fh->readdir = ISPREV;
+		break;
+	case COB_FI:
+		mode = ISFIRST;
+		fh->readdir = ISNEXT;
+		break;
+	case COB_LA:
+		mode = ISLAST;
+		fh->readdir = ISPREV;
+		break;
+	default:
+		return COB_STATUS_21_KEY_INVALID;
+	}
+	if (isstart (fh->isfd, keyd, klen, (void *)f->record->data, mode)) {
+		if (cond == COB_LE || cond == COB_LT) {
+			if (isstart (fh->isfd, keyd, klen, (void *)f->record->data, ISLAST)) {
+				f->curkey = -1;
+				f->mapkey = -1;
+				fh->startcond = -1;
+				fh->readdir = -1;
+				fh->startiscur = 0;
+				return fisretsts (fh, COB_STATUS_23_KEY_NOT_EXISTS);
+			} else {
+				savecond = COB_LA;
+			}
+		} else {
+			f->curkey = -1;
+			f->mapkey = -1;
+			fh->startcond = -1;
+			fh->readdir = -1;
+			fh->startiscur = 0;
+			return fisretsts (fh, COB_STATUS_23_KEY_NOT_EXISTS);
+		}
+	}
+	fh->startcond = savecond;
+	indexed_savekey (fh, f->record->data, k);
+	f->curkey = k;
+	f->flag_end_of_file = 0;
+	f->flag_begin_of_file = 0;
+	f->flag_first_read = 1;
+	return COB_STATUS_00_SUCCESS;
+
+#elif	defined(WITH_DB)
+
+	return indexed_start_internal (f, cond, key, 0, 0);
+
+#elif	defined(WITH_LMDB)
+
+	struct indexed_file	*p = f->file;
+	MDB_cursor		*cursor;
+	MDB_val			k, d;
+	int			idx;
+	int			rc, ret;
+
+	p->pos_valid = 0;
+	rc = lmdb_read_begin (p);
+	if (rc) {
+		return lmdb_status (rc);
+	}
+	ret = lmdb_start_internal (f, cond, key, &idx, &cursor);
+	if (ret == COB_STATUS_00_SUCCESS
+	 && mdb_cursor_get (cursor, &k, &d, MDB_GET_CURRENT) == 0) {
+		lmdb_savepos (f, idx, &k, &d);
+	}
+	if (cursor) {
+		mdb_cursor_close (cursor);
+	}
+	mdb_txn_reset (p->rtxn);
+	return ret;
+
+#else
+	COB_UNUSED (f);
+	COB_UNUSED (cond);
+	COB_UNUSED (key);
+
+	return COB_STATUS_91_NOT_AVAILABLE;
+#endif
+}
+
+/* Random READ of the INDEXED file  */
+
+static int
+indexed_read (cob_file *f, cob_field *key, const int read_opts)
+{
+#ifdef	WITH_INDEX_EXTFH
+
+	return extfh_indexed_read (f, key, read_opts);
+
+#elif	defined(WITH_ANY_ISAM)
+
+	struct indexfile	*fh;
+	int			k,fullkeylen,partlen;
+	int			ret;
+	int			lmode;
+
+	fh = f->file;
+	fh->eofpending = 0;
+	fh->startiscur = 0;
+	fh->wrkhasrec = 0;
+	if (f->flag_nonexistent) {
+		return COB_STATUS_23_KEY_NOT_EXISTS;
+	}
+	k = cob_findkey_attr (f, key, &fullkeylen, &partlen);
+	if (k < 0) {
+		return COB_STATUS_23_KEY_NOT_EXISTS;
+	}
+	f->mapkey = k;
+	if (f->curkey != (int)k) {
+		/* Switch to this index */
+		isstart (fh->isfd, &fh->key[k], 0,
+			 (void *)f->record->data, ISEQUAL);
+		f->curkey = k;
+		fh->wrkhasrec = 0;
+	}
+	fh->startcond = -1;
+	lmode = 0;
+	if (read_opts & COB_READ_LOCK) {
+		lmode = ISLOCK;
+	} else if (read_opts & COB_READ_WAIT_LOCK) {
+		lmode = ISLCKW;
+	} else if ((f->lock_mode & COB_LOCK_AUTOMATIC)) {
+		if (f->open_mode != COB_OPEN_INPUT) {
+			if (!(read_opts & COB_READ_IGNORE_LOCK)) {
+				lmode = ISLOCK;
+			}
+		}
+	}
+#ifdef	ISSKIPLOCK
+	if (read_opts & COB_READ_IGNORE_LOCK) {
+		lmode = ISSKIPLOCK;
+	}
+#endif
+	if ((fh->lmode & ISLOCK) && !(f->lock_mode & COB_LOCK_MULTIPLE)) {
+		isrelease (fh->isfd);
+	}
+	ISERRNO = 0;
+	fh->readdir = -1;
+	ret = COB_STATUS_00_SUCCESS;
+	if (isread (fh->isfd, (void *)f->record->data, ISEQUAL | lmode)) {
+		ret = fisretsts (fh, COB_STATUS_21_KEY_INVALID);
+	}
+	if (unlikely (ret != 0)) {
+		memset (fh->savekey, 0, fh->lenkey);
+		fh->recnum = 0;
+		fh->readdone = 0;
+		return ret;
+	}
+	f->flag_first_read = 0;
+	f->flag_read_done = 1;
+	fh->readdone = 1;
+	f->flag_end_of_file = 0;
+	f->flag_begin_of_file = 0;
+	indexed_savekey (fh, f->record->data, 0);
+	fh->recnum = ISRECNUM;
+#ifdef	ISVARLEN
+	if (f->record_min != f->record_max) {
+		f->record->size = ISRECLEN;
+	}
+#endif
+	return 0;
+
+#elif	defined(WITH_DB)
+
+	struct indexed_file	*p = f->file;
+	int			ret;
+	int			bdb_opts;
+	int			test_lock;
+
+	test_lock = 0;
+	bdb_opts = read_opts;
+	if (bdb_env != NULL) {
+		if (f->open_mode != COB_OPEN_I_O
+		 ||(f->lock_mode & COB_FILE_EXCLUSIVE)) {
+			bdb_opts &= ~COB_READ_LOCK;
+		} else
+		if ((f->lock_mode & COB_LOCK_AUTOMATIC)
+		 && !(bdb_opts & COB_READ_NO_LOCK)) {
+			bdb_opts |= COB_READ_LOCK;
+		}
+		if (!(f->lock_mode & COB_LOCK_MULTIPLE)) {
+			unlock_record (f);
+		}
+		test_lock = 1;
+	} else {
+		bdb_opts &= ~COB_READ_LOCK;
+	}
+
+	ret = indexed_start_internal (f, COB_EQ, key, bdb_opts, test_lock);
+	if (ret != COB_STATUS_00_SUCCESS) {
+		return ret;
+	}
+
+	f->record->size = p->data.size;
+	if (f->record->size > f->record_max) {
+		f->record->size = f->record_max;
+		ret = COB_STATUS_43_READ_NOT_DONE;
+	} else {
+		ret = COB_STATUS_00_SUCCESS;
+	}
+	memcpy (f->record->data, p->data.data, f->record->size);
+
+	return ret;
+
+#elif	defined(WITH_LMDB)
+
+	struct indexed_file	*p = f->file;
+	MDB_cursor		*cursor;
+	int			opts = read_opts;
+	int			test_lock;
+	int			idx;
+	int			rc, ret;
+
+	test_lock = lmdb_read_opts (f, &opts);
+	do {
+		rc = lmdb_read_begin (p);
+		if (rc) {
+			return lmdb_status (rc);
+		}
+		ret = lmdb_start_internal (f, COB_EQ, key, &idx, &cursor);
+		if (ret == COB_STATUS_00_SUCCESS) {
+			ret = lmdb_fetch (f, idx, cursor, opts, test_lock, 0);
+		}
+		if (cursor) {
+			mdb_cursor_close (cursor);
+		}
+		mdb_txn_reset (p->rtxn);
+	} while (ret == LMDB_RETRY);
+	return ret;
+
+#else
+	COB_UNUSED (f);
+	COB_UNUSED (key);
+	COB_UNUSED (read_opts);
+
+	return COB_STATUS_91_NOT_AVAILABLE;
+#endif
+}
+
+/* Sequential READ of the INDEXED file */
+
+static int
+indexed_read_next (cob_file *f, const int read_opts)
+{
+#ifdef	WITH_INDEX_EXTFH
+
+	return extfh_indexed_read_next (f, read_opts);
+
+#elif	defined(WITH_ANY_ISAM)
+
+	struct indexfile	*fh;
+	int			ret;
+	int			lmode;
+	int			domoveback;
+
+	fh = f->file;
+	ret = COB_STATUS_00_SUCCESS;
+	lmode = 0;
+
+	if (f->curkey == -1) {
+		/* Switch to primary index */
+		isstart (fh->isfd, &fh->key[0], 0, NULL, ISFIRST);
+		f->curkey = 0;
+		fh->readdir = ISNEXT;
+		fh->startcond = -1;
+		fh->startiscur = 0;
+		fh->wrkhasrec = 0;
+	}
+	if (read_opts & COB_READ_LOCK) {
+		lmode = ISLOCK;
+	} else if (read_opts & COB_READ_WAIT_LOCK) {
+		lmode = ISLCKW;
+	} else
+	if ((f->lock_mode & COB_LOCK_AUTOMATIC)
+	 && f->open_mode != COB_OPEN_INPUT) {
+		if (!(read_opts & COB_READ_IGNORE_LOCK)) {
+			lmode = ISLOCK;
+		}
+	}
+#ifdef	ISSKIPLOCK
+	if (read_opts & COB_READ_IGNORE_LOCK) {
+		lmode |= ISSKIPLOCK;
+	}
+#endif
+	if ((fh->lmode & ISLOCK) && !(f->lock_mode & COB_LOCK_MULTIPLE)) {
+		isrelease (fh->isfd);
+	}
+	ISERRNO = 0;
+	ret = COB_STATUS_00_SUCCESS;
+	switch (read_opts & COB_READ_MASK) {
+	case COB_READ_NEXT:
+		fh->readdir = ISNEXT;
+		if (fh->eofpending == ISNEXT) {
+			fh->eofpending = 0;
+			fh->wrkhasrec = 0;
+			return COB_STATUS_10_END_OF_FILE;
+		}
+		if (fh->startiscur) {
+			if (fh->startcond == COB_LA) {
+				if (isread (fh->isfd, (void *)f->record->data, ISLAST | lmode)) {
+					ret = fisretsts (fh, COB_STATUS_10_END_OF_FILE);
+				}
+			} else if (fh->startcond == COB_FI) {
+				if (isread (fh->isfd, (void *)f->record->data, ISFIRST | lmode)) {
+					ret = fisretsts (fh, COB_STATUS_10_END_OF_FILE);
+				}
+			} else if (isread (fh->isfd, (void *)f->record->data, ISCURR)) {
+				ret = fisretsts (fh, COB_STATUS_10_END_OF_FILE);
+			} else {
+				switch (fh->startcond) {
+				case COB_GE:
+					domoveback = 0;
+					while (ISERRNO == 0
+					&& indexed_cmpkey(fh, f->record->data, f->curkey, fh->partial_key_length) == 0) {
+						isread (fh->isfd, (void *)f->record->data, ISPREV);
+						domoveback = 1;
+					}
+					if (domoveback) {
+						isread (fh->isfd, (void *)f->record->data, ISERRNO == 0 ? ISNEXT : ISFIRST);
+					}
+					break;
+				case COB_LE:
+					domoveback = 0;
+					while (ISERRNO == 0
+					&& indexed_cmpkey(fh, f->record->data, f->curkey, fh->partial_key_length) == 0) {
+						isread (fh->isfd, (void *)f->record->data, ISNEXT);
+						domoveback = 1;
+					}
+					if (domoveback) {
+						isread (fh->isfd, (void *)f->record->data, ISERRNO == 0 ? ISPREV : ISLAST);
+					}
+					break;
+				case COB_LT:
+#if 0	/* CHECKME, not in GC4 */
+					isread (fh->isfd, (void *)f->record->data, ISPREV);
+#endif
+					while (ISERRNO == 0
+					&& indexed_cmpkey(fh, f->record->data, f->curkey, fh->partial_key_length) >= 0) {
+						isread (fh->isfd, (void *)f->record->data, ISPREV);
+					}
+					break;
+				case COB_GT:
+					while (ISERRNO == 0
+					&& indexed_cmpkey(fh, f->record->data, f->curkey, fh->partial_key_length) <= 0) {
+						isread (fh->isfd, (void *)f->record->data, ISNEXT);
+					}
+					break;
+				}
+				if (isread (fh->isfd, (void *)f->record->data, ISCURR | lmode)) {
+					ret = fisretsts (fh, COB_STATUS_10_END_OF_FILE);
+				}
+			}
+			fh->startcond = -1;
+			fh->startiscur = 0;
+		} else if (fh->wrkhasrec == ISNEXT) {
+			memcpy (f->record->data, fh->recwrk, f->record_max);
+			if (fh->lmode & ISLOCK) {
+				/* Now lock 'peek ahead' record */
+				if (isread (fh->isfd, (void *)f->record->data, ISCURR | fh->lmode)) {
+					ret = fisretsts (fh, COB_STATUS_10_END_OF_FILE);
+				}
+			}
+		} else {
+			if (fh->wrkhasrec == ISPREV) {
+				isread (fh->isfd, (void *)f->record->data, ISNEXT);
+				fh->wrkhasrec = 0;
+			}
+			if (isread (fh->isfd, (void *)f->record->data, ISNEXT | lmode)) {
+				ret = fisretsts (fh, COB_STATUS_10_END_OF_FILE);
+			}
+		}
+		break;
+	case COB_READ_PREVIOUS:
+		fh->readdir = ISPREV;
+		if (fh->eofpending == ISPREV) {
+			fh->eofpending = 0;
+			fh->wrkhasrec = 0;
+			return COB_STATUS_10_END_OF_FILE;
+		}
+		if (fh->startiscur) {
+			if (fh->startcond == COB_FI) {
+				if (isread (fh->isfd, (void *)f->record->data, ISFIRST | lmode)) {
+					ret = fisretsts (fh, COB_STATUS_10_END_OF_FILE);
+				}
+			} else if (fh->startcond == COB_LA) {
+				if (isread (fh->isfd, (void *)f->record->data, ISLAST | lmode)) {
+					ret = fisretsts (fh, COB_STATUS_10_END_OF_FILE);
+				}
+			} else if (isread (fh->isfd, (void *)f->record->data, ISCURR | lmode)) {
+				ret = fisretsts (fh, COB_STATUS_10_END_OF_FILE);
+			} else {
+				switch (fh->startcond) {
+				case COB_LE:
+					if(indexed_cmpkey(fh, f->record->data, f->curkey, fh->partial_key_length) > 0)
+						domoveback = 1;
+					else
+						domoveback = 0;
+					while (ISERRNO == 0
+					&& indexed_cmpkey(fh, f->record->data, f->curkey, fh->partial_key_length) == 0) {
+						isread (fh->isfd, (void *)f->record->data, ISNEXT);
+						domoveback = 1;
+					}
+					if (domoveback) {
+						isread (fh->isfd, (void *)f->record->data, ISPREV);
+					}
+					break;
+				case COB_LT:
+					while (ISERRNO == 0
+					&& indexed_cmpkey(fh, f->record->data, f->curkey, fh->partial_key_length) >= 0) {
+						isread (fh->isfd, (void *)f->record->data, ISPREV);
+					}
+					break;
+				case COB_GT:
+					while (ISERRNO == 0
+					&& indexed_cmpkey(fh, f->record->data, f->curkey, fh->partial_key_length) <= 0) {
+						isread (fh->isfd, (void *)f->record->data, ISNEXT);
+					}
+					break;
+				case COB_GE:
+					while (ISERRNO == 0
+					&& indexed_cmpkey(fh, f->record->data, f->curkey, fh->partial_key_length) < 0) {
+						isread (fh->isfd, (void *)f->record->data, ISNEXT);
+					}
+					break;
+				}
+				if (isread (fh->isfd, (void *)f->record->data, ISCURR | lmode)) {
+					ret = fisretsts (fh, COB_STATUS_10_END_OF_FILE);
+				}
+			}
+			fh->startcond = -1;
+			fh->startiscur = 0;
+		} else if (fh->wrkhasrec == ISPREV) {
+			memcpy (f->record->data, fh->recwrk, f->record_max);
+			if (fh->lmode & ISLOCK) {
+				/* Now lock 'peek ahead' record */
+				if (isread (fh->isfd, (void *)f->record->data,
+				    ISCURR | fh->lmode)) {
+					ret = fisretsts (fh, COB_STATUS_10_END_OF_FILE);
+				}
+			}
+		} else {
+			if (fh->wrkhasrec == ISNEXT) {
+				isread (fh->isfd, (void *)f->record->data, ISPREV);
+				fh->wrkhasrec = 0;
+			}
+			if (isread (fh->isfd, (void *)f->record->data, ISPREV | lmode)) {
+				ret = fisretsts (fh, COB_STATUS_10_END_OF_FILE);
+			}
+		}
+		break;
+	case COB_READ_FIRST:
+		fh->readdir = ISNEXT;
+		if (isread (fh->isfd, (void *)f->record->data, ISFIRST | lmode)) {
+			ret = fisretsts (fh, COB_STATUS_10_END_OF_FILE);
+		}
+		break;
+	case COB_READ_LAST:
+		fh->readdir = ISPREV;
+		if (isread (fh->isfd, (void *)f->record->data, ISLAST | lmode)) {
+			ret = fisretsts (fh, COB_STATUS_10_END_OF_FILE);
+		}
+		break;
+	default:
+		fh->readdir = ISNEXT;
+		if (isread (fh->isfd, (void *)f->record->data, ISNEXT | lmode)) {
+			ret = fisretsts (fh, COB_STATUS_10_END_OF_FILE);
+		}
+		break;
+	}
+	if (unlikely (ret != 0)) {
+		memset (fh->savekey, 0, fh->lenkey);
+		fh->recnum = 0;
+		fh->readdone = 0;
+		fh->wrkhasrec = 0;
+		return ret;
+	}
+	fh->eofpending = 0;
+	f->flag_first_read = 0;
+	f->flag_read_done = 1;
+	fh->readdone = 1;
+	f->flag_end_of_file = 0;
+	f->flag_begin_of_file = 0;
+	indexed_savekey (fh, f->record->data, 0);
+	fh->recnum = ISRECNUM;
+#ifdef	ISVARLEN
+	if (f->record_min != f->record_max) {
+		f->record->size = ISRECLEN;
+	}
+#endif
+
+#ifdef	COB_WITH_STATUS_02
+	if (isstat1 == '0'
+	 && isstat2 == '2') {
+		return COB_STATUS_02_SUCCESS_DUPLICATE;
+	}
+#endif
+	return COB_STATUS_00_SUCCESS;
+
+#elif	defined(WITH_DB)
+
+	struct indexed_file	*p = f->file;
+	int			ret;
+	int			read_nextprev;
+	cob_u32_t		nextprev;
+	int			file_changed;
+	int			bdb_opts;
+	unsigned int		dupno;
+
+	nextprev = DB_NEXT;
+	dupno = 0;
+	file_changed = 0;
+
+	bdb_opts = read_opts;
+	if (bdb_env != NULL) {
+		if (f->open_mode != COB_OPEN_I_O
+		 || (f->lock_mode & COB_FILE_EXCLUSIVE)) {
+			bdb_opts &= ~COB_READ_LOCK;
+		} else
+		if ((f->lock_mode & COB_LOCK_AUTOMATIC)
+		 && !(bdb_opts & COB_READ_NO_LOCK)) {
+			bdb_opts |= COB_READ_LOCK;
+		}
+		if (!(f->lock_mode & COB_LOCK_MULTIPLE)) {
+			unlock_record (f);
+		}
+	} else {
+		bdb_opts &= ~COB_READ_LOCK;
+	}
+
+	if (unlikely (bdb_opts & COB_READ_PREVIOUS)) {
+		if (f->flag_end_of_file) {
+			nextprev = DB_LAST;
+		} else {
+			nextprev = DB_PREV;
+		}
+	} else if (f->flag_begin_of_file) {
+		nextprev = DB_FIRST;
+	}
+	/* The open cursor makes this function atomic */
+	if (p->key_index != 0) {
+		p->db[0]->cursor (p->db[0], NULL, &p->cursor[0], 0);
+	}
+	p->db[p->key_index]->cursor (p->db[p->key_index], NULL, &p->cursor[p->key_index], 0);
+
+	if (f->flag_first_read) {
+		/* Data is read in indexed_open or indexed_start */
+		if (p->data.data == NULL
+		 || (f->flag_first_read == 2 && nextprev == DB_PREV)) {
+			bdb_close_index (f, p->key_index);
+			if (p->key_index != 0) {
+				bdb_close_cursor (f);
+			}
+			return COB_STATUS_10_END_OF_FILE;
+		}
+		/* Check if previously read data still exists */
+		p->key.size = (cob_dbtsize_t) bdb_keylen(f,p->key_index);
+		p->key.data = p->last_readkey[p->key_index];
+		bdb_setkeycol (f, p->key_index);
+		ret = DB_SEQ (p->cursor[p->key_index], &p->key, &p->data, DB_SET);
+		if (!ret && p->key_index > 0) {
+			if (f->keys[p->key_index].tf_duplicates) {
+				memcpy (&dupno, (cob_u8_ptr)p->data.data + p->primekeylen, sizeof (unsigned int));
+				dupno = COB_DUPSWAP (dupno);
+				while (ret == 0
+				   && memcmp (p->key.data, p->last_readkey[p->key_index], (size_t)p->key.size) == 0
+				   && dupno < p->last_dupno[p->key_index]) {
+					ret = DB_SEQ (p->cursor[p->key_index], &p->key, &p->data, DB_NEXT);
+					memcpy (&dupno, (cob_u8_ptr)p->data.data + p->primekeylen, sizeof (unsigned int));
+					dupno = COB_DUPSWAP (dupno);
+				}
+				if (ret == 0
+				 && memcmp (p->key.data, p->last_readkey[p->key_index], (size_t)p->key.size) == 0
+				 && dupno == p->last_dupno[p->key_index]) {
+					ret = memcmp (p->last_readkey[p->key_index + f->nkeys], p->data.data, p->primekeylen);
+				} else {
+					ret = 1;
+				}
+			} else {
+				ret = memcmp (p->last_readkey[p->key_index + f->nkeys], p->data.data, p->primekeylen);
+			}
+			if (!ret) {
+				p->key.size = (cob_dbtsize_t) p->primekeylen;
+				p->key.data = p->last_readkey[p->key_index + f->nkeys];
+				bdb_setkeycol (f, 0);
+				ret = DB_GET (p->db[0], &p->key, &p->data, 0);
+			}
+		}
+		file_changed = ret;
+		if (bdb_env != NULL && !file_changed) {
+			ret = 0;
+			if (!(bdb_opts & COB_READ_IGNORE_LOCK)) {
+				ret = test_record_lock (f, p->key.data, p->key.size);
+			} else
+			if (bdb_opts & COB_READ_LOCK) {	/* only set when bdb_env != NULL */
+				ret = lock_record (f, p->key.data, p->key.size);
+			}
+			if (ret) {
+				bdb_close_index (f, p->key_index);
+				bdb_close_cursor (f);
+				return COB_STATUS_51_RECORD_LOCKED;
+			}
+		}
+	}
+	if (!f->flag_first_read || file_changed) {
+		if (nextprev == DB_FIRST || nextprev == DB_LAST) {
+			read_nextprev = 1;
+		} else {
+			p->key.size = (cob_dbtsize_t) bdb_keylen (f, p->key_index);
+			p->key.data = p->last_readkey[p->key_index];
+			bdb_setkeycol (f, p->key_index);
+			ret = DB_SEQ (p->cursor[p->key_index], &p->key, &p->data, DB_SET_RANGE);
+			/* ret != 0 possible, records may be deleted since last read */
+			if (ret != 0) {
+				if (nextprev == DB_PREV) {
+					nextprev = DB_LAST;
+					read_nextprev = 1;
+				} else {
+					bdb_close_index (f, p->key_index);
+					if (p->key_index != 0) {
+						bdb_close_cursor (f);
+					}
+					return COB_STATUS_10_END_OF_FILE;
+				}
+			} else {
+				if (memcmp (p->key.data, p->last_readkey[p->key_index], (size_t)p->key.size) == 0) {
+					if (p->key_index > 0
+					 && f->keys[p->key_index].tf_duplicates) {
+						memcpy (&dupno, (cob_u8_ptr)p->data.data + p->primekeylen, sizeof (unsigned int));
+						dupno = COB_DUPSWAP (dupno);
+						while (ret == 0
+						 && memcmp (p->key.data, p->last_readkey[p->key_index], (size_t)p->key.size) == 0
+						 && dupno < p->last_dupno[p->key_index]) {
+							ret = DB_SEQ (p->cursor[p->key_index], &p->key, &p->data, DB_NEXT);
+							memcpy (&dupno, (cob_u8_ptr)p->data.data + p->primekeylen, sizeof (unsigned int));
+							dupno = COB_DUPSWAP (dupno);
+						}
+						if (ret != 0) {
+							if (nextprev == DB_PREV) {
+								nextprev = DB_LAST;
+								read_nextprev = 1;
+							} else {
+								bdb_close_index (f, p->key_index);
+								if (p->key_index != 0) {
+									bdb_close_cursor (f);
+								}
+								return COB_STATUS_10_END_OF_FILE;
+							}
+						} else {
+							if (memcmp (p->key.data, p->last_readkey[p->key_index], (size_t)p->key.size) == 0
+							 && dupno == p->last_dupno[p->key_index]) {
+								read_nextprev = 1;
+							} else {
+								if (nextprev == DB_PREV) {
+									read_nextprev = 1;
+								} else {
+									read_nextprev = 0;
+								}
+							}
+						}
+					} else {
+						read_nextprev = 1;
+					}
+				} else {
+					if (nextprev == DB_PREV) {
+						read_nextprev = 1;
+					} else {
+						read_nextprev = 0;
+					}
+				}
+			}
+		}
+		if (read_nextprev) {
+			ret = DB_SEQ (p->cursor[p->key_index], &p->key, &p->data, nextprev);
+			if (ret != 0) {
+				bdb_close_index (f, p->key_index);
+				if (p->key_index != 0) {
+					bdb_close_cursor (f);
+				}
+				return COB_STATUS_10_END_OF_FILE;
+			}
+		}
+
+		if (p->key_index > 0) {
+			/* Temporarily save alternate key */
+			memcpy (p->temp_key, p->key.data, (size_t)p->key.size);
+			if (f->keys[p->key_index].tf_duplicates) {
+				memcpy (&dupno, (cob_u8_ptr)p->data.data + p->primekeylen, sizeof (unsigned int));
+				dupno = COB_DUPSWAP (dupno);
+			}
+			p->key.data = p->data.data;
+			p->key.size = p->primekeylen;
+			bdb_setkeycol (f, 0);
+			ret = DB_GET (p->db[0], &p->key, &p->data, 0);
+			if (ret != 0) {
+				bdb_close_index (f, p->key_index);
+				bdb_close_cursor (f);
+				return COB_STATUS_23_KEY_NOT_EXISTS;
+			}
+		}
+		if (bdb_env != NULL) {
+			ret = 0;
+			if (!(bdb_opts & COB_READ_IGNORE_LOCK)) {
+				ret = test_record_lock (f, p->key.data, p->key.size);
+			} else
+			if (bdb_opts & COB_READ_LOCK) {	/* only set when bdb_env != NULL */
+				ret = lock_record (f, p->key.data, p->key.size);
+			}
+			if (ret) {
+				bdb_close_index (f, p->key_index);
+				bdb_close_cursor (f);
+				return COB_STATUS_51_RECORD_LOCKED;
+			}
+		}
+		if (p->key_index == 0) {
+			memcpy (p->last_readkey[0], p->key.data, (size_t)p->key.size);
+		} else {
+			memcpy (p->last_readkey[p->key_index], p->temp_key,
+			        bdb_keylen(f,p->key_index));
+			memcpy (p->last_readkey[p->key_index + f->nkeys], p->key.data, p->primekeylen);
+			if (f->keys[p->key_index].tf_duplicates) {
+				p->last_dupno[p->key_index] = dupno;
+			}
+		}
+	}
+
+	f->record->size = p->data.size;
+	if (f->record->size > f->record_max) {
+		f->record->size = f->record_max;
+		ret = COB_STATUS_43_READ_NOT_DONE;
+	} else {
+		ret = COB_STATUS_00_SUCCESS;
+	}
+	memcpy (f->record->data, p->data.data, f->record->size);
+
+	bdb_close_index (f, p->key_index);
+	if (p->key_index != 0) {
+		bdb_close_cursor (f);
+	}
+
+	return ret;
+
+#elif	defined(WITH_LMDB)
+
+	struct indexed_file	*p = f->file;
+	MDB_cursor		*cursor;
+	MDB_val			key, data;
+	int			opts = read_opts;
+	int			test_lock;
+	int			prev;
+	int			rc, ret;
+
+	test_lock = lmdb_read_opts (f, &opts);
+	prev = (opts & COB_READ_PREVIOUS) != 0;
+	do {
+		rc = lmdb_read_begin (p);
+		if (rc) {
+			return lmdb_status (rc);
+		}
+		rc = mdb_cursor_open (p->rtxn, p->dbi[p->key_index], &cursor);
+		if (rc) {
+			mdb_txn_reset (p->rtxn);
+			return lmdb_status (rc);
+		}
+		if (f->flag_first_read) {
+			/* The record of START if it still exists, or the first after OPEN */
+			if (p->pos_valid) {
+				rc = lmdb_position (f, cursor, prev, 1);
+			} else if (f->flag_first_read == 2 && !prev) {
+				rc = mdb_cursor_get (cursor, &key, &data, MDB_FIRST);
+			} else {
+				rc = MDB_NOTFOUND;
+			}
+		} else if (prev && f->flag_end_of_file) {
+			rc = mdb_cursor_get (cursor, &key, &data, MDB_LAST);
+		} else if (p->pos_valid) {
+			rc = lmdb_position (f, cursor, prev, 0);
+		} else {
+			rc = MDB_NOTFOUND;
+		}
+		if (rc == MDB_NOTFOUND) {
+			ret = COB_STATUS_10_END_OF_FILE;
+		} else if (rc) {
+			ret = lmdb_status (rc);
+		} else {
+			ret = lmdb_fetch (f, p->key_index, cursor, opts,
+					  test_lock, 1);
+		}
+		mdb_cursor_close (cursor);
+		mdb_txn_reset (p->rtxn);
+	} while (ret == LMDB_RETRY);
+	return ret;
+
 #else
 	COB_UNUSED (f);
-	COB_UNUSED (key);
 	COB_UNUSED (read_opts);
 
 	return COB_STATUS_91_NOT_AVAILABLE;
 #endif
 }
 
-/* Sequential READ of the INDEXED file */
+
+/* WRITE to the INDEXED file  */
 
 static int
-indexed_read_next (cob_file *f, const int read_opts)
+indexed_write (cob_file *f, const int opt)
 {
 #ifdef	WITH_INDEX_EXTFH
 
-	return extfh_indexed_read_next (f, read_opts);
+	return extfh_indexed_write (f, opt);
+
+#elif	defined(WITH_ANY_ISAM)
+
+	struct indexfile	*fh = f->file;
+
+	COB_UNUSED (opt);
+
+	if (f->flag_nonexistent) {
+		return COB_STATUS_48_OUTPUT_DENIED;
+	}
+	if (f->access_mode == COB_ACCESS_SEQUENTIAL
+	 && indexed_cmpkey (fh, f->record->data, 0, 0) <= 0) {
+		return COB_STATUS_21_KEY_INVALID;
+	}
+
+#ifdef	ISVARLEN
+	if (f->record_min != f->record_max) {
+		ISRECLEN = f->record->size;
+	}
+#endif
+	if (unlikely (iswrite (fh->isfd, (void *)f->record->data))) {
+		if (f->access_mode == COB_ACCESS_SEQUENTIAL
+		 && f->open_mode == COB_OPEN_OUTPUT
+#if 0	/* CHECKME */
+		 && f->flag_set_isam
+#endif
+		 && ISERRNO == EDUPL) {
+			return COB_STATUS_21_KEY_INVALID;
+		}
+		return fisretsts (fh, COB_STATUS_49_I_O_DENIED);
+	}
+	indexed_savekey (fh, f->record->data, 0);
+
+#ifdef	COB_WITH_STATUS_02
+	if (isstat1 == '0'
+	 && isstat2 == '2') {
+		return COB_STATUS_02_SUCCESS_DUPLICATE;
+	}
+#endif
+	return COB_STATUS_00_SUCCESS;
+
+#elif	defined(WITH_DB)
+
+	struct indexed_file	*p = f->file;
+	int			ret;
+
+	if (f->flag_nonexistent) {
+		return COB_STATUS_48_OUTPUT_DENIED;
+	}
+	if (bdb_env != NULL
+	 && !(f->lock_mode & COB_LOCK_MULTIPLE)) {
+		unlock_record (f);
+	}
+
+	/* Check record key */
+	bdb_setkey (f, 0);
+	if (!p->last_key) {
+		p->last_key = cob_malloc ((size_t)p->maxkeylen);
+	} else
+	if (f->access_mode == COB_ACCESS_SEQUENTIAL
+	 && indexed_key_compare (p->last_key,  (unsigned char *)p->key.data, (size_t)p->key.size,
+				 (unsigned char *)DBT_GET_APP_DATA(&p->key)) > 0) {
+		return COB_STATUS_21_KEY_INVALID;
+	}
+	memcpy (p->last_key, p->key.data, (size_t)p->key.size);
+
+	ret = indexed_write_internal (f, 0, opt);
+	bdb_close_cursor (f);
+
+	if (f->access_mode == COB_ACCESS_SEQUENTIAL
+	 && f->open_mode == COB_OPEN_OUTPUT
+#if 0	/* CHECKME */
+	 && f->flag_set_isam
+#endif
+	 && ret == COB_STATUS_22_KEY_EXISTS) {
+		return COB_STATUS_21_KEY_INVALID;
+	}
+	return ret;
+
+#elif	defined(WITH_LMDB)
+
+	struct indexed_file	*p = f->file;
+	int			ret;
+
+	if (f->flag_nonexistent) {
+		return COB_STATUS_48_OUTPUT_DENIED;
+	}
+	if (!p->envp->exclusive
+	 && !(f->lock_mode & COB_LOCK_MULTIPLE)) {
+		lmdb_unlock_record (f);
+	}
+
+	/* Check record key */
+	lmdb_setkey (f, 0);
+	if (!p->last_key) {
+		p->last_key = cob_malloc ((size_t)p->maxkeylen);
+	} else
+	if (f->access_mode == COB_ACCESS_SEQUENTIAL
+	 && memcmp (p->last_key, p->savekey, p->key.mv_size) > 0) {
+		return COB_STATUS_21_KEY_INVALID;
+	}
+	memcpy (p->last_key, p->savekey, p->key.mv_size);
+
+	ret = lmdb_update (f, lmdb_write_internal);
+
+	if (f->access_mode == COB_ACCESS_SEQUENTIAL
+	 && f->open_mode == COB_OPEN_OUTPUT
+	 && ret == COB_STATUS_22_KEY_EXISTS) {
+		return COB_STATUS_21_KEY_INVALID;
+	}
+	if ((opt & COB_WRITE_LOCK)
+	 && !p->envp->exclusive
+	 && (ret == COB_STATUS_00_SUCCESS
+	  || ret == COB_STATUS_02_SUCCESS_DUPLICATE)) {
+		lmdb_setkey (f, 0);
+		if (lmdb_lock_record (f, &p->key, 0)) {
+			return COB_STATUS_51_RECORD_LOCKED;
+		}
+	}
+	return ret;
+
+#else
+	COB_UNUSED (f);
+	COB_UNUSED (opt);
+
+	return COB_STATUS_91_NOT_AVAILABLE;
+#endif
+}
+
+
+/* DELETE record from the INDEXED file  */
+
+static int
+indexed_delete (cob_file *f)
+{
+#ifdef	WITH_INDEX_EXTFH
+
+	return extfh_indexed_delete (f);
 
 #elif	defined(WITH_ANY_ISAM)
 
 	struct indexfile	*fh;
 	int			ret;
-	int			lmode;
-	int			domoveback;
 
 	fh = f->file;
 	ret = COB_STATUS_00_SUCCESS;
-	lmode = 0;
-
+	if (f->flag_nonexistent) {
+		return COB_STATUS_49_I_O_DENIED;
+	}
 	if (f->curkey == -1) {
 		/* Switch to primary index */
-		isstart (fh->isfd, &fh->key[0], 0, NULL, ISFIRST);
+		isstart (fh->isfd, &fh->key[0], 0,
+			 (void *)f->record->data, ISEQUAL);
 		f->curkey = 0;
 		fh->readdir = ISNEXT;
-		fh->startcond = -1;
-		fh->startiscur = 0;
-		fh->wrkhasrec = 0;
-	}
-	if (read_opts & COB_READ_LOCK) {
-		lmode = ISLOCK;
-	} else if (read_opts & COB_READ_WAIT_LOCK) {
-		lmode = ISLCKW;
-	} else
-	if ((f->lock_mode & COB_LOCK_AUTOMATIC)
-	 && f->open_mode != COB_OPEN_INPUT) {
-		if (!(read_opts & COB_READ_IGNORE_LOCK)) {
-			lmode = ISLOCK;
+	} else {
+		savefileposition (f);
+		if (f->curkey != 0) {
+			/* Switch to primary index */
+			isstart (fh->isfd, &fh->key[0], 0,
+				 (void *)f->record->data, ISEQUAL);
 		}
 	}
-#ifdef	ISSKIPLOCK
-	if (read_opts & COB_READ_IGNORE_LOCK) {
-		lmode |= ISSKIPLOCK;
+	if (isread (fh->isfd, (void *)f->record->data, ISEQUAL | ISLOCK)) {
+		ret = fisretsts (fh, COB_STATUS_21_KEY_INVALID);
+	} else if (isdelete (fh->isfd, (void *)f->record->data)) {
+		ret = fisretsts (fh, COB_STATUS_49_I_O_DENIED);
 	}
-#endif
-	if ((fh->lmode & ISLOCK) && !(f->lock_mode & COB_LOCK_MULTIPLE)) {
-		isrelease (fh->isfd);
+	restorefileposition (f);
+	return ret;
+
+#elif	defined(WITH_DB)
+
+	if (f->flag_nonexistent) {
+		return COB_STATUS_49_I_O_DENIED;
 	}
-	ISERRNO = 0;
-	ret = COB_STATUS_00_SUCCESS;
-	switch (read_opts & COB_READ_MASK) {
-	case COB_READ_NEXT:
-		fh->readdir = ISNEXT;
-		if (fh->eofpending == ISNEXT) {
-			fh->eofpending = 0;
-			fh->wrkhasrec = 0;
-			return COB_STATUS_10_END_OF_FILE;
-		}
-		if (fh->startiscur) {
-			if (fh->startcond == COB_LA) {
-				if (isread (fh->isfd, (void *)f->record->data, ISLAST | lmode)) {
-					ret = fisretsts (COB_STATUS_10_END_OF_FILE);
-				}
-			} else if (fh->startcond == COB_FI) {
-				if (isread (fh->isfd, (void *)f->record->data, ISFIRST | lmode)) {
-					ret = fisretsts (COB_STATUS_10_END_OF_FILE);
-				}
-			} else if (isread (fh->isfd, (void *)f->record->data, ISCURR)) {
-				ret = fisretsts (COB_STATUS_10_END_OF_FILE);
-			} else {
-				switch (fh->startcond) {
-				case COB_GE:
-					domoveback = 0;
-					while (ISERRNO == 0
-					&& indexed_cmpkey(fh, f->record->data, f->curkey, fh->partial_key_length) == 0) {
-						isread (fh->isfd, (void *)f->record->data, ISPREV);
-						domoveback = 1;
-					}
-					if (domoveback) {
-						isread (fh->isfd, (void *)f->record->data, ISERRNO == 0 ? ISNEXT : ISFIRST);
-					}
-					break;
-				case COB_LE:
-					domoveback = 0;
-					while (ISERRNO == 0
-					&& indexed_cmpkey(fh, f->record->data, f->curkey, fh->partial_key_length) == 0) {
-						isread (fh->isfd, (void *)f->record->data, ISNEXT);
-						domoveback = 1;
-					}
-					if (domoveback) {
-						isread (fh->isfd, (void *)f->record->data, ISERRNO == 0 ? ISPREV : ISLAST);
-					}
-					break;
-				case COB_LT:
-#if 0	/* CHECKME, not in GC4 */
-					isread (fh->isfd, (void *)f->record->data, ISPREV);
-#endif
-					while (ISERRNO == 0
-					&& indexed_cmpkey(fh, f->record->data, f->curkey, fh->partial_key_length) >= 0) {
-						isread (fh->isfd, (void *)f->record->data, ISPREV);
-					}
-					break;
-				case COB_GT:
-					while (ISERRNO == 0
-					&& indexed_cmpkey(fh, f->record->data, f->curkey, fh->partial_key_length) <= 0) {
-						isread (fh->isfd, (void *)f->record->data, ISNEXT);
-					}
-					break;
-				}
-				if (isread (fh->isfd, (void *)f->record->data, ISCURR | lmode)) {
-					ret = fisretsts (COB_STATUS_10_END_OF_FILE);
-				}
-			}
-			fh->startcond = -1;
-			fh->startiscur = 0;
-		} else if (fh->wrkhasrec == ISNEXT) {
-			memcpy (f->record->data, fh->recwrk, f->record_max);
-			if (fh->lmode & ISLOCK) {
-				/* Now lock 'peek ahead' record */
-				if (isread (fh->isfd, (void *)f->record->data, ISCURR | fh->lmode)) {
-					ret = fisretsts (COB_STATUS_10_END_OF_FILE);
-				}
-			}
-		} else {
-			if (fh->wrkhasrec == ISPREV) {
-				isread (fh->isfd, (void *)f->record->data, ISNEXT);
-				fh->wrkhasrec = 0;
+	return indexed_delete_internal (f, 0);
+
+#elif	defined(WITH_LMDB)
+
+	struct indexed_file	*p = f->file;
+	MDB_val			prim;
+
+	if (f->flag_nonexistent) {
+		return COB_STATUS_49_I_O_DENIED;
+	}
+	if (!p->envp->exclusive) {
+		if (!(f->lock_mode & COB_LOCK_MULTIPLE)) {
+			lmdb_unlock_record (f);
+		}
+		lmdb_curkey (f, &prim);
+		if (lmdb_test_record_lock (f, &prim)) {
+			return COB_STATUS_51_RECORD_LOCKED;
+		}
+	}
+	return lmdb_update (f, lmdb_delete_internal);
+
+#else
+	COB_UNUSED (f);
+
+	return COB_STATUS_91_NOT_AVAILABLE;
+#endif
+}
+
+/* REWRITE record to the INDEXED file  */
+
+static int
+indexed_rewrite (cob_file *f, const int opt)
+{
+#ifdef	WITH_INDEX_EXTFH
+
+	return extfh_indexed_rewrite (f, opt);
+
+#elif	defined(WITH_ANY_ISAM)
+
+	struct indexfile	*fh;
+	size_t			k;
+	int			ret;
+	int			retdup = 0;
+
+	COB_UNUSED (opt);
+
+	fh = f->file;
+	ret = retdup = COB_STATUS_00_SUCCESS;
+	if (f->flag_nonexistent) {
+		return COB_STATUS_49_I_O_DENIED;
+	}
+
+	if (f->access_mode == COB_ACCESS_SEQUENTIAL
+	 && indexed_cmpkey (fh, f->record->data, 0, 0) != 0) {
+		return COB_STATUS_21_KEY_INVALID;
+	}
+	if (f->curkey >= 0) {
+		/* Index is active */
+		/* Save record data */
+		memcpy (fh->recwrk, f->record->data, f->record_max);
+		/* RXWRXW - readdir */
+		fh->readdir = ISNEXT;
+		savefileposition (f);
+		memcpy (fh->recwrk, f->record->data, f->record_max);
+		if (f->curkey != 0) {
+			/* Activate primary index */
+			isstart (fh->isfd, &fh->key[0], fh->key[0].k_len,
+					 (void *)fh->recwrk, ISEQUAL);
+		}
+		/* Verify record exists */
+		if (isread (fh->isfd, (void *)fh->recwrk, ISEQUAL)) {
+			restorefileposition (f);
+			return COB_STATUS_21_KEY_INVALID;
+		}
+		for (k = 1; k < f->nkeys && ret == COB_STATUS_00_SUCCESS; ++k) {
+			struct keydesc *key = &fh->key[k];
+			if (key->k_flags & ISDUPS) {
+				continue;
 			}
-			if (isread (fh->isfd, (void *)f->record->data, ISNEXT | lmode)) {
-				ret = fisretsts (COB_STATUS_10_END_OF_FILE);
+			memcpy (fh->recwrk, f->record->data, f->record_max);
+			isstart (fh->isfd, key, key->k_leng,
+				(void *)fh->recwrk, ISEQUAL);
+			if (!isread (fh->isfd, (void *)fh->recwrk, ISEQUAL)
+			 && ISRECNUM != fh->recnum) {
+				ret = COB_STATUS_22_KEY_EXISTS;
+				break;
 			}
 		}
-		break;
-	case COB_READ_PREVIOUS:
-		fh->readdir = ISPREV;
-		if (fh->eofpending == ISPREV) {
-			fh->eofpending = 0;
-			fh->wrkhasrec = 0;
-			return COB_STATUS_10_END_OF_FILE;
-		}
-		if (fh->startiscur) {
-			if (fh->startcond == COB_FI) {
-				if (isread (fh->isfd, (void *)f->record->data, ISFIRST | lmode)) {
-					ret = fisretsts (COB_STATUS_10_END_OF_FILE);
-				}
-			} else if (fh->startcond == COB_LA) {
-				if (isread (fh->isfd, (void *)f->record->data, ISLAST | lmode)) {
-					ret = fisretsts (COB_STATUS_10_END_OF_FILE);
-				}
-			} else if (isread (fh->isfd, (void *)f->record->data, ISCURR | lmode)) {
-				ret = fisretsts (COB_STATUS_10_END_OF_FILE);
+		if (ret == COB_STATUS_00_SUCCESS) {
+			memcpy (fh->recwrk, f->record->data, f->record_max);
+			isstart (fh->isfd, &fh->key[0], fh->key[0].k_len,
+				(void *)fh->recwrk, ISEQUAL);
+			if (isread (fh->isfd, (void *)fh->recwrk, ISEQUAL | ISLOCK)) {
+				ret = fisretsts (fh, COB_STATUS_49_I_O_DENIED);
 			} else {
-				switch (fh->startcond) {
-				case COB_LE:
-					if(indexed_cmpkey(fh, f->record->data, f->curkey, fh->partial_key_length) > 0)
-						domoveback = 1;
-					else
-						domoveback = 0;
-					while (ISERRNO == 0
-					&& indexed_cmpkey(fh, f->record->data, f->curkey, fh->partial_key_length) == 0) {
-						isread (fh->isfd, (void *)f->record->data, ISNEXT);
-						domoveback = 1;
-					}
-					if (domoveback) {
-						isread (fh->isfd, (void *)f->record->data, ISPREV);
-					}
-					break;
-				case COB_LT:
-					while (ISERRNO == 0
-					&& indexed_cmpkey(fh, f->record->data, f->curkey, fh->partial_key_length) >= 0) {
-						isread (fh->isfd, (void *)f->record->data, ISPREV);
-					}
-					break;
-				case COB_GT:
-					while (ISERRNO == 0
-					&& indexed_cmpkey(fh, f->record->data, f->curkey, fh->partial_key_length) <= 0) {
-						isread (fh->isfd, (void *)f->record->data, ISNEXT);
-					}
-					break;
-				case COB_GE:
-					while (ISERRNO == 0
-					&& indexed_cmpkey(fh, f->record->data, f->curkey, fh->partial_key_length) < 0) {
-						isread (fh->isfd, (void *)f->record->data, ISNEXT);
-					}
-					break;
+#ifdef	ISVARLEN
+				if (f->record_min != f->record_max) {
+					ISRECLEN = f->record->size;
 				}
-				if (isread (fh->isfd, (void *)f->record->data, ISCURR | lmode)) {
-					ret = fisretsts (COB_STATUS_10_END_OF_FILE);
+#endif
+				if (isrewcurr (fh->isfd, (void *)f->record->data)) {
+					ret = fisretsts (fh, COB_STATUS_49_I_O_DENIED);
 				}
 			}
-			fh->startcond = -1;
-			fh->startiscur = 0;
-		} else if (fh->wrkhasrec == ISPREV) {
-			memcpy (f->record->data, fh->recwrk, f->record_max);
-			if (fh->lmode & ISLOCK) {
-				/* Now lock 'peek ahead' record */
-				if (isread (fh->isfd, (void *)f->record->data,
-				    ISCURR | fh->lmode)) {
-					ret = fisretsts (COB_STATUS_10_END_OF_FILE);
-				}
+#ifdef	COB_WITH_STATUS_02
+			if (!ret && (isstat1 == '0') && (isstat2 == '2')) {
+				retdup = COB_STATUS_02_SUCCESS_DUPLICATE;
 			}
+#endif
+		}
+
+		restorefileposition (f);
+
+	} else {	/* Index is not active */
+
+		memcpy (fh->recwrk, f->record->data, f->record_max);
+		if (isread (fh->isfd, (void *)fh->recwrk, ISEQUAL | ISLOCK)) {
+			ret = fisretsts (fh, COB_STATUS_49_I_O_DENIED);
 		} else {
-			if (fh->wrkhasrec == ISNEXT) {
-				isread (fh->isfd, (void *)f->record->data, ISPREV);
-				fh->wrkhasrec = 0;
+#ifdef	ISVARLEN
+			if (f->record_min != f->record_max) {
+				ISRECLEN = f->record->size;
 			}
-			if (isread (fh->isfd, (void *)f->record->data, ISPREV | lmode)) {
-				ret = fisretsts (COB_STATUS_10_END_OF_FILE);
+#endif
+			if (isrewrite (fh->isfd, (void *)f->record->data)) {
+				ret = fisretsts (fh, COB_STATUS_49_I_O_DENIED);
 			}
 		}
-		break;
-	case COB_READ_FIRST:
-		fh->readdir = ISNEXT;
-		if (isread (fh->isfd, (void *)f->record->data, ISFIRST | lmode)) {
-			ret = fisretsts (COB_STATUS_10_END_OF_FILE);
-		}
-		break;
-	case COB_READ_LAST:
-		fh->readdir = ISPREV;
-		if (isread (fh->isfd, (void *)f->record->data, ISLAST | lmode)) {
-			ret = fisretsts (COB_STATUS_10_END_OF_FILE);
+#ifdef	COB_WITH_STATUS_02
+		if (!ret && (isstat1 == '0') && (isstat2 == '2')) {
+			retdup = COB_STATUS_02_SUCCESS_DUPLICATE;
 		}
-		break;
-	default:
-		fh->readdir = ISNEXT;
-		if (isread (fh->isfd, (void *)f->record->data, ISNEXT | lmode)) {
-			ret = fisretsts (COB_STATUS_10_END_OF_FILE);
+#endif
+		if (!ret) {
+			if ((f->lock_mode & COB_LOCK_AUTOMATIC)
+			 && !(f->lock_mode & COB_LOCK_MULTIPLE)) {
+				isrelease (fh->isfd);
+			}
 		}
-		break;
 	}
-	if (unlikely (ret != 0)) {
-		memset (fh->savekey, 0, fh->lenkey);
-		fh->recnum = 0;
-		fh->readdone = 0;
-		fh->wrkhasrec = 0;
+
+	if (retdup) {
+		/* FIXME: use (is_suppressed_key_value) or similar to verify
+		   that the duplicate is not a SUPPRESSed KEY */
+		return COB_STATUS_02_SUCCESS_DUPLICATE;
+	}
+	return ret;
+
+#elif	defined(WITH_DB)
+
+	int		ret;
+
+	if (f->flag_nonexistent) {
+		return COB_STATUS_49_I_O_DENIED;
+	}
+	if (bdb_env != NULL
+	 &&	!(f->lock_mode & COB_LOCK_MULTIPLE)) {
+		unlock_record (f);
+	}
+
+	/* Check duplicate alternate keys */
+	if (check_alt_keys (f, 1)) {
+#if 1	/* CHECKME: removed in RW-Branch r1313 */
+		bdb_close_cursor (f);
+#endif
+		return COB_STATUS_22_KEY_EXISTS;
+	}
+
+	/* Delete the current record */
+	ret = indexed_delete_internal (f, 1);
+
+	if (ret != COB_STATUS_00_SUCCESS) {
+		bdb_close_cursor (f);
+		if (ret == COB_STATUS_23_KEY_NOT_EXISTS) {
+			return COB_STATUS_21_KEY_INVALID;
+		}
 		return ret;
 	}
-	fh->eofpending = 0;
-	f->flag_first_read = 0;
-	f->flag_read_done = 1;
-	fh->readdone = 1;
-	f->flag_end_of_file = 0;
-	f->flag_begin_of_file = 0;
-	indexed_savekey (fh, f->record->data, 0);
-	fh->recnum = ISRECNUM;
-#ifdef	ISVARLEN
-	if (f->record_min != f->record_max) {
-		f->record->size = ISRECLEN;
+
+	/* Write data */
+	bdb_setkey(f, 0);
+	ret = indexed_write_internal (f, 1, opt);
+
+	bdb_close_cursor (f);
+
+	if (bdb_env != NULL) {
+		if (ret == COB_STATUS_00_SUCCESS
+		 || ret == COB_STATUS_02_SUCCESS_DUPLICATE) {
+			if ((f->lock_mode & COB_LOCK_AUTOMATIC)) {
+				if (!(f->lock_mode & COB_LOCK_MULTIPLE)) {
+					unlock_record (f);
+				}
+			} else {
+				if (!(f->lock_mode & COB_LOCK_MULTIPLE)) {
+					if (!(opt & COB_WRITE_LOCK)) {
+						unlock_record (f);
+					}
+				} else
+				if ((opt & COB_WRITE_LOCK)) {
+					unlock_record (f);
+				} else
+				if ((opt & COB_WRITE_NO_LOCK)) {
+					unlock_record (f);
+				}
+			}
+		} else if (ret) {
+			unlock_record (f);
+		}
 	}
-#endif
 
-#ifdef	COB_WITH_STATUS_02
-	if (isstat1 == '0'
-	 && isstat2 == '2') {
-		return COB_STATUS_02_SUCCESS_DUPLICATE;
-	}
-#endif
-	return COB_STATUS_00_SUCCESS;
+	return ret;
 
-#elif	defined(WITH_DB)
+#elif	defined(WITH_LMDB)
 
 	struct indexed_file	*p = f->file;
+	MDB_val			prim;
 	int			ret;
-	int			read_nextprev;
-	cob_u32_t		nextprev;
-	int			file_changed;
-	int			bdb_opts;
-	unsigned int		dupno;
-
-	nextprev = DB_NEXT;
-	dupno = 0;
-	file_changed = 0;
 
-	bdb_opts = read_opts;
-	if (bdb_env != NULL) {
-		if (f->open_mode != COB_OPEN_I_O
-		 || (f->lock_mode & COB_FILE_EXCLUSIVE)) {
-			bdb_opts &= ~COB_READ_LOCK;
-		} else
-		if ((f->lock_mode & COB_LOCK_AUTOMATIC)
-		 && !(bdb_opts & COB_READ_NO_LOCK)) {
-			bdb_opts |= COB_READ_LOCK;
+	if (f->flag_nonexistent) {
+		return COB_STATUS_49_I_O_DENIED;
+	}
+	if (!p->envp->exclusive) {
+		lmdb_curkey (f, &prim);
+		if (lmdb_test_record_lock (f, &prim)) {
+			return COB_STATUS_51_RECORD_LOCKED;
 		}
-		unlock_record (f);
-	} else {
-		bdb_opts &= ~COB_READ_LOCK;
 	}
 
-	if (unlikely (bdb_opts & COB_READ_PREVIOUS)) {
-		if (f->flag_end_of_file) {
-			nextprev = DB_LAST;
-		} else {
-			nextprev = DB_PREV;
+	ret = lmdb_update (f, lmdb_rewrite_internal);
+
+	if (!p->envp->exclusive
+	 && !(f->lock_mode & COB_LOCK_MULTIPLE)) {
+		if (ret == COB_STATUS_00_SUCCESS
+		 || ret == COB_STATUS_02_SUCCESS_DUPLICATE) {
+			if ((f->lock_mode & COB_LOCK_AUTOMATIC)
+			 || !(opt & COB_WRITE_LOCK)) {
+				lmdb_unlock_record (f);
+			}
+		} else if (ret) {
+			lmdb_unlock_record (f);
 		}
-	} else if (f->flag_begin_of_file) {
-		nextprev = DB_FIRST;
 	}
-	/* The open cursor makes this function atomic */
-	if (p->key_index != 0) {
-		p->db[0]->cursor (p->db[0], NULL, &p->cursor[0], 0);
+	return ret;
+
+#else
+	COB_UNUSED (f);
+	COB_UNUSED (opt);
+
+	return COB_STATUS_91_NOT_AVAILABLE;
+#endif
+}
+
+
+static void
+cob_file_unlock (cob_file *f)
+{
+	if (COB_FILE_SPECIAL(f)) {
+		return;
 	}
-	p->db[p->key_index]->cursor (p->db[p->key_index], NULL, &p->cursor[p->key_index], 0);
 
-	if (f->flag_first_read) {
-		/* Data is read in indexed_open or indexed_start */
-		if (p->data.data == NULL
-		 || (f->flag_first_read == 2 && nextprev == DB_PREV)) {
-			bdb_close_index (f, p->key_index);
-			if (p->key_index != 0) {
-				bdb_close_cursor (f);
-			}
-			return COB_STATUS_10_END_OF_FILE;
+	if (f->open_mode != COB_OPEN_CLOSED &&
+	    f->open_mode != COB_OPEN_LOCKED) {
+		if (f->organization == COB_ORG_SORT) {
+			return;
 		}
-		/* Check if previously read data still exists */
-		p->key.size = (cob_dbtsize_t) bdb_keylen(f,p->key_index);
-		p->key.data = p->last_readkey[p->key_index];
-		bdb_setkeycol (f, p->key_index);
-		ret = DB_SEQ (p->cursor[p->key_index], &p->key, &p->data, DB_SET);
-		if (!ret && p->key_index > 0) {
-			if (f->keys[p->key_index].tf_duplicates) {
-				memcpy (&dupno, (cob_u8_ptr)p->data.data + p->primekeylen, sizeof (unsigned int));
-				dupno = COB_DUPSWAP (dupno);
-				while (ret == 0
-				   && memcmp (p->key.data, p->last_readkey[p->key_index], (size_t)p->key.size) == 0
-				   && dupno < p->last_dupno[p->key_index]) {
-					ret = DB_SEQ (p->cursor[p->key_index], &p->key, &p->data, DB_NEXT);
-					memcpy (&dupno, (cob_u8_ptr)p->data.data + p->primekeylen, sizeof (unsigned int));
-					dupno = COB_DUPSWAP (dupno);
+		if (f->organization != COB_ORG_INDEXED) {
+#ifndef	WITH_SEQRA_EXTFH
+			(void)seqbuf_flush (f);
+			if (f->fd >= 0) {
+				fdcobsync (f->fd);
+			}
+#ifdef	HAVE_FCNTL
+			if (REL_SHARED (f)) {
+				relative_unlock_records (f);
+			} else
+			if (!(f->lock_mode & COB_FILE_EXCLUSIVE)) {
+				/* Unlock the file */
+				if (f->fd >= 0) {
+					struct flock	lock;
+					memset ((void *)&lock, 0, sizeof (struct flock));
+					lock.l_type = F_UNLCK;
+					lock.l_whence = SEEK_SET;
+					lock.l_start = 0;
+					lock.l_len = 0;
+					if (fcntl (f->fd, F_SETLK, &lock) == -1) {
+#if 1 /* CHECKME - What is the correct thing to do here? */
+						/* not translated as "testing only" */
+						cob_runtime_warning ("issue during unlock (%s), errno: %d",
+							"cob_file_unlock", errno);
+#endif
+					}
 				}
-				if (ret == 0
-				 && memcmp (p->key.data, p->last_readkey[p->key_index], (size_t)p->key.size) == 0
-				 && dupno == p->last_dupno[p->key_index]) {
-					ret = memcmp (p->last_readkey[p->key_index + f->nkeys], p->data.data, p->primekeylen);
-				} else {
-					ret = 1;
+			}
+#elif defined _WIN32
+			{
+				HANDLE osHandle = (HANDLE)_get_osfhandle (f->fd);
+				if (osHandle != INVALID_HANDLE_VALUE) {
+					if (!UnlockFile (osHandle, 0, 0, MAXDWORD, MAXDWORD)) {
+#if 1 /* CHECKME - What is the correct thing to do here? */
+						/* not translated as "testing only" */
+						cob_runtime_warning ("issue during UnLockFile (%s), lastError: " CB_FMT_LLU,
+							"cob_file_unlock", (cob_u64_t)GetLastError());
+#endif
+					}
 				}
-			} else {
-				ret = memcmp (p->last_readkey[p->key_index + f->nkeys], p->data.data, p->primekeylen);
 			}
-			if (!ret) {
-				p->key.size = (cob_dbtsize_t) p->primekeylen;
-				p->key.data = p->last_readkey[p->key_index + f->nkeys];
-				bdb_setkeycol (f, 0);
-				ret = DB_GET (p->db[0], &p->key, &p->data, 0);
+#endif
+
+#endif
+		} else {
+#ifdef	WITH_INDEX_EXTFH
+			extfh_indexed_unlock (f);
+#elif	defined(WITH_DB) || defined(WITH_LMDB) || defined(WITH_ANY_ISAM)
+			if (f->file) {
+#if	defined(WITH_DB)
+				if (bdb_env != NULL) {
+					unlock_record (f);
+					unlock_file (f);
+				}
+#elif	defined(WITH_LMDB)
+				lmdb_unlock_record (f);
+#else
+				struct indexfile	*fh = f->file;
+				isrelease (fh->isfd);
+#endif
 			}
+#endif
 		}
-		file_changed = ret;
-		if (bdb_env != NULL && !file_changed) {
-			ret = 0;
-			if (!(bdb_opts & COB_READ_IGNORE_LOCK)) {
-				ret = test_record_lock (f, p->key.data, p->key.size);
-			} else
-			if (bdb_opts & COB_READ_LOCK) {	/* only set when bdb_env != NULL */
-				ret = lock_record (f, p->key.data, p->key.size);
-			}
-			if (ret) {
-				bdb_close_index (f, p->key_index);
-				bdb_close_cursor (f);
-				return COB_STATUS_51_RECORD_LOCKED;
-			}
+	}
+}
+
+/* Global functions */
+
+/*
+ * Allocate memory for 'IS EXTERNAL' cob_file
+ */
+void
+cob_file_external_addr (const char *exname,
+		cob_file **pfl, cob_file_key **pky,
+		const int nkeys, const int linage)
+{
+	cob_file	**epfl = cob_external_addr (exname, sizeof (cob_file *));
+
+	if (cobglobptr->cob_initial_external) {
+		/* if the pointer was setup the first time:
+		   allocate the file and store the address for next request */
+		cob_file_malloc (pfl, pky, nkeys, linage);
+		*epfl = *pfl;
+	} else {
+		/* external pointer available - get the address stored
+		   and set / check keys */
+		cob_file	*fl = *pfl = *epfl;
+		/* already allocated, just pass on */
+		if (pky != NULL) {
+			*pky = fl->keys;
+		}
+#if 0	/* TODO: verify file attributes (here or in the caller?) */
+		if (fl->nkeys != nkeys) {
+			/* reallocate if KEYCHECK and bigger / raise exception otherwise ? */
+		}
+		if (linage > 0
+		 && fl->linorkeyptr == NULL) {
+			/* CHECKME: is this allowed to happen? */
+		}
+#endif
+	}
+}
+
+/*
+ * Allocate memory for cob_file
+ */
+void
+cob_file_malloc (cob_file **pfl, cob_file_key **pky,
+		 const int nkeys, const int linage)
+{
+	cob_file	*fl;
+	fl = cob_cache_malloc (sizeof (cob_file));
+	fl->file_version = COB_FILE_VERSION;
+	fl->nkeys = (size_t)nkeys;	/* casting away bad difference... */
+
+	if (nkeys > 0
+	 && pky != NULL) {
+		*pky = fl->keys = cob_cache_malloc (sizeof (cob_file_key) * nkeys);
+	}
+
+	if (linage > 0) {
+		fl->linorkeyptr = cob_cache_malloc (sizeof (cob_linage));
+	}
+	*pfl = fl;
+}
+
+/*
+ * Free memory for cob_file
+ */
+void
+cob_file_free (cob_file **pfl, cob_file_key **pky)
+{
+	if (pky != NULL) {
+		if (*pky != NULL) {
+			cob_cache_free (*pky);
+			*pky = NULL;
 		}
 	}
-	if (!f->flag_first_read || file_changed) {
-		if (nextprev == DB_FIRST || nextprev == DB_LAST) {
-			read_nextprev = 1;
-		} else {
-			p->key.size = (cob_dbtsize_t) bdb_keylen (f, p->key_index);
-			p->key.data = p->last_readkey[p->key_index];
-			bdb_setkeycol (f, p->key_index);
-			ret = DB_SEQ (p->cursor[p->key_index], &p->key, &p->data, DB_SET_RANGE);
-			/* ret != 0 possible, records may be deleted since last read */
-			if (ret != 0) {
-				if (nextprev == DB_PREV) {
-					nextprev = DB_LAST;
-					read_nextprev = 1;
-				} else {
-					bdb_close_index (f, p->key_index);
-					if (p->key_index != 0) {
-						bdb_close_cursor (f);
-					}
-					return COB_STATUS_10_END_OF_FILE;
-				}
-			} else {
-				if (memcmp (p->key.data, p->last_readkey[p->key_index], (size_t)p->key.size) == 0) {
-					if (p->key_index > 0
-					 && f->keys[p->key_index].tf_duplicates) {
-						memcpy (&dupno, (cob_u8_ptr)p->data.data + p->primekeylen, sizeof (unsigned int));
-						dupno = COB_DUPSWAP (dupno);
-						while (ret == 0
-						 && memcmp (p->key.data, p->last_readkey[p->key_index], (size_t)p->key.size) == 0
-						 && dupno < p->last_dupno[p->key_index]) {
-							ret = DB_SEQ (p->cursor[p->key_index], &p->key, &p->data, DB_NEXT);
-							memcpy (&dupno, (cob_u8_ptr)p->data.data + p->primekeylen, sizeof (unsigned int));
-							dupno = COB_DUPSWAP (dupno);
-						}
-						if (ret != 0) {
-							if (nextprev == DB_PREV) {
-								nextprev = DB_LAST;
-								read_nextprev = 1;
-							} else {
-								bdb_close_index (f, p->key_index);
-								if (p->key_index != 0) {
-									bdb_close_cursor (f);
-								}
-								return COB_STATUS_10_END_OF_FILE;
-							}
-						} else {
-							if (memcmp (p->key.data, p->last_readkey[p->key_index], (size_t)p->key.size) == 0
-							 && dupno == p->last_dupno[p->key_index]) {
-								read_nextprev = 1;
-							} else {
-								if (nextprev == DB_PREV) {
-									read_nextprev = 1;
-								} else {
-									read_nextprev = 0;
-								}
-							}
-						}
-					} else {
-						read_nextprev = 1;
-					}
-				} else {
-					if (nextprev == DB_PREV) {
-						read_nextprev = 1;
-					} else {
-						read_nextprev = 0;
-					}
-				}
-			}
+	if (pfl != NULL && *pfl != NULL) {
+		struct file_list *fc, *prev;
+		cob_file	*fl = *pfl;
+		if (fl->linorkeyptr) {
+			cob_cache_free (fl->linorkeyptr);
+			fl->linorkeyptr = NULL;
 		}
-		if (read_nextprev) {
-			ret = DB_SEQ (p->cursor[p->key_index], &p->key, &p->data, nextprev);
-			if (ret != 0) {
-				bdb_close_index (f, p->key_index);
-				if (p->key_index != 0) {
-					bdb_close_cursor (f);
+		if (fl->org_filename) {
+			cob_free (fl->org_filename);
+			fl->org_filename = NULL;
+		}
+		if (fl->convert_field) {
+			cob_free (fl->convert_field);
+			fl->convert_field = NULL;
+		}
+		seqbuf_free (fl);
+
+		/* Remove from cache  */
+		prev = file_cache;
+		for (fc = file_cache; fc; fc =fc->next) {
+			if (fc->file == fl) {
+				if (fc == file_cache) {
+					file_cache = fc->next;
+				} else {
+					prev->next = fc->next;
 				}
-				return COB_STATUS_10_END_OF_FILE;
+				cob_free (fc);
+				break;
 			}
+			prev = fc;
 		}
 
-		if (p->key_index > 0) {
-			/* Temporarily save alternate key */
-			memcpy (p->temp_key, p->key.data, (size_t)p->key.size);
-			if (f->keys[p->key_index].tf_duplicates) {
-				memcpy (&dupno, (cob_u8_ptr)p->data.data + p->primekeylen, sizeof (unsigned int));
-				dupno = COB_DUPSWAP (dupno);
-			}
-			p->key.data = p->data.data;
-			p->key.size = p->primekeylen;
-			bdb_setkeycol (f, 0);
-			ret = DB_GET (p->db[0], &p->key, &p->data, 0);
-			if (ret != 0) {
-				bdb_close_index (f, p->key_index);
-				bdb_close_cursor (f);
-				return COB_STATUS_23_KEY_NOT_EXISTS;
-			}
+		cob_cache_free (*pfl);
+		*pfl = NULL;
+	}
+}
+
+
+void
+cob_unlock_file (cob_file *f, cob_field *fnstatus)
+{
+	cob_file_unlock (f);
+	save_status (f, fnstatus, COB_STATUS_00_SUCCESS);
+}
+
+/*
+ * Prepare for Open of data file; Used by EXTFH routines)
+ */
+static void
+cob_pre_open (cob_file *f)
+{
+	f->flag_nonexistent = 0;
+	f->flag_end_of_file = 0;
+	f->flag_begin_of_file = 0;
+	f->flag_first_read = 2;
+	f->flag_operation = 0;
+
+	/* Obtain the file name */
+	if (f->fcd && f->fcd->fnamePtr && f->fcd->fnamePtr[0]) {
+		/* copy fieldname and cut at last space */
+		/* CHECKME: at least in the open case we directly copied
+		            the assign field before and could use the code below */
+		size_t i, max;
+		max = LDCOMPX2 (f->fcd->fnameLen);
+		if (max > (size_t)COB_FILE_MAX) {
+			max = (size_t)COB_FILE_MAX;
 		}
-		if (bdb_env != NULL) {
-			ret = 0;
-			if (!(bdb_opts & COB_READ_IGNORE_LOCK)) {
-				ret = test_record_lock (f, p->key.data, p->key.size);
-			} else
-			if (bdb_opts & COB_READ_LOCK) {	/* only set when bdb_env != NULL */
-				ret = lock_record (f, p->key.data, p->key.size);
+		strncpy (file_open_name, f->fcd->fnamePtr, max);
+		for (i = max - 1; ; i--) {
+			if (file_open_name[i] && file_open_name[i] != ' ') {
+				file_open_name[i + 1] = 0;
+				break;
 			}
-			if (ret) {
-				bdb_close_index (f, p->key_index);
-				bdb_close_cursor (f);
-				return COB_STATUS_51_RECORD_LOCKED;
+			if (!i) {
+				break;
 			}
 		}
-		if (p->key_index == 0) {
-			memcpy (p->last_readkey[0], p->key.data, (size_t)p->key.size);
-		} else {
-			memcpy (p->last_readkey[p->key_index], p->temp_key,
-			        bdb_keylen(f,p->key_index));
-			memcpy (p->last_readkey[p->key_index + f->nkeys], p->key.data, p->primekeylen);
-			if (f->keys[p->key_index].tf_duplicates) {
-				p->last_dupno[p->key_index] = dupno;
-			}
+	} else
+	if (f->assign != NULL
+	 && f->assign->data != NULL) {
+		cob_field_to_string (f->assign, file_open_name, COB_FILE_MAX, CCM_NONE);
+	}
+}
+
+/*
+ * Open the data file
+ */
+
+void
+cob_open (cob_file *f, const int mode, const int sharing, cob_field *fnstatus)
+{
+	/*: GC4: mode as cob_open_mode */
+	int	ret;
+
+	last_operation_open = 1;
+
+	/* File was previously closed with lock */
+	if (f->open_mode == COB_OPEN_LOCKED) {
+		save_status (f, fnstatus, COB_STATUS_38_CLOSED_WITH_LOCK);
+		return;
+	}
+
+	/* File is already open */
+	if (f->open_mode != COB_OPEN_CLOSED) {
+		save_status (f, fnstatus, COB_STATUS_41_ALREADY_OPEN);
+		return;
+	}
+
+	f->flag_read_done = 0;
+	f->curkey = -1;
+	f->mapkey = -1;
+
+	f->last_open_mode = mode;
+	f->flag_nonexistent = 0;
+	f->flag_end_of_file = 0;
+	f->flag_begin_of_file = 0;
+	f->flag_first_read = 2;
+	f->flag_operation = 0;
+	f->lock_mode &= ~COB_LOCK_OPEN_EXCLUSIVE;
+	f->lock_mode |= sharing;
+
+	if (f->fcd) {
+		cob_fcd_file_sync (f, file_open_name);		/* Copy app's FCD to cob_file */
+	}
+
+	cob_pre_open (f);
+
+	/* OPEN OUTPUT cannot be undone, it ends the unit of work */
+	if (mode == COB_OPEN_OUTPUT) {
+		journal_commit ();
+	}
+
+	if (unlikely (COB_FILE_STDIN (f))) {
+		if (mode != COB_OPEN_INPUT) {
+			save_status (f, fnstatus, COB_STATUS_30_PERMANENT_ERROR);
+			return;
 		}
+		f->file = stdin;
+		f->fd = fileno (stdin);
+		f->open_mode = mode;
+		save_status (f, fnstatus, COB_STATUS_00_SUCCESS);
+		return;
+	}
+	if (unlikely (COB_FILE_STDOUT (f))) {
+		if (mode != COB_OPEN_OUTPUT) {
+			save_status (f, fnstatus, COB_STATUS_30_PERMANENT_ERROR);
+			return;
+		}
+		f->file = stdout;
+		f->fd = fileno (stdout);
+		f->open_mode = mode;
+		save_status (f, fnstatus, COB_STATUS_00_SUCCESS);
+		return;
 	}
 
-	f->record->size = p->data.size;
-	if (f->record->size > f->record_max) {
-		f->record->size = f->record_max;
-		ret = COB_STATUS_43_READ_NOT_DONE;
-	} else {
-		ret = COB_STATUS_00_SUCCESS;
+	if (f->assign == NULL) {
+		/* CHECKME: that _seems_ to be a codegen error, but may also happen with EXTFH */
+		cob_runtime_error (_("ERROR FILE %s has ASSIGN field is NULL"),
+							f->select_name);
+		save_status (f, fnstatus, COB_STATUS_31_INCONSISTENT_FILENAME);
+		return;
+	}
+	if (f->assign->data == NULL) {
+#if 0 /* we don't raise an error in other places and a similar error is raised in cob_fatal_error */
+		cob_runtime_error ("file %s has ASSIGN field with NULL address",
+			f->select_name);
+#endif
+		save_status (f, fnstatus, COB_STATUS_31_INCONSISTENT_FILENAME);
+		return;
 	}
-	memcpy (f->record->data, p->data.data, f->record->size);
 
-	bdb_close_index (f, p->key_index);
-	if (p->key_index != 0) {
-		bdb_close_cursor (f);
+	/* Check for _bad_ quotes */
+	if (file_open_name[0] == '"'
+	 || file_open_name[0] == '\'') {
+		const size_t len = strlen (file_open_name) - 1;
+		if (len == 0
+		 || file_open_name[len] != file_open_name[0]) {
+			save_status (f, fnstatus, COB_STATUS_31_INCONSISTENT_FILENAME);
+			return;
+		}
 	}
 
-	return ret;
+	if (file_open_name[0] == 0) {
+		save_status (f, fnstatus, COB_STATUS_31_INCONSISTENT_FILENAME);
+		return;
+	}
+
+	cob_cache_file (f);
 
+	f->flag_is_concat = 0;
+#if 0 /* Note: file specific features are 4.x only ... */
+	if (file_setptr->cob_concat_name
+	 && (f->organization == COB_ORG_SEQUENTIAL
+	  || f->organization == COB_ORG_LINE_SEQUENTIAL)
+	 && (mode == COB_OPEN_INPUT
+	  || mode == COB_OPEN_I_O)
+	 && strchr (file_open_name, file_setptr->cob_concat_sep[0]) != NULL
+	 && file_open_name[0] != '>'
+	 && file_open_name[0] != '<'
+	 && file_open_name[0] != '|') {
+		f->flag_is_concat = 1;
+		f->org_filename = cob_strdup (file_open_name);
+		f->nxt_filename = strchr (f->org_filename, file_setptr->cob_concat_sep[0]);
+		*f->nxt_filename++ = 0;
+		strcpy (file_open_name, f->org_filename);
+	}
 #else
-	COB_UNUSED (f);
-	COB_UNUSED (read_opts);
+	if (cobsetptr->cob_concat_name
+	 && (f->organization == COB_ORG_SEQUENTIAL
+	  || f->organization == COB_ORG_LINE_SEQUENTIAL)
+	 && (mode == COB_OPEN_INPUT
+	  || mode == COB_OPEN_I_O)
+	 && strchr (file_open_name, cobsetptr->cob_concat_sep[0]) != NULL
+	 && file_open_name[0] != '>'
+	 && file_open_name[0] != '<'
+	 && file_open_name[0] != '|') {
+		f->flag_is_concat = 1;
+		f->org_filename = cob_strdup (file_open_name);
+		f->nxt_filename = strchr (f->org_filename, cobsetptr->cob_concat_sep[0]);
+		*f->nxt_filename++ = 0;
+		strcpy (file_open_name, f->org_filename);
+	}
+#endif
 
-	return COB_STATUS_91_NOT_AVAILABLE;
+	/* Open the file */
+	ret = fileio_funcs[(int)f->organization]->open (f, file_open_name,
+							mode, sharing);
+#ifndef	COB_NATIVE_ISAM
+	/* only the built-in ISAM journals INDEXED files */
+	if (f->organization == COB_ORG_INDEXED
+	 && mode != COB_OPEN_INPUT
+	 && journal_fd != -1
+	 && ret < 10) {
+		cob_runtime_warning (_("changes to %s are not journaled, ROLLBACK cannot undo them"),
+			f->select_name);
+	}
 #endif
+	save_status (f, fnstatus, ret);
 }
 
-
-/* WRITE to the INDEXED file  */
-
-static int
-indexed_write (cob_file *f, const int opt)
+void
+cob_close (cob_file *f, cob_field *fnstatus, const int opt, const int remfil)
 {
-#ifdef	WITH_INDEX_EXTFH
-
-	return extfh_indexed_write (f, opt);
+	struct file_list	*l;
+	struct file_list	*m;
+	int			ret;
 
-#elif	defined(WITH_ANY_ISAM)
+	f->flag_read_done = 0;
+	f->flag_operation = 0;
 
-	struct indexfile	*fh = f->file;
+	f->lock_mode &= ~COB_LOCK_OPEN_EXCLUSIVE;
 
-	COB_UNUSED (opt);
+	if (COB_FILE_SPECIAL (f)) {
+		f->open_mode = COB_OPEN_CLOSED;
+		f->file = NULL;
+		f->fd = -1;
+		save_status (f, fnstatus, COB_STATUS_00_SUCCESS);
+		return;
+	}
 
-	if (f->flag_nonexistent) {
-		return COB_STATUS_48_OUTPUT_DENIED;
+	if (unlikely (remfil)) {
+		/* Remove from cache - Needed for CANCEL */
+		/* Setting m silences false compiler warning */
+		m = file_cache;
+		for (l = file_cache; l; l = l->next) {
+			if (f == l->file) {
+				if (l == file_cache) {
+					file_cache = l->next;
+				} else {
+					m->next = l->next;
+				}
+				cob_free (l);
+				break;
+			}
+			m = l;
+		}
 	}
-	if (f->access_mode == COB_ACCESS_SEQUENTIAL
-	 && indexed_cmpkey (fh, f->record->data, 0, 0) <= 0) {
-		return COB_STATUS_21_KEY_INVALID;
+
+	if (f->open_mode == COB_OPEN_CLOSED
+	 || f->open_mode == COB_OPEN_LOCKED) {
+		save_status (f, fnstatus, COB_STATUS_42_NOT_OPEN);
+		return;
 	}
 
-#ifdef	ISVARLEN
-	if (f->record_min != f->record_max) {
-		ISRECLEN = f->record->size;
+	if (f->flag_nonexistent) {
+		save_status (f, fnstatus, COB_STATUS_00_SUCCESS);
+		f->open_mode = COB_OPEN_CLOSED;
+		return;
 	}
-#endif
-	if (unlikely (iswrite (fh->isfd, (void *)f->record->data))) {
-		if (f->access_mode == COB_ACCESS_SEQUENTIAL
-		 && f->open_mode == COB_OPEN_OUTPUT
-#if 0	/* CHECKME */
-		 && f->flag_set_isam
-#endif
-		 && ISERRNO == EDUPL) {
-			return COB_STATUS_21_KEY_INVALID;
+
+	ret = fileio_funcs[(int)f->organization]->close (f, opt);
+	if (ret == COB_STATUS_00_SUCCESS) {
+		switch (opt) {
+		case COB_CLOSE_LOCK:
+			f->open_mode = COB_OPEN_LOCKED;
+			break;
+		default:
+			f->open_mode = COB_OPEN_CLOSED;
+			break;
 		}
-		return fisretsts (COB_STATUS_49_I_O_DENIED);
 	}
-	indexed_savekey (fh, f->record->data, 0);
 
-#ifdef	COB_WITH_STATUS_02
-	if (isstat1 == '0'
-	 && isstat2 == '2') {
-		return COB_STATUS_02_SUCCESS_DUPLICATE;
-	}
-#endif
-	return COB_STATUS_00_SUCCESS;
+	save_status (f, fnstatus, ret);
+}
 
-#elif	defined(WITH_DB)
+#if	0	/* RXWRXW - unlock */
+void
+cob_unlock (cob_file *f)
+{
+	int	ret;
 
-	struct indexed_file	*p = f->file;
-	int			ret;
+	f->flag_read_done = 0;
 
-	if (f->flag_nonexistent) {
-		return COB_STATUS_48_OUTPUT_DENIED;
+	if (f->open_mode == COB_OPEN_CLOSED) {
+		save_status (f, fnstatus, COB_STATUS_42_NOT_OPEN);
+		return;
 	}
-	if (bdb_env != NULL
-	 && !(f->lock_mode & COB_LOCK_MULTIPLE)) {
-		unlock_record (f);
+
+	if (f->flag_nonexistent) {
+		ret = COB_STATUS_00_SUCCESS;
+	} else {
+		ret = fileio_funcs[(int)f->organization]->close (f, opt);
 	}
 
-	/* Check record key */
-	bdb_setkey (f, 0);
-	if (!p->last_key) {
-		p->last_key = cob_malloc ((size_t)p->maxkeylen);
-	} else
-	if (f->access_mode == COB_ACCESS_SEQUENTIAL
-	 && indexed_key_compare (p->last_key,  (unsigned char *)p->key.data, (size_t)p->key.size,
-				 (unsigned char *)DBT_GET_APP_DATA(&p->key)) > 0) {
-		return COB_STATUS_21_KEY_INVALID;
+	save_status (f, fnstatus, ret);
+}
+#endif
+
+void
+cob_start (cob_file *f, const int cond, cob_field *key,
+	   cob_field *keysize, cob_field *fnstatus)
+{
+	int		ret;
+	cob_field	tempkey;
+
+	f->flag_read_done = 0;
+	f->flag_first_read = 0;
+
+	if (unlikely (f->open_mode != COB_OPEN_I_O
+		       && f->open_mode != COB_OPEN_INPUT)) {
+		save_status (f, fnstatus, COB_STATUS_47_INPUT_DENIED);
+		return;
 	}
-	memcpy (p->last_key, p->key.data, (size_t)p->key.size);
 
-	ret = indexed_write_internal (f, 0, opt);
-	bdb_close_cursor (f);
+	if (unlikely (f->access_mode == COB_ACCESS_RANDOM)) {
+		save_status (f, fnstatus, COB_STATUS_47_INPUT_DENIED);
+		return;
+	}
 
-	if (f->access_mode == COB_ACCESS_SEQUENTIAL
-	 && f->open_mode == COB_OPEN_OUTPUT
-#if 0	/* CHECKME */
-	 && f->flag_set_isam
-#endif
-	 && ret == COB_STATUS_22_KEY_EXISTS) {
-		return COB_STATUS_21_KEY_INVALID;
+	if (f->flag_nonexistent) {
+		save_status (f, fnstatus, COB_STATUS_23_KEY_NOT_EXISTS);
+		return;
 	}
-	return ret;
 
-#else
-	COB_UNUSED (f);
-	COB_UNUSED (opt);
+	if (unlikely (keysize)) {
+		int		size = cob_get_int (keysize);
+		if (size < 1 || size > (int)key->size) {
+			save_status (f, fnstatus, COB_STATUS_23_KEY_NOT_EXISTS);
+			return;
+		}
+		tempkey = *key;
+		tempkey.size = (size_t)size;
+		ret = fileio_funcs[(int)f->organization]->start (f, cond, &tempkey);
+	} else {
+		ret = fileio_funcs[(int)f->organization]->start (f, cond, key);
+	}
+	if (ret == COB_STATUS_00_SUCCESS) {
+		f->flag_end_of_file = 0;
+		f->flag_begin_of_file = 0;
+		f->flag_first_read = 1;
+	} else {
+		f->flag_end_of_file = 1;
+		f->flag_begin_of_file = 0;
+		f->flag_first_read = 1;
+	}
 
-	return COB_STATUS_91_NOT_AVAILABLE;
-#endif
+	save_status (f, fnstatus, ret);
 }
 
-
-/* DELETE record from the INDEXED file  */
-
-static int
-indexed_delete (cob_file *f)
+void
+cob_read (cob_file *f, cob_field *key, cob_field *fnstatus, const int read_opts)
 {
-#ifdef	WITH_INDEX_EXTFH
-
-	return extfh_indexed_delete (f);
-
-#elif	defined(WITH_ANY_ISAM)
+	int	ret;
 
-	struct indexfile	*fh;
-	int			ret;
+	f->flag_read_done = 0;
 
-	fh = f->file;
-	ret = COB_STATUS_00_SUCCESS;
-	if (f->flag_nonexistent) {
-		return COB_STATUS_49_I_O_DENIED;
+	if (unlikely (f->open_mode != COB_OPEN_INPUT
+		       && f->open_mode != COB_OPEN_I_O)) {
+		save_status (f, fnstatus, COB_STATUS_47_INPUT_DENIED);
+		return;
 	}
-	if (f->curkey == -1) {
-		/* Switch to primary index */
-		isstart (fh->isfd, &fh->key[0], 0,
-			 (void *)f->record->data, ISEQUAL);
-		f->curkey = 0;
-		fh->readdir = ISNEXT;
-	} else {
-		savefileposition (f);
-		if (f->curkey != 0) {
-			/* Switch to primary index */
-			isstart (fh->isfd, &fh->key[0], 0,
-				 (void *)f->record->data, ISEQUAL);
+
+	if (unlikely (f->flag_nonexistent)) {
+		if (f->flag_first_read == 0) {
+			save_status (f, fnstatus, COB_STATUS_23_KEY_NOT_EXISTS);
+			return;
 		}
+		f->flag_first_read = 0;
+		save_status (f, fnstatus, COB_STATUS_10_END_OF_FILE);
+		return;
 	}
-	if (isread (fh->isfd, (void *)f->record->data, ISEQUAL | ISLOCK)) {
-		ret = fisretsts (COB_STATUS_21_KEY_INVALID);
-	} else if (isdelete (fh->isfd, (void *)f->record->data)) {
-		ret = fisretsts (COB_STATUS_49_I_O_DENIED);
-	}
-	restorefileposition (f);
-	return ret;
 
-#elif	defined(WITH_DB)
-
-	if (f->flag_nonexistent) {
-		return COB_STATUS_49_I_O_DENIED;
+	/* Sequential read at the end of file is an error */
+	if (key == NULL) {
+		if (unlikely (f->flag_end_of_file
+		           && !(read_opts & COB_READ_PREVIOUS))) {
+			save_status (f, fnstatus, COB_STATUS_46_READ_ERROR);
+			return;
+		}
+		if (unlikely (f->flag_begin_of_file
+			       && (read_opts & COB_READ_PREVIOUS))) {
+			save_status (f, fnstatus, COB_STATUS_46_READ_ERROR);
+			return;
+		}
+		ret = fileio_funcs[(int)f->organization]->read_next (f, read_opts);
+	} else {
+		ret = fileio_funcs[(int)f->organization]->read (f, key, read_opts);
 	}
-	return indexed_delete_internal (f, 0);
 
-#else
-	COB_UNUSED (f);
-
-	return COB_STATUS_91_NOT_AVAILABLE;
+	switch (ret) {
+	case COB_STATUS_00_SUCCESS:
+	case COB_STATUS_02_SUCCESS_DUPLICATE:
+	case COB_STATUS_04_SUCCESS_INCOMPLETE:
+	case COB_STATUS_06_READ_TRUNCATE:
+	case COB_STATUS_09_READ_DATA_BAD:
+#if defined (COB_EXPERIMENTAL)
+	case COB_STATUS_0P_NOT_PRINTABLE:
 #endif
-}
+		f->flag_first_read = 0;
+		f->flag_read_done = 1;
+		f->flag_end_of_file = 0;
+		f->flag_begin_of_file = 0;
+		if (f->variable_record) {
+			cob_set_int (f->variable_record, (int) f->record->size);
+		}
+		break;
+	case COB_STATUS_10_END_OF_FILE:
+		if (read_opts & COB_READ_PREVIOUS) {
+			f->flag_begin_of_file = 1;
+		} else {
+			f->flag_end_of_file = 1;
+		}
+		break;
+	}
 
-/* REWRITE record to the INDEXED file  */
+	save_status (f, fnstatus, ret);
+}
 
 static int
-indexed_rewrite (cob_file *f, const int opt)
+is_suppressed_key_value (cob_file *f, const int idx)
 {
-#ifdef	WITH_INDEX_EXTFH
+	if (idx < 0 || idx >= (int)f->nkeys) {
+		return -1;
+	}
+#if 0	/* TODO: SUPPRESS string not merged yet */
+	if (f->keys[idx].len_suppress > 0) {
+		(void) cob_savekey (f, idx, f->keys[idx].field->data);
+		if (memcmp (f->keys[idx].field->data,
+			        f->keys[idx].str_suppress,
+			        f->keys[idx].len_suppress) == 0) {
+			return 1;
+		}
+	} else
+#endif
+	if (f->keys[idx].tf_suppress) {
+		int pos = cob_savekey (f, idx, f->keys[idx].field->data);
+		for (pos = 0;
+			 pos < (int)f->keys[idx].field->size
+		  && f->keys[idx].field->data[pos] == (unsigned char)f->keys[idx].char_suppress;
+			 pos++);
+		/* All SUPPRESS char ? */
+		if (pos == f->keys[idx].field->size) {
+			return 1;
+		}
+	}
+	return 0;
+}
 
-	return extfh_indexed_rewrite (f, opt);
 
-#elif	defined(WITH_ANY_ISAM)
+void
+cob_read_next (cob_file *f, cob_field *fnstatus, const int read_opts)
+{
+	int	ret,idx;
 
-	struct indexfile	*fh;
-	size_t			k;
-	int			ret;
-	int			retdup = 0;
+	f->flag_read_done = 0;
 
-	COB_UNUSED (opt);
+	if (unlikely (f->open_mode != COB_OPEN_INPUT
+		       && f->open_mode != COB_OPEN_I_O)) {
+		save_status (f, fnstatus, COB_STATUS_47_INPUT_DENIED);
+		return;
+	}
 
-	fh = f->file;
-	ret = retdup = COB_STATUS_00_SUCCESS;
-	if (f->flag_nonexistent) {
-		return COB_STATUS_49_I_O_DENIED;
+	if (unlikely (f->flag_nonexistent)) {
+		if (f->flag_first_read == 0) {
+			save_status (f, fnstatus, COB_STATUS_46_READ_ERROR);
+			return;
+		}
+		f->flag_first_read = 0;
+		save_status (f, fnstatus, COB_STATUS_10_END_OF_FILE);
+		return;
 	}
 
-	if (f->access_mode == COB_ACCESS_SEQUENTIAL
-	 && indexed_cmpkey (fh, f->record->data, 0, 0) != 0) {
-		return COB_STATUS_21_KEY_INVALID;
+	/* Sequential read at the end of file is an error */
+	if (unlikely (f->flag_end_of_file && !(read_opts & COB_READ_PREVIOUS))) {
+		save_status (f, fnstatus, COB_STATUS_46_READ_ERROR);
+		return;
 	}
-	if (f->curkey >= 0) {
-		/* Index is active */
-		/* Save record data */
-		memcpy (fh->recwrk, f->record->data, f->record_max);
-		/* RXWRXW - readdir */
-		fh->readdir = ISNEXT;
-		savefileposition (f);
-		memcpy (fh->recwrk, f->record->data, f->record_max);
-		if (f->curkey != 0) {
-			/* Activate primary index */
-			isstart (fh->isfd, &fh->key[0], fh->key[0].k_len,
-					 (void *)fh->recwrk, ISEQUAL);
+	if (unlikely (f->flag_begin_of_file && (read_opts & COB_READ_PREVIOUS))) {
+		save_status (f, fnstatus, COB_STATUS_46_READ_ERROR);
+		return;
+	}
+
+Again:
+	ret = fileio_funcs[(int)f->organization]->read_next (f, read_opts);
+
+	switch (ret) {
+	case COB_STATUS_00_SUCCESS:
+	case COB_STATUS_02_SUCCESS_DUPLICATE:
+	case COB_STATUS_04_SUCCESS_INCOMPLETE:
+	case COB_STATUS_06_READ_TRUNCATE:
+	case COB_STATUS_09_READ_DATA_BAD:
+#if defined (COB_EXPERIMENTAL)
+	case COB_STATUS_0P_NOT_PRINTABLE:
+#endif
+		/* If record has suppressed key, skip it */
+		/* This is to catch CISAM, old VBISAM, ODBC & OCI */
+		if (f->organization == COB_ORG_INDEXED) {
+			idx = f->curkey;
+			if (f->mapkey >= 0) {	/* FD has Indexes in alternate appearance */
+				idx = f->mapkey;
+			}
+			if (is_suppressed_key_value (f, idx) > 0) {
+				/* SUPPRESS -> so skip */
+				goto Again;
+			}
 		}
-		/* Verify record exists */
-		if (isread (fh->isfd, (void *)fh->recwrk, ISEQUAL)) {
-			restorefileposition (f);
-			return COB_STATUS_21_KEY_INVALID;
+
+		f->flag_first_read = 0;
+		f->flag_read_done = 1;
+		f->flag_end_of_file = 0;
+		f->flag_begin_of_file = 0;
+		if (f->variable_record) {
+			cob_set_int (f->variable_record, (int) f->record->size);
 		}
-		for (k = 1; k < f->nkeys && ret == COB_STATUS_00_SUCCESS; ++k) {
-			struct keydesc *key = &fh->key[k];
-			if (key->k_flags & ISDUPS) {
-				continue;
-			}
-			memcpy (fh->recwrk, f->record->data, f->record_max);
-			isstart (fh->isfd, key, key->k_leng,
-				(void *)fh->recwrk, ISEQUAL);
-			if (!isread (fh->isfd, (void *)fh->recwrk, ISEQUAL)
-			 && ISRECNUM != fh->recnum) {
-				ret = COB_STATUS_22_KEY_EXISTS;
-				break;
+		break;
+	case COB_STATUS_10_END_OF_FILE:
+		if (read_opts & COB_READ_PREVIOUS) {
+			f->flag_begin_of_file = 1;
+		} else {
+			f->flag_end_of_file = 1;
+		}
+		break;
+	}
+
+	save_status (f, fnstatus, ret);
+}
+
+/* CODE-SET conversion for re-/write */
+static unsigned char *
+get_code_set_converted_data (cob_file *f)
+{
+	const size_t size = f->record->size;
+	unsigned char *real_rec_data = f->record->data;
+	unsigned char *converted_copy = cob_malloc (size);
+	if (!converted_copy) return NULL;
+
+	if (f->nconvert_fields) {
+		/* CODE-SET FOR - convert specific areas only */
+		const unsigned char *rec_end = converted_copy + size;
+		size_t ic;
+		memcpy (converted_copy, real_rec_data, size);
+		for (ic = 0; ic < f->nconvert_fields; ic++) {
+			const cob_field to_conv = f->convert_field[ic];
+			const unsigned char *to_conv_end = to_conv.data + to_conv.size;
+			const unsigned char *conv_end = rec_end < to_conv_end ? rec_end : to_conv_end;
+			unsigned char *p;
+			for (p = to_conv.data; p < conv_end; p++) {
+				*p = f->sort_collating[*p];
 			}
 		}
-		if (ret == COB_STATUS_00_SUCCESS) {
-			memcpy (fh->recwrk, f->record->data, f->record_max);
-			isstart (fh->isfd, &fh->key[0], fh->key[0].k_len,
-				(void *)fh->recwrk, ISEQUAL);
-			if (isread (fh->isfd, (void *)fh->recwrk, ISEQUAL | ISLOCK)) {
-				ret = fisretsts (COB_STATUS_49_I_O_DENIED);
-			} else {
-#ifdef	ISVARLEN
-				if (f->record_min != f->record_max) {
-					ISRECLEN = f->record->size;
-				}
-#endif
-				if (isrewcurr (fh->isfd, (void *)f->record->data)) {
-					ret = fisretsts (COB_STATUS_49_I_O_DENIED);
-				}
-			}
-#ifdef	COB_WITH_STATUS_02
-			if (!ret && (isstat1 == '0') && (isstat2 == '2')) {
-				retdup = COB_STATUS_02_SUCCESS_DUPLICATE;
-			}
-#endif
+	} else {
+		/* CODE-SET FOR - convert complete record */
+		const unsigned char *rec_end = real_rec_data + size;
+		unsigned char *d, *p;
+		for (d = converted_copy, p = real_rec_data; p < rec_end; d++, p++) {
+			*d = f->sort_collating[*p];
 		}
+	}
 
-		restorefileposition (f);
+	return converted_copy;
+}
 
-	} else {	/* Index is not active */
+void
+cob_write (cob_file *f, cob_field *rec, const int opt, cob_field *fnstatus,
+	   const unsigned int check_eop)
+{
+	f->flag_read_done = 0;
 
-		memcpy (fh->recwrk, f->record->data, f->record_max);
-		if (isread (fh->isfd, (void *)fh->recwrk, ISEQUAL | ISLOCK)) {
-			ret = fisretsts (COB_STATUS_49_I_O_DENIED);
-		} else {
-#ifdef	ISVARLEN
-			if (f->record_min != f->record_max) {
-				ISRECLEN = f->record->size;
-			}
-#endif
-			if (isrewrite (fh->isfd, (void *)f->record->data)) {
-				ret = fisretsts (COB_STATUS_49_I_O_DENIED);
-			}
+	if (f->access_mode == COB_ACCESS_SEQUENTIAL) {
+		if (unlikely (f->open_mode != COB_OPEN_OUTPUT
+			       && f->open_mode != COB_OPEN_EXTEND)) {
+			save_status (f, fnstatus, COB_STATUS_48_OUTPUT_DENIED);
+			return;
 		}
-#ifdef	COB_WITH_STATUS_02
-		if (!ret && (isstat1 == '0') && (isstat2 == '2')) {
-			retdup = COB_STATUS_02_SUCCESS_DUPLICATE;
+	} else {
+		if (unlikely (f->open_mode != COB_OPEN_OUTPUT
+			       && f->open_mode != COB_OPEN_I_O)) {
+			save_status (f, fnstatus, COB_STATUS_48_OUTPUT_DENIED);
+			return;
 		}
+	}
+
+	if (f->variable_record) {
+		f->record->size = (size_t)cob_get_int (f->variable_record);
+		if (unlikely (f->record->size > rec->size)) {
+			f->record->size = rec->size;
+		}
+	} else {
+		f->record->size = rec->size;
+	}
+
+	if (f->record->size < f->record_min || f->record_max < f->record->size) {
+		save_status (f, fnstatus, COB_STATUS_44_RECORD_OVERFLOW);
+		return;
+	}
+
+	check_eop_status = check_eop;
+
+	if (f->organization == COB_ORG_LINE_SEQUENTIAL) {
+		/* Re-Determine the size to be written (done here so possible
+		   CODE-SET conversions do not convert trailing spaces when
+		   not part of the record [= fixed length] */
+		const size_t size = lineseq_size (f);
+		/* early pre-validation for data we'd otherwise convert */
+		if (cobsetptr->cob_ls_validate
+		 && !f->flag_line_adv
+		 && f->sort_collating) {
+			const unsigned char *p = f->record->data;
+			size_t i;
+#if 0 /* Note: file specific features are 4.x only ... */
+			if (f->file_features & COB_FILE_LS_VALIDATE) {
+#else
+			if (cobsetptr->cob_ls_validate == 1) {
+#endif
+				for (i = 0; i < size; ++i, ++p) {
+					if (IS_BAD_CHAR (*p)) {
+						save_status (f, fnstatus, COB_STATUS_71_BAD_CHAR);
+						return;
+					}
+				}
+#if defined (COB_EXPERIMENTAL)
+			} else {
+				for (i = 0; i < size; ++i, ++p) {
+					if (IS_BAD_CHAR (*p)) {
+						save_status (f, fnstatus, COB_STATUS_71_BAD_CHAR);
+						return;
+					}
+				}
+				int sts = 0;
+				for (i = 0; i < size; ++i, ++p) {
+					if (IS_BAD_CHAR (*p)) {
+						save_status (f, fnstatus, COB_STATUS_71_BAD_CHAR);
+						return;
+					}
+					if (IS_NOT_PRINTABLE (*p)) {
+						sts = COB_STATUS_0P_NOT_PRINTABLE;
+					}
+				}
+				if (sts != 0) {
+					save_status (f, fnstatus, COB_STATUS_0P_NOT_PRINTABLE);
+					return;
+				}
 #endif
-		if (!ret) {
-			if ((f->lock_mode & COB_LOCK_AUTOMATIC)
-			 && !(f->lock_mode & COB_LOCK_MULTIPLE)) {
-				isrelease (fh->isfd);
 			}
 		}
+		f->record->size = size;
 	}
 
-	if (retdup) {
-		/* FIXME: use (is_suppressed_key_value) or similar to verify
-		   that the duplicate is not a SUPPRESSed KEY */
-		return COB_STATUS_02_SUCCESS_DUPLICATE;
+	/* CODE-SET conversion (write from converted shadow-copy) */
+	if (f->organization != COB_ORG_SORT && f->sort_collating) {
+		unsigned char *real_rec_data = f->record->data;
+		unsigned char *converted_copy = get_code_set_converted_data (f);
+		if (!converted_copy) {
+			save_status (f, fnstatus, COB_STATUS_30_PERMANENT_ERROR);
+			return;
+		}
+		f->record->data = converted_copy;
+		save_status (f, fnstatus,
+			     fileio_funcs[(int)f->organization]->write (f, opt));
+		f->record->data = real_rec_data;
+		cob_free (converted_copy);
+		return;
 	}
-	return ret;
 
-#elif	defined(WITH_DB)
+	save_status (f, fnstatus,
+		     fileio_funcs[(int)f->organization]->write (f, opt));
+}
 
-	int		ret;
+void
+cob_rewrite (cob_file *f, cob_field *rec, const int opt, cob_field *fnstatus)
+{
+	int	read_done;
 
-	if (f->flag_nonexistent) {
-		return COB_STATUS_49_I_O_DENIED;
-	}
-	if (bdb_env != NULL
-	 &&	!(f->lock_mode & COB_LOCK_MULTIPLE)) {
-		unlock_record (f);
+	read_done = f->flag_read_done;
+	f->flag_read_done = 0;
+
+	if (unlikely (f->open_mode != COB_OPEN_I_O)) {
+		save_status (f, fnstatus, COB_STATUS_49_I_O_DENIED);
+		return;
 	}
 
-	/* Check duplicate alternate keys */
-	if (check_alt_keys (f, 1)) {
-#if 1	/* CHECKME: removed in RW-Branch r1313 */
-		bdb_close_cursor (f);
-#endif
-		return COB_STATUS_22_KEY_EXISTS;
+	if (f->access_mode == COB_ACCESS_SEQUENTIAL && !read_done) {
+		save_status (f, fnstatus, COB_STATUS_43_READ_NOT_DONE);
+		return;
 	}
 
-	/* Delete the current record */
-	ret = indexed_delete_internal (f, 1);
+	if (unlikely (f->organization == COB_ORG_SEQUENTIAL)) {
+		if (f->record->size != rec->size) {
+			save_status (f, fnstatus, COB_STATUS_44_RECORD_OVERFLOW);
+			return;
+		}
 
-	if (ret != COB_STATUS_00_SUCCESS) {
-		bdb_close_cursor (f);
-		if (ret == COB_STATUS_23_KEY_NOT_EXISTS) {
-			return COB_STATUS_21_KEY_INVALID;
+		if (f->variable_record) {
+			if (f->record->size != (size_t)cob_get_int (f->variable_record)) {
+				save_status (f, fnstatus, COB_STATUS_44_RECORD_OVERFLOW);
+				return;
+			}
 		}
-		return ret;
 	}
 
-	/* Write data */
-	bdb_setkey(f, 0);
-	ret = indexed_write_internal (f, 1, opt);
-
-	bdb_close_cursor (f);
+	if (f->variable_record) {
+		f->record->size = (size_t)cob_get_int (f->variable_record);
+		if (f->record->size < f->record_min || f->record_max < f->record->size) {
+			save_status (f, fnstatus, COB_STATUS_44_RECORD_OVERFLOW);
+			return;
+		}
+		if (unlikely(f->record->size > rec->size)) {
+			/* CHECKME: Shouldn't this get a status? */
+			f->record->size = rec->size;
+		}
+	} else {
+		f->record->size = rec->size;
+	}
 
-	if (bdb_env != NULL) {
-		if (ret == COB_STATUS_00_SUCCESS
-		 || ret == COB_STATUS_02_SUCCESS_DUPLICATE) {
-			if ((f->lock_mode & COB_LOCK_AUTOMATIC)) {
-				if (!(f->lock_mode & COB_LOCK_MULTIPLE)) {
-					unlock_record (f);
+	if (f->organization == COB_ORG_LINE_SEQUENTIAL) {
+		/* Re-Determine the size to be written (done here so possible
+		   CODE-SET conversions do not convert trailing spaces when
+		   not part of the record [= fixed length] */
+		size_t size = lineseq_size (f);
+		/* early pre-validation for data we'd otherwise convert */
+		if (cobsetptr->cob_ls_validate
+		 && !f->flag_line_adv
+		 && f->sort_collating) {
+			const unsigned char *p = f->record->data;
+			size_t i;
+#if 0 /* Note: file specific features are 4.x only ... */
+			if (f->file_features & COB_FILE_LS_VALIDATE) {
+#else
+			if (cobsetptr->cob_ls_validate == 1) {
+#endif
+				for (i = 0; i < size; ++i, ++p) {
+					if (IS_BAD_CHAR (*p)) {
+						save_status (f, fnstatus, COB_STATUS_71_BAD_CHAR);
+						return;
+					}
 				}
+#if defined (COB_EXPERIMENTAL)
 			} else {
-				if (!(f->lock_mode & COB_LOCK_MULTIPLE)) {
-					if (!(opt & COB_WRITE_LOCK)) {
-						unlock_record (f);
+				int sts = 0;
+				for (i = 0; i < size; ++i, ++p) {
+					if (IS_BAD_CHAR (*p)) {
+						save_status (f, fnstatus, COB_STATUS_71_BAD_CHAR);
+						return;
 					}
-				} else
-				if ((opt & COB_WRITE_LOCK)) {
-					unlock_record (f);
-				} else
-				if ((opt & COB_WRITE_NO_LOCK)) {
-					unlock_record (f);
+					if (IS_NOT_PRINTABLE (*p)) {
+						sts = COB_STATUS_0P_NOT_PRINTABLE;
+					}
+				}
+				if (sts != 0) {
+					save_status (f, fnstatus, COB_STATUS_0P_NOT_PRINTABLE);
+					return;
 				}
+#endif
 			}
-		} else if (ret) {
-			unlock_record (f);
 		}
+		f->record->size = size;
 	}
 
-	return ret;
-
-#else
-	COB_UNUSED (f);
-	COB_UNUSED (opt);
+	/* CODE-SET conversion (rewrite from converted shadow-copy) */
+	if (f->organization != COB_ORG_SORT && f->sort_collating) {
+		unsigned char *real_rec_data = f->record->data;
+		unsigned char *converted_copy = get_code_set_converted_data (f);
+		if (!converted_copy) {
+			save_status (f, fnstatus, COB_STATUS_30_PERMANENT_ERROR);
+			return;
+		}
+		f->record->data = converted_copy;
+		save_status (f, fnstatus,
+				 fileio_funcs[(int)f->organization]->rewrite (f, opt));
+		f->record->data = real_rec_data;
+		cob_free (converted_copy);
+		return;
+	}
 
-	return COB_STATUS_91_NOT_AVAILABLE;
-#endif
+	save_status (f, fnstatus,
+		     fileio_funcs[(int)f->organization]->rewrite (f, opt));
 }
 
-
-static void
-cob_file_unlock (cob_file *f)
+void
+cob_delete (cob_file *f, cob_field *fnstatus)
 {
-	if (COB_FILE_SPECIAL(f)) {
+	int	read_done;
+
+	read_done = f->flag_read_done;
+	f->flag_read_done = 0;
+
+	if (unlikely (f->open_mode != COB_OPEN_I_O)) {
+		save_status (f, fnstatus, COB_STATUS_49_I_O_DENIED);
 		return;
 	}
 
-	if (f->open_mode != COB_OPEN_CLOSED &&
-	    f->open_mode != COB_OPEN_LOCKED) {
-		if (f->organization == COB_ORG_SORT) {
-			return;
-		}
-		if (f->organization != COB_ORG_INDEXED) {
-#ifndef	WITH_SEQRA_EXTFH
-			if (f->fd >= 0) {
-				fdcobsync (f->fd);
-			}
-#ifdef	HAVE_FCNTL
-			if (!(f->lock_mode & COB_FILE_EXCLUSIVE)) {
-				/* Unlock the file */
-				if (f->fd >= 0) {
-					struct flock	lock;
-					memset ((void *)&lock, 0, sizeof (struct flock));
-					lock.l_type = F_UNLCK;
-					lock.l_whence = SEEK_SET;
-					lock.l_start = 0;
-					lock.l_len = 0;
-					if (fcntl (f->fd, F_SETLK, &lock) == -1) {
-#if 1 /* CHECKME - What is the correct thing to do here? */
-						/* not translated as "testing only" */
-						cob_runtime_warning ("issue during unlock (%s), errno: %d",
-							"cob_file_unlock", errno);
-#endif
-					}
-				}
-			}
-#elif defined _WIN32
-			{
-				HANDLE osHandle = (HANDLE)_get_osfhandle (f->fd);
-				if (osHandle != INVALID_HANDLE_VALUE) {
-					if (!UnlockFile (osHandle, 0, 0, MAXDWORD, MAXDWORD)) {
-#if 1 /* CHECKME - What is the correct thing to do here? */
-						/* not translated as "testing only" */
-						cob_runtime_warning ("issue during UnLockFile (%s), lastError: " CB_FMT_LLU,
-							"cob_file_unlock", (cob_u64_t)GetLastError());
-#endif
-					}
-				}
-			}
-#endif
+	if (f->access_mode == COB_ACCESS_SEQUENTIAL && !read_done) {
+		save_status (f, fnstatus, COB_STATUS_43_READ_NOT_DONE);
+		return;
+	}
 
-#endif
-		} else {
-#ifdef	WITH_INDEX_EXTFH
-			extfh_indexed_unlock (f);
-#elif	defined(WITH_DB) || defined(WITH_ANY_ISAM)
+	save_status (f, fnstatus,
+		     fileio_funcs[(int)f->organization]->fdelete (f));
+}
+
+/* Journal: flush the data buffered for the journaled files */
+static void
+journal_flush_files (void)
+{
+	struct journal_file	*jf;
+
+	for (jf = journal_files; jf; jf = jf->next) {
+		cob_file	*f = jf->f;
+		if (f == NULL || jf->fd < 0) {
+			continue;
+		}
+		if (f->organization == COB_ORG_LINE_SEQUENTIAL) {
 			if (f->file) {
-#if	defined(WITH_DB)
-				if (bdb_env != NULL) {
-					unlock_record (f);
-					unlock_file (f);
-				}
-#else
-				struct indexfile	*fh = f->file;
-				isrelease (fh->isfd);
-#endif
+				fflush ((FILE *)f->file);
 			}
-#endif
+		} else {
+			(void)seqbuf_flush (f);
 		}
 	}
+#ifdef	COB_NATIVE_ISAM
+	cob_isam_journal_flush ();
+#endif
 }
 
-/* Global functions */
-
-/*
- * Allocate memory for 'IS EXTERNAL' cob_file
- */
-void
-cob_file_external_addr (const char *exname,
-		cob_file **pfl, cob_file_key **pky,
-		const int nkeys, const int linage)
-{
-	cob_file	**epfl = cob_external_addr (exname, sizeof (cob_file *));
-
-	if (cobglobptr->cob_initial_external) {
-		/* if the pointer was setup the first time:
-		   allocate the file and store the address for next request */
-		cob_file_malloc (pfl, pky, nkeys, linage);
-		*epfl = *pfl;
-	} else {
-		/* external pointer available - get the address stored
-		   and set / check keys */
-		cob_file	*fl = *pfl = *epfl;
-		/* already allocated, just pass on */
-		if (pky != NULL) {
-			*pky = fl->keys;
-		}
-#if 0	/* TODO: verify file attributes (here or in the caller?) */
-		if (fl->nkeys != nkeys) {
-			/* reallocate if KEYCHECK and bigger / raise exception otherwise ? */
+/* empty the journal, the unit of work ends */
+static void
+journal_reset (void)
+{
+	struct journal_file	*jf, **link;
+
+	if (fdcobtruncate (journal_fd, 0) != 0
+	 || lseek (journal_fd, (off_t)0, SEEK_SET) == (off_t)-1) {
+		cob_runtime_warning (_("cannot reset journal %s"),
+			cobsetptr->cob_file_journal);
+	}
+	fdcobsync (journal_fd);
+	journal_size = 0;
+	link = &journal_files;
+	while ((jf = *link) != NULL) {
+		if (jf->fd == -1) {
+			*link = jf->next;
+			journal_free_file (jf);
+			continue;
 		}
-		if (linage > 0
-		 && fl->linorkeyptr == NULL) {
-			/* CHECKME: is this allowed to happen? */
+		jf->touched = 0;
+		if (jf->regions) {
+			memset (jf->regions, 0,
+				jf->alloc_regions * sizeof (struct journal_region));
+			jf->nregions = 0;
 		}
-#endif
+		link = &jf->next;
 	}
 }
 
-/*
- * Allocate memory for cob_file
- */
-void
-cob_file_malloc (cob_file **pfl, cob_file_key **pky,
-		 const int nkeys, const int linage)
+/* write back the image of the journal entry at 'pos',
+   returns zero on success */
+static int
+journal_restore (const cob_s64_t pos)
 {
-	cob_file	*fl;
-	fl = cob_cache_malloc (sizeof (cob_file));
-	fl->file_version = COB_FILE_VERSION;
-	fl->nkeys = (size_t)nkeys;	/* casting away bad difference... */
+	struct journal_entry	e;
+	struct journal_file	*jf;
+	struct stat		st;
+	const char		*name;
+	size_t			total;
+	off_t			fpos = 0;
+	int			fd, ret = 0;
 
-	if (nkeys > 0
-	 && pky != NULL) {
-		*pky = fl->keys = cob_cache_malloc (sizeof (cob_file_key) * nkeys);
+	if (lseek (journal_fd, (off_t)pos, SEEK_SET) == (off_t)-1
+	 || read (journal_fd, &e, sizeof (e)) != (int)sizeof (e)) {
+		return -1;
+	}
+	total = e.name_len + 1 + (size_t)e.len;
+	if (total > journal_buff_size) {
+		if (journal_buff) {
+			cob_free (journal_buff);
+		}
+		journal_buff_size = total;
+		journal_buff = cob_fast_malloc (journal_buff_size);
+	}
+	if (read (journal_fd, journal_buff, e.name_len) != (int)e.name_len
+	 || read (journal_fd, journal_buff + e.name_len + 1, (size_t)e.len)
+	    != (int)e.len) {
+		return -1;
 	}
+	journal_buff[e.name_len] = 0;
+	name = (const char *)journal_buff;
 
-	if (linage > 0) {
-		fl->linorkeyptr = cob_cache_malloc (sizeof (cob_linage));
+	/* use the open file, closing another descriptor would drop its locks */
+	for (jf = journal_files; jf; jf = jf->next) {
+		if (jf->fd >= 0
+		 && !strcmp (jf->name, name)) {
+			break;
+		}
 	}
-	*pfl = fl;
+	if (jf) {
+		fd = jf->fd;
+		fpos = lseek (fd, (off_t)0, SEEK_CUR);
+	} else {
+		fd = open (name, O_RDWR | O_BINARY);
+		if (fd < 0) {
+			return -1;
+		}
+	}
+	if (e.len > 0
+	 && (lseek (fd, (off_t)e.offset, SEEK_SET) == (off_t)-1
+	  || write (fd, journal_buff + e.name_len + 1, (size_t)e.len)
+	     != (int)e.len)) {
+		ret = -1;
+	}
+	if (!fstat (fd, &st)
+	 && (cob_s64_t)st.st_size > e.size
+	 && fdcobtruncate (fd, (off_t)e.size) != 0) {
+		ret = -1;
+	}
+	if (jf) {
+		(void)lseek (fd, fpos, SEEK_SET);
+	} else {
+		fdcobsync (fd);
+		close (fd);
+	}
+	return ret;
 }
 
-/*
- * Free memory for cob_file
- */
-void
-cob_file_free (cob_file **pfl, cob_file_key **pky)
+/* write the images of the journal back, newest first;
+   returns zero on success */
+static int
+journal_apply (void)
 {
-	if (pky != NULL) {
-		if (*pky != NULL) {
-			cob_cache_free (*pky);
-			*pky = NULL;
-		}
+	struct journal_entry	e;
+	struct stat		st;
+	cob_s64_t		*entries = NULL;
+	size_t			nentries = 0, alloc_entries = 0;
+	cob_s64_t		pos = 0;
+	int			ret = 0;
+
+	if (fstat (journal_fd, &st)) {
+		return -1;
 	}
-	if (pfl != NULL && *pfl != NULL) {
-		struct file_list *fc, *prev;
-		cob_file	*fl = *pfl;
-		if (fl->linorkeyptr) {
-			cob_cache_free (fl->linorkeyptr);
-			fl->linorkeyptr = NULL;
-		}
-		if (fl->org_filename) {
-			cob_free (fl->org_filename);
-			fl->org_filename = NULL;
+	/* an incomplete entry at the end belongs to a change not done */
+	while (pos + (cob_s64_t)sizeof (e) <= (cob_s64_t)st.st_size) {
+		if (lseek (journal_fd, (off_t)pos, SEEK_SET) == (off_t)-1
+		 || read (journal_fd, &e, sizeof (e)) != (int)sizeof (e)
+		 || e.magic != JOURNAL_MAGIC
+		 || e.name_len == 0 || e.name_len > COB_FILE_MAX
+		 || e.len < 0
+		 || pos + (cob_s64_t)(sizeof (e) + e.name_len) + e.len
+		    > (cob_s64_t)st.st_size) {
+			break;
 		}
-		if (fl->convert_field) {
-			cob_free (fl->convert_field);
-			fl->convert_field = NULL;
+		if (nentries == alloc_entries) {
+			const size_t	old_size = alloc_entries * sizeof (cob_s64_t);
+			alloc_entries = alloc_entries ? alloc_entries * 2 : 256;
+			entries = entries
+				? cob_realloc (entries, old_size,
+					alloc_entries * sizeof (cob_s64_t))
+				: cob_malloc (alloc_entries * sizeof (cob_s64_t));
 		}
-
-		/* Remove from cache  */
-		prev = file_cache;
-		for (fc = file_cache; fc; fc =fc->next) {
-			if (fc->file == fl) {
-				if (fc == file_cache) {
-					file_cache = fc->next;
-				} else {
-					prev->next = fc->next;
-				}
-				cob_free (fc);
-				break;
-			}
-			prev = fc;
+		entries[nentries++] = pos;
+		pos += (cob_s64_t)(sizeof (e) + e.name_len) + e.len;
+	}
+	while (nentries > 0) {
+		if (journal_restore (entries[--nentries])) {
+			ret = -1;
 		}
-
-		cob_cache_free (*pfl);
-		*pfl = NULL;
 	}
+	if (entries) {
+		cob_free (entries);
+	}
+	return ret;
 }
 
-
-void
-cob_unlock_file (cob_file *f, cob_field *fnstatus)
-{
-	cob_file_unlock (f);
-	save_status (f, fnstatus, COB_STATUS_00_SUCCESS);
-}
-
-/*
- * Prepare for Open of data file; Used by EXTFH routines)
- */
+/* position a file after ROLLBACK changed it underneath */
 static void
-cob_pre_open (cob_file *f)
+journal_resync (cob_file *f)
 {
-	f->flag_nonexistent = 0;
-	f->flag_end_of_file = 0;
-	f->flag_begin_of_file = 0;
-	f->flag_first_read = 2;
-	f->flag_operation = 0;
+	struct seq_buffer	*b = seqbuf_get (f);
+	off_t			pos;
 
-	/* Obtain the file name */
-	if (f->fcd && f->fcd->fnamePtr && f->fcd->fnamePtr[0]) {
-		/* copy fieldname and cut at last space */
-		/* CHECKME: at least in the open case we directly copied
-		            the assign field before and could use the code below */
-		size_t i, max;
-		max = LDCOMPX2 (f->fcd->fnameLen);
-		if (max > (size_t)COB_FILE_MAX) {
-			max = (size_t)COB_FILE_MAX;
+	if (f->organization == COB_ORG_LINE_SEQUENTIAL) {
+		FILE	*fp = (FILE *)f->file;
+		if (f->open_mode == COB_OPEN_I_O) {
+			/* drops the data read ahead */
+			fseek (fp, ftell (fp), SEEK_SET);
+		} else {
+			fseek (fp, 0L, SEEK_END);
 		}
-		strncpy (file_open_name, f->fcd->fnamePtr, max);
-		for (i = max - 1; ; i--) {
-			if (file_open_name[i] && file_open_name[i] != ' ') {
-				file_open_name[i + 1] = 0;
-				break;
-			}
-			if (!i) {
-				break;
-			}
+		return;
+	}
+	if (f->open_mode == COB_OPEN_I_O) {
+		if (b) {
+			pos = (off_t)(b->offset + b->pos);
+			b->offset = (cob_s64_t)pos;
+			b->len = b->pos = 0;
+			(void)lseek (f->fd, pos, SEEK_SET);
 		}
-	} else
-	if (f->assign != NULL
-	 && f->assign->data != NULL) {
-		cob_field_to_string (f->assign, file_open_name, COB_FILE_MAX, CCM_NONE);
+		return;
+	}
+	pos = lseek (f->fd, (off_t)0, SEEK_END);
+	if (b && pos != (off_t)-1) {
+		b->offset = (cob_s64_t)pos;
+		b->len = 0;
 	}
 }
 
-/*
- * Open the data file
- */
-
-void
-cob_open (cob_file *f, const int mode, const int sharing, cob_field *fnstatus)
+/* make the changes of the unit of work durable: one sync per file */
+static void
+journal_commit (void)
 {
-	/*: GC4: mode as cob_open_mode */
+	struct journal_file	*jf;
 
-	last_operation_open = 1;
-
-	/* File was previously closed with lock */
-	if (f->open_mode == COB_OPEN_LOCKED) {
-		save_status (f, fnstatus, COB_STATUS_38_CLOSED_WITH_LOCK);
+	if (journal_fd == -1) {
 		return;
 	}
-
-	/* File is already open */
-	if (f->open_mode != COB_OPEN_CLOSED) {
-		save_status (f, fnstatus, COB_STATUS_41_ALREADY_OPEN);
+	/* buffered data belongs to this unit */
+	journal_flush_files ();
+	if (journal_size == 0) {
 		return;
 	}
-
-	f->flag_read_done = 0;
-	f->curkey = -1;
-	f->mapkey = -1;
-
-	f->last_open_mode = mode;
-	f->flag_nonexistent = 0;
-	f->flag_end_of_file = 0;
-	f->flag_begin_of_file = 0;
-	f->flag_first_read = 2;
-	f->flag_operation = 0;
-	f->lock_mode &= ~COB_LOCK_OPEN_EXCLUSIVE;
-	f->lock_mode |= sharing;
-
-	if (f->fcd) {
-		cob_fcd_file_sync (f, file_open_name);		/* Copy app's FCD to cob_file */
+	for (jf = journal_files; jf; jf = jf->next) {
+		if (jf->touched && jf->fd >= 0) {
+			fdcobsync (jf->fd);
+		}
 	}
+	journal_reset ();
+}
 
-	cob_pre_open (f);
+/* undo the changes of the unit of work */
+static void
+journal_rollback (void)
+{
+	struct journal_file	*jf;
 
-	if (unlikely (COB_FILE_STDIN (f))) {
-		if (mode != COB_OPEN_INPUT) {
-			save_status (f, fnstatus, COB_STATUS_30_PERMANENT_ERROR);
-			return;
-		}
-		f->file = stdin;
-		f->fd = fileno (stdin);
-		f->open_mode = mode;
-		save_status (f, fnstatus, COB_STATUS_00_SUCCESS);
+	if (journal_fd == -1) {
 		return;
 	}
-	if (unlikely (COB_FILE_STDOUT (f))) {
-		if (mode != COB_OPEN_OUTPUT) {
-			save_status (f, fnstatus, COB_STATUS_30_PERMANENT_ERROR);
-			return;
-		}
-		f->file = stdout;
-		f->fd = fileno (stdout);
-		f->open_mode = mode;
-		save_status (f, fnstatus, COB_STATUS_00_SUCCESS);
+	/* buffered data belongs to this unit */
+	journal_flush_files ();
+	if (journal_size == 0) {
 		return;
 	}
+	if (journal_apply ()) {
+		cob_runtime_warning (_("ROLLBACK could not restore all data of journal %s"),
+			cobsetptr->cob_file_journal);
+	}
+	for (jf = journal_files; jf; jf = jf->next) {
+		if (jf->touched && jf->fd >= 0 && jf->f) {
+			journal_resync (jf->f);
+		}
+	}
+#ifdef	COB_NATIVE_ISAM
+	cob_isam_journal_reload ();
+#endif
+	journal_reset ();
+}
 
-	if (f->assign == NULL) {
-		/* CHECKME: that _seems_ to be a codegen error, but may also happen with EXTFH */
-		cob_runtime_error (_("ERROR FILE %s has ASSIGN field is NULL"),
-							f->select_name);
-		save_status (f, fnstatus, COB_STATUS_31_INCONSISTENT_FILENAME);
+/* open the journal of COB_FILE_JOURNAL, rolling back what a program
+   that did not end left in it */
+static void
+journal_open (void)
+{
+	const char	*name = cobsetptr->cob_file_journal;
+
+	if (name == NULL || *name == 0) {
 		return;
 	}
-	if (f->assign->data == NULL) {
-#if 0 /* we don't raise an error in other places and a similar error is raised in cob_fatal_error */
-		cob_runtime_error ("file %s has ASSIGN field with NULL address",
-			f->select_name);
-#endif
-		save_status (f, fnstatus, COB_STATUS_31_INCONSISTENT_FILENAME);
+	journal_fd = open (name, O_RDWR | O_CREAT | O_BINARY, COB_FILE_MODE);
+	if (journal_fd == -1) {
+		cob_runtime_warning (_("cannot open journal %s: %s"),
+			name, cob_get_strerror ());
 		return;
 	}
-
-	/* Check for _bad_ quotes */
-	if (file_open_name[0] == '"'
-	 || file_open_name[0] == '\'') {
-		const size_t len = strlen (file_open_name) - 1;
-		if (len == 0
-		 || file_open_name[len] != file_open_name[0]) {
-			save_status (f, fnstatus, COB_STATUS_31_INCONSISTENT_FILENAME);
+#ifdef	HAVE_FCNTL
+	{
+		struct flock	lock;
+		memset ((void *)&lock, 0, sizeof (struct flock));
+		lock.l_type = F_WRLCK;
+		lock.l_whence = SEEK_SET;
+		lock.l_start = 0;
+		lock.l_len = 0;
+		if (fcntl (journal_fd, F_SETLK, &lock) == -1) {
+			cob_runtime_warning (_("journal %s is in use by another process"),
+				name);
+			close (journal_fd);
+			journal_fd = -1;
 			return;
 		}
 	}
-
-	if (file_open_name[0] == 0) {
-		save_status (f, fnstatus, COB_STATUS_31_INCONSISTENT_FILENAME);
-		return;
+#endif
+	if (lseek (journal_fd, (off_t)0, SEEK_END) > 0) {
+		if (journal_apply ()) {
+			cob_runtime_warning (_("ROLLBACK could not restore all data of journal %s"),
+				name);
+		}
+		journal_reset ();
 	}
+}
 
-	cob_cache_file (f);
+static void
+journal_close (void)
+{
+	struct journal_file	*jf;
 
-	f->flag_is_concat = 0;
-#if 0 /* Note: file specific features are 4.x only ... */
-	if (file_setptr->cob_concat_name
-	 && (f->organization == COB_ORG_SEQUENTIAL
-	  || f->organization == COB_ORG_LINE_SEQUENTIAL)
-	 && (mode == COB_OPEN_INPUT
-	  || mode == COB_OPEN_I_O)
-	 && strchr (file_open_name, file_setptr->cob_concat_sep[0]) != NULL
-	 && file_open_name[0] != '>'
-	 && file_open_name[0] != '<'
-	 && file_open_name[0] != '|') {
-		f->flag_is_concat = 1;
-		f->org_filename = cob_strdup (file_open_name);
-		f->nxt_filename = strchr (f->org_filename, file_setptr->cob_concat_sep[0]);
-		*f->nxt_filename++ = 0;
-		strcpy (file_open_name, f->org_filename);
+	if (journal_fd == -1) {
+		return;
 	}
-#else
-	if (cobsetptr->cob_concat_name
-	 && (f->organization == COB_ORG_SEQUENTIAL
-	  || f->organization == COB_ORG_LINE_SEQUENTIAL)
-	 && (mode == COB_OPEN_INPUT
-	  || mode == COB_OPEN_I_O)
-	 && strchr (file_open_name, cobsetptr->cob_concat_sep[0]) != NULL
-	 && file_open_name[0] != '>'
-	 && file_open_name[0] != '<'
-	 && file_open_name[0] != '|') {
-		f->flag_is_concat = 1;
-		f->org_filename = cob_strdup (file_open_name);
-		f->nxt_filename = strchr (f->org_filename, cobsetptr->cob_concat_sep[0]);
-		*f->nxt_filename++ = 0;
-		strcpy (file_open_name, f->org_filename);
+	journal_commit ();
+	close (journal_fd);
+	journal_fd = -1;
+	while (journal_files) {
+		jf = journal_files;
+		journal_files = jf->next;
+		journal_free_file (jf);
 	}
-#endif
+	if (journal_buff) {
+		cob_free (journal_buff);
+		journal_buff = NULL;
+		journal_buff_size = 0;
+	}
+}
 
-	/* Open the file */
-	save_status (f, fnstatus,
-		     fileio_funcs[(int)f->organization]->open (f, file_open_name,
-								mode, sharing));
+void
+cob_commit (void)
+{
+	struct file_list	*l;
+
+	journal_commit ();
+	for (l = file_cache; l; l = l->next) {
+		if (l->file) {
+			cob_file_unlock (l->file);
+		}
+	}
 }
 
 void
-cob_close (cob_file *f, cob_field *fnstatus, const int opt, const int remfil)
+cob_rollback (void)
 {
 	struct file_list	*l;
-	struct file_list	*m;
-	int			ret;
 
-	f->flag_read_done = 0;
-	f->flag_operation = 0;
+	journal_rollback ();
+	for (l = file_cache; l; l = l->next) {
+		if (l->file) {
+			cob_file_unlock (l->file);
+		}
+	}
+}
 
-	f->lock_mode &= ~COB_LOCK_OPEN_EXCLUSIVE;
+void
+cob_delete_file (cob_file *f, cob_field *fnstatus)
+{
+	if (f->organization == COB_ORG_SORT) {
+		save_status (f, fnstatus, COB_STATUS_30_PERMANENT_ERROR);
+		return;
+	}
 
-	if (COB_FILE_SPECIAL (f)) {
-		f->open_mode = COB_OPEN_CLOSED;
-		f->file = NULL;
-		f->fd = -1;
-		save_status (f, fnstatus, COB_STATUS_00_SUCCESS);
+	/* File was previously closed with lock */
+	if (f->open_mode == COB_OPEN_LOCKED) {
+		save_status (f, fnstatus, COB_STATUS_38_CLOSED_WITH_LOCK);
 		return;
 	}
 
-	if (unlikely (remfil)) {
-		/* Remove from cache - Needed for CANCEL */
-		/* Setting m silences false compiler warning */
-		m = file_cache;
-		for (l = file_cache; l; l = l->next) {
-			if (f == l->file) {
-				if (l == file_cache) {
-					file_cache = l->next;
-				} else {
-					m->next = l->next;
-				}
-				cob_free (l);
-				break;
-			}
-			m = l;
-		}
+	/* File is open */
+	if (f->open_mode != COB_OPEN_CLOSED) {
+		save_status (f, fnstatus, COB_STATUS_41_ALREADY_OPEN);
+		return;
 	}
 
-	if (f->open_mode == COB_OPEN_CLOSED
-	 || f->open_mode == COB_OPEN_LOCKED) {
-		save_status (f, fnstatus, COB_STATUS_42_NOT_OPEN);
+	if (unlikely (COB_FILE_STDIN (f) || COB_FILE_STDOUT (f))) {
+		save_status (f, fnstatus, COB_STATUS_30_PERMANENT_ERROR);
 		return;
 	}
 
-	if (f->flag_nonexistent) {
-		save_status (f, fnstatus, COB_STATUS_00_SUCCESS);
-		f->open_mode = COB_OPEN_CLOSED;
+	/* DELETE FILE cannot be undone, it ends the unit of work */
+	journal_commit ();
+
+	/* Obtain the file name */
+	cob_field_to_string (f->assign, file_open_name, COB_FILE_MAX, CCM_NONE);
+	cob_chk_file_mapping ();
+
+	if (f->organization != COB_ORG_INDEXED) {
+#ifdef	WITH_SEQRA_EXTFH
+		save_status (f, fnstatus, COB_STATUS_91_NOT_AVAILABLE);
+		return;
+#else
+		unlink (file_open_name);
+#endif
+	} else {
+#ifdef	WITH_INDEX_EXTFH
+		save_status (f, fnstatus, COB_STATUS_91_NOT_AVAILABLE);
 		return;
+#else
+		indexed_file_delete (f, file_open_name);
+#endif
 	}
+	save_status (f, fnstatus, errno_cob_sts(COB_STATUS_00_SUCCESS));
+}
 
-	ret = fileio_funcs[(int)f->organization]->close (f, opt);
-	if (ret == COB_STATUS_00_SUCCESS) {
-		switch (opt) {
-		case COB_CLOSE_LOCK:
-			f->open_mode = COB_OPEN_LOCKED;
-			break;
-		default:
-			f->open_mode = COB_OPEN_CLOSED;
-			break;
-		}
+/* Return index number for given key and set length attributes,
+	 storing resulting key field in file's last_key */
+int
+cob_findkey (cob_file *f, cob_field *kf, int *fullkeylen, int *partlen)
+{
+	int 	k = cob_findkey_attr (f, kf, fullkeylen, partlen);
+#if 0 /* pending merge of r1411 */
+	if (k >= 0) {
+		f->last_key = f->keys[k].field;
 	}
-
-	save_status (f, fnstatus, ret);
+#endif
+	return k;
 }
 
-#if	0	/* RXWRXW - unlock */
-void
-cob_unlock (cob_file *f)
+/* Copy key data and return length of data copied */
+static int
+cob_savekey (cob_file *f, int idx, unsigned char *data)
 {
-	int	ret;
-
-	f->flag_read_done = 0;
+	int 	len,part;
 
-	if (f->open_mode == COB_OPEN_CLOSED) {
-		save_status (f, fnstatus, COB_STATUS_42_NOT_OPEN);
-		return;
+	if (f->keys[idx].field == NULL)
+		return -1;
+	if (f->keys[idx].count_components <= 1) {
+		if (data != f->keys[idx].field->data) {
+			memcpy (data, f->keys[idx].field->data, f->keys[idx].field->size);
+		}
+		return (int)f->keys[idx].field->size;
 	}
-
-	if (f->flag_nonexistent) {
-		ret = COB_STATUS_00_SUCCESS;
-	} else {
-		ret = fileio_funcs[(int)f->organization]->close (f, opt);
+	for (len=part=0; part < f->keys[idx].count_components; part++) {
+		memcpy (&data[len], f->keys[idx].component[part]->data,
+							f->keys[idx].component[part]->size);
+		len += f->keys[idx].component[part]->size;
 	}
-
-	save_status (f, fnstatus, ret);
+	return len;
 }
-#endif
 
-void
-cob_start (cob_file *f, const int cond, cob_field *key,
-	   cob_field *keysize, cob_field *fnstatus)
+/* System routines */
+
+/* stores the field's rtrimmed string content into a fresh allocated
+	 string, which later needs to be passed to cob_free */
+static void *
+cob_str_from_fld (const cob_field *f)
 {
-	int		ret;
-	cob_field	tempkey;
+#if	0	/* Quotes in file */
+	register int	quote_switch = 0;
+#endif
+	register unsigned char	*end, *data, *s;
+	void		*mptr;
 
-	f->flag_read_done = 0;
-	f->flag_first_read = 0;
 
-	if (unlikely (f->open_mode != COB_OPEN_I_O
-		       && f->open_mode != COB_OPEN_INPUT)) {
-		save_status (f, fnstatus, COB_STATUS_47_INPUT_DENIED);
-		return;
+	if (!f || f->size == 0 || !f->data) {
+		return cob_malloc ((size_t)1);
 	}
 
-	if (unlikely (f->access_mode == COB_ACCESS_RANDOM)) {
-		save_status (f, fnstatus, COB_STATUS_47_INPUT_DENIED);
-		return;
+	data = f->data;
+	end = data + f->size - 1;
+	while (end > data) {
+		if (*end != ' ' && *end) {
+			break;
+		}
+		end--;
 	}
-
-	if (f->flag_nonexistent) {
-		save_status (f, fnstatus, COB_STATUS_23_KEY_NOT_EXISTS);
-		return;
+	s = mptr = cob_fast_malloc (end + 1 - data + 1);
+	if (*end == ' ' || *end == 0) {
+		*s = 0;
+		return s;
 	}
 
-	if (unlikely (keysize)) {
-		int		size = cob_get_int (keysize);
-		if (size < 1 || size > (int)key->size) {
-			save_status (f, fnstatus, COB_STATUS_23_KEY_NOT_EXISTS);
-			return;
+	while (data <= end) {
+#if 0	/* Quotes in file */
+		if (*data == '"') {
+			quote_switch = !quote_switch;
+			data++;
+			continue;
 		}
-		tempkey = *key;
-		tempkey.size = (size_t)size;
-		ret = fileio_funcs[(int)f->organization]->start (f, cond, &tempkey);
-	} else {
-		ret = fileio_funcs[(int)f->organization]->start (f, cond, key);
-	}
-	if (ret == COB_STATUS_00_SUCCESS) {
-		f->flag_end_of_file = 0;
-		f->flag_begin_of_file = 0;
-		f->flag_first_read = 1;
-	} else {
-		f->flag_end_of_file = 1;
-		f->flag_begin_of_file = 0;
-		f->flag_first_read = 1;
+		if (!quote_switch
+		 &&  (*data == ' '
+		   || *data == 0)) {
+			break;
+		}
+#else
+		if (*data == '"') {
+			data++;
+			continue;
+		}
+#endif
+		*s++ = *data++;
 	}
+	*s = 0;
 
-	save_status (f, fnstatus, ret);
+	return mptr;
 }
 
-void
-cob_read (cob_file *f, cob_field *key, cob_field *fnstatus, const int read_opts)
+/* actual processing for CBL_OPEN_FILE and CBL_CREATE_FILE */
+static int
+open_cbl_file (unsigned char *file_name, unsigned char *file_access,
+	       unsigned char *file_handle, const int file_flags)
 {
-	int	ret;
+	int	flag = O_BINARY;
+	int	fd;
 
-	f->flag_read_done = 0;
+	COB_UNUSED (file_name);
 
-	if (unlikely (f->open_mode != COB_OPEN_INPUT
-		       && f->open_mode != COB_OPEN_I_O)) {
-		save_status (f, fnstatus, COB_STATUS_47_INPUT_DENIED);
-		return;
+	if (!COB_MODULE_PTR->cob_procedure_params[0]) {
+		memset (file_handle, -1, (size_t)4);
+		return -1;
+	}
+	flag |= file_flags;
+	switch (*file_access & 0x3F) {
+		case 1:
+			flag |= O_RDONLY;
+			break;
+		case 2:
+			flag |= O_CREAT | O_TRUNC | O_WRONLY;
+			break;
+		case 3:
+			flag |= O_RDWR;
+			break;
+		default:
+			cob_runtime_warning (_("call to CBL_OPEN_FILE with wrong access mode: %d"), *file_access & 0x3F);
+			memset (file_handle, -1, (size_t)4);
+			return -1;
 	}
 
-	if (unlikely (f->flag_nonexistent)) {
-		if (f->flag_first_read == 0) {
-			save_status (f, fnstatus, COB_STATUS_23_KEY_NOT_EXISTS);
-			return;
-		}
-		f->flag_first_read = 0;
-		save_status (f, fnstatus, COB_STATUS_10_END_OF_FILE);
-		return;
+	{
+		char	*fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[0]);
+		strncpy (file_open_name, fn, (size_t)COB_FILE_MAX);
+		file_open_name[COB_FILE_MAX] = 0;
+		cob_free (fn);
 	}
 
-	/* Sequential read at the end of file is an error */
-	if (key == NULL) {
-		if (unlikely (f->flag_end_of_file
-		           && !(read_opts & COB_READ_PREVIOUS))) {
-			save_status (f, fnstatus, COB_STATUS_46_READ_ERROR);
-			return;
-		}
-		if (unlikely (f->flag_begin_of_file
-			       && (read_opts & COB_READ_PREVIOUS))) {
-			save_status (f, fnstatus, COB_STATUS_46_READ_ERROR);
-			return;
-		}
-		ret = fileio_funcs[(int)f->organization]->read_next (f, read_opts);
-	} else {
-		ret = fileio_funcs[(int)f->organization]->read (f, key, read_opts);
+	cob_chk_file_mapping ();
+
+	fd = open (file_open_name, flag, COB_FILE_MODE);
+	if (fd == -1) {
+		int ret = errno_cob_sts (COB_STATUS_35_NOT_EXISTS);
+		memset (file_handle, -1, (size_t)4);
+		return ret;
 	}
+	memcpy (file_handle, &fd, (size_t)4);
+	return 0;
+}
+
+/* entry point for library routine CBL_OPEN_FILE */
+int
+cob_sys_open_file (unsigned char *file_name, unsigned char *file_access,
+		   unsigned char *file_lock, unsigned char *file_dev,
+		   unsigned char *file_handle)
+{
+	COB_UNUSED (file_lock);
+	COB_UNUSED (file_dev);
+
+	COB_CHK_PARMS (CBL_OPEN_FILE, 5);
+
+#ifdef	WORDS_BIGENDIAN
+	/* if value is passed as numeric literal, it becomes an 'int' so value is in 4th byte */
+	if (file_access[0] == 0
+	 && file_access[1] == 0
+	 && file_access[2] == 0)
+		file_access += 3;
+	if (file_lock[0] == 0
+	 && file_lock[1] == 0
+	 && file_lock[2] == 0)
+		file_lock += 3;
+	if (file_dev[0] == 0
+	 && file_dev[1] == 0
+	 && file_dev[2] == 0)
+		file_dev += 3;
+#endif
+
+	return open_cbl_file (file_name, file_access, file_handle, 0);
+}
+
+/* entry point for library routine CBL_CREATE_FILE */
+int
+cob_sys_create_file (unsigned char *file_name, unsigned char *file_access,
+		     unsigned char *file_lock, unsigned char *file_dev,
+		     unsigned char *file_handle)
+{
+	/*
+	 * @param: file_access : 1 (read-only), 2 (write-only), 3 (both)
+	 * @param: file_lock : not implemented, set 0
+	 * @param: file_dev : not implemented, set 0
+	 */
 
-	switch (ret) {
-	case COB_STATUS_00_SUCCESS:
-	case COB_STATUS_02_SUCCESS_DUPLICATE:
-	case COB_STATUS_04_SUCCESS_INCOMPLETE:
-	case COB_STATUS_06_READ_TRUNCATE:
-	case COB_STATUS_09_READ_DATA_BAD:
-#if defined (COB_EXPERIMENTAL)
-	case COB_STATUS_0P_NOT_PRINTABLE:
+	COB_CHK_PARMS (CBL_CREATE_FILE, 5);
+
+#ifdef	WORDS_BIGENDIAN
+	/* if value is passed as numeric literal, it becomes an 'int' so value is in 4th byte */
+	if (file_access[0] == 0
+	 && file_access[1] == 0
+	 && file_access[2] == 0)
+		file_access += 3;
+	if (file_lock[0] == 0
+	 && file_lock[1] == 0
+	 && file_lock[2] == 0)
+		file_lock += 3;
+	if (file_dev[0] == 0
+	 && file_dev[1] == 0
+	 && file_dev[2] == 0)
+		file_dev += 3;
 #endif
-		f->flag_first_read = 0;
-		f->flag_read_done = 1;
-		f->flag_end_of_file = 0;
-		f->flag_begin_of_file = 0;
-		if (f->variable_record) {
-			cob_set_int (f->variable_record, (int) f->record->size);
-		}
-		break;
-	case COB_STATUS_10_END_OF_FILE:
-		if (read_opts & COB_READ_PREVIOUS) {
-			f->flag_begin_of_file = 1;
-		} else {
-			f->flag_end_of_file = 1;
-		}
-		break;
+
+	if (*file_lock != 0) {
+		cob_runtime_warning (_("call to CBL_CREATE_FILE with wrong file_lock: %d"), *file_lock);
+	}
+	if (*file_dev != 0) {
+		cob_runtime_warning (_("call to CBL_CREATE_FILE with wrong file_dev: %d"), *file_dev);
 	}
 
-	save_status (f, fnstatus, ret);
+	return open_cbl_file (file_name, file_access, file_handle, O_CREAT | O_TRUNC);
 }
 
-static int
-is_suppressed_key_value (cob_file *f, const int idx)
+/* entry point and processing for library routine CBL_READ_FILE */
+int
+cob_sys_read_file (unsigned char *file_handle, unsigned char *file_offset,
+		   unsigned char *file_len, unsigned char *flags,
+		   unsigned char *buf)
 {
-	if (idx < 0 || idx >= (int)f->nkeys) {
-		return -1;
-	}
-#if 0	/* TODO: SUPPRESS string not merged yet */
-	if (f->keys[idx].len_suppress > 0) {
-		(void) cob_savekey (f, idx, f->keys[idx].field->data);
-		if (memcmp (f->keys[idx].field->data,
-			        f->keys[idx].str_suppress,
-			        f->keys[idx].len_suppress) == 0) {
-			return 1;
+	cob_s64_t	off;
+	int		fd;
+	int		len;
+
+	COB_CHK_PARMS (CBL_READ_FILE, 5);
+
+	memcpy (&fd, file_handle, 4);
+	if ((*flags & 0x80) != 0) {
+		struct stat	st;
+		if (fstat (fd, &st) < 0) {
+			return -1;
 		}
-	} else
+		off = st.st_size;
+#ifndef	WORDS_BIGENDIAN
+		off = COB_BSWAP_64 (off);
 #endif
-	if (f->keys[idx].tf_suppress) {
-		int pos = cob_savekey (f, idx, f->keys[idx].field->data);
-		for (pos = 0;
-			 pos < (int)f->keys[idx].field->size
-		  && f->keys[idx].field->data[pos] == (unsigned char)f->keys[idx].char_suppress;
-			 pos++);
-		/* All SUPPRESS char ? */
-		if (pos == f->keys[idx].field->size) {
-			return 1;
+		memcpy (file_offset, &off, 8);
+		return 0;
+	}
+
+	memcpy (&off, file_offset, 8);
+	memcpy (&len, file_len, 4);
+#ifndef	WORDS_BIGENDIAN
+	off = COB_BSWAP_64 (off);
+	len = COB_BSWAP_32 (len);
+#endif
+	if (lseek (fd, off, SEEK_SET) == -1) {
+		return -1;	/* error in positioning -> bad offset */
+	}
+
+	if (len > 0) {
+		const int	rc = read (fd, buf, (size_t)len);
+		if (rc < 0) {
+			return -1;	/* error in read */
+		} else if (rc == 0) {
+			/* 0 byte read -> "at end" */
+			return COB_STATUS_10_END_OF_FILE;
 		}
 	}
-	return 0;
+	return COB_STATUS_00_SUCCESS;
 }
 
-
-void
-cob_read_next (cob_file *f, cob_field *fnstatus, const int read_opts)
+/* entry point and processing for library routine CBL_WRITE_FILE */
+int
+cob_sys_write_file (unsigned char *file_handle, unsigned char *file_offset,
+		    unsigned char *file_len, unsigned char *flags,
+		    unsigned char *buf)
 {
-	int	ret,idx;
-
-	f->flag_read_done = 0;
+	cob_s64_t	off;
+	int		fd;
+	int		len;
+	int		rc;
 
-	if (unlikely (f->open_mode != COB_OPEN_INPUT
-		       && f->open_mode != COB_OPEN_I_O)) {
-		save_status (f, fnstatus, COB_STATUS_47_INPUT_DENIED);
-		return;
-	}
+	COB_UNUSED (flags);
 
-	if (unlikely (f->flag_nonexistent)) {
-		if (f->flag_first_read == 0) {
-			save_status (f, fnstatus, COB_STATUS_46_READ_ERROR);
-			return;
-		}
-		f->flag_first_read = 0;
-		save_status (f, fnstatus, COB_STATUS_10_END_OF_FILE);
-		return;
-	}
+	COB_CHK_PARMS (CBL_WRITE_FILE, 5);
 
-	/* Sequential read at the end of file is an error */
-	if (unlikely (f->flag_end_of_file && !(read_opts & COB_READ_PREVIOUS))) {
-		save_status (f, fnstatus, COB_STATUS_46_READ_ERROR);
-		return;
+	memcpy (&fd, file_handle, 4);
+	memcpy (&off, file_offset, 8);
+	memcpy (&len, file_len, 4);
+#ifndef	WORDS_BIGENDIAN
+	off = COB_BSWAP_64 (off);
+	len = COB_BSWAP_32 (len);
+#endif
+	if (lseek (fd, off, SEEK_SET) == -1) {
+		return -1;
 	}
-	if (unlikely (f->flag_begin_of_file && (read_opts & COB_READ_PREVIOUS))) {
-		save_status (f, fnstatus, COB_STATUS_46_READ_ERROR);
-		return;
+	rc = (int) write (fd, buf, (size_t)len);
+	if (rc != len) {
+		return COB_STATUS_30_PERMANENT_ERROR;
 	}
+	return COB_STATUS_00_SUCCESS;
+}
 
-Again:
-	ret = fileio_funcs[(int)f->organization]->read_next (f, read_opts);
-
-	switch (ret) {
-	case COB_STATUS_00_SUCCESS:
-	case COB_STATUS_02_SUCCESS_DUPLICATE:
-	case COB_STATUS_04_SUCCESS_INCOMPLETE:
-	case COB_STATUS_06_READ_TRUNCATE:
-	case COB_STATUS_09_READ_DATA_BAD:
-#if defined (COB_EXPERIMENTAL)
-	case COB_STATUS_0P_NOT_PRINTABLE:
-#endif
-		/* If record has suppressed key, skip it */
-		/* This is to catch CISAM, old VBISAM, ODBC & OCI */
-		if (f->organization == COB_ORG_INDEXED) {
-			idx = f->curkey;
-			if (f->mapkey >= 0) {	/* FD has Indexes in alternate appearance */
-				idx = f->mapkey;
-			}
-			if (is_suppressed_key_value (f, idx) > 0) {
-				/* SUPPRESS -> so skip */
-				goto Again;
-			}
-		}
+/* entry point and processing for library routine CBL_CLOSE_FILE */
+int
+cob_sys_close_file (unsigned char *file_handle)
+{
+	int	fd;
 
-		f->flag_first_read = 0;
-		f->flag_read_done = 1;
-		f->flag_end_of_file = 0;
-		f->flag_begin_of_file = 0;
-		if (f->variable_record) {
-			cob_set_int (f->variable_record, (int) f->record->size);
-		}
-		break;
-	case COB_STATUS_10_END_OF_FILE:
-		if (read_opts & COB_READ_PREVIOUS) {
-			f->flag_begin_of_file = 1;
-		} else {
-			f->flag_end_of_file = 1;
-		}
-		break;
-	}
+	COB_CHK_PARMS (CBL_CLOSE_FILE, 1);
 
-	save_status (f, fnstatus, ret);
+	memcpy (&fd, file_handle, 4);
+	return close (fd);
 }
 
-/* CODE-SET conversion for re-/write */
-static unsigned char *
-get_code_set_converted_data (cob_file *f)
+/* entry point and processing for library routine CBL_FLUSH_FILE
+	 (flush bytestream file handle, got from CBL_OPEN_FILE) */
+int
+cob_sys_flush_file (unsigned char *file_handle)
 {
-	const size_t size = f->record->size;
-	unsigned char *real_rec_data = f->record->data;
-	unsigned char *converted_copy = cob_malloc (size);
-	if (!converted_copy) return NULL;
+	int	fd;
 
-	if (f->nconvert_fields) {
-		/* CODE-SET FOR - convert specific areas only */
-		const unsigned char *rec_end = converted_copy + size;
-		size_t ic;
-		memcpy (converted_copy, real_rec_data, size);
-		for (ic = 0; ic < f->nconvert_fields; ic++) {
-			const cob_field to_conv = f->convert_field[ic];
-			const unsigned char *to_conv_end = to_conv.data + to_conv.size;
-			const unsigned char *conv_end = rec_end < to_conv_end ? rec_end : to_conv_end;
-			unsigned char *p;
-			for (p = to_conv.data; p < conv_end; p++) {
-				*p = f->sort_collating[*p];
-			}
-		}
-	} else {
-		/* CODE-SET FOR - convert complete record */
-		const unsigned char *rec_end = real_rec_data + size;
-		unsigned char *d, *p;
-		for (d = converted_copy, p = real_rec_data; p < rec_end; d++, p++) {
-			*d = f->sort_collating[*p];
-		}
-	}
+	COB_CHK_PARMS (CBL_FLUSH_FILE, 1);
 
-	return converted_copy;
+	memcpy (&fd, file_handle, sizeof (int));
+	return fdcobsync (fd);
 }
 
-void
-cob_write (cob_file *f, cob_field *rec, const int opt, cob_field *fnstatus,
-	   const unsigned int check_eop)
+/* entry point and processing for library routine CBL_DELETE_FILE */
+int
+cob_sys_delete_file (unsigned char *file_name)
 {
-	f->flag_read_done = 0;
+	int	ret;
 
-	if (f->access_mode == COB_ACCESS_SEQUENTIAL) {
-		if (unlikely (f->open_mode != COB_OPEN_OUTPUT
-			       && f->open_mode != COB_OPEN_EXTEND)) {
-			save_status (f, fnstatus, COB_STATUS_48_OUTPUT_DENIED);
-			return;
-		}
-	} else {
-		if (unlikely (f->open_mode != COB_OPEN_OUTPUT
-			       && f->open_mode != COB_OPEN_I_O)) {
-			save_status (f, fnstatus, COB_STATUS_48_OUTPUT_DENIED);
-			return;
-		}
-	}
+	COB_UNUSED (file_name);
 
-	if (f->variable_record) {
-		f->record->size = (size_t)cob_get_int (f->variable_record);
-		if (unlikely (f->record->size > rec->size)) {
-			f->record->size = rec->size;
-		}
-	} else {
-		f->record->size = rec->size;
-	}
+	COB_CHK_PARMS (CBL_DELETE_FILE, 1);
 
-	if (f->record->size < f->record_min || f->record_max < f->record->size) {
-		save_status (f, fnstatus, COB_STATUS_44_RECORD_OVERFLOW);
-		return;
+	if (!COB_MODULE_PTR->cob_procedure_params[0]) {
+		return -1;
 	}
 
-	check_eop_status = check_eop;
-
-	if (f->organization == COB_ORG_LINE_SEQUENTIAL) {
-		/* Re-Determine the size to be written (done here so possible
-		   CODE-SET conversions do not convert trailing spaces when
-		   not part of the record [= fixed length] */
-		const size_t size = lineseq_size (f);
-		/* early pre-validation for data we'd otherwise convert */
-		if (cobsetptr->cob_ls_validate
-		 && !f->flag_line_adv
-		 && f->sort_collating) {
-			const unsigned char *p = f->record->data;
-			size_t i;
-#if 0 /* Note: file specific features are 4.x only ... */
-			if (f->file_features & COB_FILE_LS_VALIDATE) {
-#else
-			if (cobsetptr->cob_ls_validate == 1) {
-#endif
-				for (i = 0; i < size; ++i, ++p) {
-					if (IS_BAD_CHAR (*p)) {
-						save_status (f, fnstatus, COB_STATUS_71_BAD_CHAR);
-						return;
-					}
-				}
-#if defined (COB_EXPERIMENTAL)
-			} else {
-				for (i = 0; i < size; ++i, ++p) {
-					if (IS_BAD_CHAR (*p)) {
-						save_status (f, fnstatus, COB_STATUS_71_BAD_CHAR);
-						return;
-					}
-				}
-				int sts = 0;
-				for (i = 0; i < size; ++i, ++p) {
-					if (IS_BAD_CHAR (*p)) {
-						save_status (f, fnstatus, COB_STATUS_71_BAD_CHAR);
-						return;
-					}
-					if (IS_NOT_PRINTABLE (*p)) {
-						sts = COB_STATUS_0P_NOT_PRINTABLE;
-					}
-				}
-				if (sts != 0) {
-					save_status (f, fnstatus, COB_STATUS_0P_NOT_PRINTABLE);
-					return;
-				}
-#endif
-			}
-		}
-		f->record->size = size;
+	{
+		char	*fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[0]);
+		strncpy (file_open_name, fn, (size_t)COB_FILE_MAX);
+		file_open_name[COB_FILE_MAX] = 0;
+		cob_free (fn);
 	}
+	cob_chk_file_mapping ();
 
-	/* CODE-SET conversion (write from converted shadow-copy) */
-	if (f->organization != COB_ORG_SORT && f->sort_collating) {
-		unsigned char *real_rec_data = f->record->data;
-		unsigned char *converted_copy = get_code_set_converted_data (f);
-		if (!converted_copy) {
-			save_status (f, fnstatus, COB_STATUS_30_PERMANENT_ERROR);
-			return;
-		}
-		f->record->data = converted_copy;
-		save_status (f, fnstatus,
-			     fileio_funcs[(int)f->organization]->write (f, opt));
-		f->record->data = real_rec_data;
-		cob_free (converted_copy);
-		return;
+	ret = unlink (file_open_name);
+	if (ret) {
+		return 128;
 	}
-
-	save_status (f, fnstatus,
-		     fileio_funcs[(int)f->organization]->write (f, opt));
+	return 0;
 }
 
-void
-cob_rewrite (cob_file *f, cob_field *rec, const int opt, cob_field *fnstatus)
+/* entry point and processing for library routine CBL_COPY_FILE,
+	 does a direct read + write of the complete file */
+int
+cob_sys_copy_file (unsigned char *fname1, unsigned char *fname2)
 {
-	int	read_done;
+	int	flag = O_BINARY;
+	int	ret;
+	int	i;
+	int	fd1, fd2;
 
-	read_done = f->flag_read_done;
-	f->flag_read_done = 0;
+	COB_UNUSED (fname1);
+	COB_UNUSED (fname2);
 
-	if (unlikely (f->open_mode != COB_OPEN_I_O)) {
-		save_status (f, fnstatus, COB_STATUS_49_I_O_DENIED);
-		return;
+	COB_CHK_PARMS (CBL_COPY_FILE, 2);
+
+	if (!COB_MODULE_PTR->cob_procedure_params[0]) {
+		return -1;
+	}
+	if (!COB_MODULE_PTR->cob_procedure_params[1]) {
+		return -1;
 	}
 
-	if (f->access_mode == COB_ACCESS_SEQUENTIAL && !read_done) {
-		save_status (f, fnstatus, COB_STATUS_43_READ_NOT_DONE);
-		return;
+	{
+		char	*fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[0]);
+		strncpy (file_open_name, fn, (size_t)COB_FILE_MAX);
+		file_open_name[COB_FILE_MAX] = 0;
+		cob_free (fn);
 	}
+	cob_chk_file_mapping ();
 
-	if (unlikely (f->organization == COB_ORG_SEQUENTIAL)) {
-		if (f->record->size != rec->size) {
-			save_status (f, fnstatus, COB_STATUS_44_RECORD_OVERFLOW);
-			return;
-		}
+	flag |= O_RDONLY;
+	fd1 = open (file_open_name, flag, 0);
+	if (fd1 == -1) {
+		return errno_cob_sts (COB_STATUS_35_NOT_EXISTS);
+	}
 
-		if (f->variable_record) {
-			if (f->record->size != (size_t)cob_get_int (f->variable_record)) {
-				save_status (f, fnstatus, COB_STATUS_44_RECORD_OVERFLOW);
-				return;
-			}
-		}
+	{
+		char	*fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[1]);
+		strncpy (file_open_name, fn, (size_t)COB_FILE_MAX);
+		file_open_name[COB_FILE_MAX] = 0;
+		cob_free (fn);
 	}
+	cob_chk_file_mapping ();
 
-	if (f->variable_record) {
-		f->record->size = (size_t)cob_get_int (f->variable_record);
-		if (f->record->size < f->record_min || f->record_max < f->record->size) {
-			save_status (f, fnstatus, COB_STATUS_44_RECORD_OVERFLOW);
-			return;
-		}
-		if (unlikely(f->record->size > rec->size)) {
-			/* CHECKME: Shouldn't this get a status? */
-			f->record->size = rec->size;
+	flag &= ~O_RDONLY;
+	flag |= O_CREAT | O_TRUNC | O_WRONLY;
+	fd2 = open (file_open_name, flag, COB_FILE_MODE);
+	if (fd2 == -1) {
+		ret = errno_cob_sts (COB_STATUS_35_NOT_EXISTS);
+		close (fd1);
+		return ret;
+	}
+
+	ret = 0;
+	while ((i = read (fd1, file_open_buff, COB_FILE_BUFF)) > 0) {
+		if (write (fd2, file_open_buff, (size_t)i) != (size_t)i) {
+			ret = -1;
+			break;
 		}
-	} else {
-		f->record->size = rec->size;
 	}
+	close (fd1);
+	close (fd2);
+	return ret;
+}
 
-	if (f->organization == COB_ORG_LINE_SEQUENTIAL) {
-		/* Re-Determine the size to be written (done here so possible
-		   CODE-SET conversions do not convert trailing spaces when
-		   not part of the record [= fixed length] */
-		size_t size = lineseq_size (f);
-		/* early pre-validation for data we'd otherwise convert */
-		if (cobsetptr->cob_ls_validate
-		 && !f->flag_line_adv
-		 && f->sort_collating) {
-			const unsigned char *p = f->record->data;
-			size_t i;
-#if 0 /* Note: file specific features are 4.x only ... */
-			if (f->file_features & COB_FILE_LS_VALIDATE) {
+/* entry point and processing for library routine CBL_CHECK_FILE_EXIST */
+int
+cob_sys_check_file_exist (unsigned char *file_name, unsigned char *file_info)
+{
+	struct tm	*tm;
+	cob_s64_t	sz;
+	struct stat	st;
+	short		y;
+	short		d, m, hh, mm, ss;
+
+	COB_UNUSED (file_name);
+
+	COB_CHK_PARMS (CBL_CHECK_FILE_EXIST, 2);
+
+	if (!COB_MODULE_PTR->cob_procedure_params[0]
+	 || !COB_MODULE_PTR->cob_procedure_params[1]) {
+		return -1;
+	}
+	if (COB_MODULE_PTR->cob_procedure_params[1]->size < 16U) {
+		cob_runtime_error (_("'%s' - File detail area is too short"), "CBL_CHECK_FILE_EXIST");
+#if 0 /* should be handled by the caller,
+		TODO: check for better return code (or the one from MF/ACU) */
+		cob_hard_failure ();
 #else
-			if (cobsetptr->cob_ls_validate == 1) {
-#endif
-				for (i = 0; i < size; ++i, ++p) {
-					if (IS_BAD_CHAR (*p)) {
-						save_status (f, fnstatus, COB_STATUS_71_BAD_CHAR);
-						return;
-					}
-				}
-#if defined (COB_EXPERIMENTAL)
-			} else {
-				int sts = 0;
-				for (i = 0; i < size; ++i, ++p) {
-					if (IS_BAD_CHAR (*p)) {
-						save_status (f, fnstatus, COB_STATUS_71_BAD_CHAR);
-						return;
-					}
-					if (IS_NOT_PRINTABLE (*p)) {
-						sts = COB_STATUS_0P_NOT_PRINTABLE;
-					}
-				}
-				if (sts != 0) {
-					save_status (f, fnstatus, COB_STATUS_0P_NOT_PRINTABLE);
-					return;
-				}
+		return -1;
 #endif
-			}
-		}
-		f->record->size = size;
 	}
 
-	/* CODE-SET conversion (rewrite from converted shadow-copy) */
-	if (f->organization != COB_ORG_SORT && f->sort_collating) {
-		unsigned char *real_rec_data = f->record->data;
-		unsigned char *converted_copy = get_code_set_converted_data (f);
-		if (!converted_copy) {
-			save_status (f, fnstatus, COB_STATUS_30_PERMANENT_ERROR);
-			return;
-		}
-		f->record->data = converted_copy;
-		save_status (f, fnstatus,
-				 fileio_funcs[(int)f->organization]->rewrite (f, opt));
-		f->record->data = real_rec_data;
-		cob_free (converted_copy);
-		return;
+	{
+		char	*fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[0]);
+		strncpy (file_open_name, fn, (size_t)COB_FILE_MAX);
+		cob_free (fn);
 	}
+	cob_chk_file_mapping ();
 
-	save_status (f, fnstatus,
-		     fileio_funcs[(int)f->organization]->rewrite (f, opt));
+	if (stat (file_open_name, &st) < 0) {
+		return 35;
+	}
+
+	sz = (cob_s64_t)st.st_size;
+	tm = localtime (&st.st_mtime);
+	d = (short)tm->tm_mday;
+	m = (short)(tm->tm_mon + 1);
+	y = (short)(tm->tm_year + 1900);
+	hh = (short)tm->tm_hour;
+	mm = (short)tm->tm_min;
+	/* Leap seconds ? */
+	if (tm->tm_sec >= 60) {
+		ss = 59;
+	} else {
+		ss = (short)tm->tm_sec;
+	}
+
+#ifndef	WORDS_BIGENDIAN
+	sz = COB_BSWAP_64 (sz);
+	y = COB_BSWAP_16 (y);
+#endif
+	memcpy (file_info, &sz, (size_t)8);
+	file_info[8] = (unsigned char)d;
+	file_info[9] = (unsigned char)m;
+	memcpy (file_info+10, &y, (size_t)2);
+	file_info[12] = (unsigned char)hh;
+	file_info[13] = (unsigned char)mm;
+	file_info[14] = (unsigned char)ss;
+	file_info[15] = 0;
+	return 0;
 }
 
-void
-cob_delete (cob_file *f, cob_field *fnstatus)
+/* entry point and processing for library routine CBL_RENAME_FILE */
+int
+cob_sys_rename_file (unsigned char *fname1, unsigned char *fname2)
 {
-	int	read_done;
+	char	localbuff [COB_FILE_BUFF];
+	int 	ret;
 
-	read_done = f->flag_read_done;
-	f->flag_read_done = 0;
+	COB_UNUSED (fname1);
+	COB_UNUSED (fname2);
 
-	if (unlikely (f->open_mode != COB_OPEN_I_O)) {
-		save_status (f, fnstatus, COB_STATUS_49_I_O_DENIED);
-		return;
+	COB_CHK_PARMS (CBL_RENAME_FILE, 2);
+
+	if (!COB_MODULE_PTR->cob_procedure_params[0]) {
+		return -1;
+	}
+	if (!COB_MODULE_PTR->cob_procedure_params[1]) {
+		return -1;
 	}
 
-	if (f->access_mode == COB_ACCESS_SEQUENTIAL && !read_done) {
-		save_status (f, fnstatus, COB_STATUS_43_READ_NOT_DONE);
-		return;
+	{
+		char	*fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[0]);
+		strncpy (file_open_name, fn, (size_t)COB_FILE_MAX);
+		file_open_name[COB_FILE_MAX] = 0;
+		cob_free (fn);
 	}
+	cob_chk_file_mapping ();
+	strncpy (localbuff, file_open_name, (size_t)COB_FILE_MAX);
+	localbuff[COB_FILE_MAX] = 0;
 
-	save_status (f, fnstatus,
-		     fileio_funcs[(int)f->organization]->fdelete (f));
+	{
+		char	*fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[1]);
+		strncpy (file_open_name, fn, (size_t)COB_FILE_MAX);
+		file_open_name[COB_FILE_MAX] = 0;
+		cob_free (fn);
+	}
+	cob_chk_file_mapping ();
+
+	ret = rename (localbuff, file_open_name);
+	if (ret) {
+		return 128;
+	}
+	return 0;
 }
 
-void
-cob_commit (void)
+/* entry point and processing for library routine CBL_GET_CURRENT_DIR */
+int
+cob_sys_get_current_dir (const int flags, const int dir_length,
+			 unsigned char *dir)
 {
-	struct file_list	*l;
+	char	*dirname;
+	int	dir_size;
+	int	has_space;
 
-	for (l = file_cache; l; l = l->next) {
-		if (l->file) {
-			cob_file_unlock (l->file);
-		}
+	COB_CHK_PARMS (CBL_GET_CURRENT_DIR, 3);
+
+	if (dir_length < 1) {
+		return 128;
+	}
+	if (flags) {
+		return 129;
+	}
+	memset (dir, ' ', (size_t)dir_length);
+	dirname = getcwd (NULL, (size_t)0);
+	if (dirname == NULL) {
+		return 128;
+	}
+	dir_size = (int) strlen (dirname);
+	has_space = 0;
+	if (strchr (dirname, ' ')) {
+		has_space = 2;
+	}
+	if (dir_size + has_space > dir_length) {
+		cob_free (dirname);
+		return 128;
+	}
+	if (has_space) {
+		*dir = '"';
+		memcpy (&dir[1], dirname, (size_t)dir_size);
+		dir[dir_size + 1] = '"';
+	} else {
+		memcpy (dir, dirname, (size_t)dir_size);
 	}
+	cob_free (dirname);
+	return 0;
 }
 
-void
-cob_rollback (void)
+/* entry point and processing for library routine CBL_CREATE_DIR */
+int
+cob_sys_create_dir (unsigned char *dir)
 {
-	struct file_list	*l;
+	char	*fn;
+	int	ret;
 
-	for (l = file_cache; l; l = l->next) {
-		if (l->file) {
-			cob_file_unlock (l->file);
-		}
+	COB_UNUSED (dir);
+
+	COB_CHK_PARMS (CBL_CREATE_DIR, 1);
+
+	if (!COB_MODULE_PTR->cob_procedure_params[0]) {
+		return -1;
+	}
+	fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[0]);
+	ret = mkdir (fn, 0770);
+	cob_free (fn);
+	if (ret) {
+		return 128;
 	}
+	return 0;
 }
 
-void
-cob_delete_file (cob_file *f, cob_field *fnstatus)
+/* entry point and processing for library routine CBL_CHANGE_DIR */
+int
+cob_sys_change_dir (unsigned char *dir)
 {
-	if (f->organization == COB_ORG_SORT) {
-		save_status (f, fnstatus, COB_STATUS_30_PERMANENT_ERROR);
-		return;
-	}
+	char	*fn;
+	int	ret;
 
-	/* File was previously closed with lock */
-	if (f->open_mode == COB_OPEN_LOCKED) {
-		save_status (f, fnstatus, COB_STATUS_38_CLOSED_WITH_LOCK);
-		return;
-	}
+	COB_UNUSED (dir);
 
-	/* File is open */
-	if (f->open_mode != COB_OPEN_CLOSED) {
-		save_status (f, fnstatus, COB_STATUS_41_ALREADY_OPEN);
-		return;
-	}
+	COB_CHK_PARMS (CBL_CHANGE_DIR, 1);
 
-	if (unlikely (COB_FILE_STDIN (f) || COB_FILE_STDOUT (f))) {
-		save_status (f, fnstatus, COB_STATUS_30_PERMANENT_ERROR);
-		return;
+	if (!COB_MODULE_PTR->cob_procedure_params[0]) {
+		return -1;
 	}
+	fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[0]);
+	ret = chdir (fn);
+	cob_free (fn);
+	if (ret) {
+		return 128;
+	}
+	return 0;
+}
 
-	/* Obtain the file name */
-	cob_field_to_string (f->assign, file_open_name, COB_FILE_MAX, CCM_NONE);
-	cob_chk_file_mapping ();
+/* entry point and processing for library routine CBL_DELETE_DIR */
+int
+cob_sys_delete_dir (unsigned char *dir)
+{
+	char	*fn;
+	int	ret;
 
-	if (f->organization != COB_ORG_INDEXED) {
-#ifdef	WITH_SEQRA_EXTFH
-		save_status (f, fnstatus, COB_STATUS_91_NOT_AVAILABLE);
-		return;
-#else
-		unlink (file_open_name);
-#endif
-	} else {
-#ifdef	WITH_INDEX_EXTFH
-		save_status (f, fnstatus, COB_STATUS_91_NOT_AVAILABLE);
-		return;
-#else
-		indexed_file_delete (f, file_open_name);
-#endif
+	COB_UNUSED (dir);
+
+	COB_CHK_PARMS (CBL_DELETE_DIR, 1);
+
+	if (!COB_MODULE_PTR->cob_procedure_params[0]) {
+		return -1;
 	}
-	save_status (f, fnstatus, errno_cob_sts(COB_STATUS_00_SUCCESS));
+	fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[0]);
+	ret = rmdir (fn);
+	cob_free (fn);
+	if (ret) {
+		return 128;
+	}
+	return 0;
 }
 
-/* Return index number for given key and set length attributes,
-	 storing resulting key field in file's last_key */
+/* entry point for C$MAKEDIR, processing in cob_sys_create_dir */
 int
-cob_findkey (cob_file *f, cob_field *kf, int *fullkeylen, int *partlen)
+cob_sys_mkdir (unsigned char *dir)
 {
-	int 	k = cob_findkey_attr (f, kf, fullkeylen, partlen);
-#if 0 /* pending merge of r1411 */
-	if (k >= 0) {
-		f->last_key = f->keys[k].field;
+	int		ret;
+
+	COB_CHK_PARMS (C$MAKEDIR, 1);
+
+	ret = cob_sys_create_dir (dir);
+	if (ret < 0) {
+		ret = 128;
 	}
-#endif
-	return k;
+	return ret;
 }
 
-/* Copy key data and return length of data copied */
-static int
-cob_savekey (cob_file *f, int idx, unsigned char *data)
+/* entry point for C$CHDIR, processing in cob_sys_change_dir */
+int
+cob_sys_chdir (unsigned char *dir, unsigned char *status)
 {
-	int 	len,part;
+	int		ret;
 
-	if (f->keys[idx].field == NULL)
-		return -1;
-	if (f->keys[idx].count_components <= 1) {
-		if (data != f->keys[idx].field->data) {
-			memcpy (data, f->keys[idx].field->data, f->keys[idx].field->size);
-		}
-		return (int)f->keys[idx].field->size;
-	}
-	for (len=part=0; part < f->keys[idx].count_components; part++) {
-		memcpy (&data[len], f->keys[idx].component[part]->data,
-							f->keys[idx].component[part]->size);
-		len += f->keys[idx].component[part]->size;
+	COB_UNUSED (status);
+
+	COB_CHK_PARMS (C$CHDIR, 2);
+
+	ret = cob_sys_change_dir (dir);
+	if (ret < 0) {
+		ret = 128;
 	}
-	return len;
+	cob_set_int (COB_MODULE_PTR->cob_procedure_params[1], ret);
+	return ret;
 }
 
-/* System routines */
-
-/* stores the field's rtrimmed string content into a fresh allocated
-	 string, which later needs to be passed to cob_free */
-static void *
-cob_str_from_fld (const cob_field *f)
+/* entry point for C$COPY, processing in cob_sys_copy_file */
+int
+cob_sys_copyfile (unsigned char *fname1, unsigned char *fname2,
+		  unsigned char *file_type)
 {
-#if	0	/* Quotes in file */
-	register int	quote_switch = 0;
-#endif
-	register unsigned char	*end, *data, *s;
-	void		*mptr;
+	int		ret;
 
+	/* RXW - Type is not yet evaluated */
+	COB_UNUSED (file_type);
 
-	if (!f || f->size == 0 || !f->data) {
-		return cob_malloc ((size_t)1);
-	}
+	COB_CHK_PARMS (C$COPY, 3);
 
-	data = f->data;
-	end = data + f->size - 1;
-	while (end > data) {
-		if (*end != ' ' && *end) {
-			break;
-		}
-		end--;
-	}
-	s = mptr = cob_fast_malloc (end + 1 - data + 1);
-	if (*end == ' ' || *end == 0) {
-		*s = 0;
-		return s;
+	if (cobglobptr->cob_call_params < 3) {
+		return 128;
 	}
-
-	while (data <= end) {
-#if 0	/* Quotes in file */
-		if (*data == '"') {
-			quote_switch = !quote_switch;
-			data++;
-			continue;
-		}
-		if (!quote_switch
-		 &&  (*data == ' '
-		   || *data == 0)) {
-			break;
-		}
-#else
-		if (*data == '"') {
-			data++;
-			continue;
-		}
-#endif
-		*s++ = *data++;
+	ret = cob_sys_copy_file (fname1, fname2);
+	if (ret < 0) {
+		ret = 128;
 	}
-	*s = 0;
-
-	return mptr;
+	return ret;
 }
 
-/* actual processing for CBL_OPEN_FILE and CBL_CREATE_FILE */
-static int
-open_cbl_file (unsigned char *file_name, unsigned char *file_access,
-	       unsigned char *file_handle, const int file_flags)
+/* entry point and processing for C$FILEINFO */
+int
+cob_sys_file_info (unsigned char *file_name, unsigned char *file_info)
 {
-	int	flag = O_BINARY;
-	int	fd;
+	char			*fn;
+	struct tm		*tm;
+	cob_u64_t		sz;
+	unsigned int		dt;
+	short			y;
+	short			d, m, hh, mm, ss;
+	struct stat		st;
 
 	COB_UNUSED (file_name);
 
-	if (!COB_MODULE_PTR->cob_procedure_params[0]) {
-		memset (file_handle, -1, (size_t)4);
-		return -1;
+	COB_CHK_PARMS (C$FILEINFO, 2);
+
+	if (cobglobptr->cob_call_params < 2
+	 || !COB_MODULE_PTR->cob_procedure_params[0]) {
+		return 128;
 	}
-	flag |= file_flags;
-	switch (*file_access & 0x3F) {
-		case 1:
-			flag |= O_RDONLY;
-			break;
-		case 2:
-			flag |= O_CREAT | O_TRUNC | O_WRONLY;
-			break;
-		case 3:
-			flag |= O_RDWR;
-			break;
-		default:
-			cob_runtime_warning (_("call to CBL_OPEN_FILE with wrong access mode: %d"), *file_access & 0x3F);
-			memset (file_handle, -1, (size_t)4);
-			return -1;
+	if (!COB_MODULE_PTR->cob_procedure_params[1]) {
+		return 128;
+	}
+	if (COB_MODULE_PTR->cob_procedure_params[1]->size < 16U) {
+		cob_runtime_error (_("'%s' - File detail area is too short"), "C$FILEINFO");
+#if 0 /* should be handled by the caller,
+		TODO: check for better return code (or the one from ACU) */
+		cob_hard_failure ();
+#else
+		return 128;
+#endif
 	}
 
-	{
-		char	*fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[0]);
-		strncpy (file_open_name, fn, (size_t)COB_FILE_MAX);
-		file_open_name[COB_FILE_MAX] = 0;
+	fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[0]);
+	if (stat (fn, &st) < 0) {
 		cob_free (fn);
+		return 35;
 	}
-
-	cob_chk_file_mapping ();
-
-	fd = open (file_open_name, flag, COB_FILE_MODE);
-	if (fd == -1) {
-		int ret = errno_cob_sts (COB_STATUS_35_NOT_EXISTS);
-		memset (file_handle, -1, (size_t)4);
-		return ret;
+	cob_free (fn);
+	sz = (cob_u64_t)st.st_size;
+	tm = localtime (&st.st_mtime);
+	d = (short)tm->tm_mday;
+	m = (short)(tm->tm_mon + 1);
+	y = (short)(tm->tm_year + 1900);
+	hh = (short)tm->tm_hour;
+	mm = (short)tm->tm_min;
+	/* Leap seconds ? */
+	if (tm->tm_sec >= 60) {
+		ss = 59;
+	} else {
+		ss = (short)tm->tm_sec;
 	}
-	memcpy (file_handle, &fd, (size_t)4);
-	return 0;
-}
-
-/* entry point for library routine CBL_OPEN_FILE */
-int
-cob_sys_open_file (unsigned char *file_name, unsigned char *file_access,
-		   unsigned char *file_lock, unsigned char *file_dev,
-		   unsigned char *file_handle)
-{
-	COB_UNUSED (file_lock);
-	COB_UNUSED (file_dev);
-
-	COB_CHK_PARMS (CBL_OPEN_FILE, 5);
 
-#ifdef	WORDS_BIGENDIAN
-	/* if value is passed as numeric literal, it becomes an 'int' so value is in 4th byte */
-	if (file_access[0] == 0
-	 && file_access[1] == 0
-	 && file_access[2] == 0)
-		file_access += 3;
-	if (file_lock[0] == 0
-	 && file_lock[1] == 0
-	 && file_lock[2] == 0)
-		file_lock += 3;
-	if (file_dev[0] == 0
-	 && file_dev[1] == 0
-	 && file_dev[2] == 0)
-		file_dev += 3;
+#ifndef	WORDS_BIGENDIAN
+	sz = COB_BSWAP_64 (sz);
 #endif
-
-	return open_cbl_file (file_name, file_access, file_handle, 0);
+	memcpy (file_info, &sz, (size_t)8);
+	dt = (y * 10000) + (m * 100) + d;
+#ifndef	WORDS_BIGENDIAN
+	dt = COB_BSWAP_32 (dt);
+#endif
+	memcpy (file_info + 8, &dt, (size_t)4);
+	dt = (hh * 1000000) + (mm * 10000) + (ss * 100);
+#ifndef	WORDS_BIGENDIAN
+	dt = COB_BSWAP_32 (dt);
+#endif
+	memcpy (file_info + 12, &dt, (size_t)4);
+	return 0;
 }
 
-/* entry point for library routine CBL_CREATE_FILE */
+/* entry point for C$DELETE, processing in cob_sys_delete_file */
 int
-cob_sys_create_file (unsigned char *file_name, unsigned char *file_access,
-		     unsigned char *file_lock, unsigned char *file_dev,
-		     unsigned char *file_handle)
+cob_sys_file_delete (unsigned char *file_name, unsigned char *file_type)
 {
-	/*
-	 * @param: file_access : 1 (read-only), 2 (write-only), 3 (both)
-	 * @param: file_lock : not implemented, set 0
-	 * @param: file_dev : not implemented, set 0
-	 */
+	int	ret;
 
-	COB_CHK_PARMS (CBL_CREATE_FILE, 5);
+	/* RXW - Type is not yet evaluated */
+	COB_UNUSED (file_type);
 
-#ifdef	WORDS_BIGENDIAN
-	/* if value is passed as numeric literal, it becomes an 'int' so value is in 4th byte */
-	if (file_access[0] == 0
-	 && file_access[1] == 0
-	 && file_access[2] == 0)
-		file_access += 3;
-	if (file_lock[0] == 0
-	 && file_lock[1] == 0
-	 && file_lock[2] == 0)
-		file_lock += 3;
-	if (file_dev[0] == 0
-	 && file_dev[1] == 0
-	 && file_dev[2] == 0)
-		file_dev += 3;
-#endif
+	COB_CHK_PARMS (C$DELETE, 2);
 
-	if (*file_lock != 0) {
-		cob_runtime_warning (_("call to CBL_CREATE_FILE with wrong file_lock: %d"), *file_lock);
+	if (cobglobptr->cob_call_params < 2 ||
+	    !COB_MODULE_PTR->cob_procedure_params[0]) {
+		return 128;
 	}
-	if (*file_dev != 0) {
-		cob_runtime_warning (_("call to CBL_CREATE_FILE with wrong file_dev: %d"), *file_dev);
+	ret = cob_sys_delete_file (file_name);
+	if (ret < 0) {
+		ret = 128;
 	}
+	return ret;
+}
 
-	return open_cbl_file (file_name, file_access, file_handle, O_CREAT | O_TRUNC);
+/* SORT */
+
+static COB_INLINE void
+unique_copy (unsigned char *s1, const unsigned char *s2)
+{
+	size_t	size = sizeof (size_t);
+	do {
+		*s1++ = *s2++;
+	} while (--size);
 }
 
-/* entry point and processing for library routine CBL_READ_FILE */
-int
-cob_sys_read_file (unsigned char *file_handle, unsigned char *file_offset,
-		   unsigned char *file_len, unsigned char *flags,
-		   unsigned char *buf)
+static int
+cob_file_sort_compare (struct cobsort *hp, const struct cobitem *k1,
+		       const struct cobitem *k2)
 {
-	cob_s64_t	off;
-	int		fd;
-	int		len;
+	const cob_file	*f = hp->pointer;
+	int		cmp;
+	size_t		u1;
+	size_t		u2;
 
-	COB_CHK_PARMS (CBL_READ_FILE, 5);
+	if (hp->key_len) {
+		cmp = memcmp (k1->item + hp->size, k2->item + hp->size,
+			      hp->key_len);
+	} else {
+		cmp = cob_sort_key_cmp (hp->keys, f->nkeys, k1->item, k2->item);
+	}
+	if (cmp != 0) {
+		return cmp;
+	}
+	unique_copy ((unsigned char *)&u1, k1->unique);
+	unique_copy ((unsigned char *)&u2, k2->unique);
+	if (u1 < u2) {
+		return -1;
+	}
+	return 1;
+}
 
-	memcpy (&fd, file_handle, 4);
-	if ((*flags & 0x80) != 0) {
-		struct stat	st;
-		if (fstat (fd, &st) < 0) {
-			return -1;
+/* up to eight bytes of the first key (or the encoded keys), so that
+   most compares of sort entries are done by comparing two integers */
+static COB_INLINE cob_u64_t
+sort_key_prefix (struct cobsort *hp, const unsigned char *data)
+{
+	if (hp->key_len) {
+		const unsigned char	*p = data + hp->size;
+		const size_t		n = hp->key_len < sizeof (cob_u64_t)
+					  ? hp->key_len : sizeof (cob_u64_t);
+		cob_u64_t		prefix = 0;
+		size_t			i;
+		for (i = 0; i < n; ++i) {
+			prefix = (prefix << 8) | p[i];
 		}
-		off = st.st_size;
-#ifndef	WORDS_BIGENDIAN
-		off = COB_BSWAP_64 (off);
-#endif
-		memcpy (file_offset, &off, 8);
+		return prefix << (8 * (sizeof (cob_u64_t) - n));
+	}
+	if (!hp->use_prefix) {
 		return 0;
 	}
+	return cob_sort_key_prefix (hp->keys, data);
+}
 
-	memcpy (&off, file_offset, 8);
-	memcpy (&len, file_len, 4);
-#ifndef	WORDS_BIGENDIAN
-	off = COB_BSWAP_64 (off);
-	len = COB_BSWAP_32 (len);
-#endif
-	if (lseek (fd, off, SEEK_SET) == -1) {
-		return -1;	/* error in positioning -> bad offset */
+/* store record 'p' with the next record number (and encoded keys)
+   into item 'q', returning the prefix for its sort entry */
+static cob_u64_t
+sort_item_fill (struct cobsort *hp, struct cobitem *q, const unsigned char *p)
+{
+	unique_copy (q->unique, (const unsigned char *)&(hp->unique));
+	hp->unique++;
+	memcpy (q->item, p, hp->size);
+	if (hp->key_len) {
+		const cob_file	*f = hp->pointer;
+		unsigned char	*dest = q->item + hp->size;
+		size_t		i;
+		for (i = 0; i < f->nkeys; ++i) {
+			cob_sort_key_encode (&hp->keys[i], q->item, dest);
+			dest += hp->keys[i].encoded_size;
+		}
 	}
+	return sort_key_prefix (hp, q->item);
+}
 
-	if (len > 0) {
-		const int	rc = read (fd, buf, (size_t)len);
-		if (rc < 0) {
-			return -1;	/* error in read */
-		} else if (rc == 0) {
-			/* 0 byte read -> "at end" */
-			return COB_STATUS_10_END_OF_FILE;
-		}
+static COB_INLINE int
+sort_entry_cmp (struct cobsort *hp, const struct sort_entry *e1,
+		const struct sort_entry *e2)
+{
+	if (e1->prefix != e2->prefix) {
+		return e1->prefix < e2->prefix ? -1 : 1;
 	}
-	return COB_STATUS_00_SUCCESS;
+	return cob_file_sort_compare (hp, e1->item, e2->item);
 }
 
-/* entry point and processing for library routine CBL_WRITE_FILE */
-int
-cob_sys_write_file (unsigned char *file_handle, unsigned char *file_offset,
-		    unsigned char *file_len, unsigned char *flags,
-		    unsigned char *buf)
+/* stable merge sort of the in-memory entries, 'tmp' has room for n / 2 */
+static void
+sort_entries (struct cobsort *hp, struct sort_entry *a,
+	      struct sort_entry *tmp, const size_t n)
 {
-	cob_s64_t	off;
-	int		fd;
-	int		len;
-	int		rc;
+	struct sort_entry	*l, *l_end, *r, *r_end, *dest;
+	size_t			i, j, mid;
 
-	COB_UNUSED (flags);
+	if (n <= 16) {
+		for (i = 1; i < n; ++i) {
+			struct sort_entry	x = a[i];
+			for (j = i; j > 0 && sort_entry_cmp (hp, &x, &a[j - 1]) < 0; --j) {
+				a[j] = a[j - 1];
+			}
+			a[j] = x;
+		}
+		return;
+	}
+	mid = n / 2;
+	sort_entries (hp, a, tmp, mid);
+	sort_entries (hp, a + mid, tmp, n - mid);
+	if (sort_entry_cmp (hp, &a[mid - 1], &a[mid]) < 0) {
+		/* already in order */
+		return;
+	}
+	memcpy (tmp, a, mid * sizeof (struct sort_entry));
+	l = tmp;
+	l_end = tmp + mid;
+	r = a + mid;
+	r_end = a + n;
+	dest = a;
+	while (l < l_end && r < r_end) {
+		if (sort_entry_cmp (hp, r, l) < 0) {
+			*dest++ = *r++;
+		} else {
+			*dest++ = *l++;
+		}
+	}
+	/* the rest of r is already in place */
+	while (l < l_end) {
+		*dest++ = *l++;
+	}
+}
 
-	COB_CHK_PARMS (CBL_WRITE_FILE, 5);
+/* buckets smaller than this are sorted by sort_entries */
+#define	COB_SORT_RADIX_MIN	64
+/* maximal recursion of sort_radix */
+#define	COB_SORT_RADIX_DEPTH	32
 
-	memcpy (&fd, file_handle, 4);
-	memcpy (&off, file_offset, 8);
-	memcpy (&len, file_len, 4);
-#ifndef	WORDS_BIGENDIAN
-	off = COB_BSWAP_64 (off);
-	len = COB_BSWAP_32 (len);
-#endif
-	if (lseek (fd, off, SEEK_SET) == -1) {
-		return -1;
+/* byte 'pos' of the encoded keys of entry 'e' */
+static COB_INLINE unsigned int
+sort_key_byte (struct cobsort *hp, const struct sort_entry *e, const size_t pos)
+{
+	if (pos < sizeof (cob_u64_t)) {
+		return (unsigned int)(e->prefix >> (8 * (sizeof (cob_u64_t) - 1 - pos))) & 0xFF;
 	}
-	rc = (int) write (fd, buf, (size_t)len);
-	if (rc != len) {
-		return COB_STATUS_30_PERMANENT_ERROR;
+	return e->item->item[hp->size + pos];
+}
+
+/* number of bytes from 'pos' (after the prefix) which are
+   the same in the encoded keys of all 'n' entries */
+static size_t
+sort_key_common (struct cobsort *hp, const struct sort_entry *a,
+		 const size_t n, const size_t pos)
+{
+	const unsigned char	*first = a[0].item->item + hp->size;
+	size_t			len = hp->key_len - pos;
+	size_t			i, j;
+
+	for (i = 1; i < n && len > 0; ++i) {
+		const unsigned char	*key = a[i].item->item + hp->size;
+		for (j = 0; j < len && key[pos + j] == first[pos + j]; ++j);
+		len = j;
 	}
-	return COB_STATUS_00_SUCCESS;
+	return len;
 }
 
-/* entry point and processing for library routine CBL_CLOSE_FILE */
-int
-cob_sys_close_file (unsigned char *file_handle)
+/* stable MSD radix sort of the entries by the encoded keys, starting
+   at byte 'pos'; 'tmp' has room for n entries */
+static void
+sort_radix (struct cobsort *hp, struct sort_entry *a,
+	    struct sort_entry *tmp, const size_t n, size_t pos,
+	    const unsigned int depth)
 {
-	int	fd;
+	size_t	count[256];
+	size_t	start[256];
+	size_t	i, b;
 
-	COB_CHK_PARMS (CBL_CLOSE_FILE, 1);
+	for (; ;) {
+		if (pos == hp->key_len) {
+			/* same keys, in order of RELEASE */
+			return;
+		}
+		if (n <= COB_SORT_RADIX_MIN || depth == COB_SORT_RADIX_DEPTH) {
+			sort_entries (hp, a, tmp, n);
+			return;
+		}
+		memset (count, 0, sizeof (count));
+		for (i = 0; i < n; ++i) {
+			count[sort_key_byte (hp, &a[i], pos)]++;
+		}
+		/* skip bytes that are the same in all keys */
+		if (count[sort_key_byte (hp, &a[0], pos)] != n) {
+			break;
+		}
+		pos++;
+		if (pos >= sizeof (cob_u64_t)) {
+			pos += sort_key_common (hp, a, n, pos);
+		}
+	}
+	start[0] = 0;
+	for (b = 1; b < 256; ++b) {
+		start[b] = start[b - 1] + count[b - 1];
+	}
+	for (i = 0; i < n; ++i) {
+		tmp[start[sort_key_byte (hp, &a[i], pos)]++] = a[i];
+	}
+	memcpy (a, tmp, n * sizeof (struct sort_entry));
+	for (b = 0, i = 0; b < 256; i += count[b++]) {
+		if (count[b] > 1) {
+			sort_radix (hp, a + i, tmp, count[b], pos + 1, depth + 1);
+		}
+	}
+}
 
-	memcpy (&fd, file_handle, 4);
-	return close (fd);
+/* sort 'n' entries, with 'tmp' having room for n entries */
+static void
+sort_entries_any (struct cobsort *hp, struct sort_entry *a,
+		  struct sort_entry *tmp, const size_t n)
+{
+	if (hp->key_len) {
+		sort_radix (hp, a, tmp, n, 0, 0);
+	} else {
+		sort_entries (hp, a, tmp, n);
+	}
 }
 
-/* entry point and processing for library routine CBL_FLUSH_FILE
-	 (flush bytestream file handle, got from CBL_OPEN_FILE) */
-int
-cob_sys_flush_file (unsigned char *file_handle)
+/* heap order while generating runs: run number, then key */
+static COB_INLINE int
+sort_heap_less (struct cobsort *hp, const struct sort_entry *e1,
+		const struct sort_entry *e2)
 {
-	int	fd;
+	if (e1->run != e2->run) {
+		return e1->run < e2->run;
+	}
+	return sort_entry_cmp (hp, e1, e2) < 0;
+}
 
-	COB_CHK_PARMS (CBL_FLUSH_FILE, 1);
+static void
+sort_heap_down (struct cobsort *hp, size_t i)
+{
+	struct sort_entry	*e = hp->entries;
+	const size_t		n = hp->entry_count;
+	struct sort_entry	x = e[i];
 
-	memcpy (&fd, file_handle, sizeof (int));
-	return fdcobsync (fd);
+	for (; ;) {
+		size_t	c = 2 * i + 1;
+		if (c >= n) {
+			break;
+		}
+		if (c + 1 < n
+		 && sort_heap_less (hp, &e[c + 1], &e[c])) {
+			c++;
+		}
+		if (!sort_heap_less (hp, &e[c], &x)) {
+			break;
+		}
+		e[i] = e[c];
+		i = c;
+	}
+	e[i] = x;
 }
 
-/* entry point and processing for library routine CBL_DELETE_FILE */
-int
-cob_sys_delete_file (unsigned char *file_name)
+static void
+sort_free_mem (struct sort_mem_struct *s1)
 {
-	int	ret;
+	struct sort_mem_struct	*s2;
 
-	COB_UNUSED (file_name);
+	for (; s1;) {
+		s2 = s1;
+		s1 = s1->next;
+		cob_free (s2->mem_ptr);
+		cob_free (s2);
+	}
+}
 
-	COB_CHK_PARMS (CBL_DELETE_FILE, 1);
+static void
+cob_free_list (struct cobsort *hp)
+{
+	sort_free_mem (hp->mem_base);
+	hp->mem_base = NULL;
+}
 
-	if (!COB_MODULE_PTR->cob_procedure_params[0]) {
-		return -1;
+static struct cobitem *
+cob_new_item (struct cobsort *hp)
+{
+	struct cobitem		*q;
+
+	if (unlikely ((hp->mem_used + hp->alloc_size) > hp->mem_size)) {
+		struct sort_mem_struct	*s;
+		s = cob_fast_malloc (sizeof (struct sort_mem_struct));
+		s->mem_ptr = cob_fast_malloc (hp->chunk_size);
+		s->next = hp->mem_base;
+		hp->mem_base = s;
+		hp->mem_size = hp->chunk_size;
+		hp->mem_total += hp->chunk_size;
+		hp->mem_used = 0;
+	}
+	q = (struct cobitem *)(hp->mem_base->mem_ptr + hp->mem_used);
+	hp->mem_used += hp->alloc_size;
+	if (unlikely (hp->mem_total
+	            + hp->entry_alloc * sizeof (struct sort_entry)
+	           >= hp->mem_limit)) {
+		if ((hp->mem_used + hp->alloc_size) > hp->mem_size) {
+			hp->switch_to_file = 1;
+		}
 	}
+	return q;
+}
 
-	{
-		char	*fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[0]);
-		strncpy (file_open_name, fn, (size_t)COB_FILE_MAX);
-		file_open_name[COB_FILE_MAX] = 0;
-		cob_free (fn);
+FILE *
+cob_create_tmpfile (const char *ext)
+{
+	FILE	*fp;
+	char	*filename;
+	int 	fd;
+
+	filename = cob_malloc ((size_t)COB_FILE_BUFF);
+	cob_temp_name (filename, ext);
+	cob_incr_temp_iteration ();
+#ifdef	_WIN32
+	fd = open (filename,
+		    _O_CREAT | _O_TRUNC | _O_RDWR | _O_BINARY | _O_TEMPORARY,
+		    _S_IREAD | _S_IWRITE);
+#else
+	fd = open (filename, O_CREAT | O_TRUNC | O_RDWR | O_BINARY, COB_FILE_MODE);
+#endif
+	if (fd == -1) {
+		cob_free (filename);
+		return NULL;
 	}
-	cob_chk_file_mapping ();
+	(void)unlink (filename);
+	fp = fdopen (fd, "w+b");
+	if (!fp) {
+		close (fd);
+	}
+	cob_free (filename);
+	return fp;
+}
 
-	ret = unlink (file_open_name);
-	if (ret) {
-		return 128;
+static int
+cob_get_sort_tempfile (struct cobsort *hp, const int n)
+{
+	if (hp->file[n].fp == NULL) {
+		hp->file[n].fp = cob_create_tmpfile (NULL);
+#if 0 /* error to be handled by the caller */
+		if (hp->file[n].fp == NULL) {
+			cob_runtime_error (_("SORT is unable to acquire temporary file"));
+			cob_hard_failure ();
+		}
+#endif
+	} else if (lseek (fileno (hp->file[n].fp), (off_t)0, SEEK_SET) == (off_t)-1) {
+		return 1;
 	}
-	return 0;
+	hp->file[n].size = 0;
+	return hp->file[n].fp == NULL;
 }
 
-/* entry point and processing for library routine CBL_COPY_FILE,
-	 does a direct read + write of the complete file */
-int
-cob_sys_copy_file (unsigned char *fname1, unsigned char *fname2)
-{
-	int	flag = O_BINARY;
-	int	ret;
-	int	i;
-	int	fd1, fd2;
+/* COB_SORT_COMPRESS: blocks of the temporary files are compressed by
+   LZ77 in the manner of LZ4; each sequence is a token with the number of
+   literals in the high and the match length - 4 in the low four bits,
+   each continued in bytes up to 255 if 15, followed by the literals and
+   the offset of the match (two bytes); the last sequence has no match */
 
-	COB_UNUSED (fname1);
-	COB_UNUSED (fname2);
+static COB_INLINE unsigned int
+sort_lz_hash (const unsigned char *p)
+{
+	unsigned int	v;
 
-	COB_CHK_PARMS (CBL_COPY_FILE, 2);
+	memcpy (&v, p, sizeof (v));
+	return (v * 2654435761U) >> (32 - SORT_LZ_HASH_BITS);
+}
 
-	if (!COB_MODULE_PTR->cob_procedure_params[0]) {
-		return -1;
-	}
-	if (!COB_MODULE_PTR->cob_procedure_params[1]) {
-		return -1;
-	}
+/* enter position 'pos' into the hash chains, returning the last
+   position + 1 with the same hash, or 0 */
+static COB_INLINE unsigned int
+sort_lz_insert (struct sort_lz *lz, const unsigned char *src, const size_t pos)
+{
+	const unsigned int	h = sort_lz_hash (src + pos);
+	const unsigned int	prev = lz->head[h];
 
-	{
-		char	*fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[0]);
-		strncpy (file_open_name, fn, (size_t)COB_FILE_MAX);
-		file_open_name[COB_FILE_MAX] = 0;
-		cob_free (fn);
-	}
-	cob_chk_file_mapping ();
+	lz->prev[pos & SORT_LZ_WINDOW] = prev;
+	lz->head[h] = (unsigned int)pos + 1;
+	return prev;
+}
 
-	flag |= O_RDONLY;
-	fd1 = open (file_open_name, flag, 0);
-	if (fd1 == -1) {
-		return errno_cob_sts (COB_STATUS_35_NOT_EXISTS);
+static unsigned char *
+sort_lz_put_length (unsigned char *out, size_t n)
+{
+	while (n >= 255) {
+		*out++ = 255;
+		n -= 255;
 	}
+	*out++ = (unsigned char)n;
+	return out;
+}
 
-	{
-		char	*fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[1]);
-		strncpy (file_open_name, fn, (size_t)COB_FILE_MAX);
-		file_open_name[COB_FILE_MAX] = 0;
-		cob_free (fn);
-	}
-	cob_chk_file_mapping ();
+static unsigned char *
+sort_lz_put_sequence (unsigned char *out, const unsigned char *lit,
+		      const size_t lit_len, const size_t match_len)
+{
+	const size_t	m = match_len ? match_len - SORT_LZ_MIN_MATCH : 0;
+	unsigned char	*token = out++;
 
-	flag &= ~O_RDONLY;
-	flag |= O_CREAT | O_TRUNC | O_WRONLY;
-	fd2 = open (file_open_name, flag, COB_FILE_MODE);
-	if (fd2 == -1) {
-		ret = errno_cob_sts (COB_STATUS_35_NOT_EXISTS);
-		close (fd1);
-		return ret;
+	*token = (unsigned char)(((lit_len < 15 ? lit_len : 15) << 4)
+			       | (m < 15 ? m : 15));
+	if (lit_len >= 15) {
+		out = sort_lz_put_length (out, lit_len - 15);
 	}
+	memcpy (out, lit, lit_len);
+	return out + lit_len;
+}
 
-	ret = 0;
-	while ((i = read (fd1, file_open_buff, COB_FILE_BUFF)) > 0) {
-		if (write (fd2, file_open_buff, (size_t)i) != (size_t)i) {
-			ret = -1;
-			break;
+/* compress 'len' bytes of 'src' to 'dst', which must have space for
+   len + len / 255 + 16 bytes; returns the compressed size;
+   'level' 1 to 9 is the number of earlier matches checked: 1 to 256 */
+static size_t
+sort_lz_compress (struct sort_lz *lz, const unsigned char *src,
+		  const size_t len, unsigned char *dst, const unsigned int level)
+{
+	const unsigned int	depth = 1U << (level - 1);
+	unsigned char		*out = dst;
+	size_t			anchor = 0;
+	size_t			pos = 0;
+
+	memset (lz->head, 0, sizeof (lz->head));
+	while (pos + SORT_LZ_MIN_MATCH <= len) {
+		unsigned int	cand = sort_lz_insert (lz, src, pos);
+		unsigned int	chain = depth;
+		size_t		best_len = 0;
+		size_t		best_off = 0;
+		size_t		end;
+
+		while (cand != 0 && chain-- > 0
+		    && best_len < len - pos) {
+			const size_t	c = cand - 1;
+			if (pos - c > SORT_LZ_WINDOW) {
+				break;
+			}
+			if (src[c + best_len] == src[pos + best_len]) {
+				size_t	l = 0;
+				while (pos + l < len && src[c + l] == src[pos + l]) {
+					l++;
+				}
+				if (l > best_len) {
+					best_len = l;
+					best_off = pos - c;
+				}
+			}
+			cand = lz->prev[c & SORT_LZ_WINDOW];
+		}
+		if (best_len < SORT_LZ_MIN_MATCH) {
+			pos++;
+			continue;
+		}
+		out = sort_lz_put_sequence (out, src + anchor, pos - anchor, best_len);
+		*out++ = (unsigned char)(best_off & 0xFF);
+		*out++ = (unsigned char)(best_off >> 8);
+		if (best_len - SORT_LZ_MIN_MATCH >= 15) {
+			out = sort_lz_put_length (out, best_len - SORT_LZ_MIN_MATCH - 15);
 		}
+		end = pos + best_len;
+		for (pos++; pos < end && pos + SORT_LZ_MIN_MATCH <= len; pos++) {
+			(void)sort_lz_insert (lz, src, pos);
+		}
+		pos = end;
+		anchor = pos;
 	}
-	close (fd1);
-	close (fd2);
-	return ret;
+	if (anchor < len) {
+		out = sort_lz_put_sequence (out, src + anchor, len - anchor, 0);
+	}
+	return (size_t)(out - dst);
 }
 
-/* entry point and processing for library routine CBL_CHECK_FILE_EXIST */
-int
-cob_sys_check_file_exist (unsigned char *file_name, unsigned char *file_info)
+static int
+sort_lz_get_length (const unsigned char **in, const unsigned char *end,
+		    size_t *n)
 {
-	struct tm	*tm;
-	cob_s64_t	sz;
-	struct stat	st;
-	short		y;
-	short		d, m, hh, mm, ss;
+	unsigned char	b;
 
-	COB_UNUSED (file_name);
+	do {
+		if (*in == end) {
+			return 1;
+		}
+		b = *(*in)++;
+		*n += b;
+	} while (b == 255);
+	return 0;
+}
 
-	COB_CHK_PARMS (CBL_CHECK_FILE_EXIST, 2);
+/* decompress 'len' bytes of 'src' to the 'raw' bytes of 'dst';
+   returns non-zero if the data is invalid */
+static int
+sort_lz_decompress (const unsigned char *src, const size_t len,
+		    unsigned char *dst, const size_t raw)
+{
+	const unsigned char	*end = src + len;
+	size_t			out = 0;
 
-	if (!COB_MODULE_PTR->cob_procedure_params[0]
-	 || !COB_MODULE_PTR->cob_procedure_params[1]) {
-		return -1;
-	}
-	if (COB_MODULE_PTR->cob_procedure_params[1]->size < 16U) {
-		cob_runtime_error (_("'%s' - File detail area is too short"), "CBL_CHECK_FILE_EXIST");
-#if 0 /* should be handled by the caller,
-		TODO: check for better return code (or the one from MF/ACU) */
-		cob_hard_failure ();
-#else
-		return -1;
-#endif
-	}
+	while (src < end) {
+		const unsigned int	token = *src++;
+		size_t			n = token >> 4;
+		size_t			off;
 
-	{
-		char	*fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[0]);
-		strncpy (file_open_name, fn, (size_t)COB_FILE_MAX);
-		cob_free (fn);
+		if (n == 15 && sort_lz_get_length (&src, end, &n)) {
+			return 1;
+		}
+		if (n > (size_t)(end - src) || n > raw - out) {
+			return 1;
+		}
+		memcpy (dst + out, src, n);
+		src += n;
+		out += n;
+		if (src == end) {
+			break;
+		}
+		if (end - src < 2) {
+			return 1;
+		}
+		off = src[0] | ((size_t)src[1] << 8);
+		src += 2;
+		n = token & 15;
+		if (n == 15 && sort_lz_get_length (&src, end, &n)) {
+			return 1;
+		}
+		n += SORT_LZ_MIN_MATCH;
+		if (off == 0 || off > out || n > raw - out) {
+			return 1;
+		}
+		/* the match may overlap its own output */
+		for (; n > 0; --n, ++out) {
+			dst[out] = dst[out - off];
+		}
 	}
-	cob_chk_file_mapping ();
+	return out != raw;
+}
 
-	if (stat (file_open_name, &st) < 0) {
-		return 35;
+static int
+sort_write_all (const int fd, const unsigned char *p, size_t left)
+{
+	while (left > 0) {
+		const int	written = write (fd, p, left);
+		/* LCOV_EXCL_START */
+		if (unlikely (written <= 0)) {
+			return 1;
+		}
+		/* LCOV_EXCL_STOP */
+		p += written;
+		left -= written;
 	}
+	return 0;
+}
 
-	sz = (cob_s64_t)st.st_size;
-	tm = localtime (&st.st_mtime);
-	d = (short)tm->tm_mday;
-	m = (short)(tm->tm_mon + 1);
-	y = (short)(tm->tm_year + 1900);
-	hh = (short)tm->tm_hour;
-	mm = (short)tm->tm_min;
-	/* Leap seconds ? */
-	if (tm->tm_sec >= 60) {
-		ss = 59;
-	} else {
-		ss = (short)tm->tm_sec;
+static int
+sort_read_all (const int fd, unsigned char *p, size_t left)
+{
+	while (left > 0) {
+		const int	bytesread = read (fd, p, left);
+		/* LCOV_EXCL_START */
+		if (unlikely (bytesread <= 0)) {
+			return 1;
+		}
+		/* LCOV_EXCL_STOP */
+		p += bytesread;
+		left -= bytesread;
 	}
-
-#ifndef	WORDS_BIGENDIAN
-	sz = COB_BSWAP_64 (sz);
-	y = COB_BSWAP_16 (y);
-#endif
-	memcpy (file_info, &sz, (size_t)8);
-	file_info[8] = (unsigned char)d;
-	file_info[9] = (unsigned char)m;
-	memcpy (file_info+10, &y, (size_t)2);
-	file_info[12] = (unsigned char)hh;
-	file_info[13] = (unsigned char)mm;
-	file_info[14] = (unsigned char)ss;
-	file_info[15] = 0;
 	return 0;
 }
 
-/* entry point and processing for library routine CBL_RENAME_FILE */
-int
-cob_sys_rename_file (unsigned char *fname1, unsigned char *fname2)
+/* write the output buffer to temporary file 'n',
+   with COB_SORT_COMPRESS as one block */
+static int
+sort_flush (struct cobsort *hp, const int n)
 {
-	char	localbuff [COB_FILE_BUFF];
-	int 	ret;
-
-	COB_UNUSED (fname1);
-	COB_UNUSED (fname2);
-
-	COB_CHK_PARMS (CBL_RENAME_FILE, 2);
-
-	if (!COB_MODULE_PTR->cob_procedure_params[0]) {
-		return -1;
-	}
-	if (!COB_MODULE_PTR->cob_procedure_params[1]) {
-		return -1;
-	}
+	const unsigned char	*p = hp->wbuf;
+	size_t			size = hp->wlen;
 
-	{
-		char	*fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[0]);
-		strncpy (file_open_name, fn, (size_t)COB_FILE_MAX);
-		file_open_name[COB_FILE_MAX] = 0;
-		cob_free (fn);
+	if (size == 0) {
+		return 0;
 	}
-	cob_chk_file_mapping ();
-	strncpy (localbuff, file_open_name, (size_t)COB_FILE_MAX);
-	localbuff[COB_FILE_MAX] = 0;
+	if (hp->compress) {
+		struct sort_block	blk;
+		unsigned char		*data = hp->cbuf + sizeof (blk);
+		const size_t		len = sort_lz_compress (hp->lz,
+					hp->wbuf, hp->wlen, data, hp->compress);
 
-	{
-		char	*fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[1]);
-		strncpy (file_open_name, fn, (size_t)COB_FILE_MAX);
-		file_open_name[COB_FILE_MAX] = 0;
-		cob_free (fn);
+		blk.raw = (unsigned int)hp->wlen;
+		if (len < hp->wlen) {
+			blk.stored = (unsigned int)len;
+		} else {
+			/* incompressible: stored as is */
+			blk.stored = blk.raw;
+			memcpy (data, hp->wbuf, hp->wlen);
+		}
+		memcpy (hp->cbuf, &blk, sizeof (blk));
+		p = hp->cbuf;
+		size = sizeof (blk) + blk.stored;
 	}
-	cob_chk_file_mapping ();
-
-	ret = rename (localbuff, file_open_name);
-	if (ret) {
-		return 128;
+	/* LCOV_EXCL_START */
+	if (unlikely (sort_write_all (fileno (hp->file[n].fp), p, size))) {
+		return 1;
 	}
+	/* LCOV_EXCL_STOP */
+	hp->file[n].size += size;
+	hp->spilled += size;
+	hp->wlen = 0;
 	return 0;
 }
 
-/* entry point and processing for library routine CBL_GET_CURRENT_DIR */
-int
-cob_sys_get_current_dir (const int flags, const int dir_length,
-			 unsigned char *dir)
+/* append item 'q' to the run currently written to temporary file 'n';
+   the copy in the output buffer stays valid until the next call */
+static int
+sort_write_item (struct cobsort *hp, const int n, const struct cobitem *q)
 {
-	char	*dirname;
-	int	dir_size;
-	int	has_space;
-
-	COB_CHK_PARMS (CBL_GET_CURRENT_DIR, 3);
-
-	if (dir_length < 1) {
-		return 128;
-	}
-	if (flags) {
-		return 129;
-	}
-	memset (dir, ' ', (size_t)dir_length);
-	dirname = getcwd (NULL, (size_t)0);
-	if (dirname == NULL) {
-		return 128;
-	}
-	dir_size = (int) strlen (dirname);
-	has_space = 0;
-	if (strchr (dirname, ' ')) {
-		has_space = 2;
+	if (hp->wlen + hp->w_size > hp->buff_size
+	 && sort_flush (hp, n)) {
+		return 1;
 	}
-	if (dir_size + has_space > dir_length) {
-		cob_free (dirname);
-		return 128;
+	memcpy (hp->wbuf + hp->wlen, q, hp->w_size);
+	hp->wlen += hp->w_size;
+	return 0;
+}
+
+/* start a new run at the current end of temporary file 'n' */
+static void
+sort_run_start (struct cobsort *hp, const int n)
+{
+	if (hp->run_count == hp->run_alloc) {
+		if (hp->runs) {
+			hp->run_alloc *= 2;
+			hp->runs = cob_realloc (hp->runs,
+				hp->run_count * sizeof (struct sort_run),
+				hp->run_alloc * sizeof (struct sort_run));
+		} else {
+			hp->run_alloc = 64;
+			hp->runs = cob_malloc (hp->run_alloc * sizeof (struct sort_run));
+		}
 	}
-	if (has_space) {
-		*dir = '"';
-		memcpy (&dir[1], dirname, (size_t)dir_size);
-		dir[dir_size + 1] = '"';
-	} else {
-		memcpy (dir, dirname, (size_t)dir_size);
+	hp->runs[hp->run_count].start = hp->file[n].size + hp->wlen;
+	hp->runs[hp->run_count].end = hp->runs[hp->run_count].start;
+	hp->run_count++;
+}
+
+static int
+sort_run_end (struct cobsort *hp, const int n)
+{
+	/* compressed runs consist of whole blocks */
+	if (hp->compress
+	 && sort_flush (hp, n)) {
+		return 1;
 	}
-	cob_free (dirname);
+	hp->runs[hp->run_count - 1].end = hp->file[n].size + hp->wlen;
 	return 0;
 }
 
-/* entry point and processing for library routine CBL_CREATE_DIR */
-int
-cob_sys_create_dir (unsigned char *dir)
+/* write the smallest record of the heap to the current run,
+   starting the next run if the record belongs to that */
+static int
+sort_output_top (struct cobsort *hp)
 {
-	char	*fn;
-	int	ret;
+	const struct sort_entry	*top = hp->entries;
 
-	COB_UNUSED (dir);
-
-	COB_CHK_PARMS (CBL_CREATE_DIR, 1);
+	if (top->run != hp->cur_run) {
+		/* LCOV_EXCL_START */
+		if (unlikely (sort_run_end (hp, 0))) {
+			return 1;
+		}
+		/* LCOV_EXCL_STOP */
+		sort_run_start (hp, 0);
+		hp->cur_run = top->run;
+	}
+	hp->last_prefix = top->prefix;
+	return sort_write_item (hp, 0, top->item);
+}
 
-	if (!COB_MODULE_PTR->cob_procedure_params[0]) {
-		return -1;
+/* get the temporary file and the output buffer for the initial runs */
+static int
+sort_open_runs (struct cobsort *hp)
+{
+	/* LCOV_EXCL_START */
+	if (unlikely (cob_get_sort_tempfile (hp, 0))) {
+		return 1;
 	}
-	fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[0]);
-	ret = mkdir (fn, 0770);
-	cob_free (fn);
-	if (ret) {
-		return 128;
+	/* LCOV_EXCL_STOP */
+	hp->buff_size = cobsetptr->cob_sort_block_size
+		? cobsetptr->cob_sort_block_size : hp->chunk_size;
+	hp->buff_size -= hp->buff_size % hp->w_size;
+	if (hp->buff_size < hp->w_size) {
+		hp->buff_size = hp->w_size;
+	}
+	hp->wbuf = cob_fast_malloc (hp->buff_size);
+	hp->wlen = 0;
+	hp->compress = cobsetptr->cob_sort_compress;
+	if (hp->compress) {
+		hp->cbuf = cob_fast_malloc (sizeof (struct sort_block)
+			+ hp->buff_size + hp->buff_size / 255 + 16);
+		hp->lz = cob_fast_malloc (sizeof (struct sort_lz));
 	}
 	return 0;
 }
 
-/* entry point and processing for library routine CBL_CHANGE_DIR */
-int
-cob_sys_change_dir (unsigned char *dir)
+/* memory is exhausted: switch to generating runs in temporary files
+   by replacement selection, using the records in memory as heap */
+static int
+sort_start_runs (struct cobsort *hp)
 {
-	char	*fn;
-	int	ret;
-
-	COB_UNUSED (dir);
-
-	COB_CHK_PARMS (CBL_CHANGE_DIR, 1);
+	size_t	i;
 
-	if (!COB_MODULE_PTR->cob_procedure_params[0]) {
-		return -1;
+	/* LCOV_EXCL_START */
+	if (unlikely (sort_open_runs (hp))) {
+		return 1;
 	}
-	fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[0]);
-	ret = chdir (fn);
-	cob_free (fn);
-	if (ret) {
-		return 128;
+	/* LCOV_EXCL_STOP */
+	for (i = 0; i < hp->entry_count; ++i) {
+		hp->entries[i].run = 0;
 	}
+	for (i = hp->entry_count / 2; i > 0; --i) {
+		sort_heap_down (hp, i - 1);
+	}
+	hp->cur_run = 0;
+	sort_run_start (hp, 0);
+	hp->files_used = 1;
 	return 0;
 }
 
-/* entry point and processing for library routine CBL_DELETE_DIR */
-int
-cob_sys_delete_dir (unsigned char *dir)
+/* replacement selection: write the smallest record to the current run
+   and take over its memory for the new record 'p', which goes to the
+   next run if it is less than the record just written */
+static int
+sort_replace_top (struct cobsort *hp, const unsigned char *p)
 {
-	char	*fn;
-	int	ret;
-
-	COB_UNUSED (dir);
-
-	COB_CHK_PARMS (CBL_DELETE_DIR, 1);
+	struct sort_entry	*top = hp->entries;
+	struct cobitem		*q = top->item;
+	struct cobitem		*last;
+	int			less;
 
-	if (!COB_MODULE_PTR->cob_procedure_params[0]) {
-		return -1;
+	/* LCOV_EXCL_START */
+	if (unlikely (sort_output_top (hp))) {
+		return COBSORTFILEERR;
 	}
-	fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[0]);
-	ret = rmdir (fn);
-	cob_free (fn);
-	if (ret) {
-		return 128;
+	/* LCOV_EXCL_STOP */
+	last = (struct cobitem *)(hp->wbuf + hp->wlen - hp->w_size);
+	top->prefix = sort_item_fill (hp, q, p);
+	if (top->prefix != hp->last_prefix) {
+		less = top->prefix < hp->last_prefix;
+	} else {
+		less = cob_file_sort_compare (hp, q, last) < 0;
 	}
+	top->run = less ? hp->cur_run + 1 : hp->cur_run;
+	sort_heap_down (hp, 0);
 	return 0;
 }
 
-/* entry point for C$MAKEDIR, processing in cob_sys_create_dir */
-int
-cob_sys_mkdir (unsigned char *dir)
-{
-	int		ret;
+#ifdef	COB_SORT_USE_THREADS
+/* minimal number of records sorted by one thread */
+#define	COB_SORT_MIN_PART	16384
 
-	COB_CHK_PARMS (C$MAKEDIR, 1);
+/* whether comparing the keys only reads the records,
+   so that multiple threads may compare at the same time */
+static int
+sort_keys_thread_safe (struct cobsort *hp)
+{
+	const cob_file	*f = hp->pointer;
+	size_t		i;
 
-	ret = cob_sys_create_dir (dir);
-	if (ret < 0) {
-		ret = 128;
+	for (i = 0; i < f->nkeys; ++i) {
+		if (!hp->keys[i].thread_safe) {
+			return 0;
+		}
 	}
-	return ret;
+	return 1;
 }
 
-/* entry point for C$CHDIR, processing in cob_sys_change_dir */
-int
-cob_sys_chdir (unsigned char *dir, unsigned char *status)
-{
-	int		ret;
+/* part of a parallel in-memory sort, either sorting 'n' entries
+   of 'src' or merging them with 'n2' entries of 'src2' into 'dest' */
+struct sort_task {
+	struct cobsort		*hp;
+	struct sort_entry	*src;
+	struct sort_entry	*src2;
+	struct sort_entry	*dest;
+	size_t			n;
+	size_t			n2;
+};
 
-	COB_UNUSED (status);
+static void *
+sort_task_sort (void *data)
+{
+	struct sort_task	*t = data;
 
-	COB_CHK_PARMS (C$CHDIR, 2);
+	/* 'dest' is used as scratch area */
+	sort_entries_any (t->hp, t->src, t->dest, t->n);
+	return NULL;
+}
 
-	ret = cob_sys_change_dir (dir);
-	if (ret < 0) {
-		ret = 128;
+static void *
+sort_task_merge (void *data)
+{
+	struct sort_task	*t = data;
+	struct sort_entry	*a = t->src;
+	struct sort_entry	*a_end = a + t->n;
+	struct sort_entry	*b = t->src2;
+	struct sort_entry	*b_end = b + t->n2;
+	struct sort_entry	*dest = t->dest;
+
+	while (a < a_end && b < b_end) {
+		if (sort_entry_cmp (t->hp, b, a) < 0) {
+			*dest++ = *b++;
+		} else {
+			*dest++ = *a++;
+		}
 	}
-	cob_set_int (COB_MODULE_PTR->cob_procedure_params[1], ret);
-	return ret;
+	while (a < a_end) {
+		*dest++ = *a++;
+	}
+	while (b < b_end) {
+		*dest++ = *b++;
+	}
+	return NULL;
 }
 
-/* entry point for C$COPY, processing in cob_sys_copy_file */
-int
-cob_sys_copyfile (unsigned char *fname1, unsigned char *fname2,
-		  unsigned char *file_type)
+/* run the tasks, all but the first one in their own thread;
+   a task that can't get a thread is done here afterwards */
+static void
+sort_run_tasks (void *(*func) (void *), struct sort_task *task,
+		const size_t count)
 {
-	int		ret;
-
-	/* RXW - Type is not yet evaluated */
-	COB_UNUSED (file_type);
-
-	COB_CHK_PARMS (C$COPY, 3);
+	pthread_t	*tid = cob_malloc (count * sizeof (pthread_t));
+	int		*started = cob_malloc (count * sizeof (int));
+	size_t		i;
 
-	if (cobglobptr->cob_call_params < 3) {
-		return 128;
+	for (i = 1; i < count; ++i) {
+		started[i] = pthread_create (&tid[i], NULL, func, &task[i]) == 0;
 	}
-	ret = cob_sys_copy_file (fname1, fname2);
-	if (ret < 0) {
-		ret = 128;
+	func (&task[0]);
+	for (i = 1; i < count; ++i) {
+		if (started[i]) {
+			pthread_join (tid[i], NULL);
+		} else {
+			func (&task[i]);
+		}
 	}
-	return ret;
+	cob_free (started);
+	cob_free (tid);
 }
 
-/* entry point and processing for C$FILEINFO */
-int
-cob_sys_file_info (unsigned char *file_name, unsigned char *file_info)
+/* number of entries from 'a' within the first 'k' entries
+   of the merge of 'a' and 'b' */
+static size_t
+sort_merge_split (struct cobsort *hp,
+		  const struct sort_entry *a, const size_t na,
+		  const struct sort_entry *b, const size_t nb, const size_t k)
 {
-	char			*fn;
-	struct tm		*tm;
-	cob_u64_t		sz;
-	unsigned int		dt;
-	short			y;
-	short			d, m, hh, mm, ss;
-	struct stat		st;
+	size_t	lo = k > nb ? k - nb : 0;
+	size_t	hi = k < na ? k : na;
 
-	COB_UNUSED (file_name);
+	while (lo < hi) {
+		const size_t	i = lo + (hi - lo) / 2;
+		if (sort_entry_cmp (hp, &b[k - i - 1], &a[i]) < 0) {
+			hi = i;
+		} else {
+			lo = i + 1;
+		}
+	}
+	return lo;
+}
 
-	COB_CHK_PARMS (C$FILEINFO, 2);
+/* sort the entries in memory with all threads: each thread sorts one
+   part, then pairs of sorted parts are merged, each merge again split
+   into pieces of equal size for the threads; as the record number
+   makes all keys unique the result is the same as sorting by one thread */
+static void
+sort_entries_parallel (struct cobsort *hp)
+{
+	const size_t		n = hp->entry_count;
+	const size_t		threads = hp->threads;
+	struct sort_entry	*src = hp->entries;
+	struct sort_entry	*dest = cob_fast_malloc (n * sizeof (struct sort_entry));
+	struct sort_task	*task = cob_malloc (threads * sizeof (struct sort_task));
+	size_t			*bound = cob_malloc ((threads + 1) * sizeof (size_t));
+	size_t			parts = threads;
+	size_t			i;
 
-	if (cobglobptr->cob_call_params < 2
-	 || !COB_MODULE_PTR->cob_procedure_params[0]) {
-		return 128;
-	}
-	if (!COB_MODULE_PTR->cob_procedure_params[1]) {
-		return 128;
-	}
-	if (COB_MODULE_PTR->cob_procedure_params[1]->size < 16U) {
-		cob_runtime_error (_("'%s' - File detail area is too short"), "C$FILEINFO");
-#if 0 /* should be handled by the caller,
-		TODO: check for better return code (or the one from ACU) */
-		cob_hard_failure ();
-#else
-		return 128;
-#endif
-	}
+	if (parts > n / COB_SORT_MIN_PART) {
+		parts = n / COB_SORT_MIN_PART;
+	}
+	for (i = 0; i <= parts; ++i) {
+		bound[i] = n / parts * i + n % parts * i / parts;
+	}
+	for (i = 0; i < parts; ++i) {
+		task[i].hp = hp;
+		task[i].src = src + bound[i];
+		task[i].dest = dest + bound[i];
+		task[i].n = bound[i + 1] - bound[i];
+	}
+	sort_run_tasks (sort_task_sort, task, parts);
+
+	while (parts > 1) {
+		const size_t		pairs = parts / 2;
+		const size_t		pieces = threads / pairs;
+		struct sort_entry	*swap;
+		size_t			count = 0;
+
+		for (i = 0; i < pairs; ++i) {
+			struct sort_entry	*a = src + bound[2 * i];
+			struct sort_entry	*b = src + bound[2 * i + 1];
+			const size_t		na = bound[2 * i + 1] - bound[2 * i];
+			const size_t		nb = bound[2 * i + 2] - bound[2 * i + 1];
+			size_t			k = 0;
+			size_t			ia = 0;
+			size_t			j;
+			for (j = 1; j <= pieces; ++j) {
+				const size_t	k2 = (na + nb) / pieces * j
+					+ (na + nb) % pieces * j / pieces;
+				const size_t	ia2 = sort_merge_split (hp, a, na, b, nb, k2);
+				task[count].hp = hp;
+				task[count].src = a + ia;
+				task[count].n = ia2 - ia;
+				task[count].src2 = b + (k - ia);
+				task[count].n2 = (k2 - ia2) - (k - ia);
+				task[count].dest = dest + bound[2 * i] + k;
+				count++;
+				k = k2;
+				ia = ia2;
+			}
+		}
+		if (parts % 2) {
+			memcpy (dest + bound[parts - 1], src + bound[parts - 1],
+				(n - bound[parts - 1]) * sizeof (struct sort_entry));
+		}
+		sort_run_tasks (sort_task_merge, task, count);
+		for (i = 0; i < (parts + 1) / 2; ++i) {
+			bound[i] = bound[2 * i];
+		}
+		parts = (parts + 1) / 2;
+		bound[parts] = n;
+		swap = src;
+		src = dest;
+		dest = swap;
+	}
+
+	cob_free (dest);
+	hp->entries = src;
+	hp->entry_alloc = n;
+	cob_free (bound);
+	cob_free (task);
+}
+
+#endif
+
+/* sort all records in memory */
+static void
+sort_all_entries (struct cobsort *hp)
+{
+	struct sort_entry	*tmp;
 
-	fn = cob_str_from_fld (COB_MODULE_PTR->cob_procedure_params[0]);
-	if (stat (fn, &st) < 0) {
-		cob_free (fn);
-		return 35;
+	if (hp->entry_count < 2) {
+		return;
 	}
-	cob_free (fn);
-	sz = (cob_u64_t)st.st_size;
-	tm = localtime (&st.st_mtime);
-	d = (short)tm->tm_mday;
-	m = (short)(tm->tm_mon + 1);
-	y = (short)(tm->tm_year + 1900);
-	hh = (short)tm->tm_hour;
-	mm = (short)tm->tm_min;
-	/* Leap seconds ? */
-	if (tm->tm_sec >= 60) {
-		ss = 59;
-	} else {
-		ss = (short)tm->tm_sec;
+#ifdef	COB_SORT_USE_THREADS
+	if (hp->threads > 1
+	 && hp->entry_count >= 2 * COB_SORT_MIN_PART) {
+		sort_entries_parallel (hp);
+		return;
 	}
-
-#ifndef	WORDS_BIGENDIAN
-	sz = COB_BSWAP_64 (sz);
-#endif
-	memcpy (file_info, &sz, (size_t)8);
-	dt = (y * 10000) + (m * 100) + d;
-#ifndef	WORDS_BIGENDIAN
-	dt = COB_BSWAP_32 (dt);
-#endif
-	memcpy (file_info + 8, &dt, (size_t)4);
-	dt = (hh * 1000000) + (mm * 10000) + (ss * 100);
-#ifndef	WORDS_BIGENDIAN
-	dt = COB_BSWAP_32 (dt);
 #endif
-	memcpy (file_info + 12, &dt, (size_t)4);
-	return 0;
+	tmp = cob_fast_malloc ((hp->key_len ? hp->entry_count : hp->entry_count / 2 + 1)
+			       * sizeof (struct sort_entry));
+	sort_entries_any (hp, hp->entries, tmp, hp->entry_count);
+	cob_free (tmp);
 }
 
-/* entry point for C$DELETE, processing in cob_sys_delete_file */
-int
-cob_sys_file_delete (unsigned char *file_name, unsigned char *file_type)
+#ifdef	COB_SORT_USE_THREADS
+/* thread writing a batch of sorted records as one run,
+   releasing the batch afterwards */
+static void *
+sort_write_batch (void *data)
 {
-	int	ret;
-
-	/* RXW - Type is not yet evaluated */
-	COB_UNUSED (file_type);
-
-	COB_CHK_PARMS (C$DELETE, 2);
+	struct cobsort	*hp = data;
+	size_t		i;
 
-	if (cobglobptr->cob_call_params < 2 ||
-	    !COB_MODULE_PTR->cob_procedure_params[0]) {
-		return 128;
+	sort_run_start (hp, 0);
+	for (i = 0; i < hp->w_count; ++i) {
+		/* LCOV_EXCL_START */
+		if (unlikely (sort_write_item (hp, 0, hp->w_entries[i].item))) {
+			hp->writer_error = 1;
+			break;
+		}
+		/* LCOV_EXCL_STOP */
 	}
-	ret = cob_sys_delete_file (file_name);
-	if (ret < 0) {
-		ret = 128;
+	/* LCOV_EXCL_START */
+	if (unlikely (sort_run_end (hp, 0))) {
+		hp->writer_error = 1;
 	}
-	return ret;
+	/* LCOV_EXCL_STOP */
+	if (hp->w_entries) {
+		cob_free (hp->w_entries);
+	}
+	sort_free_mem (hp->w_mem_base);
+	hp->w_entries = NULL;
+	hp->w_mem_base = NULL;
+	hp->w_count = 0;
+	return NULL;
 }
 
-/* SORT */
-
+/* wait for the writer of the last batch */
 static int
-sort_cmps (const unsigned char *s1, const unsigned char *s2, const size_t size,
-	   const unsigned char *col)
+sort_writer_wait (struct cobsort *hp)
 {
-	size_t		i;
-	int 		ret;
-
-	if (unlikely (col)) {
-		for (i = 0; i < size; ++i) {
-			if ((ret = col[s1[i]] - col[s2[i]]) != 0) {
-				return ret;
-			}
-		}
-	} else {
-		for (i = 0; i < size; ++i) {
-			if ((ret = s1[i] - s2[i]) != 0) {
-				return ret;
-			}
-		}
+	if (hp->writer_active) {
+		pthread_join (hp->writer, NULL);
+		hp->writer_active = 0;
 	}
-	return 0;
+	return hp->writer_error;
 }
 
-static COB_INLINE void
-unique_copy (unsigned char *s1, const unsigned char *s2)
+/* memory is exhausted with multiple threads: sort the records in memory
+   and hand them to a writer thread as the next run, so that the next batch
+   is read in meanwhile; if 'last' is set the batch is written directly */
+static int
+sort_spill_batch (struct cobsort *hp, const int last)
 {
-	size_t	size = sizeof (size_t);
-	do {
-		*s1++ = *s2++;
-	} while (--size);
+	if (sort_writer_wait (hp)) {
+		return 1;
+	}
+	if (!hp->files_used) {
+		/* LCOV_EXCL_START */
+		if (unlikely (sort_open_runs (hp))) {
+			return 1;
+		}
+		/* LCOV_EXCL_STOP */
+		hp->files_used = 1;
+	}
+	sort_all_entries (hp);
+	hp->w_mem_base = hp->mem_base;
+	hp->w_entries = hp->entries;
+	hp->w_count = hp->entry_count;
+	hp->mem_base = NULL;
+	hp->mem_size = 0;
+	hp->mem_used = 0;
+	hp->mem_total = 0;
+	hp->entries = NULL;
+	hp->entry_count = 0;
+	hp->entry_alloc = 0;
+	hp->switch_to_file = 0;
+	if (last
+	 || pthread_create (&hp->writer, NULL, sort_write_batch, hp) != 0) {
+		sort_write_batch (hp);
+	} else {
+		hp->writer_active = 1;
+	}
+	return hp->writer_error;
 }
-
+#endif
+/* read the next part of the run into the input buffer,
+   with COB_SORT_COMPRESS the next block */
 static int
-cob_file_sort_compare (struct cobitem *k1, struct cobitem *k2, void *pointer)
+sort_input_fill (struct cobsort *hp, struct sort_input *in, const int n)
 {
-	cob_file	*f = pointer;
-	size_t		i;
-	size_t		u1;
-	size_t		u2;
+	const int	fd = fileno (hp->file[n].fp);
+	size_t		size = hp->buff_size;
 
-	for (i = 0; i < f->nkeys; ++i) {
-		int		cmp;
-		cob_field	f1;
-		cob_field	f2;
-		f1 = f2 = *(f->keys[i].field);
-		f1.data = k1->item + f->keys[i].offset;
-		f2.data = k2->item + f->keys[i].offset;
-		if (unlikely (COB_FIELD_IS_NUMERIC (&f1))) {
-			cmp = cob_numeric_cmp (&f1, &f2);
-		} else {
-			cmp = sort_cmps (f1.data, f2.data, f1.size,
-					 f->sort_collating);
+	/* LCOV_EXCL_START */
+	if (unlikely (lseek (fd, (off_t)in->offset, SEEK_SET) == (off_t)-1)) {
+		return 1;
+	}
+	/* LCOV_EXCL_STOP */
+	if (hp->compress) {
+		struct sort_block	blk;
+		/* LCOV_EXCL_START */
+		if (unlikely (in->end - in->offset < (cob_s64_t)sizeof (blk)
+		 || sort_read_all (fd, (unsigned char *)&blk, sizeof (blk)))) {
+			return 1;
+		}
+		in->offset += sizeof (blk);
+		if (unlikely (blk.raw > hp->buff_size
+		 || blk.stored > blk.raw
+		 || (cob_s64_t)blk.stored > in->end - in->offset)) {
+			return 1;
+		}
+		if (blk.stored == blk.raw) {
+			if (unlikely (sort_read_all (fd, in->buff, blk.raw))) {
+				return 1;
+			}
+		} else if (unlikely (sort_read_all (fd, hp->cbuf, blk.stored)
+			|| sort_lz_decompress (hp->cbuf, blk.stored,
+					       in->buff, blk.raw))) {
+			return 1;
 		}
-		if (cmp != 0) {
-			return (f->keys[i].flag == COB_ASCENDING) ? cmp : -cmp;
+		/* LCOV_EXCL_STOP */
+		in->offset += blk.stored;
+		size = blk.raw;
+	} else {
+		if ((cob_s64_t)size > in->end - in->offset) {
+			size = (size_t)(in->end - in->offset);
+		}
+		/* LCOV_EXCL_START */
+		if (unlikely (sort_read_all (fd, in->buff, size))) {
+			return 1;
 		}
+		/* LCOV_EXCL_STOP */
+		in->offset += size;
 	}
-	unique_copy ((unsigned char *)&u1, k1->unique);
-	unique_copy ((unsigned char *)&u2, k2->unique);
-	if (u1 < u2) {
-		return -1;
+	in->len = size;
+	in->pos = 0;
+#if	defined (HAVE_POSIX_FADVISE) && defined (POSIX_FADV_WILLNEED)
+	/* the inputs are read in turns, which defeats the read-ahead
+	   of the system: request the next part while this one is merged */
+	if (in->offset < in->end) {
+		cob_s64_t	next = hp->buff_size + sizeof (struct sort_block);
+		if (next > in->end - in->offset) {
+			next = in->end - in->offset;
+		}
+		(void)posix_fadvise (fd, (off_t)in->offset, (off_t)next,
+				     POSIX_FADV_WILLNEED);
 	}
-	return 1;
+#endif
+	return 0;
 }
 
-static void
-cob_free_list (struct cobsort *hp)
+/* index 'input_count' is used as "less than everything" while setting up */
+static int
+sort_merge_less (struct cobsort *hp, const size_t a, const size_t b)
 {
-	struct sort_mem_struct	*s1;
-	struct sort_mem_struct	*s2;
+	const struct sort_input	*ia, *ib;
 
-	s1 = hp->mem_base;
-	for (; s1;) {
-		s2 = s1;
-		s1 = s1->next;
-		cob_free (s2->mem_ptr);
-		cob_free (s2);
+	if (a == hp->input_count) {
+		return 1;
 	}
-}
-
-static struct cobitem *
-cob_new_item (struct cobsort *hp, const size_t size)
-{
-	struct cobitem		*q;
-
-	COB_UNUSED (size);
-
-	/* Creation of an empty item */
-	if (unlikely (hp->empty != NULL)) {
-		q = hp->empty;
-		hp->empty = q->next;
-		q->block_byte = 0;
-		q->next = NULL;
-		q->end_of_block = 0;
-		return (void *)q;
+	if (b == hp->input_count) {
+		return 0;
 	}
-	if (unlikely ((hp->mem_used + hp->alloc_size) > hp->mem_size)) {
-		struct sort_mem_struct	*s;
-		s = cob_fast_malloc (sizeof (struct sort_mem_struct));
-		s->mem_ptr = cob_fast_malloc (hp->chunk_size);
-		s->next = hp->mem_base;
-		hp->mem_base = s;
-		hp->mem_size = hp->chunk_size;
-		hp->mem_total += hp->chunk_size;
-		hp->mem_used = 0;
+	ia = &hp->input[a];
+	ib = &hp->input[b];
+	/* exhausted input is greater than everything */
+	if (ia->pos == ia->len) {
+		return 0;
 	}
-	q = (struct cobitem *)(hp->mem_base->mem_ptr + hp->mem_used);
-	hp->mem_used += hp->alloc_size;
-	if (unlikely (hp->mem_total >= cobsetptr->cob_sort_memory)) {
-		if ((hp->mem_used + hp->alloc_size) > hp->mem_size) {
-			hp->switch_to_file = 1;
-		}
+	if (ib->pos == ib->len) {
+		return 1;
 	}
-	q->block_byte = 0;
-	q->next = NULL;
-	q->end_of_block = 0;
-	return q;
+	return cob_file_sort_compare (hp, (struct cobitem *)(ia->buff + ia->pos),
+				(struct cobitem *)(ib->buff + ib->pos)) < 0;
 }
 
-FILE *
-cob_create_tmpfile (const char *ext)
+/* replay the matches of input 'w' up to the root of the loser tree */
+static void
+sort_merge_adjust (struct cobsort *hp, size_t w)
 {
-	FILE	*fp;
-	char	*filename;
-	int 	fd;
+	size_t	t = (w + hp->input_count) / 2;
 
-	filename = cob_malloc ((size_t)COB_FILE_BUFF);
-	cob_temp_name (filename, ext);
-	cob_incr_temp_iteration ();
-#ifdef	_WIN32
-	fd = open (filename,
-		    _O_CREAT | _O_TRUNC | _O_RDWR | _O_BINARY | _O_TEMPORARY,
-		    _S_IREAD | _S_IWRITE);
-#else
-	fd = open (filename, O_CREAT | O_TRUNC | O_RDWR | O_BINARY, COB_FILE_MODE);
-#endif
-	if (fd == -1) {
-		cob_free (filename);
-		return NULL;
-	}
-	(void)unlink (filename);
-	fp = fdopen (fd, "w+b");
-	if (!fp) {
-		close (fd);
+	while (t > 0) {
+		if (sort_merge_less (hp, hp->tree[t], w)) {
+			const size_t	loser = w;
+			w = hp->tree[t];
+			hp->tree[t] = loser;
+		}
+		t /= 2;
 	}
-	cob_free (filename);
-	return fp;
+	hp->tree[0] = w;
 }
 
-static int
-cob_get_sort_tempfile (struct cobsort *hp, const int n)
+static void
+sort_merge_free (struct cobsort *hp)
 {
-	if (hp->file[n].fp == NULL) {
-		hp->file[n].fp = cob_create_tmpfile (NULL);
-#if 0 /* error to be handled by the caller */
-		if (hp->file[n].fp == NULL) {
-			cob_runtime_error (_("SORT is unable to acquire temporary file"));
-			cob_hard_failure ();
+	size_t	i;
+
+	if (hp->input) {
+		for (i = 0; i < hp->input_count; ++i) {
+			cob_free (hp->input[i].buff);
 		}
-#endif
-	} else {
-		rewind (hp->file[n].fp);
+		cob_free (hp->input);
+		cob_free (hp->tree);
+		hp->input = NULL;
+		hp->tree = NULL;
 	}
-	hp->file[n].count = 0;
-	return hp->file[n].fp == NULL;
+	hp->input_count = 0;
 }
 
+/* set up a merge of 'count' runs, starting with 'first', of temporary
+   file 'n'; the next record is then the one of input tree[0] */
 static int
-cob_sort_queues (struct cobsort *hp)
-{
-	int 	source = 0;
-
-	while (hp->queue[source + 1].count != 0) {
-		int		destination  = source ^ 2;
-		hp->queue[destination].first = NULL;
-		hp->queue[destination].count = 0;
-		hp->queue[destination + 1].first = NULL;
-		hp->queue[destination + 1].count = 0;
-		for (;;) {
-			int		end_of_block[2];
-			end_of_block[0] = hp->queue[source].count == 0;
-			end_of_block[1] = hp->queue[source + 1].count == 0;
-			if (end_of_block[0] && end_of_block[1]) {
-				break;
-			}
-			while (!end_of_block[0] || !end_of_block[1]) {
-				struct cobitem	*q;
-				int 	move;
-				if (end_of_block[0]) {
-					move = 1;
-				} else if (end_of_block[1]) {
-					move = 0;
-				} else {
-					const int	res
-					 = cob_file_sort_compare
-						(hp->queue[source].first,
-						hp->queue[source + 1].first,
-						hp->pointer);
-					move = res < 0 ? 0 : 1;
-				}
-				q = hp->queue[source + move].first;
-				if (q->end_of_block) {
-					end_of_block[move] = 1;
-				}
-				hp->queue[source + move].first = q->next;
-				if (hp->queue[destination].first == NULL) {
-					hp->queue[destination].first = q;
-				} else {
-					hp->queue[destination].last->next = q;
-				}
-				hp->queue[destination].last = q;
-				hp->queue[source + move].count--;
-				hp->queue[destination].count++;
-				q->next = NULL;
-				q->end_of_block = 0;
-			}
-			hp->queue[destination].last->end_of_block = 1;
-			destination ^= 1;
+sort_merge_start (struct cobsort *hp, const struct sort_run *first,
+		  const size_t count, const int n)
+{
+	size_t	i;
+
+	hp->input_count = count;
+	hp->input = cob_malloc (count * sizeof (struct sort_input));
+	hp->tree = cob_malloc (count * sizeof (size_t));
+	for (i = 0; i < count; ++i) {
+		struct sort_input	*in = &hp->input[i];
+		in->buff = cob_fast_malloc (hp->buff_size);
+		in->offset = first[i].start;
+		in->end = first[i].end;
+		/* LCOV_EXCL_START */
+		if (unlikely (sort_input_fill (hp, in, n))) {
+			return 1;
 		}
-		source = destination & 2;
+		/* LCOV_EXCL_STOP */
+		hp->tree[i] = count;
 	}
-	return source;
+	for (i = count; i > 0; --i) {
+		sort_merge_adjust (hp, i - 1);
+	}
+	return 0;
 }
 
+/* pass the record of input 'w' and replay its matches */
 static int
-cob_read_item (struct cobsort *hp, const int n)
+sort_merge_next (struct cobsort *hp, const size_t w, const int n)
 {
-	FILE	*fp = hp->file[n].fp;
+	struct sort_input	*in = &hp->input[w];
 
-	if (getc (fp) != 0) {
-		hp->queue[n].first->end_of_block = 1;
-	} else {
-		hp->queue[n].first->end_of_block = 0;
+	in->pos += hp->w_size;
+	if (in->pos == in->len
+	 && in->offset < in->end) {
 		/* LCOV_EXCL_START */
-		if (unlikely (fread (hp->queue[n].first->unique,
-				hp->r_size, (size_t)1, fp) != 1)) {
+		if (unlikely (sort_input_fill (hp, in, n))) {
 			return 1;
 		}
 		/* LCOV_EXCL_STOP */
 	}
+	sort_merge_adjust (hp, w);
 	return 0;
 }
 
+/* merge the runs in temporary files until there are not more
+   than can be merged at once, then set up that final merge */
 static int
-cob_write_block (struct cobsort *hp, const int n)
+sort_merge_runs (struct cobsort *hp)
 {
-	FILE	*fp = hp->file[hp->destination_file].fp;
+	size_t	fan_in;
+	int	source = 0;
 
-	for (;;) {
-		struct cobitem	*q = hp->queue[n].first;
-		if (q == NULL) {
-			break;
+	fan_in = cobsetptr->cob_sort_memory / hp->buff_size;
+	if (fan_in < 2) {
+		fan_in = 2;
+	}
+	while (hp->run_count > fan_in) {
+		const int		destination = source ^ 1;
+		struct sort_run		*runs = hp->runs;
+		const size_t		run_count = hp->run_count;
+		size_t			i;
+
+		/* LCOV_EXCL_START */
+		if (unlikely (cob_get_sort_tempfile (hp, destination))) {
+			return 1;
+		}
+		/* LCOV_EXCL_STOP */
+		hp->runs = NULL;
+		hp->run_count = hp->run_alloc = 0;
+		for (i = 0; i < run_count; i += fan_in) {
+			const size_t	count = run_count - i < fan_in
+					      ? run_count - i : fan_in;
+			sort_run_start (hp, destination);
+			/* LCOV_EXCL_START */
+			if (unlikely (sort_merge_start (hp, runs + i, count, source))) {
+				cob_free (runs);
+				return 1;
+			}
+			/* LCOV_EXCL_STOP */
+			for (; ;) {
+				const size_t		w = hp->tree[0];
+				struct sort_input	*in = &hp->input[w];
+				if (in->pos == in->len) {
+					break;
+				}
+				/* LCOV_EXCL_START */
+				if (unlikely (sort_write_item (hp, destination,
+					(struct cobitem *)(in->buff + in->pos))
+				 || sort_merge_next (hp, w, source))) {
+					cob_free (runs);
+					return 1;
+				}
+				/* LCOV_EXCL_STOP */
+			}
+			sort_merge_free (hp);
+			/* LCOV_EXCL_START */
+			if (unlikely (sort_run_end (hp, destination))) {
+				cob_free (runs);
+				return 1;
+			}
+			/* LCOV_EXCL_STOP */
 		}
+		cob_free (runs);
 		/* LCOV_EXCL_START */
-		if (unlikely (fwrite (&(q->block_byte),
-				hp->w_size, (size_t)1, fp) != 1)) {
+		if (unlikely (sort_flush (hp, destination))) {
 			return 1;
 		}
 		/* LCOV_EXCL_STOP */
-		hp->queue[n].first = q->next;
-		q->next = hp->empty;
-		hp->empty = q;
+		hp->passes++;
+		source = destination;
 	}
-	hp->queue[n].count = 0;
-	hp->file[hp->destination_file].count++;
-	/* LCOV_EXCL_START */
-	if (unlikely (putc (1, fp) != 1)) {
-		return 1;
-	}
-	/* LCOV_EXCL_STOP */
-	return 0;
+	hp->merge_file = source;
+	hp->passes++;
+	return sort_merge_start (hp, hp->runs, hp->run_count, source);
 }
 
 static void
@@ -8108,116 +12244,98 @@ cob_copy_check (cob_field *to_record, cob_field *from_record)
 	}
 }
 
-static int
-cob_file_sort_process (struct cobsort *hp)
+/* sizes of a record in memory and in the temporary files,
+   including the encoded keys */
+static void
+sort_set_sizes (struct cobsort *hp)
 {
-	const int	n = cob_sort_queues (hp);
-	int 	source;
+	const size_t	n = sizeof (struct cobitem) - offsetof (struct cobitem, item);
 
-	hp->retrieving = 1;
-#if	0	/* RXWRXW - Cannot be true */
-	/* LCOV_EXCL_START */
-	if (unlikely (n < 0)) {
-		return COBSORTABORT;
+	hp->w_size = offsetof (struct cobitem, item) + hp->size + hp->key_len;
+	if (hp->size + hp->key_len <= n) {
+		hp->alloc_size = sizeof (struct cobitem);
+	} else {
+		hp->alloc_size = hp->w_size;
 	}
-	/* LCOV_EXCL_STOP */
-#endif
-	if (likely(!hp->files_used)) {
-		hp->retrieval_queue = n;
-		return 0;
+	if (hp->alloc_size % sizeof (void *)) {
+		hp->alloc_size += sizeof (void *) - (hp->alloc_size % sizeof (void *));
 	}
-	/* LCOV_EXCL_START */
-	if (unlikely (cob_write_block (hp, n))) {
-		return COBSORTFILEERR;
+	hp->chunk_size = cobsetptr->cob_sort_chunk;
+	if (hp->chunk_size % hp->alloc_size) {
+		hp->chunk_size += hp->alloc_size - (hp->chunk_size % hp->alloc_size);
 	}
-	/* LCOV_EXCL_STOP */
-	{
-		int	i;
-		for (i = 0; i < 4; ++i) {
-			hp->queue[i].first = hp->empty;
-			hp->empty = hp->empty->next;
-			hp->queue[i].first->next = NULL;
+}
+
+/* COB_SORT_RADIX: store the keys encoded after each record,
+   if all of them can be encoded */
+static void
+sort_use_encoded_keys (struct cobsort *hp)
+{
+	const cob_file	*f = hp->pointer;
+	size_t		len = 0;
+	size_t		i;
+
+	for (i = 0; i < f->nkeys; ++i) {
+		if (hp->keys[i].encoded_size == 0) {
+			return;
 		}
+		len += hp->keys[i].encoded_size;
 	}
-	rewind (hp->file[0].fp);
-	rewind (hp->file[1].fp);
-	/* LCOV_EXCL_START */
-	if (unlikely (cob_get_sort_tempfile (hp, 2))) {
-		return COBSORTFILEERR;
-	}
-	if (unlikely (cob_get_sort_tempfile (hp, 3))) {
-		return COBSORTFILEERR;
+	hp->key_len = len;
+	sort_set_sizes (hp);
+}
+
+static int
+cob_file_sort_process (struct cobsort *hp)
+{
+	hp->retrieving = 1;
+	if (likely (!hp->files_used)) {
+		sort_all_entries (hp);
+		hp->retrieval_pos = 0;
+		return 0;
 	}
-	/* LCOV_EXCL_STOP */
-	source = 0;
-	while (hp->file[source].count > 1) {
-		int 	destination = source ^ 2;
-		hp->file[destination].count = 0;
-		hp->file[destination + 1].count = 0;
-		while (hp->file[source].count > 0) {
-			/* LCOV_EXCL_START */
-			if (unlikely (cob_read_item (hp, source))) {
-				return COBSORTFILEERR;
-			}
-			/* LCOV_EXCL_STOP */
-			if (hp->file[source + 1].count > 0) {
-				/* LCOV_EXCL_START */
-				if (unlikely (cob_read_item (hp, source + 1))) {
-					return COBSORTFILEERR;
-				}
-				/* LCOV_EXCL_STOP */
-			} else {
-				hp->queue[source + 1].first->end_of_block = 1;
-			}
-			while (!hp->queue[source].first->end_of_block
-			    || !hp->queue[source + 1].first->end_of_block) {
-				int 	move;
-				if (hp->queue[source].first->end_of_block) {
-					move = 1;
-				} else if (hp->queue[source + 1].first->end_of_block) {
-					move = 0;
-				} else {
-					const int	res
-					 = cob_file_sort_compare
-						(hp->queue[source].first,
-						hp->queue[source + 1].first,
-						hp->pointer);
-					move = res < 0 ? 0 : 1;
-				}
-				/* LCOV_EXCL_START */
-				if (unlikely (fwrite (
-				    &(hp->queue[source + move].first->block_byte),
-				    hp->w_size, (size_t)1,
-				    hp->file[destination].fp) != 1)) {
-					return COBSORTFILEERR;
-				}
-				if (unlikely(cob_read_item (hp, source + move))) {
-					return COBSORTFILEERR;
-				}
-				/* LCOV_EXCL_STOP */
-			}
-			hp->file[destination].count++;
+#ifdef	COB_SORT_USE_THREADS
+	if (hp->threads > 1) {
+		/* write the records in memory as last run */
+		/* LCOV_EXCL_START */
+		if (unlikely (sort_spill_batch (hp, 1))) {
+			return COBSORTFILEERR;
+		}
+		/* LCOV_EXCL_STOP */
+	} else
+#endif
+	{
+		/* write out the heap */
+		while (hp->entry_count > 0) {
 			/* LCOV_EXCL_START */
-			if (unlikely (putc (1, hp->file[destination].fp) != 1)) {
+			if (unlikely (sort_output_top (hp))) {
 				return COBSORTFILEERR;
 			}
 			/* LCOV_EXCL_STOP */
-			hp->file[source].count--;
-			hp->file[source + 1].count--;
-			destination ^= 1;
+			hp->entries[0] = hp->entries[--hp->entry_count];
+			sort_heap_down (hp, 0);
 		}
-		source = destination & 2;
-		rewind (hp->file[0].fp);
-		rewind (hp->file[1].fp);
-		rewind (hp->file[2].fp);
-		rewind (hp->file[3].fp);
+		/* LCOV_EXCL_START */
+		if (unlikely (sort_run_end (hp, 0))) {
+			return COBSORTFILEERR;
+		}
+		/* LCOV_EXCL_STOP */
 	}
-	hp->retrieval_queue = source;
 	/* LCOV_EXCL_START */
-	if (unlikely (cob_read_item (hp, source))) {
+	if (unlikely (sort_flush (hp, 0))) {
 		return COBSORTFILEERR;
 	}
-	if (unlikely (cob_read_item (hp, source + 1))) {
+	/* LCOV_EXCL_STOP */
+	/* release the memory for the merge */
+	cob_free_list (hp);
+	if (hp->entries) {
+		cob_free (hp->entries);
+		hp->entries = NULL;
+	}
+	hp->entry_alloc = 0;
+	hp->initial_runs = hp->run_count;
+	/* LCOV_EXCL_START */
+	if (unlikely (sort_merge_runs (hp))) {
 		return COBSORTFILEERR;
 	}
 	/* LCOV_EXCL_STOP */
@@ -8228,9 +12346,8 @@ cob_file_sort_process (struct cobsort *hp)
 static int
 cob_file_sort_submit (struct cobsort *hp, const unsigned char *p)
 {
+	struct sort_entry	*e;
 	struct cobitem		*q;
-	struct queue_struct	*z;
-	int 		n;
 
 #if 0	/* can't happen */
 	if (unlikely (!hp)) {
@@ -8240,47 +12357,62 @@ cob_file_sort_submit (struct cobsort *hp, const unsigned char *p)
 	if (unlikely (hp->retrieving)) {
 		return COBSORTABORT;
 	}
+	if (unlikely (hp->unique == 0)) {
+		cob_file	*f = hp->pointer;
+		if (cobsetptr->cob_sort_radix) {
+			sort_use_encoded_keys (hp);
+		}
+		hp->use_prefix = f->nkeys > 0
+			&& hp->keys[0].type != COB_SORT_KEY_NUMERIC;
+#ifdef	COB_SORT_USE_THREADS
+		hp->threads = cobsetptr->cob_sort_threads;
+		if (hp->threads > 1
+		 && (hp->key_len || sort_keys_thread_safe (hp))) {
+			/* half of the memory for the records read in,
+			   the other half for the batch currently written */
+			hp->mem_limit /= 2;
+		} else {
+			hp->threads = 1;
+		}
+#endif
+	}
 	if (unlikely (hp->switch_to_file)) {
-		if (!hp->files_used) {
+#ifdef	COB_SORT_USE_THREADS
+		if (hp->threads > 1) {
 			/* LCOV_EXCL_START */
-			if (unlikely (cob_get_sort_tempfile (hp, 0))) {
-				return COBSORTFILEERR;
-			}
-			if (unlikely (cob_get_sort_tempfile (hp, 1))) {
+			if (unlikely (sort_spill_batch (hp, 0))) {
 				return COBSORTFILEERR;
 			}
 			/* LCOV_EXCL_STOP */
-			hp->files_used = 1;
-			hp->destination_file = 0;
-		}
-		n = cob_sort_queues (hp);
-#if	0	/* RXWRXW - Cannot be true */
-		/* LCOV_EXCL_START */
-		if (unlikely (n < 0)) {
-			return COBSORTABORT;
-		}
-		/* LCOV_EXCL_STOP */
+		} else
 #endif
-		/* LCOV_EXCL_START */
-		if (unlikely (cob_write_block (hp, n))) {
-			return COBSORTFILEERR;
+		{
+			if (!hp->files_used) {
+				/* LCOV_EXCL_START */
+				if (unlikely (sort_start_runs (hp))) {
+					return COBSORTFILEERR;
+				}
+				/* LCOV_EXCL_STOP */
+			}
+			return sort_replace_top (hp, p);
 		}
-		/* LCOV_EXCL_STOP */
-		hp->destination_file ^= 1;
 	}
-	q = cob_new_item (hp, sizeof (struct cobitem) + hp->size);
-	q->end_of_block = 1;
-	unique_copy (q->unique, (const unsigned char *)&(hp->unique));
-	hp->unique++;
-	memcpy (q->item, p, hp->size);
-	if (hp->queue[0].count <= hp->queue[1].count) {
-		z = &hp->queue[0];
-	} else {
-		z = &hp->queue[1];
+	if (unlikely (hp->entry_count == hp->entry_alloc)) {
+		if (hp->entries) {
+			hp->entry_alloc *= 2;
+			hp->entries = cob_realloc (hp->entries,
+				hp->entry_count * sizeof (struct sort_entry),
+				hp->entry_alloc * sizeof (struct sort_entry));
+		} else {
+			hp->entry_alloc = hp->chunk_size / hp->alloc_size;
+			hp->entries = cob_malloc (hp->entry_alloc * sizeof (struct sort_entry));
+		}
 	}
-	q->next = z->first;
-	z->first = q;
-	z->count++;
+	q = cob_new_item (hp);
+	e = &hp->entries[hp->entry_count++];
+	e->item = q;
+	e->prefix = sort_item_fill (hp, q, p);
+	e->run = 0;
 	return 0;
 }
 
@@ -8302,38 +12434,22 @@ cob_file_sort_retrieve (struct cobsort *hp, unsigned char *p)
 		}
 	}
 	if (unlikely (hp->files_used)) {
-		int 	source = hp->retrieval_queue;
-		int 	move;
-		if (hp->queue[source].first->end_of_block) {
-			if (hp->queue[source + 1].first->end_of_block) {
-				return COBSORTEND;
-			}
-			move = 1;
-		} else if (hp->queue[source + 1].first->end_of_block) {
-			move = 0;
-		} else {
-			res = cob_file_sort_compare (hp->queue[source].first,
-						hp->queue[source + 1].first,
-						hp->pointer);
-			move = res < 0 ? 0 : 1;
+		const size_t		w = hp->tree[0];
+		struct sort_input	*in = &hp->input[w];
+		if (in->pos == in->len) {
+			return COBSORTEND;
 		}
-		memcpy (p, hp->queue[source + move].first->item, hp->size);
+		memcpy (p, ((struct cobitem *)(in->buff + in->pos))->item, hp->size);
 		/* LCOV_EXCL_START */
-		if (unlikely (cob_read_item (hp, source + move))) {
+		if (unlikely (sort_merge_next (hp, w, hp->merge_file))) {
 			return COBSORTFILEERR;
 		}
 		/* LCOV_EXCL_STOP */
 	} else {
-		struct queue_struct	*z = &hp->queue[hp->retrieval_queue];
-		struct cobitem		*next;
-		if (z->first == NULL) {
+		if (hp->retrieval_pos == hp->entry_count) {
 			return COBSORTEND;
 		}
-		memcpy (p, z->first->item, hp->size);
-		next = z->first->next;
-		z->first->next = hp->empty;
-		hp->empty = z->first;
-		z->first = next;
+		memcpy (p, hp->entries[hp->retrieval_pos++].item->item, hp->size);
 	}
 	return 0;
 }
@@ -8345,38 +12461,22 @@ cob_file_sort_init (cob_file *f, const unsigned int nkeys,
 		    void *sort_return, cob_field *fnstatus)
 {
 	struct cobsort	*p;
-	size_t		n;
 
 	p = cob_malloc (sizeof (struct cobsort));
 	p->fnstatus = fnstatus;
 	p->size = f->record_max;
-	p->r_size = f->record_max + sizeof (size_t);
-	p->w_size = f->record_max + sizeof (size_t) + 1;
-	n = sizeof (struct cobitem) - offsetof (struct cobitem, item);
-	if (f->record_max <= n) {
-		p->alloc_size = sizeof (struct cobitem);
-	} else {
-		p->alloc_size = offsetof (struct cobitem, item) + f->record_max;
-	}
-	if (p->alloc_size % sizeof (void *)) {
-		p->alloc_size += sizeof (void *) - (p->alloc_size % sizeof (void *));
-	}
-	p->chunk_size = cobsetptr->cob_sort_chunk;
-	if (p->chunk_size % p->alloc_size) {
-		p->chunk_size += p->alloc_size - (p->chunk_size % p->alloc_size);
-	}
+	sort_set_sizes (p);
 	p->pointer = f;
 	if (sort_return) {
 		p->sort_return = sort_return;
 		*(int *)sort_return = 0;
 	}
-	p->mem_base = cob_fast_malloc (sizeof (struct sort_mem_struct));
-	p->mem_base->mem_ptr = cob_fast_malloc (p->chunk_size);
-	p->mem_base->next = NULL;
-	p->mem_size = p->chunk_size;
-	p->mem_total = p->chunk_size;
+	/* note: memory for the records is allocated with the first one */
+	p->mem_limit = cobsetptr->cob_sort_memory;
+	p->threads = 1;
 	f->file = p;
 	f->keys = cob_malloc (sizeof (cob_file_key) * nkeys);
+	p->keys = cob_malloc (sizeof (struct cob_sort_key) * nkeys);
 	f->nkeys = 0;
 	if (collating_sequence) {
 		f->sort_collating = collating_sequence;
@@ -8405,6 +12505,10 @@ void
 cob_file_sort_init_key (cob_file *f, cob_field *field, const int flag,
 			const unsigned int offset)
 {
+	struct cobsort	*hp = f->file;
+
+	cob_sort_key_init (&hp->keys[f->nkeys], field, flag, offset,
+			   f->sort_collating);
 	f->keys[f->nkeys].field = field;
 	f->keys[f->nkeys].flag = flag;
 	f->keys[f->nkeys].offset = offset;
@@ -8650,8 +12754,38 @@ cob_file_sort_close (cob_file *f)
 
 	if (likely (hp)) {
 		fnstatus = hp->fnstatus;
+		if (cobsetptr->cob_sort_stats) {
+			/* xgettext can't expand CB_FMT_LLD in the message */
+			char	spilled[24];
+			snprintf (spilled, sizeof (spilled), CB_FMT_LLD, hp->spilled);
+			fprintf (stderr, _("SORT %s: %lu records, %lu runs, "
+				"%lu merge passes, %s bytes in temporary files"),
+				f->select_name, (unsigned long)hp->unique,
+				(unsigned long)hp->initial_runs,
+				(unsigned long)hp->passes,
+				spilled);
+			putc ('\n', stderr);
+		}
+#ifdef	COB_SORT_USE_THREADS
+		(void)sort_writer_wait (hp);
+#endif
 		cob_free_list (hp);
-		for (i = 0; i < 4; ++i) {
+		sort_merge_free (hp);
+		cob_free (hp->keys);
+		if (hp->entries) {
+			cob_free (hp->entries);
+		}
+		if (hp->runs) {
+			cob_free (hp->runs);
+		}
+		if (hp->wbuf) {
+			cob_free (hp->wbuf);
+		}
+		if (hp->cbuf) {
+			cob_free (hp->cbuf);
+			cob_free (hp->lz);
+		}
+		for (i = 0; i < 2; ++i) {
 			if (hp->file[i].fp != NULL) {
 				fclose (hp->file[i].fp);
 			}
@@ -8799,6 +12933,24 @@ cob_exit_fileio_closeall (void)
 		}
 	}
 #ifdef	WITH_DB
+	if (bdb_env
+	 && cobsetptr->bdb_stats) {
+		bdb_add_cache_stats (bdb_env);
+	}
+	if (cobsetptr->bdb_stats
+	 && bdb_cache_hit + bdb_cache_miss != 0) {
+		/* the format of the counts is platform specific, so it is
+		   not part of the translated message */
+		char	hits[24], misses[24];
+		snprintf (hits, sizeof (hits), CB_FMT_LLU, bdb_cache_hit);
+		snprintf (misses, sizeof (misses), CB_FMT_LLU, bdb_cache_miss);
+		fprintf (stderr, _("BDB cache: %s hits, %s misses, hit ratio %.1f%%"),
+			hits, misses,
+			100.0 * (double)bdb_cache_hit
+			 / (double)(bdb_cache_hit + bdb_cache_miss));
+		putc ('\n', stderr);
+	}
+	bdb_cache_hit = bdb_cache_miss = 0;
 	if (bdb_env) {
 		DB_LOCKREQ	lckreq[1];
 		memset (lckreq, 0, sizeof (DB_LOCKREQ));
@@ -8819,6 +12971,7 @@ void
 cob_exit_fileio (void)
 {
 	cob_exit_fileio_closeall ();
+	journal_close ();
 
 #if	defined(WITH_INDEX_EXTFH) || defined(WITH_SEQRA_EXTFH)
 	extfh_cob_exit_fileio ();
@@ -8860,6 +13013,9 @@ cob_init_fileio (cob_global *lptr, cob_settings *sptr)
 	cobglobptr = lptr;
 	cobsetptr  = sptr;
 	file_cache = NULL;
+#ifdef	COB_NATIVE_ISAM
+	cob_init_isam (sptr);
+#endif
 	eop_status = 0;
 	check_eop_status = 0;
 	if (cobsetptr->cob_sort_chunk > (cobsetptr->cob_sort_memory / 2)) {
@@ -8901,6 +13057,8 @@ cob_init_fileio (cob_global *lptr, cob_settings *sptr)
 	extfh_cob_init_fileio (&sequential_funcs, &lineseq_funcs,
 			       &relative_funcs, &cob_file_write_opt);
 #endif
+
+	journal_open ();
 }
 
 /********************************************************************************/
@@ -9776,6 +13934,15 @@ cob_extfh_open (
 
 	/* Keep table of 'fcd' created */
 	sts = callfh (opcode, fcd);
+	/* other handlers may not pass the changes to libcob's journal */
+	if (callfh != EXTFH
+	 && f->organization == COB_ORG_INDEXED
+	 && mode != COB_OPEN_INPUT
+	 && journal_fd != -1
+	 && sts == 0) {
+		cob_runtime_warning (_("changes to %s by an external file handler may not be journaled"),
+			f->select_name);
+	}
 	if (f->file_status) {
 		if (memcmp(f->file_status,"00",2) == 0
 		 || memcmp(f->file_status,"05",2) == 0) {
@@ -141,6 +141,222 @@ static const unsigned char pack_to_bin [] = {
 #endif
 };
 
+/* Conversion kernels for DISPLAY digits <-> packed nibbles <-> binary,
+   also used by numeric.c and common.c;
+   SSE2 is always available on x86-64 and used there unconditionally,
+   the AVX2 variants are selected at runtime by cob_init_move.
+   All kernels handle invalid data identical to the scalar code:
+   only the low nibble of a DISPLAY byte is used (COB_D2I),
+   packed nibbles are unpacked as '0' + nibble (COB_I2D). */
+
+#ifdef	COB_SIMD_SSE2
+#include <emmintrin.h>
+#if	(defined (__GNUC__) && __GNUC__ >= 5) || defined (__clang__)
+#define COB_SIMD_AVX2
+#include <immintrin.h>
+#define COB_TARGET_AVX2	__attribute__ ((target ("avx2")))
+static int	cob_has_avx2 = 0;
+#endif
+#endif
+
+#ifdef	COB_SIMD_SSE2
+/* mask of bytes that are not '0' - '9' */
+static COB_INLINE COB_A_INLINE int
+sse2_invalid_digits (const __m128i v)
+{
+	const __m128i	lt = _mm_cmplt_epi8 (v, _mm_set1_epi8 ('0'));
+	const __m128i	gt = _mm_cmpgt_epi8 (v, _mm_set1_epi8 ('9'));
+	return _mm_movemask_epi8 (_mm_or_si128 (lt, gt));
+}
+
+/* 16 digits -> 16-bit lanes with (high nibble << 4) | low nibble */
+static COB_INLINE COB_A_INLINE __m128i
+sse2_pack_pairs (const __m128i digits)
+{
+	const __m128i	v = _mm_and_si128 (digits, _mm_set1_epi8 (0x0F));
+	const __m128i	hi = _mm_and_si128 (_mm_slli_epi16 (v, 4),
+					_mm_set1_epi16 (0x00F0));
+	return _mm_or_si128 (hi, _mm_srli_epi16 (v, 8));
+}
+
+/* 8 packed bytes -> 16 digits */
+static COB_INLINE COB_A_INLINE __m128i
+sse2_unpack8 (const __m128i v)
+{
+	const __m128i	nib = _mm_set1_epi8 (0x0F);
+	const __m128i	hi = _mm_and_si128 (_mm_srli_epi16 (v, 4), nib);
+	const __m128i	lo = _mm_and_si128 (v, nib);
+	return _mm_add_epi8 (_mm_unpacklo_epi8 (hi, lo), _mm_set1_epi8 ('0'));
+}
+
+/* 16 (or 8 in the low half) digits -> 32-bit lanes with 8 digits each */
+static COB_INLINE COB_A_INLINE __m128i
+sse2_digits_to_int (const __m128i digits)
+{
+	const __m128i	v = _mm_and_si128 (digits, _mm_set1_epi8 (0x0F));
+	/* 2 digits per 16-bit lane: first * 10 + second */
+	__m128i		t = _mm_add_epi16 (
+				_mm_mullo_epi16 (_mm_and_si128 (v, _mm_set1_epi16 (0x00FF)),
+					_mm_set1_epi16 (10)),
+				_mm_srli_epi16 (v, 8));
+	/* 4 digits per 32-bit lane, at most 16665 for invalid data */
+	t = _mm_madd_epi16 (t, _mm_set1_epi32 ((1 << 16) | 100));
+	t = _mm_packs_epi32 (t, t);
+	/* 8 digits per 32-bit lane */
+	return _mm_madd_epi16 (t, _mm_set1_epi32 ((1 << 16) | 10000));
+}
+#endif
+
+#ifdef	COB_SIMD_AVX2
+static COB_TARGET_AVX2 int
+avx2_invalid_digits (const unsigned char *p)
+{
+	const __m256i	v = _mm256_loadu_si256 ((const __m256i *)p);
+	const __m256i	lt = _mm256_cmpgt_epi8 (_mm256_set1_epi8 ('0'), v);
+	const __m256i	gt = _mm256_cmpgt_epi8 (v, _mm256_set1_epi8 ('9'));
+	return _mm256_movemask_epi8 (_mm256_or_si256 (lt, gt));
+}
+
+/* 32 digits -> 16 packed bytes */
+static COB_TARGET_AVX2 void
+avx2_pack32 (unsigned char *q, const unsigned char *p)
+{
+	const __m256i	v = _mm256_and_si256 (
+				_mm256_loadu_si256 ((const __m256i *)p),
+				_mm256_set1_epi8 (0x0F));
+	const __m256i	hi = _mm256_and_si256 (_mm256_slli_epi16 (v, 4),
+					_mm256_set1_epi16 (0x00F0));
+	__m256i		r = _mm256_or_si256 (hi, _mm256_srli_epi16 (v, 8));
+	/* packing works per 128-bit lane, take the low quadword of both */
+	r = _mm256_permute4x64_epi64 (_mm256_packus_epi16 (r, r), 0x08);
+	_mm_storeu_si128 ((__m128i *)q, _mm256_castsi256_si128 (r));
+}
+
+/* 16 packed bytes -> 32 digits */
+static COB_TARGET_AVX2 void
+avx2_unpack16 (unsigned char *b, const unsigned char *d)
+{
+	const __m256i	v = _mm256_cvtepu8_epi16 (
+				_mm_loadu_si128 ((const __m128i *)d));
+	/* high nibble to the first byte of each 16-bit lane */
+	const __m256i	r = _mm256_or_si256 (_mm256_srli_epi16 (v, 4),
+				_mm256_slli_epi16 (_mm256_and_si256 (v,
+					_mm256_set1_epi16 (0x000F)), 8));
+	_mm256_storeu_si256 ((__m256i *)b,
+		_mm256_add_epi8 (r, _mm256_set1_epi8 ('0')));
+}
+#endif
+
+/* check that all n bytes are valid digits '0' - '9' */
+int
+cob_check_digits (const unsigned char *p, size_t n)
+{
+#ifdef	COB_SIMD_AVX2
+	if (cob_has_avx2) {
+		for (; n >= 32; n -= 32, p += 32) {
+			if (avx2_invalid_digits (p)) {
+				return 0;
+			}
+		}
+	}
+#endif
+#ifdef	COB_SIMD_SSE2
+	for (; n >= 16; n -= 16, p += 16) {
+		if (sse2_invalid_digits (_mm_loadu_si128 ((const __m128i *)p))) {
+			return 0;
+		}
+	}
+	if (n >= 8) {
+		if (sse2_invalid_digits (_mm_loadl_epi64 ((const __m128i *)p)) & 0xFF) {
+			return 0;
+		}
+		n -= 8;
+		p += 8;
+	}
+#endif
+	for (; n; n--, p++) {
+		if ((unsigned char)(*p - '0') > 9) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* pack 2 * n digits into n bytes, the first digit into the high nibble */
+void
+cob_pack_digits (unsigned char *q, const unsigned char *p, size_t n)
+{
+#ifdef	COB_SIMD_AVX2
+	if (cob_has_avx2) {
+		for (; n >= 16; n -= 16, p += 32, q += 16) {
+			avx2_pack32 (q, p);
+		}
+	}
+#endif
+#ifdef	COB_SIMD_SSE2
+	for (; n >= 8; n -= 8, p += 16, q += 8) {
+		const __m128i	r = sse2_pack_pairs (
+					_mm_loadu_si128 ((const __m128i *)p));
+		_mm_storel_epi64 ((__m128i *)q, _mm_packus_epi16 (r, r));
+	}
+#endif
+	for (; n; n--, p += 2, q++) {
+		*q = (unsigned char)((*p << 4) & 0xF0)
+		   + COB_D2I (*(p + 1));
+	}
+}
+
+/* unpack n bytes into 2 * n digits */
+void
+cob_unpack_digits (unsigned char *b, const unsigned char *d, size_t n)
+{
+#ifdef	COB_SIMD_AVX2
+	if (cob_has_avx2) {
+		for (; n >= 16; n -= 16, d += 16, b += 32) {
+			avx2_unpack16 (b, d);
+		}
+	}
+#endif
+#ifdef	COB_SIMD_SSE2
+	for (; n >= 8; n -= 8, d += 8, b += 16) {
+		_mm_storeu_si128 ((__m128i *)b,
+			sse2_unpack8 (_mm_loadl_epi64 ((const __m128i *)d)));
+	}
+#endif
+	for (; n; n--, d++) {
+		*b++ = COB_I2D (*d >> 4);
+		*b++ = COB_I2D (*d & 0x0F);
+	}
+}
+
+/* get the value of n digits, for more than 19 digits modulo 2^64 */
+cob_u64_t
+cob_digits_to_u64 (const unsigned char *p, size_t n)
+{
+	cob_u64_t	val = 0;
+
+#ifdef	COB_SIMD_SSE2
+	for (; n >= 16; n -= 16, p += 16) {
+		const __m128i	t = sse2_digits_to_int (
+					_mm_loadu_si128 ((const __m128i *)p));
+		val = val * COB_U64_C (10000000000000000)
+		    + (cob_u64_t)_mm_cvtsi128_si32 (t) * 100000000
+		    + (cob_u64_t)_mm_cvtsi128_si32 (_mm_srli_si128 (t, 4));
+	}
+	if (n >= 8) {
+		val = val * 100000000
+		    + (cob_u64_t)_mm_cvtsi128_si32 (sse2_digits_to_int (
+				_mm_loadl_epi64 ((const __m128i *)p)));
+		n -= 8;
+		p += 8;
+	}
+#endif
+	for (; n; n--, p++) {
+		val = val * 10 + COB_D2I (*p);
+	}
+	return val;
+}
+
 static void
 store_common_region (cob_field *f, const unsigned char *data,
 		     const size_t size, const int scale, const int verified_data)
@@ -628,12 +844,14 @@ cob_move_display_to_packed (cob_field *f1, cob_field *f2)
 			/*                                                          */
 			/************************************************************/
 
-	while ((p < p_end) && (q <= q_end))
+	if ((p < p_end) && (q <= q_end))
 	{
-			*q = (unsigned char) ((*p << 4) & 0xF0)  /* -> dropping the higher bits = no use in COB_D2I */
-					+ COB_D2I (*(p + 1));
-			p = p + 2;
-				q++;
+			size_t	pairs = (size_t)(p_end - p + 1) >> 1;
+			if (pairs > (size_t)(q_end - q + 1))
+					pairs = (size_t)(q_end - q + 1);
+			cob_pack_digits (q, p, pairs);
+			p = p + (pairs << 1);
+			q = q + pairs;
 	}
 
 			/************************************************************/
@@ -713,9 +931,8 @@ cob_move_packed_to_display (cob_field *f1, cob_field *f2)
 				d++;
 			}
 		}
-		while (d <= d_end) {
-			*b++ = COB_I2D (*d >> 4);
-			*b++ = COB_I2D (*d++ & 0x0F);
+		if (d <= d_end) {
+			cob_unpack_digits (b, d, (size_t)(d_end - d + 1));
 		}
 
 		/* Store */
@@ -745,9 +962,10 @@ cob_move_packed_to_display (cob_field *f1, cob_field *f2)
 				d++;
 			}
 		}
-		while (d < d_end) {
-			*b++ = COB_I2D (*d >> 4);
-			*b++ = COB_I2D (*d++ & 0x0F);
+		if (d < d_end) {
+			cob_unpack_digits (b, d, (size_t)(d_end - d));
+			b += (d_end - d) << 1;
+			d = d_end;
 		}
 		*b++ = COB_I2D (*d >> 4);
 
@@ -758,6 +976,105 @@ cob_move_packed_to_display (cob_field *f1, cob_field *f2)
 
 }
 
+/* specialized entry points for MOVE, generated by cobc when the layout
+   of both fields is known at compile time; the caller passes the
+   position of the first digit to transfer in the source (src_skip)
+   and in the target (dst_skip) together with the number of digits
+   to transfer (count), as cob_move_display_to_packed and
+   cob_move_packed_to_display would compute them */
+
+/* MOVE numeric DISPLAY to PACKED-DECIMAL / COMP-6,
+   src_skip counts digits, dst_skip counts nibbles */
+void
+cob_move_display_to_bcd (cob_field *f1, cob_field *f2,
+	const int src_skip, const int dst_skip, const int count)
+{
+	const int	sign = COB_GET_SIGN_ADJUST (f1);
+	register const unsigned char	*p = COB_FIELD_DATA (f1) + src_skip;
+	register unsigned char	*q = f2->data + (dst_skip >> 1);
+	unsigned char	*q_end = f2->data + f2->size - 1;
+	int		n = count;
+
+	memset (f2->data, 0, f2->size);
+	if (n > 0) {
+		if (dst_skip & 1) {
+			*q++ = *p++ & 0x0F;
+			n--;
+		}
+		if (n > 1) {
+			cob_pack_digits (q, p, (size_t)n >> 1);
+			q += n >> 1;
+			p += n & ~1;
+		}
+		if (n & 1) {
+			*q = (unsigned char)((*p << 4) & 0xF0);
+		}
+	}
+
+	COB_PUT_SIGN_ADJUSTED (f1, sign);
+
+	if (COB_FIELD_NO_SIGN_NIBBLE (f2)) {
+		if (COB_FIELD_DIGITS (f2) < (f2->size << 1)) {
+			*(f2->data) &= 0x0F;
+		}
+		return;
+	}
+	if (COB_FIELD_DIGITS (f2) < (f2->size << 1) - 1) {
+		*(f2->data) &= 0x0F;
+	}
+	if (!COB_FIELD_HAVE_SIGN (f2)) {
+		*q_end |= 0x0F;
+	} else if (sign < 0) {
+		*q_end = (*q_end & 0xF0) | 0x0D;
+	} else {
+		*q_end = (*q_end & 0xF0) | 0x0C;
+	}
+}
+
+/* MOVE PACKED-DECIMAL / COMP-6 to numeric DISPLAY,
+   src_skip counts nibbles, dst_skip counts digits */
+void
+cob_move_bcd_to_display (cob_field *f1, cob_field *f2,
+	const int src_skip, const int dst_skip, const int count)
+{
+	register const unsigned char	*d = f1->data + (src_skip >> 1);
+	register unsigned char	*b = COB_FIELD_DATA (f2);
+	int		n = count;
+
+	memset (b, '0', COB_FIELD_SIZE (f2));
+	b += dst_skip;
+	if (n > 0) {
+		if (src_skip & 1) {
+			*b++ = COB_I2D (*d++ & 0x0F);
+			n--;
+		}
+		if (n > 1) {
+			cob_unpack_digits (b, d, (size_t)n >> 1);
+			b += n & ~1;
+			d += n >> 1;
+		}
+		if (n & 1) {
+			*b = COB_I2D (*d >> 4);
+		}
+	}
+
+	if (COB_FIELD_NO_SIGN_NIBBLE (f1)) {
+		COB_PUT_SIGN (f2, 0);
+	} else {
+		COB_PUT_SIGN (f2,
+			((f1->data[f1->size - 1] & 0x0F) == 0x0D) ? -1 : 1);
+	}
+}
+
+/* MOVE alphanumeric to a longer alphanumeric item,
+   padding with spaces */
+void
+cob_move_pad (void *dst, void *src, const int dst_len, const int src_len)
+{
+	memmove (dst, src, (size_t)src_len);
+	memset ((unsigned char *)dst + src_len, ' ', (size_t)(dst_len - src_len));
+}
+
 /* Floating point */
 
 static void
@@ -901,12 +1218,13 @@ cob_move_display_to_binary (cob_field *f1, cob_field *f2)
 
 	/* Get value */
 	sign = COB_GET_SIGN_ADJUST (f1);
+	if (i < size1 && i < size) {
+		const size_t	end = size < size1 ? size : size1;
+		val = cob_digits_to_u64 (data1 + i, end - i);
+		i = end;
+	}
 	for ( ; i < size; ++i) {
-		if (i < size1) {
-			val = val * 10 + COB_D2I (data1[i]);
-		} else {
-			val *= 10;
-		}
+		val *= 10;
 	}
 
 	if (COB_FIELD_HAVE_SIGN (f2)) {
@@ -2222,14 +2540,12 @@ display_get_long_long (cob_field *f)
 
 	/* Get value */
 	if (scale < 0) {
-		for (; i < size; ++i) {
-			val = val * 10 + COB_D2I (data[i]);
-		}
+		val = (cob_s64_t)cob_digits_to_u64 (data + i, size - i);
 		val *= cob_exp10_ll[-scale];
 	} else {
 		size -= scale;
-		for (; i < size; ++i) {
-			val = val * 10 + COB_D2I (data[i]);
+		if (i < size) {
+			val = (cob_s64_t)cob_digits_to_u64 (data + i, size - i);
 		}
 	}
 	if (sign < 0) {
@@ -2328,6 +2644,10 @@ cob_init_move (cob_global *lptr, cob_settings *sptr)
 {
 	cobglobptr = lptr;
 	cobsetptr  = sptr;
+#ifdef	COB_SIMD_AVX2
+	__builtin_cpu_init ();
+	cob_has_avx2 = __builtin_cpu_supports ("avx2");
+#endif
 }
 
 /*
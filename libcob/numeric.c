@@ -372,7 +372,9 @@ cob_decimal_clear (cob_decimal *d)
 void
 cob_decimal_set_ullint (cob_decimal *d, const cob_u64_t n)
 {
-#ifdef	COB_LI_IS_LL
+#if	defined (COB_DECIMAL_INT128)
+	mpz_set_s128 (d->value, (cob_s128_t)n);
+#elif	defined (COB_LI_IS_LL)
 	mpz_set_ui (d->value, (cob_uli_t)n);
 #else
 	mpz_set_ui (d->value, (cob_uli_t)(n >> 32));
@@ -386,7 +388,9 @@ cob_decimal_set_ullint (cob_decimal *d, const cob_u64_t n)
 void
 cob_decimal_set_llint (cob_decimal *d, const cob_s64_t n)
 {
-#ifdef	COB_LI_IS_LL
+#if	defined (COB_DECIMAL_INT128)
+	mpz_set_s128 (d->value, (cob_s128_t)n);
+#elif	defined (COB_LI_IS_LL)
 	mpz_set_si (d->value, (cob_sli_t)n);
 #else
 	cob_u64_t	uval;
@@ -409,6 +413,15 @@ cob_decimal_set_llint (cob_decimal *d, const cob_s64_t n)
 	d->scale = 0;
 }
 
+/** setting a decimal field from a signed binary long int with the given
+    implied scale, used for expressions that cobc computes natively */
+void
+cob_decimal_set_llint_scaled (cob_decimal *d, const cob_s64_t n, const int scale)
+{
+	cob_decimal_set_llint (d, n);
+	d->scale = scale;
+}
+
 /* Decimal print, note: currently (GC3.1) only called by display/dump
    code from termio.c (cob_display) via cob_print_ieeedec) */
 static void
@@ -554,11 +567,167 @@ cob_div_by_pow_10 (mpz_t mexp, unsigned int n)
 	mpz_tdiv_q (mexp, mexp, cob_mexp);
 }
 
+/* 128-bit fast path: values up to 2^127 - 1 (which covers all 38 digit
+   numbers) are read and written directly as __int128 in the (at most two)
+   limbs of the mpz_t, so that the common arithmetic on such numbers
+   doesn't need any GMP call; anything bigger falls back to GMP,
+   define COB_DECIMAL_NO_INT128 to disable this */
+#if	defined (__SIZEOF_INT128__) && !defined (COB_DECIMAL_NO_INT128) \
+ && GMP_LIMB_BITS == 64 && GMP_NAIL_BITS == 0
+#define	COB_DECIMAL_INT128
+typedef __int128		cob_s128_t;
+typedef unsigned __int128	cob_u128_t;
+
+#define	COB_S128_MAX	((cob_s128_t)(((cob_u128_t)1 << 127) - 1))
+
+/* 10 ^ n and the biggest number that may be multiplied with it */
+static cob_u128_t	cob_u128_pow10[COB_MAX_DIGITS + 1];
+static cob_u128_t	cob_u128_mulmax[COB_MAX_DIGITS + 1];
+
+/* get value of mpz_t if it fits into a signed 128-bit integer */
+static COB_INLINE COB_A_INLINE int
+mpz_get_s128 (mpz_srcptr src, cob_s128_t *val)
+{
+	const int	size = src->_mp_size;
+	cob_u128_t	uval;
+
+	switch (size) {
+	case 0:
+		*val = 0;
+		return 1;
+	case 1:
+		*val = (cob_s128_t)src->_mp_d[0];
+		return 1;
+	case -1:
+		*val = -(cob_s128_t)src->_mp_d[0];
+		return 1;
+	case 2:
+	case -2:
+		if (src->_mp_d[1] >> 63) {
+			return 0;
+		}
+		uval = ((cob_u128_t)src->_mp_d[1] << 64) | src->_mp_d[0];
+		*val = size > 0 ? (cob_s128_t)uval : -(cob_s128_t)uval;
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/* set mpz_t from a signed 128-bit integer */
+static COB_INLINE COB_A_INLINE void
+mpz_set_s128 (mpz_ptr dest, const cob_s128_t val)
+{
+	const cob_u128_t	uval = val < 0 ? -(cob_u128_t)val : (cob_u128_t)val;
+	const mp_limb_t		hi = (mp_limb_t)(uval >> 64);
+	int	size;
+
+	if (unlikely (dest->_mp_alloc < 2)) {
+		mpz_realloc2 (dest, 128UL);
+	}
+	dest->_mp_d[0] = (mp_limb_t)uval;
+	dest->_mp_d[1] = hi;
+	size = hi ? 2 : (uval ? 1 : 0);
+	dest->_mp_size = val < 0 ? -size : size;
+}
+
+/* number of significant bits */
+static COB_INLINE COB_A_INLINE int
+cob_u128_bits (const cob_u128_t val)
+{
+	const cob_u64_t	hi = (cob_u64_t)(val >> 64);
+	if (hi) {
+		return 128 - __builtin_clzll (hi);
+	}
+	if (val) {
+		return 64 - __builtin_clzll ((cob_u64_t)val);
+	}
+	return 0;
+}
+
+#define	cob_s128_abs(x)	((x) < 0 ? -(cob_u128_t)(x) : (cob_u128_t)(x))
+
+/* val / 10^n, truncated; using 64-bit division where possible,
+   as 128-bit division is a (much slower) library call */
+static COB_INLINE COB_A_INLINE cob_s128_t
+cob_s128_div_pow10 (const cob_s128_t val, const unsigned int n)
+{
+	if (n < 19
+	 && val == (cob_s64_t)val) {
+		return (cob_s64_t)val / (cob_s64_t)cob_u128_pow10[n];
+	}
+	return val / (cob_s128_t)cob_u128_pow10[n];
+}
+
+/* val % 10^n for an unsigned value, see above */
+static COB_INLINE COB_A_INLINE cob_u128_t
+cob_u128_mod_pow10 (const cob_u128_t val, const unsigned int n)
+{
+	if (n < 20
+	 && val == (cob_u64_t)val) {
+		return (cob_u64_t)val % (cob_u64_t)cob_u128_pow10[n];
+	}
+	return val % cob_u128_pow10[n];
+}
+
+/* decimal digits of 'val' into 'buff' (no leading zeros, terminated),
+   returns the number of digits */
+static unsigned int
+cob_u128_to_str (char *buff, cob_u128_t val)
+{
+	char		tmp[COB_MAX_BINARY + 1];
+	char		*p = tmp + sizeof (tmp);
+	cob_u64_t	part;
+	unsigned int	size;
+
+	while (val > (cob_u64_t)-1) {
+		/* 19 digits at once, with leading zeros */
+		int	i;
+		part = (cob_u64_t)(val % 10000000000000000000U);
+		val /= 10000000000000000000U;
+		for (i = 0; i < 19; i++) {
+			*--p = (char)('0' + part % 10);
+			part /= 10;
+		}
+	}
+	part = (cob_u64_t)val;
+	do {
+		*--p = (char)('0' + part % 10);
+		part /= 10;
+	} while (part);
+	size = (unsigned int)(tmp + sizeof (tmp) - p);
+	memcpy (buff, p, size);
+	buff[size] = 0;
+	return size;
+}
+#endif
+
 /* d->value *= 10^n, d->scale += n
    n may not be 0! */
 static void
 shift_decimal (cob_decimal *d, int n)
 {
+#ifdef	COB_DECIMAL_INT128
+	cob_s128_t	val;
+	if (mpz_get_s128 (d->value, &val)) {
+		if (n < 0) {
+			if (n >= -COB_MAX_DIGITS) {
+				mpz_set_s128 (d->value, cob_s128_div_pow10 (val, -n));
+			} else {
+				/* 10^39 is bigger than any 128-bit value */
+				d->value->_mp_size = 0;
+			}
+			d->scale += n;
+			return;
+		}
+		if (n <= COB_MAX_DIGITS
+		 && cob_s128_abs (val) <= cob_u128_mulmax[n]) {
+			mpz_set_s128 (d->value, val * (cob_s128_t)cob_u128_pow10[n]);
+			d->scale += n;
+			return;
+		}
+	}
+#endif
 	if (n > 0) {
 		cob_mul_by_pow_10 (d->value, n);
 	} else {
@@ -1187,12 +1356,41 @@ cob_decimal_set_packed (cob_decimal *d, cob_field *f)
 			val = val * 10
 				+ (*p >> 4);
 		}
-#ifdef	COB_LI_IS_LL
+#if	defined (COB_DECIMAL_INT128)
+		mpz_set_s128 (d->value, cob_packed_get_sign (f) == -1
+			? -(cob_s128_t)val : (cob_s128_t)val);
+		d->scale = COB_FIELD_SCALE (f);
+		return;
+#elif	defined (COB_LI_IS_LL)
 		mpz_set_ui (d->value, (cob_uli_t)val);
 #else
 		cob_decimal_set_ullint (d, val);
 #endif
 
+#ifdef	COB_DECIMAL_INT128
+	} else if (digits <= COB_MAX_DIGITS) {
+		/* up to 38 digits: collect the last 18 digits in a 64-bit part,
+		   the leading ones (up to 20) in a 128-bit one */
+		const unsigned char	*endp_lo = endp - 9;
+		cob_u128_t	val = byteval;
+		register cob_u64_t	lo = 0;
+
+		for (; p < endp_lo; p++) {
+			val = val * 100 + pack_to_bin[*p];
+		}
+		for (; p < endp; p++) {
+			lo = lo * 100 + pack_to_bin[*p];
+		}
+		val = val * 1000000000000000000U + lo;
+		if (!nibtest) {
+			val = val * 10 + (*p >> 4);
+		}
+		mpz_set_s128 (d->value, cob_packed_get_sign (f) == -1
+			? -(cob_s128_t)val : (cob_s128_t)val);
+		d->scale = COB_FIELD_SCALE (f);
+		return;
+#endif
+
 	} else {
 		/* note: an implementation similar to display - expanding to string,
 		   then convert to mpz from there - was tested and found to be slower */
@@ -1274,6 +1472,32 @@ cob_decimal_get_packed (cob_decimal *d, cob_field *f, const int opt)
 		}
 	}
 
+#ifdef	COB_DECIMAL_INT128
+	{
+		cob_s128_t	val;
+		if (digits <= COB_MAX_DIGITS
+		 && mpz_get_s128 (d->value, &val)) {
+			cob_u128_t	uval = cob_s128_abs (val);
+			if (uval >= cob_u128_pow10[digits]) {
+				/* Overflow */
+				if ((opt & COB_STORE_NO_SIZE_ERROR) == 0) {
+					cob_set_exception (COB_EC_SIZE_OVERFLOW);
+					if (opt & COB_STORE_KEEP_ON_OVERFLOW) {
+						return cobglobptr->cob_exception_code;
+					}
+				}
+				uval = cob_u128_mod_pow10 (uval, digits);
+			}
+			if (uval <= (cob_u64_t)-1) {
+				cob_set_packed_u64 (f, (cob_u64_t)uval, sign);
+				return 0;
+			}
+			(void) cob_u128_to_str (buff, uval);
+			goto store;
+		}
+	}
+#endif
+
 	/* Build string, note: we can't check the decimal size with mpz_sizeinbase,
 	   as its result is "either exact or one too big" (for base != 2);
 	   using gmp_snprintf to get both the string and the length was also
@@ -1314,6 +1538,9 @@ cob_decimal_get_packed (cob_decimal *d, cob_field *f, const int opt)
 		(void) mpz_get_str (buff, 10, d->value);
 	}
 
+#ifdef	COB_DECIMAL_INT128
+store:
+#endif
 	/* zero-out memory, necessary as we skip leading zeroes */
 	data = f->data;
 	memset (data, 0, f->size);
@@ -1438,6 +1665,21 @@ cob_set_packed_int (cob_field *f, const int val)
 
 /* DISPLAY */
 
+#ifdef	COB_DECIMAL_INT128
+/* check that all of the given data are digits, invalid data of more
+   than 19 digits is resolved by GMP as before */
+static int
+display_digits_valid (const unsigned char *data, unsigned int size)
+{
+	while (size--) {
+		if (COB_D2I (*data++) > 9) {
+			return 0;
+		}
+	}
+	return 1;
+}
+#endif
+
 static void
 cob_decimal_set_display (cob_decimal *d, cob_field *f)
 {
@@ -1473,14 +1715,28 @@ cob_decimal_set_display (cob_decimal *d, cob_field *f)
 	if (size < MAX_LI_DIGITS_PLUS_1) {
 		/* note: we skipped leading zeros above, so either
 		   "n > 0" " or "size = 0" afterwards */
-		register cob_uli_t	n = COB_D2I (*data);
-		data++;
-		while (--size) {
-			n = n * 10
-			  + COB_D2I (*data);
-			data++;
-		}
+		const cob_uli_t	n = (cob_uli_t)cob_digits_to_u64 (data, size);
+#ifdef	COB_DECIMAL_INT128
+		mpz_set_s128 (d->value, sign < 0 ? -(cob_s128_t)n : (cob_s128_t)n);
+		d->scale = COB_FIELD_SCALE (f);
+		COB_PUT_SIGN_ADJUSTED (f, sign);
+		return;
+#else
 		mpz_set_ui (d->value, n);
+#endif
+
+#ifdef	COB_DECIMAL_INT128
+	} else if (size <= COB_MAX_DIGITS
+		&& display_digits_valid (data, size)) {
+		/* up to 38 digits: two 64-bit parts, the lower one with 19 digits */
+		const cob_u64_t	hi = cob_digits_to_u64 (data, size - 19);
+		const cob_u64_t	lo = cob_digits_to_u64 (data + size - 19, 19);
+		const cob_u128_t	n = (cob_u128_t)hi * 10000000000000000000U + lo;
+		mpz_set_s128 (d->value, sign < 0 ? -(cob_s128_t)n : (cob_s128_t)n);
+		d->scale = COB_FIELD_SCALE (f);
+		COB_PUT_SIGN_ADJUSTED (f, sign);
+		return;
+#endif
 
 	} else if (size <= COB_MAX_INTERMEDIATE_FLOATING_SIZE) {
 
@@ -1558,6 +1814,32 @@ cob_decimal_get_display (cob_decimal *d, cob_field *f, const int opt)
 		COB_PUT_SIGN (f, 0);
 		return 0;
 	}
+#ifdef	COB_DECIMAL_INT128
+	{
+		cob_s128_t	val;
+		if (fsize <= COB_MAX_BINARY
+		 && mpz_get_s128 (d->value, &val)) {
+			cob_u128_t	uval = cob_s128_abs (val);
+			size_t		size;
+			if (fsize <= COB_MAX_DIGITS
+			 && uval >= cob_u128_pow10[fsize]) {
+				/* Overflow */
+				if ((opt & COB_STORE_NO_SIZE_ERROR) == 0) {
+					cob_set_exception (COB_EC_SIZE_OVERFLOW);
+					if (opt & COB_STORE_KEEP_ON_OVERFLOW) {
+						return cobglobptr->cob_exception_code;
+					}
+				}
+				uval = cob_u128_mod_pow10 (uval, fsize);
+			}
+			size = cob_u128_to_str (buff, uval);
+			memset (data, '0', fsize - size);
+			memcpy (data + fsize - size, buff, size);
+			COB_PUT_SIGN (f, sign);
+			return 0;
+		}
+	}
+#endif
 	if (sign == -1) {
 		mpz_abs (d->value, d->value);
 	}
@@ -1676,6 +1958,12 @@ cob_decimal_set_binary (cob_decimal *d, cob_field *f)
 	}
 #endif
 
+#elif	defined (COB_DECIMAL_INT128)
+	if (COB_FIELD_HAVE_SIGN (f)) {
+		mpz_set_s128 (d->value, (cob_s128_t)cob_binary_get_sint64 (f));
+	} else {
+		mpz_set_s128 (d->value, (cob_s128_t)cob_binary_get_uint64 (f));
+	}
 #elif	defined(COB_LI_IS_LL)
 	if (COB_FIELD_HAVE_SIGN (f)) {
 		mpz_set_si (d->value, cob_binary_get_sint64 (f));
@@ -1728,6 +2016,33 @@ cob_decimal_get_binary (cob_decimal *d, cob_field *f, const int opt)
 		memset (f->data, 0, f->size);
 		return 0;
 	}
+#ifdef	COB_DECIMAL_INT128
+	{
+		cob_s128_t	val;
+		if (mpz_get_s128 (d->value, &val)
+		 && cob_u128_bits (cob_s128_abs (val)) <= (int)bitnum) {
+			int	fits = 1;
+			if (!field_sign && val < 0) {
+				val = -val;
+			}
+			if (opt && COB_FIELD_BINARY_TRUNC (f)) {
+				const short	scale = COB_FIELD_SCALE (f);
+				const unsigned short	digits = scale >= 0
+					? COB_FIELD_DIGITS (f) : COB_FIELD_DIGITS (f) + scale;
+				fits = cob_s128_abs (val) < cob_u128_pow10[digits];
+			}
+			/* otherwise overflow, handled below */
+			if (fits) {
+				if (!field_sign) {
+					cob_binary_set_uint64 (f, (cob_u64_t)val);
+				} else {
+					cob_binary_set_int64 (f, (cob_s64_t)val);
+				}
+				return 0;
+			}
+		}
+	}
+#endif
 	overflow = 0;
 	if (!field_sign
 	 && mpz_sgn (d->value) == -1) {
@@ -1934,6 +2249,85 @@ cob_print_realbin (const cob_field *f, FILE *fp, const int size)
 
 /* do rounding on the decimal,
    returns 1 if needed and PROHIBITED */
+#ifdef	COB_DECIMAL_INT128
+/* rounding of a decimal with 128-bit value 'val' to 'scale',
+   with the same result as cob_decimal_do_round, returns 0 if
+   not possible, leaving 'd' unchanged */
+static int
+cob_decimal_round_s128 (cob_decimal *d, cob_s128_t val,
+	const int scale, const int opt)
+{
+	const unsigned int	adj = d->scale - scale;
+	const cob_u128_t	uval = cob_s128_abs (val);
+	const int		sign = val < 0 ? -1 : 1;
+	const cob_s128_t	pow = (cob_s128_t)cob_u128_pow10[adj];
+
+	switch (opt & ~(COB_STORE_MASK)) {
+	case COB_STORE_TRUNCATION:
+	case COB_STORE_PROHIBITED:
+		return 0;
+	case COB_STORE_AWAY_FROM_ZERO:
+	case COB_STORE_TOWARD_GREATER:
+	case COB_STORE_TOWARD_LESSER:
+		if (cob_u128_mod_pow10 (uval, adj) == 0) {
+			return 1;
+		}
+		if ((opt & ~(COB_STORE_MASK)) == COB_STORE_TOWARD_GREATER) {
+			if (sign == -1) {
+				return 1;
+			}
+		} else if ((opt & ~(COB_STORE_MASK)) == COB_STORE_TOWARD_LESSER) {
+			if (sign == 1) {
+				return 1;
+			}
+		}
+		if (uval > (cob_u128_t)(COB_S128_MAX - pow)) {
+			return 0;
+		}
+		mpz_set_s128 (d->value, val + sign * pow);
+		return 1;
+	default:
+		break;
+	}
+
+	/* rounding to nearest: cut off all but one of the digits to drop,
+	   then add 5 to that one (the caller truncates it);
+	   exact halves are checked before for rounding toward zero / even */
+	{
+		const cob_u128_t	rest = cob_u128_mod_pow10 (uval, adj);
+		const int	exact_half = rest == 0
+			|| rest == cob_u128_pow10[adj - 1] * 5;
+		val = cob_s128_div_pow10 (val, adj - 1);
+		d->scale = scale + 1;
+		switch (opt & ~(COB_STORE_MASK)) {
+		case COB_STORE_NEAR_TOWARD_ZERO:
+			if (exact_half) {
+				mpz_set_s128 (d->value, val);
+				return 1;
+			}
+			break;
+		case COB_STORE_NEAR_EVEN:
+			if (exact_half) {
+				switch ((int)(cob_s128_abs (val) % 100)) {
+				case 5:
+				case 25:
+				case 45:
+				case 65:
+				case 85:
+					mpz_set_s128 (d->value, val);
+					return 1;
+				}
+			}
+			break;
+		default:
+			break;
+		}
+		mpz_set_s128 (d->value, val + sign * 5);
+		return 1;
+	}
+}
+#endif
+
 static int
 cob_decimal_do_round (cob_decimal *d, cob_field *f, const int opt)
 {
@@ -1947,6 +2341,17 @@ cob_decimal_do_round (cob_decimal *d, cob_field *f, const int opt)
 		return 0;
 	}
 
+#ifdef	COB_DECIMAL_INT128
+	{
+		cob_s128_t	val;
+		if (d->scale - scale <= COB_MAX_DIGITS
+		 && mpz_get_s128 (d->value, &val)
+		 && cob_decimal_round_s128 (d, val, scale, opt)) {
+			return 0;
+		}
+	}
+#endif
+
 	switch (opt & ~(COB_STORE_MASK)) {
 	case COB_STORE_TRUNCATION:
 		return 0;
@@ -2178,10 +2583,83 @@ cob_decimal_get_field (cob_decimal *d, cob_field *f, const int opt)
 
 /* Decimal arithmetic */
 
+#ifdef	COB_DECIMAL_INT128
+/* align the 128-bit values of two decimals to the bigger scale,
+   returns that or INT_MIN if the value doesn't fit */
+static COB_INLINE COB_A_INLINE int
+cob_s128_align (cob_s128_t *v1, const int scale1,
+	cob_s128_t *v2, const int scale2)
+{
+	cob_s128_t	*v;
+	int	n;
+
+	if (scale1 == scale2) {
+		return scale1;
+	}
+	if (scale1 < scale2) {
+		v = v1;
+		n = scale2 - scale1;
+	} else {
+		v = v2;
+		n = scale1 - scale2;
+	}
+	if (n > COB_MAX_DIGITS
+	 || cob_s128_abs (*v) > cob_u128_mulmax[n]) {
+		return INT_MIN;
+	}
+	*v *= (cob_s128_t)cob_u128_pow10[n];
+	return scale1 < scale2 ? scale2 : scale1;
+}
+
+/* d1 += d2 or d1 -= d2 with 128-bit values,
+   returns 0 (leaving d1 unchanged) if not possible */
+static int
+cob_decimal_addsub_s128 (cob_decimal *d1, cob_decimal *d2, const int sub)
+{
+	cob_s128_t	v1, v2;
+	int	scale;
+
+	if (!mpz_get_s128 (d1->value, &v1)
+	 || !mpz_get_s128 (d2->value, &v2)) {
+		return 0;
+	}
+	if (d1->scale != d2->scale) {
+		/* same special cases as in cob_decimal_add / cob_decimal_sub */
+		if (v2 == 0) {
+			return 1;
+		}
+		if (v1 == 0 && !sub) {
+			mpz_set_s128 (d1->value, v2);
+			d1->scale = d2->scale;
+			return 1;
+		}
+	}
+	scale = cob_s128_align (&v1, d1->scale, &v2, d2->scale);
+	if (scale == INT_MIN) {
+		return 0;
+	}
+	if (sub) {
+		v2 = -v2;
+	}
+	if ((v2 > 0 && v1 > COB_S128_MAX - v2)
+	 || (v2 < 0 && v1 < -COB_S128_MAX - v2)) {
+		return 0;
+	}
+	mpz_set_s128 (d1->value, v1 + v2);
+	d1->scale = scale;
+	return 1;
+}
+#endif
+
 void
 cob_decimal_add (cob_decimal *d1, cob_decimal *d2)
 {
 	DECIMAL_CHECK (d1, d2);
+#ifdef	COB_DECIMAL_INT128
+	if (cob_decimal_addsub_s128 (d1, d2, 0)) {
+		return;
+	}
+#endif
 	if (d1->scale != d2->scale) {
 		if (mpz_sgn (d2->value) == 0) {
 			return;
@@ -2204,6 +2682,11 @@ void
 cob_decimal_sub (cob_decimal *d1, cob_decimal *d2)
 {
 	DECIMAL_CHECK (d1, d2);
+#ifdef	COB_DECIMAL_INT128
+	if (cob_decimal_addsub_s128 (d1, d2, 1)) {
+		return;
+	}
+#endif
 	if (d1->scale != d2->scale) {
 		if (mpz_sgn (d2->value) == 0) {
 			return;
@@ -2234,6 +2717,18 @@ cob_decimal_mul (cob_decimal *d1, cob_decimal *d2)
 {
 	DECIMAL_CHECK (d1, d2);
 	d1->scale += d2->scale;
+#ifdef	COB_DECIMAL_INT128
+	{
+		cob_s128_t	v1, v2;
+		if (mpz_get_s128 (d1->value, &v1)
+		 && mpz_get_s128 (d2->value, &v2)
+		 && cob_u128_bits (cob_s128_abs (v1))
+		  + cob_u128_bits (cob_s128_abs (v2)) <= 127) {
+			mpz_set_s128 (d1->value, v1 * v2);
+			return;
+		}
+	}
+#endif
 	mpz_mul (d1->value, d1->value, d2->value);
 }
 
@@ -2265,6 +2760,16 @@ cob_decimal_div (cob_decimal *d1, cob_decimal *d2)
 int
 cob_decimal_cmp (cob_decimal *d1, cob_decimal *d2)
 {
+#ifdef	COB_DECIMAL_INT128
+	{
+		cob_s128_t	v1, v2;
+		if (mpz_get_s128 (d1->value, &v1)
+		 && mpz_get_s128 (d2->value, &v2)
+		 && cob_s128_align (&v1, d1->scale, &v2, d2->scale) != INT_MIN) {
+			return v1 < v2 ? -1 : v1 > v2;
+		}
+	}
+#endif
 	if (d1->scale != d2->scale) {
 		mpz_set (cob_t1.value, d1->value);
 		cob_t1.scale = d1->scale;
@@ -4747,6 +5252,15 @@ cob_init_numeric (cob_global *lptr)
 		mpz_init2 (cob_mpze10[i], 128UL);
 		mpz_ui_pow_ui (cob_mpze10[i], 10UL, (cob_uli_t)i);
 	}
+#ifdef	COB_DECIMAL_INT128
+	cob_u128_pow10[0] = 1;
+	for (i = 1; i <= COB_MAX_DIGITS; i++) {
+		cob_u128_pow10[i] = cob_u128_pow10[i - 1] * 10;
+	}
+	for (i = 0; i <= COB_MAX_DIGITS; i++) {
+		cob_u128_mulmax[i] = (cob_u128_t)COB_S128_MAX / cob_u128_pow10[i];
+	}
+#endif
 	mpz_init_set (cob_mpz_ten16m1, cob_mpze10[16]);
 	mpz_sub_ui (cob_mpz_ten16m1, cob_mpz_ten16m1, 1UL);
 	mpz_init_set (cob_mpz_ten34m1, cob_mpze10[34]);
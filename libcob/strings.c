@@ -33,6 +33,10 @@
 #define	COB_LIB_EXPIMP
 #include "coblocal.h"
 
+#ifdef	COB_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
 enum inspect_type {
 	INSPECT_UNSET = 0,
 	INSPECT_ALL,
@@ -66,6 +70,20 @@ struct cob_inspect_state {
 	enum inspect_type type;
 };
 
+/* search plan for one INSPECT / BEFORE / AFTER operand, set up once and
+   used for all searches in the inspected area: single bytes and short
+   patterns look for the first byte with memchr, longer ones use the
+   skip table of Boyer-Moore-Horspool */
+#define INSPECT_SKIP_MIN	4	/* minimal pattern length for skip table */
+#define INSPECT_SKIP_AREA	32	/* minimal area length for skip table */
+
+struct inspect_plan {
+	const unsigned char	*pat;
+	size_t			len;
+	int			use_skip;
+	unsigned char		skip[256];
+};
+
 struct cob_string_state {
 	cob_field		*dst;
 	cob_field		*ptr;
@@ -84,6 +102,9 @@ struct cob_unstring_state {
 	int                 offset;
 	unsigned int        count;
 	unsigned int        ndlms;
+	int                 dlm_map;	/* dlm_first is used for multiple delimiters */
+	unsigned char       dlm_first[256];	/* 1 + index of the first delimiter
+                                         starting with that byte, 0 = none */
 };
 
 /* Local variables */
@@ -203,21 +224,60 @@ setup_repdata (struct cob_inspect_state *st)
 	}
 }
 
-static COB_INLINE COB_A_INLINE unsigned char *
-inspect_find_data (struct cob_inspect_state *st, const cob_field *str)
+static void
+inspect_plan_init (struct inspect_plan *plan, const cob_field *str,
+		   const size_t area_len)
 {
-	const unsigned char *data = str->data;
+	const unsigned char	*pat = str->data;
 	const size_t	len = str->size;
 
-	register unsigned char *p = st->start;
-	unsigned char *const end_p = st->end - len + 1;
+	plan->pat = pat;
+	plan->len = len;
+	plan->use_skip = len >= INSPECT_SKIP_MIN && len <= 255
+		&& area_len >= INSPECT_SKIP_AREA && area_len > 2 * len;
+	if (plan->use_skip) {
+		size_t	i;
+		memset (plan->skip, (int)len, sizeof (plan->skip));
+		for (i = 0; i < len - 1; ++i) {
+			plan->skip[pat[i]] = (unsigned char)(len - 1 - i);
+		}
+	}
+}
 
-	if (p > end_p) {
+/* find the first occurrence of the plan's pattern in p .. end */
+static unsigned char *
+inspect_plan_find (const struct inspect_plan *plan,
+		   unsigned char *p, unsigned char *const end)
+{
+	const unsigned char	*pat = plan->pat;
+	const size_t	len = plan->len;
+	unsigned char	*last;
+
+	if (len == 0 || p >= end || (size_t)(end - p) < len) {
+		return NULL;
+	}
+	last = end - len;	/* last possible start position */
+
+	if (plan->use_skip) {
+		const unsigned char	pat_last = pat[len - 1];
+		while (p <= last) {
+			const unsigned char	c = p[len - 1];
+			if (c == pat_last
+			 && memcmp (p, pat, len - 1) == 0) {
+				return p;
+			}
+			p += plan->skip[c];
+		}
 		return NULL;
 	}
 
-	while (p != end_p) {
-		if (memcmp (p, data, len) == 0) {
+	while (p <= last) {
+		p = memchr (p, *pat, (size_t)(last - p) + 1);
+		if (p == NULL) {
+			return NULL;
+		}
+		if (len == 1
+		 || memcmp (p + 1, pat + 1, len - 1) == 0) {
 			return p;
 		}
 		p++;
@@ -225,6 +285,18 @@ inspect_find_data (struct cob_inspect_state *st, const cob_field *str)
 	return NULL;
 }
 
+static unsigned char *
+inspect_find_data (struct cob_inspect_state *st, const cob_field *str)
+{
+	struct inspect_plan	plan;
+
+	if (str->size == 0) {
+		return st->start;
+	}
+	inspect_plan_init (&plan, str, (size_t)(st->end - st->start));
+	return inspect_plan_find (&plan, st->start, st->end);
+}
+
 static COB_INLINE COB_A_INLINE void
 set_inspect_mark (
 	struct cob_inspect_state *st,
@@ -330,21 +402,24 @@ inspect_common_no_replace (
 	/* note: same code as for LEADING, moved out as we don't need to check
 	   LEADING for _every_ byte in that tight loop */
 	} else {
-		const size_t	i_max = len - f2->size + 1;
-		for (i = 0; i < i_max; ++i) {
-			/* Find matching substring */
-			if (memcmp (i + st->start, f2->data, f2->size) == 0) {
-				const size_t checked_pos = pos + i;
-				/* when not marked yet: count, mark and skip handled positions */
-				if (!is_marked (st, checked_pos, f2->size)) {
-					n++;
-					/* set the marker so we won't iterate over this area again */
-					set_inspect_mark (st, checked_pos, f2->size);
-					if (st->type == INSPECT_FIRST) {
-						break;
-					}
-					i += f2->size - 1;
+		unsigned char	*const end = st->start + len;
+		unsigned char	*p = st->start;
+		struct inspect_plan	plan;
+		inspect_plan_init (&plan, f2, len);
+		/* Find matching substrings */
+		while ((p = inspect_plan_find (&plan, p, end)) != NULL) {
+			const size_t checked_pos = pos + (p - st->start);
+			/* when not marked yet: count, mark and skip handled positions */
+			if (!is_marked (st, checked_pos, f2->size)) {
+				n++;
+				/* set the marker so we won't iterate over this area again */
+				set_inspect_mark (st, checked_pos, f2->size);
+				if (st->type == INSPECT_FIRST) {
+					break;
 				}
+				p += f2->size;
+			} else {
+				p++;
 			}
 		}
 	}
@@ -421,17 +496,20 @@ inspect_common_replacing (
 	/* note: same code as for LEADING, moved out as we don't need to check
 	   LEADING for _every_ byte in that tight loop */
 	} else {
-		const size_t	i_max = len - f2->size + 1;
-		for (i = 0; i < i_max; ++i) {
-			/* Find matching substring */
-			if (memcmp (i + st->start, f2->data, f2->size) == 0) {
-				/* when not marked yet: count, mark and skip handled positions */
-				if (do_mark (st, pos + i, f2->size, f1->data)) {
-					if (st->type == INSPECT_FIRST) {
-						break;
-					}
-					i += f2->size - 1;
+		unsigned char	*const end = st->start + len;
+		unsigned char	*p = st->start;
+		struct inspect_plan	plan;
+		inspect_plan_init (&plan, f2, len);
+		/* Find matching substrings */
+		while ((p = inspect_plan_find (&plan, p, end)) != NULL) {
+			/* when not marked yet: count, mark and skip handled positions */
+			if (do_mark (st, pos + (p - st->start), f2->size, f1->data)) {
+				if (st->type == INSPECT_FIRST) {
+					break;
 				}
+				p += f2->size;
+			} else {
+				p++;
 			}
 		}
 	}
@@ -721,6 +799,87 @@ cob_inspect_trailing (cob_field *f1, cob_field *f2)
 	cob_inspect_trailing_intern (&share_inspect_state, f1, f2);
 }
 
+#ifdef	COB_SIMD_SSE2
+/* CONVERTING that shifts up to INSPECT_MAX_RANGES ranges of consecutive
+   characters by a constant (like lower- to upper-case or digits to
+   letters) is done 16 bytes at a time; returns 0 if the operands
+   don't qualify, leaving the data untouched */
+#define INSPECT_MAX_RANGES	4
+
+static int
+inspect_convert_ranges (unsigned char *p, size_t len,
+	const unsigned char *from, const unsigned char *to, const size_t size)
+{
+	__m128i		lo[INSPECT_MAX_RANGES];
+	__m128i		width[INSPECT_MAX_RANGES];
+	__m128i		delta[INSPECT_MAX_RANGES];
+	unsigned int	r_lo[INSPECT_MAX_RANGES];
+	unsigned int	r_hi[INSPECT_MAX_RANGES];
+	int		n = 0;
+	int		m = 0;
+	size_t		i = 0;
+
+	/* split the operands into ranges */
+	while (i < size) {
+		const unsigned int	first = from[i];
+		const unsigned char	d = (unsigned char)(to[i] - from[i]);
+		int		k;
+		for (i++; i < size
+		 && from[i] == from[i - 1] + 1
+		 && (unsigned char)(to[i] - from[i]) == d; i++);
+		if (m == INSPECT_MAX_RANGES) {
+			return 0;
+		}
+		/* the first occurrence of a character counts,
+		   so overlapping ranges need the table */
+		for (k = 0; k < m; k++) {
+			if (first <= r_hi[k] && from[i - 1] >= r_lo[k]) {
+				return 0;
+			}
+		}
+		r_lo[m] = first;
+		r_hi[m] = from[i - 1];
+		m++;
+		if (d == 0) {
+			/* converting to itself */
+			continue;
+		}
+		lo[n] = _mm_set1_epi8 ((char)first);
+		width[n] = _mm_set1_epi8 ((char)(from[i - 1] - first));
+		delta[n] = _mm_set1_epi8 ((char)d);
+		n++;
+	}
+
+	while (len) {
+		unsigned char	buff[16];
+		unsigned char	*q = p;
+		__m128i		v, add;
+		int		k;
+		if (len < 16) {
+			memcpy (buff, p, len);
+			q = buff;
+		}
+		v = _mm_loadu_si128 ((const __m128i *)q);
+		add = _mm_setzero_si128 ();
+		for (k = 0; k < n; k++) {
+			/* v - lo <= width (unsigned) -> v in range */
+			const __m128i	t = _mm_sub_epi8 (v, lo[k]);
+			const __m128i	in = _mm_cmpeq_epi8 (
+					_mm_min_epu8 (t, width[k]), t);
+			add = _mm_or_si128 (add, _mm_and_si128 (in, delta[k]));
+		}
+		_mm_storeu_si128 ((__m128i *)q, _mm_add_epi8 (v, add));
+		if (len < 16) {
+			memcpy (p, buff, len);
+			break;
+		}
+		p += 16;
+		len -= 16;
+	}
+	return 1;
+}
+#endif
+
 static void
 cob_inspect_converting_intern (
 	struct cob_inspect_state *st,
@@ -752,6 +911,13 @@ cob_inspect_converting_intern (
 		}
 	}
 
+#ifdef	COB_SIMD_SSE2
+	if (len >= 16
+	 && inspect_convert_ranges (st->start, len, f1->data, f2->data, f1->size)) {
+		goto end;
+	}
+#endif
+
 	/* test _all_ positions of the inspect target against
 	   all entries of CONVERTING position by position */
 	{
@@ -1032,7 +1198,6 @@ cob_unstring_init_intern (
 	st->offset = 0;
 	st->count = 0;
 	st->ndlms = 0;
-	st->dlm_list_size = 0;
 	cobglobptr->cob_exception_code = 0;
 	if (num_dlm > st->dlm_list_size) {
 		if (st->dlm_list) {
@@ -1045,6 +1210,10 @@ cob_unstring_init_intern (
 		}
 		st->dlm_list = cob_malloc (st->dlm_list_size * sizeof(struct dlm_struct));
 	}
+	st->dlm_map = num_dlm > 1;
+	if (st->dlm_map) {
+		memset (st->dlm_first, 0, sizeof (st->dlm_first));
+	}
 
 	if (st->ptr) {
 		st->offset = cob_get_int (st->ptr) - 1;
@@ -1066,6 +1235,14 @@ cob_unstring_init (
 static void
 cob_unstring_delimited_intern (struct cob_unstring_state *st, cob_field *dlm, const cob_u32_t all)
 {
+	/* map the first byte of the delimiters for a fast search */
+	if (st->dlm_map) {
+		if (dlm->size == 0 || st->ndlms >= 255) {
+			st->dlm_map = 0;
+		} else if (st->dlm_first[*dlm->data] == 0) {
+			st->dlm_first[*dlm->data] = (unsigned char)(st->ndlms + 1);
+		}
+	}
 	st->dlm_list[st->ndlms].uns_dlm = *dlm;
 	st->dlm_list[st->ndlms].uns_all = all;
 	st->ndlms++;
@@ -1132,6 +1309,12 @@ cob_unstring_into_intern (
 			dp = dlms.uns_dlm.data;
 
 			for (p = start; p < s; ++p) {
+				if (dlsize > 0) {
+					p = memchr (p, *dp, (size_t)(s - p));
+					if (p == NULL) {
+						break;
+					}
+				}
 				if (!memcmp (p, dp, (size_t)dlsize)) {         /* delimiter matches */
 					match_size = (int)(p - start);             /* count in */
 					cob_str_memcpy (dst, start, match_size);   /* into */
@@ -1154,11 +1337,22 @@ cob_unstring_into_intern (
 			const unsigned char *s = st->src->data + srsize;
 			int		i;
 			for (p = start; p < s; ++p) {
-				for (i = 0; i < st->ndlms; ++i) {
+				/* only check the delimiters starting with that byte,
+				   in the order they were specified */
+				if (st->dlm_map) {
+					i = st->dlm_first[*p];
+					if (i == 0) {
+						continue;
+					}
+					i--;
+				} else {
+					i = 0;
+				}
+				for (; i < st->ndlms; ++i) {
 					const struct dlm_struct dlms = st->dlm_list[i];
 					const int     dlsize = (int)dlms.uns_dlm.size;
 					const unsigned char *s2 = s - dlsize + 1;
-					if (p > s2) {
+					if (p >= s2) {
 						continue;
 					}
 					dp = dlms.uns_dlm.data;